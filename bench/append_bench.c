@@ -0,0 +1,60 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "filesys.h"
+#include "utility.h"
+#include "bench_util.h"
+
+// cost of appending small records as a file grows.
+//
+// usage: append_bench [file_mib]
+// appends 100 byte records until the file reaches `file_mib` MiB (default 64) and reports
+// the average time per append for each eighth of the run. with the append tail cached the
+// last eighth should cost the same as the first.
+
+#define RECORD_SIZE 100
+#define WINDOWS 8
+
+int main(int argc, char *argv[])
+{
+    size_t file_mib = argc > 1 ? strtoul(argv[1], NULL, 10) : 64;
+    if (file_mib == 0) file_mib = 1;
+    size_t file_size = file_mib << 20;
+    size_t records = file_size / RECORD_SIZE;
+
+    filesystem_t fs;
+    if (new_filesystem(&fs, 16, bench_dblocks(file_size) + 64) != SUCCESS)
+    {
+        puts("cannot allocate the file system");
+        return 1;
+    }
+    inode_t *inode = bench_new_data_inode(&fs);
+
+    char record[RECORD_SIZE];
+    bench_fill_text(record, RECORD_SIZE, 3);
+
+    printf("appending %lu records of %d bytes up to %lu MiB\n", records, RECORD_SIZE, file_mib);
+    size_t per_window = records / WINDOWS;
+    double total_start = bench_now();
+    for (size_t w = 0; w < WINDOWS; ++w)
+    {
+        double start = bench_now();
+        for (size_t r = 0; r < per_window; ++r)
+        {
+            if (inode_write_data(&fs, inode, record, RECORD_SIZE) != SUCCESS)
+            {
+                puts("append failed");
+                return 1;
+            }
+        }
+        double seconds = bench_now() - start;
+        printf("file at %7.2f MiB: %7.1f ns per append\n",
+            (double) inode->internal.file_size / MIB, seconds / (double) per_window * 1e9);
+    }
+    printf("total: %.2f s, %.1f MiB/s\n", bench_now() - total_start,
+        (double) inode->internal.file_size / MIB / (bench_now() - total_start));
+
+    free_filesystem(&fs);
+    return 0;
+}
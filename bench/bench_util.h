@@ -0,0 +1,98 @@
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+
+#include <time.h>
+#include <string.h>
+
+#include "filesys.h"
+#include "utility.h"
+
+#define MIB (1024.0 * 1024.0)
+
+// monotonic wall clock in seconds
+static inline double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+// dblocks needed to hold `size` bytes on an image with the default block size
+static inline size_t bench_dblocks(size_t size)
+{
+    filesystem_t geometry = { .block_shift = __builtin_ctzll(DEFAULT_DATA_BLOCK_SIZE) };
+    return calculate_necessary_dblock_amount(&geometry, size);
+}
+
+// claims an empty data file inode without linking it into a directory
+static inline inode_t *bench_new_data_inode(filesystem_t *fs)
+{
+    inode_index_t index;
+    if (claim_available_inode(fs, &index) != SUCCESS) return NULL;
+    inode_t *inode = &fs->inodes[index];
+    memset(inode, 0, sizeof(*inode));
+    inode->internal.file_type = DATA_FILE;
+    inode->internal.file_perms = FS_READ | FS_WRITE;
+    return inode;
+}
+
+// length of `name` as stored in a directory entry
+static inline size_t bench_name_length(const char *name)
+{
+    size_t len = strlen(name);
+    return len < MAX_FILE_NAME_LEN ? len : MAX_FILE_NAME_LEN;
+}
+
+// appends a directory entry for `inode` named `name` to `dir`
+static inline fs_retcode_t bench_add_entry(filesystem_t *fs, inode_t *dir, inode_t *inode, const char *name)
+{
+    byte entry[WIDE_DIRECTORY_ENTRY_SIZE] = { 0 };
+    inode_index_t index = inode - fs->inodes;
+    memcpy(entry, &index, fs->index_width);
+    memcpy(entry + fs->index_width, name, bench_name_length(name));
+    return inode_write_data(fs, dir, entry, DIRECTORY_ENTRY_SIZE(fs));
+}
+
+// creates an empty data file named `name` in the root directory so it can be opened with `fs_open`
+static inline inode_t *bench_new_file(filesystem_t *fs, const char *name)
+{
+    inode_t *inode = bench_new_data_inode(fs);
+    if (!inode) return NULL;
+    memcpy(inode->internal.file_name, name, bench_name_length(name));
+    if (bench_add_entry(fs, &fs->inodes[0], inode, name) != SUCCESS) return NULL;
+    return inode;
+}
+
+// creates a directory named `name` with its `.` and `..` entries in `parent`
+static inline inode_t *bench_new_directory(filesystem_t *fs, inode_t *parent, const char *name)
+{
+    inode_t *dir = bench_new_data_inode(fs);
+    if (!dir) return NULL;
+    dir->internal.file_type = DIRECTORY;
+    memcpy(dir->internal.file_name, name, bench_name_length(name));
+    if (bench_add_entry(fs, dir, dir, ".") != SUCCESS) return NULL;
+    if (bench_add_entry(fs, dir, parent, "..") != SUCCESS) return NULL;
+    if (bench_add_entry(fs, parent, dir, name) != SUCCESS) return NULL;
+    return dir;
+}
+
+// fills a buffer with english like text from a fixed vocabulary
+static inline void bench_fill_text(char *buf, size_t n, unsigned seed)
+{
+    static const char *words[] = {
+        "the", "file", "system", "block", "inode", "is", "a", "of", "to", "and", "data", "this",
+        "assignment", "anyway", "interesting", "pleasure", "directory", "entry", "index", "write",
+        "read", "secret", "I", "you", "will", "not", "long", "cool", "learn", "characters"
+    };
+    size_t word_count = sizeof(words) / sizeof(words[0]);
+    size_t pos = 0;
+    while (pos < n)
+    {
+        seed = seed * 1103515245u + 12345u;
+        const char *word = words[(seed >> 16) % word_count];
+        for (size_t i = 0; word[i] && pos < n; ++i) buf[pos++] = word[i];
+        if (pos < n) buf[pos++] = ((seed >> 8) % 11 == 0) ? '.' : ' ';
+    }
+}
+
+#endif
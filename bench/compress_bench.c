@@ -0,0 +1,144 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "filesys.h"
+#include "utility.h"
+#include "compress.h"
+#include "bench_util.h"
+
+// compression ratio and throughput of compressed data files on text content.
+//
+// usage: compress_bench [path_to_text_image]
+// the image defaults to input/medium_text.bin. every data file of the image is compressed,
+// then synthetic text files of increasing size are measured.
+
+#define READ_SIZE 4096
+#define SMALL_READ_SIZE 64
+
+static size_t used_dblocks(inode_t *inode)
+{
+    return bench_dblocks(inode->internal.file_size);
+}
+
+static double sequential_read(filesystem_t *fs, inode_t *inode, size_t logical_size, byte *buf, int rounds)
+{
+    double start = bench_now();
+    for (int r = 0; r < rounds; ++r)
+    {
+        for (size_t offset = 0; offset < logical_size; offset += READ_SIZE)
+        {
+            size_t bytes_read = 0;
+            inode_read_data(fs, inode, offset, buf, READ_SIZE, &bytes_read);
+        }
+    }
+    return (double) logical_size * rounds / MIB / (bench_now() - start);
+}
+
+static double small_random_read(filesystem_t *fs, inode_t *inode, size_t logical_size, byte *buf, size_t reads)
+{
+    unsigned seed = 7;
+    double start = bench_now();
+    for (size_t i = 0; i < reads; ++i)
+    {
+        seed = seed * 1103515245u + 12345u;
+        size_t bytes_read = 0;
+        inode_read_data(fs, inode, seed % logical_size, buf, SMALL_READ_SIZE, &bytes_read);
+    }
+    return (double) reads / (bench_now() - start) / 1e6;
+}
+
+static void bench_image(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        printf("%s not found, skipping\n", path);
+        return;
+    }
+    filesystem_t fs;
+    if (load_filesystem(file, &fs) != SUCCESS)
+    {
+        fclose(file);
+        printf("%s could not be loaded\n", path);
+        return;
+    }
+    fclose(file);
+
+    printf("%s\n", path);
+    printf("  %-16s %10s %10s %10s\n", "file", "bytes", "raw blks", "lz blks");
+    size_t total_raw = 0, total_lz = 0;
+    for (size_t i = 0; i < fs.inode_count; ++i)
+    {
+        inode_t *inode = &fs.inodes[i];
+        // skip free inodes and directories
+        if (inode->internal.file_type != DATA_FILE || inode->internal.file_perms > (FS_READ | FS_WRITE | FS_EXECUTE)) continue;
+        if (inode->internal.file_size == 0) continue;
+
+        char name[MAX_FILE_NAME_LEN + 1] = { 0 };
+        memcpy(name, inode->internal.file_name, MAX_FILE_NAME_LEN);
+        size_t raw = used_dblocks(inode);
+        inode_compress_data(&fs, inode);
+        size_t lz = used_dblocks(inode);
+        total_raw += raw;
+        total_lz += lz;
+        printf("  %-16s %10zu %10zu %10zu\n", name, inode_data_size(&fs, inode), raw, lz);
+    }
+    printf("  total dblocks %zu -> %zu\n\n", total_raw, total_lz);
+    free_filesystem(&fs);
+}
+
+static void bench_synthetic(size_t size)
+{
+    size_t dblocks = bench_dblocks(size) * 2 + 64;
+    filesystem_t fs;
+    new_filesystem(&fs, 4, dblocks);
+    inode_t *inode = bench_new_data_inode(&fs);
+
+    char *text = malloc(size);
+    byte *buf = malloc(READ_SIZE);
+    byte *check = malloc(size);
+    bench_fill_text(text, size, 42);
+    inode_write_data(&fs, inode, text, size);
+
+    int rounds = size < (1 << 20) ? 64 : 4;
+    size_t small_reads = 200000;
+    double raw_seq = sequential_read(&fs, inode, size, buf, rounds);
+    double raw_small = small_random_read(&fs, inode, size, buf, small_reads);
+    size_t raw_blocks = used_dblocks(inode);
+
+    double start = bench_now();
+    inode_compress_data(&fs, inode);
+    double compress_mbs = (double) size / MIB / (bench_now() - start);
+    size_t lz_blocks = used_dblocks(inode);
+
+    double lz_seq = sequential_read(&fs, inode, size, buf, rounds);
+    double lz_small = small_random_read(&fs, inode, size, buf, small_reads);
+
+    size_t bytes_read = 0;
+    inode_read_data(&fs, inode, 0, check, size, &bytes_read);
+    int intact = bytes_read == size && memcmp(check, text, size) == 0;
+
+    start = bench_now();
+    inode_decompress_data(&fs, inode);
+    double decompress_mbs = (double) size / MIB / (bench_now() - start);
+
+    printf("%8zu KiB  ratio %5.2fx (%zu -> %zu dblocks)  compress %7.1f MiB/s  decompress %7.1f MiB/s\n",
+        size / 1024, (double) raw_blocks / (double) lz_blocks, raw_blocks, lz_blocks, compress_mbs, decompress_mbs);
+    printf("              seq read raw %7.1f MiB/s  lz %7.1f MiB/s   64B random read raw %5.2f M/s  lz %5.2f M/s  %s\n",
+        raw_seq, lz_seq, raw_small, lz_small, intact ? "ok" : "MISMATCH");
+
+    free(text);
+    free(buf);
+    free(check);
+    free_filesystem(&fs);
+}
+
+int main(int argc, char *argv[])
+{
+    bench_image(argc > 1 ? argv[1] : "input/medium_text.bin");
+
+    size_t sizes[] = { 16 * 1024, 256 * 1024, 4 * 1024 * 1024 };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) bench_synthetic(sizes[i]);
+    return 0;
+}
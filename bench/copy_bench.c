@@ -0,0 +1,92 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "filesys.h"
+#include "utility.h"
+#include "bench_util.h"
+
+// copying a file inside the file system with `fs_copy` against the `fs_read` + `fs_write`
+// round trip through a buffer the size of the file that a caller would otherwise use.
+//
+// usage: copy_bench [file_mib] [copies]
+// writes one file of `file_mib` MiB (default 16) and copies it `copies` times (default 8)
+// each way. the data of the first copies is released in between so both runs claim the
+// same dblocks.
+
+#define DEFAULT_FILE_MIB 16
+#define DEFAULT_COPIES 8
+
+int main(int argc, char *argv[])
+{
+    size_t file_mib = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_FILE_MIB;
+    size_t copies = argc > 2 ? strtoul(argv[2], NULL, 10) : DEFAULT_COPIES;
+    if (file_mib == 0) file_mib = 1;
+    if (copies == 0) copies = 1;
+    if (copies > 99) copies = 99;
+
+    size_t file_size = file_mib << 20;
+    size_t dblocks = bench_dblocks(file_size) * (copies + 1) + 16;
+    filesystem_t fs;
+    if (new_filesystem(&fs, 2 * copies + 2, dblocks) != SUCCESS)
+    {
+        puts("cannot allocate the file system");
+        return 1;
+    }
+    terminal_context_t context;
+    new_terminal(&fs, &context);
+
+    char *data = malloc(file_size);
+    if (!data)
+    {
+        puts("out of memory");
+        return 1;
+    }
+    bench_fill_text(data, file_size, 3);
+    inode_t *src = bench_new_file(&fs, "src");
+    if (!src || inode_write_data(&fs, src, data, file_size) != SUCCESS)
+    {
+        puts("cannot write the source file");
+        return 1;
+    }
+
+    // buffered copy: read the whole file into a buffer and write it to a new file
+    char name[8];
+    inode_t *targets[99];
+    double start = bench_now();
+    for (size_t c = 0; c < copies; ++c)
+    {
+        snprintf(name, sizeof(name), "b%lu", c);
+        targets[c] = bench_new_file(&fs, name);
+        struct fs_file in = { &fs, src, 0 };
+        struct fs_file out = { &fs, targets[c], 0 };
+        if (!targets[c] || fs_read(&in, data, file_size) != file_size || fs_write(&out, data, file_size) != file_size)
+        {
+            puts("buffered copy failed");
+            return 1;
+        }
+    }
+    double buffered = bench_now() - start;
+    for (size_t c = 0; c < copies; ++c) inode_release_data(&fs, targets[c]);
+
+    start = bench_now();
+    for (size_t c = 0; c < copies; ++c)
+    {
+        snprintf(name, sizeof(name), "c%lu", c);
+        if (fs_copy(&context, "src", name) != 0)
+        {
+            puts("fs_copy failed");
+            return 1;
+        }
+    }
+    double direct = bench_now() - start;
+
+    double total_mib = (double) (file_size * copies) / MIB;
+    printf("%lu copies of a %lu MiB file\n", copies, file_mib);
+    printf("  fs_read + fs_write %8.1f MiB/s\n", total_mib / buffered);
+    printf("  fs_copy            %8.1f MiB/s\n", total_mib / direct);
+
+    free(data);
+    free_filesystem(&fs);
+    return 0;
+}
@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "filesys.h"
+#include "utility.h"
+#include "bench_util.h"
+
+// path lookups that keep resolving the same few hundred paths, the case the dentry cache
+// is for.
+//
+// usage: dentry_bench [opens]
+// builds a tree of DIR_FANOUT * DIR_FANOUT directories holding FILES_PER_DIR files each and
+// opens `opens` (default 5000000) pseudo random files of it with `fs_open`.
+
+#define DEFAULT_OPENS 5000000
+#define DIR_FANOUT 4
+#define FILES_PER_DIR 20
+
+int main(int argc, char *argv[])
+{
+    size_t opens = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_OPENS;
+    if (opens == 0) opens = 1;
+
+    size_t dirs = DIR_FANOUT + DIR_FANOUT * DIR_FANOUT;
+    size_t files = DIR_FANOUT * DIR_FANOUT * FILES_PER_DIR;
+    filesystem_t fs;
+    if (new_filesystem(&fs, dirs + files + 1, 64 * (dirs + 1)) != SUCCESS)
+    {
+        puts("cannot allocate the file system");
+        return 1;
+    }
+    terminal_context_t context;
+    new_terminal(&fs, &context);
+
+    char name[MAX_FILE_NAME_LEN + 1];
+    for (size_t i = 0; i < DIR_FANOUT; ++i)
+    {
+        sprintf(name, "dir%zu", i);
+        inode_t *top = bench_new_directory(&fs, &fs.inodes[0], name);
+        for (size_t j = 0; top && j < DIR_FANOUT; ++j)
+        {
+            sprintf(name, "sub%zu", j);
+            inode_t *sub = bench_new_directory(&fs, top, name);
+            for (size_t k = 0; sub && k < FILES_PER_DIR; ++k)
+            {
+                sprintf(name, "file%zu.txt", k);
+                inode_t *file = bench_new_data_inode(&fs);
+                if (!file || bench_add_entry(&fs, sub, file, name) != SUCCESS) sub = NULL;
+            }
+            if (!sub) top = NULL;
+        }
+        if (!top)
+        {
+            puts("cannot create the tree");
+            return 1;
+        }
+    }
+
+    char path[64];
+    unsigned seed = 42;
+    double start = bench_now();
+    for (size_t n = 0; n < opens; ++n)
+    {
+        seed = seed * 1103515245u + 12345u;
+        size_t f = (seed >> 8) % files;
+        sprintf(path, "dir%zu/sub%zu/file%zu.txt", f / (DIR_FANOUT * FILES_PER_DIR), f / FILES_PER_DIR % DIR_FANOUT, f % FILES_PER_DIR);
+        fs_file_t file = fs_open(&context, path);
+        if (!file)
+        {
+            printf("cannot open %s\n", path);
+            return 1;
+        }
+        fs_close(file);
+    }
+    double seconds = bench_now() - start;
+
+    dentry_cache_stats_t stats;
+    fs_dentry_cache_stats(&fs, &stats);
+    printf("%zu opens of %zu paths: %.0f opens/s\n", opens, files, (double) opens / seconds);
+    printf("dentry cache: %zu hits, %zu misses\n", stats.hits, stats.misses);
+
+    free_filesystem(&fs);
+    return 0;
+}
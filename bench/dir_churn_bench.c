@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "filesys.h"
+#include "utility.h"
+#include "bench_util.h"
+
+// file creation in large directories full of tombstones, where a new entry has to find a
+// free slot.
+//
+// usage: dir_churn_bench [rounds]
+// for directory sizes of 1000, 10000 and 50000 files, fills the root directory with
+// `new_file` and then runs `rounds` (default 2000) rounds that remove CHURN_BATCH random
+// files with `remove_file` and create as many new ones, which take the freed slots.
+
+#define DEFAULT_ROUNDS 2000
+#define CHURN_BATCH 64
+
+int main(int argc, char *argv[])
+{
+    size_t rounds = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_ROUNDS;
+    if (rounds == 0) rounds = 1;
+
+    static const size_t sizes[] = { 1000, 10000, 50000 };
+    printf("%10s %14s %14s\n", "entries", "removes/s", "creates/s");
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+    {
+        size_t entries = sizes[s];
+        filesystem_t fs;
+        if (new_filesystem(&fs, entries + 1, bench_dblocks((entries + 1) * WIDE_DIRECTORY_ENTRY_SIZE)) != SUCCESS)
+        {
+            puts("cannot allocate the file system");
+            return 1;
+        }
+        terminal_context_t context;
+        new_terminal(&fs, &context);
+
+        // the numbers in the names of the files that exist
+        size_t *live = malloc(entries * sizeof(size_t));
+        if (!live)
+        {
+            puts("cannot allocate the file list");
+            return 1;
+        }
+        // room for any size_t, the names used stay below MAX_FILE_NAME_LEN
+        char name[24];
+        for (size_t i = 0; i < entries; ++i)
+        {
+            live[i] = i;
+            sprintf(name, "f%zu", i);
+            if (new_file(&context, name, FS_READ | FS_WRITE) != 0)
+            {
+                printf("cannot create %s\n", name);
+                return 1;
+            }
+        }
+
+        size_t next = entries;
+        unsigned seed = 42;
+        double remove_seconds = 0, create_seconds = 0;
+        for (size_t round = 0; round < rounds; ++round)
+        {
+            // a partial shuffle moves the files to remove to the front of `live`
+            for (size_t k = 0; k < CHURN_BATCH; ++k)
+            {
+                seed = seed * 1103515245u + 12345u;
+                size_t j = k + (seed >> 4) % (entries - k);
+                size_t swap = live[k];
+                live[k] = live[j];
+                live[j] = swap;
+            }
+
+            double start = bench_now();
+            for (size_t k = 0; k < CHURN_BATCH; ++k)
+            {
+                sprintf(name, "f%zu", live[k]);
+                if (remove_file(&context, name) != 0)
+                {
+                    printf("cannot remove %s\n", name);
+                    return 1;
+                }
+            }
+            remove_seconds += bench_now() - start;
+
+            start = bench_now();
+            for (size_t k = 0; k < CHURN_BATCH; ++k)
+            {
+                live[k] = next++;
+                sprintf(name, "f%zu", live[k]);
+                if (new_file(&context, name, FS_READ | FS_WRITE) != 0)
+                {
+                    printf("cannot create %s\n", name);
+                    return 1;
+                }
+            }
+            create_seconds += bench_now() - start;
+        }
+
+        double ops = (double) rounds * CHURN_BATCH;
+        printf("%10zu %14.0f %14.0f\n", entries, ops / remove_seconds, ops / create_seconds);
+        free(live);
+        free_filesystem(&fs);
+    }
+    return 0;
+}
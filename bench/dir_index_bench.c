@@ -0,0 +1,72 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "filesys.h"
+#include "utility.h"
+#include "bench_util.h"
+
+// file creation and lookup rates in one large directory, which should not depend on the
+// number of entries once the directory has a hash index.
+//
+// usage: dir_index_bench [max_entries]
+// for directory sizes of 1000, 10000, ... up to `max_entries` (default 100000, capped by the
+// inodes of the build), fills the root directory of a new file system with `new_file` and
+// then opens every file once in a pseudo random order with `fs_open`.
+
+#define DEFAULT_MAX_ENTRIES 100000
+
+int main(int argc, char *argv[])
+{
+    size_t max_entries = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_MAX_ENTRIES;
+    if (max_entries < 1000) max_entries = 1000;
+    if (max_entries > INODE_INDEX_MAX) max_entries = INODE_INDEX_MAX;
+
+    printf("%10s %14s %14s\n", "entries", "creates/s", "opens/s");
+    for (size_t entries = 1000; ; entries *= 10)
+    {
+        if (entries > max_entries) entries = max_entries;
+        filesystem_t fs;
+        if (new_filesystem(&fs, entries + 1, bench_dblocks((entries + 1) * WIDE_DIRECTORY_ENTRY_SIZE)) != SUCCESS)
+        {
+            puts("cannot allocate the file system");
+            return 1;
+        }
+        terminal_context_t context;
+        new_terminal(&fs, &context);
+
+        char name[MAX_FILE_NAME_LEN + 1];
+        double start = bench_now();
+        for (size_t i = 0; i < entries; ++i)
+        {
+            sprintf(name, "f%zu", i);
+            if (new_file(&context, name, FS_READ | FS_WRITE) != 0)
+            {
+                printf("cannot create %s\n", name);
+                return 1;
+            }
+        }
+        double create_seconds = bench_now() - start;
+
+        unsigned seed = 42;
+        start = bench_now();
+        for (size_t n = 0; n < entries; ++n)
+        {
+            seed = seed * 1103515245u + 12345u;
+            sprintf(name, "f%zu", (size_t) (seed >> 4) % entries);
+            fs_file_t file = fs_open(&context, name);
+            if (!file)
+            {
+                printf("cannot open %s\n", name);
+                return 1;
+            }
+            fs_close(file);
+        }
+        double open_seconds = bench_now() - start;
+
+        printf("%10zu %14.0f %14.0f\n", entries, (double) entries / create_seconds, (double) entries / open_seconds);
+        free_filesystem(&fs);
+        if (entries == max_entries) break;
+    }
+    return 0;
+}
@@ -0,0 +1,64 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "filesys.h"
+#include "utility.h"
+#include "bench_util.h"
+
+// lookups in directories too small for a hash index, which scan the entries of the
+// directory, on a workload that keeps the dentry cache from answering them.
+//
+// usage: entry_scan_bench [rounds]
+// fills DIR_COUNT directories with FILES_PER_DIR files each and runs `rounds` (default
+// 2000000) rounds that remove a pseudo random file with `remove_file` and create it again
+// with `new_file`. both change the directory, so the lookups of the next round scan it.
+
+#define DEFAULT_ROUNDS 2000000
+#define DIR_COUNT 64
+#define FILES_PER_DIR 60
+
+int main(int argc, char *argv[])
+{
+    size_t rounds = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_ROUNDS;
+    if (rounds == 0) rounds = 1;
+
+    filesystem_t fs;
+    if (new_filesystem(&fs, DIR_COUNT * (FILES_PER_DIR + 1) + 1, 8 * DIR_COUNT * (FILES_PER_DIR + 2)) != SUCCESS)
+    {
+        puts("cannot allocate the file system");
+        return 1;
+    }
+    terminal_context_t context;
+    new_terminal(&fs, &context);
+
+    char path[32];
+    for (size_t d = 0; d < DIR_COUNT; ++d)
+    {
+        sprintf(path, "dir%zu", d);
+        if (new_directory(&context, path) != 0) return 1;
+        for (size_t f = 0; f < FILES_PER_DIR; ++f)
+        {
+            sprintf(path, "dir%zu/file%zu.txt", d, f);
+            if (new_file(&context, path, FS_READ) != 0) return 1;
+        }
+    }
+
+    unsigned seed = 42;
+    double start = bench_now();
+    for (size_t n = 0; n < rounds; ++n)
+    {
+        seed = seed * 1103515245u + 12345u;
+        sprintf(path, "dir%zu/file%zu.txt", (size_t) (seed >> 8) % DIR_COUNT, (size_t) (seed >> 16) % FILES_PER_DIR);
+        if (remove_file(&context, path) != 0 || new_file(&context, path, FS_READ) != 0)
+        {
+            printf("cannot recreate %s\n", path);
+            return 1;
+        }
+    }
+    double seconds = bench_now() - start;
+
+    printf("%zu rounds in directories of %d files: %.0f rounds/s\n", rounds, FILES_PER_DIR, (double) rounds / seconds);
+    free_filesystem(&fs);
+    return 0;
+}
@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "filesys.h"
+#include "utility.h"
+#include "bench_util.h"
+
+// throughput and space overhead of dblocks of 64, 512 and 4096 bytes.
+//
+// usage: geometry_bench [file_count]
+// for each block size, writes `file_count` files (default 2048) with sizes spread
+// log-uniformly between 100 bytes and 1 MiB in 4 KiB writes, reads them back in 4 KiB
+// reads, and reports how many bytes of dblocks the file system needed per byte of data.
+// every block size gets the same files.
+
+#define DEFAULT_FILE_COUNT 2048
+#define MIN_FILE_SIZE 100.0
+#define MAX_FILE_SIZE 1048576.0
+#define IO_SIZE 4096
+
+static int run(const size_t *sizes, inode_t **files, size_t file_count, char *buffer, size_t block_size)
+{
+    // the dblocks needed follow from the geometry alone, so the file system is made just
+    // large enough
+    filesystem_t fs;
+    if (new_filesystem_geometry(&fs, 1, 1, block_size) != SUCCESS) return 1;
+    size_t data_bytes = 0, dblocks_needed = 0;
+    for (size_t f = 0; f < file_count; ++f)
+    {
+        data_bytes += sizes[f];
+        dblocks_needed += calculate_necessary_dblock_amount(&fs, sizes[f]);
+    }
+    free_filesystem(&fs);
+    if (new_filesystem_geometry(&fs, file_count + 1, dblocks_needed + 1, block_size) != SUCCESS)
+    {
+        puts("cannot allocate the file system");
+        return 1;
+    }
+
+    double start = bench_now();
+    for (size_t f = 0; f < file_count; ++f)
+    {
+        files[f] = bench_new_data_inode(&fs);
+        for (size_t done = 0; done < sizes[f]; done += IO_SIZE)
+        {
+            size_t n = sizes[f] - done < IO_SIZE ? sizes[f] - done : IO_SIZE;
+            if (inode_write_data(&fs, files[f], buffer, n) != SUCCESS)
+            {
+                puts("write failed");
+                return 1;
+            }
+        }
+    }
+    double write_seconds = bench_now() - start;
+
+    size_t checksum = 0;
+    start = bench_now();
+    for (size_t f = 0; f < file_count; ++f)
+    {
+        size_t bytes_read;
+        for (size_t done = 0; done < sizes[f]; done += bytes_read)
+        {
+            if (inode_read_data(&fs, files[f], done, buffer, IO_SIZE, &bytes_read) != SUCCESS || bytes_read == 0)
+            {
+                puts("read failed");
+                return 1;
+            }
+            checksum += (byte) buffer[bytes_read - 1];
+        }
+    }
+    double read_seconds = bench_now() - start;
+
+    size_t used = fs.dblock_count - available_dblocks(&fs) - 1; // minus the root directory
+    size_t index_dblocks = 0;
+    for (size_t f = 0; f < file_count; ++f) index_dblocks += calculate_index_dblock_amount(&fs, sizes[f]);
+    size_t used_bytes = used * DATA_BLOCK_SIZE(&fs);
+
+    printf("block size %zu, %d direct blocks: %lu files, %.1f MiB of data\n",
+        DATA_BLOCK_SIZE(&fs), INODE_DIRECT_BLOCK_COUNT, file_count, (double) data_bytes / MIB);
+    printf("  write %8.1f MiB/s, read %8.1f MiB/s\n",
+        (double) data_bytes / MIB / write_seconds, (double) data_bytes / MIB / read_seconds);
+    printf("  space %.1f MiB of dblocks, %.3f bytes per data byte (index %.2f%%, slack %.2f%%)\n",
+        (double) used_bytes / MIB, (double) used_bytes / (double) data_bytes,
+        100.0 * (double) (index_dblocks * DATA_BLOCK_SIZE(&fs)) / (double) used_bytes,
+        100.0 * (double) ((used - index_dblocks) * DATA_BLOCK_SIZE(&fs) - data_bytes) / (double) used_bytes);
+    printf("  checksum %lu\n", checksum);
+
+    free_filesystem(&fs);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t file_count = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_FILE_COUNT;
+    if (file_count == 0) file_count = 1;
+    if (file_count > INODE_INDEX_MAX) file_count = INODE_INDEX_MAX;
+
+    size_t *sizes = malloc(file_count * sizeof(size_t));
+    inode_t **files = malloc(file_count * sizeof(inode_t*));
+    char *buffer = malloc(IO_SIZE);
+    if (!sizes || !files || !buffer)
+    {
+        puts("out of memory");
+        return 1;
+    }
+    unsigned seed = 42;
+    for (size_t f = 0; f < file_count; ++f)
+    {
+        seed = seed * 1103515245u + 12345u;
+        double t = (double) ((seed >> 8) & 0xFFFF) / 65536.0;
+        sizes[f] = (size_t) (MIN_FILE_SIZE * pow(MAX_FILE_SIZE / MIN_FILE_SIZE, t));
+    }
+    bench_fill_text(buffer, IO_SIZE, 11);
+
+    for (size_t block_size = 64; block_size <= 4096; block_size *= 8)
+    {
+        if (run(sizes, files, file_count, buffer, block_size) != 0) return 1;
+    }
+
+    free(buffer);
+    free(files);
+    free(sizes);
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "filesys.h"
+#include "utility.h"
+#include "bench_util.h"
+
+// file creation and path lookup rates with many files, for the inode index width the file
+// system takes.
+//
+// usage: inode_index_bench [file_count]
+// spreads `file_count` files (default 1000000) over a tree of directories holding at most
+// FANOUT entries each, creates them with `new_file` and then opens LOOKUP_COUNT of them in
+// a pseudo random order with `fs_open`. up to 65,536 inodes the file system keeps 2 byte
+// indices, past that it takes the wide format, so running it on both sides of that count
+// compares the widths.
+
+#define DEFAULT_FILE_COUNT 1000000
+#define FANOUT 128
+#define MAX_DEPTH 8
+#define LOOKUP_COUNT 1000000
+#define PATH_LEN (MAX_DEPTH * 5 + 1)
+
+// the path of file `i` in a tree of `depth` levels, e.g. "d3/d41/f7"
+static void file_path(char *buf, size_t i, size_t depth)
+{
+    size_t digits[MAX_DEPTH];
+    for (size_t k = 0; k < depth; ++k)
+    {
+        digits[k] = i % FANOUT;
+        i /= FANOUT;
+    }
+    char *end = buf;
+    for (size_t k = depth; k-- > 1;) end += sprintf(end, "d%zu/", digits[k]);
+    sprintf(end, "f%zu", digits[0]);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t file_count = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_FILE_COUNT;
+    if (file_count == 0) file_count = 1;
+    // leaves room for the directories
+    size_t max_files = INODE_INDEX_MAX - INODE_INDEX_MAX / (FANOUT / 2);
+    if (file_count > max_files) file_count = max_files;
+
+    size_t depth = 1, leaves = 1;
+    while (leaves * FANOUT < file_count && depth < MAX_DEPTH)
+    {
+        leaves *= FANOUT;
+        ++depth;
+    }
+    // a directory on level k holds FANOUT^k files
+    size_t directories = 0;
+    for (size_t width = FANOUT; width <= leaves; width *= FANOUT) directories += (file_count + width - 1) / width;
+
+    size_t dblocks = (directories + 1) * bench_dblocks((FANOUT + 2) * WIDE_DIRECTORY_ENTRY_SIZE) + 16;
+    filesystem_t fs;
+    if (new_filesystem(&fs, file_count + directories + 1, dblocks) != SUCCESS)
+    {
+        puts("cannot allocate the file system");
+        return 1;
+    }
+    terminal_context_t context;
+    new_terminal(&fs, &context);
+
+    // the directories are made up front so the timed loop only creates files
+    inode_t *dirs[MAX_DEPTH + 1];
+    dirs[depth] = &fs.inodes[0];
+    for (size_t i = 0; i < file_count; i += FANOUT)
+    {
+        // every level whose next directory starts at file `i` gets it, parents first
+        for (size_t k = depth - 1, width = leaves; k >= 1; --k, width /= FANOUT)
+        {
+            if (i % width != 0) continue;
+            char name[MAX_FILE_NAME_LEN + 1];
+            sprintf(name, "d%zu", (i / width) % FANOUT);
+            dirs[k] = bench_new_directory(&fs, dirs[k + 1], name);
+            if (!dirs[k])
+            {
+                puts("cannot create the directories");
+                return 1;
+            }
+        }
+    }
+
+    char path[PATH_LEN];
+    double start = bench_now();
+    for (size_t i = 0; i < file_count; ++i)
+    {
+        file_path(path, i, depth);
+        if (new_file(&context, path, FS_READ | FS_WRITE) != 0)
+        {
+            printf("cannot create %s\n", path);
+            return 1;
+        }
+    }
+    double create_seconds = bench_now() - start;
+
+    unsigned seed = 42;
+    start = bench_now();
+    for (size_t n = 0; n < LOOKUP_COUNT; ++n)
+    {
+        seed = seed * 1103515245u + 12345u;
+        size_t i = (((size_t) seed << 16) ^ (seed >> 8)) % file_count;
+        file_path(path, i, depth);
+        fs_file_t file = fs_open(&context, path);
+        if (!file)
+        {
+            printf("cannot open %s\n", path);
+            return 1;
+        }
+        fs_close(file);
+    }
+    double lookup_seconds = bench_now() - start;
+
+    printf("inode index width %zu bytes, %zu files in %zu directories\n", fs.index_width, file_count, directories + 1);
+    printf("create: %10.0f files/s\n", (double) file_count / create_seconds);
+    printf("lookup: %10.0f opens/s\n", LOOKUP_COUNT / lookup_seconds);
+
+    free_filesystem(&fs);
+    return 0;
+}
@@ -0,0 +1,95 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "filesys.h"
+#include "utility.h"
+#include "bench_util.h"
+
+// building a deep tree from a list of paths, with `fs_import_manifest` and with one
+// `fs_make_directories` and `new_file` call per path.
+//
+// usage: manifest_bench [files]
+// lists `files` (default 1000000) paths `t<i>/s<j>/f<k>` of FANOUT files in each of
+// FANOUT subdirectories per top directory, in a pseudo random order, and creates them in a
+// new file system both ways. the file system takes the wide format, so the tree can hold
+// a million files.
+
+#define DEFAULT_FILES 1000000
+#define FANOUT 100
+
+static int run(char **paths, size_t files, int bulk)
+{
+    // every directory of FANOUT entries and every top directory fits in a few dblocks
+    size_t dirs = files / FANOUT + files / (FANOUT * FANOUT) + 2;
+    filesystem_t fs;
+    if (new_filesystem(&fs, files + dirs + 1, dirs * (bench_dblocks((FANOUT + 2) * WIDE_DIRECTORY_ENTRY_SIZE) + 1)) != SUCCESS)
+    {
+        puts("cannot allocate the file system");
+        return 1;
+    }
+    terminal_context_t context;
+    new_terminal(&fs, &context);
+
+    double start = bench_now();
+    if (bulk)
+    {
+        if (fs_import_manifest(&context, paths, files, FS_READ | FS_WRITE) != 0) return 1;
+    }
+    else
+    {
+        char parent[32];
+        for (size_t n = 0; n < files; ++n)
+        {
+            // the directory part of the path
+            size_t len = strrchr(paths[n], '/') - paths[n];
+            memcpy(parent, paths[n], len);
+            parent[len] = '\0';
+            if (fs_make_directories(&context, parent) != 0 || new_file(&context, paths[n], FS_READ | FS_WRITE) != 0) return 1;
+        }
+    }
+    double seconds = bench_now() - start;
+
+    printf("%-10s %10zu %10.2f %14.0f\n", bulk ? "manifest" : "per path", files, seconds, (double) files / seconds);
+    free_filesystem(&fs);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t files = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_FILES;
+    if (files < FANOUT) files = FANOUT;
+    if (files > INODE_INDEX_MAX / 2) files = INODE_INDEX_MAX / 2;
+
+    char **paths = malloc(files * sizeof(char*));
+    char *names = malloc(files * 32);
+    if (!paths || !names)
+    {
+        puts("cannot allocate the manifest");
+        return 1;
+    }
+    for (size_t n = 0; n < files; ++n)
+    {
+        paths[n] = names + 32 * n;
+        sprintf(paths[n], "t%zu/s%zu/f%zu", n / (FANOUT * FANOUT), n / FANOUT % FANOUT, n % FANOUT);
+    }
+    unsigned seed = 42;
+    for (size_t n = files - 1; n > 0; --n)
+    {
+        seed = seed * 1103515245u + 12345u;
+        size_t other = (seed >> 4) % (n + 1);
+        char *swap = paths[n];
+        paths[n] = paths[other];
+        paths[other] = swap;
+    }
+
+    printf("%-10s %10s %10s %14s\n", "method", "files", "seconds", "files/s");
+    if (run(paths, files, 1) != 0 || run(paths, files, 0) != 0)
+    {
+        puts("cannot create the tree");
+        return 1;
+    }
+    free(names);
+    free(paths);
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "filesys.h"
+#include "utility.h"
+#include "bench_util.h"
+
+// streaming reads through fs_read on a fragmented file system, with and without read-ahead.
+//
+// usage: read_ahead_bench [image_mib] [file_count] [read_ahead_blocks]
+// fills an image of `image_mib` MiB (default 256) by appending one dblock at a time to a
+// randomly chosen file out of `file_count` (default 64), so consecutive blocks of a file
+// are scattered over the whole image. every file is then read front to back in chunks of
+// several sizes, once with read-ahead disabled and once with `read_ahead_blocks` (default 32).
+// the image should be larger than the last level cache for the prefetches to matter.
+
+#define DEFAULT_IMAGE_MIB 256
+#define DEFAULT_FILE_COUNT 64
+#define DEFAULT_READ_AHEAD_BLOCKS 32
+#define MAX_CHUNK 65536
+
+static double stream_files(filesystem_t *fs, inode_t **files, size_t file_count, size_t chunk, byte *buffer, size_t *checksum)
+{
+    size_t total = 0;
+    double start = bench_now();
+    for (size_t f = 0; f < file_count; ++f)
+    {
+        struct fs_file file = { fs, files[f], 0 };
+        size_t got;
+        while ((got = fs_read(&file, buffer, chunk)) > 0)
+        {
+            total += got;
+            *checksum += buffer[got - 1];
+        }
+    }
+    double seconds = bench_now() - start;
+    return (double) total / seconds / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t image_mib = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_IMAGE_MIB;
+    size_t file_count = argc > 2 ? strtoul(argv[2], NULL, 10) : DEFAULT_FILE_COUNT;
+    size_t read_ahead_blocks = argc > 3 ? strtoul(argv[3], NULL, 10) : DEFAULT_READ_AHEAD_BLOCKS;
+    if (image_mib == 0) image_mib = 1;
+    if (file_count == 0) file_count = 1;
+
+    size_t dblock_count = (image_mib << 20) / DEFAULT_DATA_BLOCK_SIZE;
+    filesystem_t fs;
+    if (new_filesystem(&fs, file_count + 1, dblock_count) != SUCCESS)
+    {
+        puts("cannot allocate the file system");
+        return 1;
+    }
+
+    inode_t **files = malloc(file_count * sizeof(inode_t*));
+    byte *buffer = malloc(MAX_CHUNK);
+    if (!files || !buffer)
+    {
+        puts("out of memory");
+        return 1;
+    }
+    for (size_t f = 0; f < file_count; ++f) files[f] = bench_new_data_inode(&fs);
+
+    // leave room for the index dblocks of every file
+    char block[DEFAULT_DATA_BLOCK_SIZE];
+    bench_fill_text(block, DEFAULT_DATA_BLOCK_SIZE, 7);
+    size_t appends = dblock_count - dblock_count / 8;
+    unsigned seed = 12345;
+    double start = bench_now();
+    for (size_t i = 0; i < appends; ++i)
+    {
+        seed = seed * 1103515245u + 12345u;
+        inode_t *inode = files[(seed >> 8) % file_count];
+        if (inode_write_data(&fs, inode, block, DEFAULT_DATA_BLOCK_SIZE) != SUCCESS) break;
+    }
+    printf("image: %lu MiB, %lu files of %.2f MiB on average, filled in %.2f s\n",
+        image_mib, file_count, (double) appends * DEFAULT_DATA_BLOCK_SIZE / MIB / (double) file_count, bench_now() - start);
+
+    size_t chunks[] = { DEFAULT_DATA_BLOCK_SIZE, 512, 4096, MAX_CHUNK };
+    size_t checksum = 0;
+    for (size_t c = 0; c < sizeof(chunks) / sizeof(chunks[0]); ++c)
+    {
+        fs.read_ahead_blocks = 0;
+        double off = stream_files(&fs, files, file_count, chunks[c], buffer, &checksum);
+        fs.read_ahead_blocks = read_ahead_blocks;
+        double on = stream_files(&fs, files, file_count, chunks[c], buffer, &checksum);
+        printf("%6lu byte reads: %6.2f GB/s without read-ahead, %6.2f GB/s with %lu blocks\n",
+            chunks[c], off, on, read_ahead_blocks);
+    }
+    printf("checksum %lu\n", checksum);
+
+    free(buffer);
+    free(files);
+    free_filesystem(&fs);
+    return 0;
+}
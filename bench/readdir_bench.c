@@ -0,0 +1,97 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "filesys.h"
+#include "utility.h"
+#include "bench_util.h"
+
+// reading a large directory with `fs_readdir` against reading it whole with `inode_read_data`.
+//
+// usage: readdir_bench [entries]
+// fills the root with `entries` (default 1000000) empty files and reads the directory three
+// ways: whole into one buffer, streamed to its end, and streamed up to its first file. every
+// way decodes the entries and looks up the type of what they link to. the memory each way
+// holds is printed next to its time. past 65,536 entries the file system takes the wide
+// format, so the directory can hold millions of them.
+
+#define DEFAULT_ENTRIES 1000000
+#define ROUNDS 5
+
+int main(int argc, char *argv[])
+{
+    size_t entries = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_ENTRIES;
+    if (entries < 1000) entries = 1000;
+    if (entries > INODE_INDEX_MAX - 1) entries = INODE_INDEX_MAX - 1;
+
+    filesystem_t fs;
+    if (new_filesystem(&fs, entries + 1, bench_dblocks((entries + 1) * WIDE_DIRECTORY_ENTRY_SIZE)) != SUCCESS)
+    {
+        puts("cannot allocate the file system");
+        return 1;
+    }
+    terminal_context_t context;
+    new_terminal(&fs, &context);
+
+    char name[24];
+    for (size_t i = 0; i < entries; ++i)
+    {
+        sprintf(name, "f%zu", i);
+        inode_t *file = bench_new_data_inode(&fs);
+        if (!file || bench_add_entry(&fs, &fs.inodes[0], file, name) != SUCCESS)
+        {
+            puts("cannot build the directory");
+            return 1;
+        }
+    }
+    inode_t *root = &fs.inodes[0];
+    size_t size = root->internal.file_size;
+    printf("%zu entries, %zu bytes of directory\n", entries, size);
+
+    double whole = 0, streamed = 0, first = 0;
+    size_t counted = 0, whole_counted = 0;
+    for (int round = 0; round < ROUNDS; ++round)
+    {
+        // the whole directory in one buffer, the way the entries used to be read
+        double start = bench_now();
+        byte *buffer = malloc(size);
+        size_t read = 0;
+        if (!buffer || inode_read_data(&fs, root, 0, buffer, size, &read) != SUCCESS) return 1;
+        // each entry is decoded and its type looked up, as `fs_readdir` does
+        whole_counted = 0;
+        for (size_t at = 0; at < read; at += DIRECTORY_ENTRY_SIZE(&fs))
+        {
+            inode_index_t index = 0;
+            memcpy(&index, buffer + at, fs.index_width);
+            if (buffer[at + fs.index_width] == '\0' || index >= fs.inode_count) continue;
+            whole_counted += fs.inodes[index].internal.file_type == DATA_FILE || fs.inodes[index].internal.file_type == DIRECTORY;
+        }
+        free(buffer);
+        whole += bench_now() - start;
+
+        start = bench_now();
+        fs_dir_t dir = fs_opendir(&context, (char[]) { "." });
+        fs_dirent_t entry;
+        counted = 0;
+        while (fs_readdir(dir, &entry)) ++counted;
+        fs_closedir(dir);
+        streamed += bench_now() - start;
+
+        start = bench_now();
+        dir = fs_opendir(&context, (char[]) { "." });
+        while (fs_readdir(dir, &entry) && entry.type != DATA_FILE) { }
+        fs_closedir(dir);
+        first += bench_now() - start;
+    }
+    if (counted != entries + 1 || whole_counted != entries + 1)
+    {
+        puts("the entries do not add up");
+        return 1;
+    }
+
+    printf("%-22s %12s %14s\n", "", "s", "bytes held");
+    printf("%-22s %12.6f %14zu\n", "whole directory", whole / ROUNDS, size);
+    printf("%-22s %12.6f %14s\n", "fs_readdir to the end", streamed / ROUNDS, "one handle");
+    printf("%-22s %12.9f %14s\n", "fs_readdir first file", first / ROUNDS, "one handle");
+    free_filesystem(&fs);
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "filesys.h"
+#include "utility.h"
+#include "bench_util.h"
+
+// removing a whole tree with `remove_tree`, against one `remove_file` or
+// `remove_directory` call per object, deepest objects first.
+//
+// usage: remove_tree_bench [files]
+// builds the tree `t<i>/s<j>/f<k>` of `files` (default 1000000) files, FANOUT per
+// subdirectory and FANOUT subdirectories per top directory, under one directory with
+// `fs_import_manifest`, and removes it both ways. the file system takes the wide format,
+// so the tree can hold a million files.
+
+#define DEFAULT_FILES 1000000
+#define FANOUT 100
+
+static int run(char **paths, size_t files, int whole)
+{
+    size_t dirs = files / FANOUT + files / (FANOUT * FANOUT) + 3;
+    filesystem_t fs;
+    if (new_filesystem(&fs, files + dirs + 1, dirs * (bench_dblocks((FANOUT + 2) * WIDE_DIRECTORY_ENTRY_SIZE) + 1)) != SUCCESS)
+    {
+        puts("cannot allocate the file system");
+        return 1;
+    }
+    terminal_context_t context;
+    new_terminal(&fs, &context);
+    if (fs_import_manifest(&context, paths, files, FS_READ | FS_WRITE) != 0) return 1;
+    size_t inodes = available_inodes(&fs);
+
+    double start = bench_now();
+    if (whole)
+    {
+        if (remove_tree(&context, (char[]) { "tree" }) != 0) return 1;
+    }
+    else
+    {
+        // the paths are in order, so a subdirectory is empty once its last file is gone
+        char dir[32];
+        for (size_t n = files; n-- > 0; )
+        {
+            if (remove_file(&context, paths[n]) != 0) return 1;
+            if (n % FANOUT != 0) continue;
+            size_t len = strrchr(paths[n], '/') - paths[n];
+            memcpy(dir, paths[n], len);
+            dir[len] = '\0';
+            if (remove_directory(&context, dir) != 0) return 1;
+            if (n % (FANOUT * FANOUT) != 0) continue;
+            *strrchr(dir, '/') = '\0';
+            if (remove_directory(&context, dir) != 0) return 1;
+        }
+        if (remove_directory(&context, (char[]) { "tree" }) != 0) return 1;
+    }
+    double seconds = bench_now() - start;
+
+    printf("%-12s %10zu %10.3f %14.0f %10zu\n", whole ? "remove_tree" : "per object", files, seconds,
+        (double) files / seconds, available_inodes(&fs) - inodes);
+    free_filesystem(&fs);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t files = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_FILES;
+    if (files < FANOUT) files = FANOUT;
+    if (files > INODE_INDEX_MAX / 2) files = INODE_INDEX_MAX / 2;
+
+    char **paths = malloc(files * sizeof(char*));
+    char *names = malloc(files * 40);
+    if (!paths || !names)
+    {
+        puts("cannot allocate the manifest");
+        return 1;
+    }
+    for (size_t n = 0; n < files; ++n)
+    {
+        paths[n] = names + 40 * n;
+        sprintf(paths[n], "tree/t%zu/s%zu/f%zu", n / (FANOUT * FANOUT), n / FANOUT % FANOUT, n % FANOUT);
+    }
+
+    printf("%-12s %10s %10s %14s %10s\n", "method", "files", "seconds", "files/s", "inodes");
+    if (run(paths, files, 1) != 0 || run(paths, files, 0) != 0)
+    {
+        puts("cannot remove the tree");
+        return 1;
+    }
+    free(names);
+    free(paths);
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "filesys.h"
+#include "utility.h"
+#include "checksum.h"
+#include "bench_util.h"
+
+// CRC32C throughput and scrub bandwidth on a large file system.
+//
+// usage: scrub_bench [dblock_count]
+// the file system defaults to 4M dblocks (256 MiB) with 7 in 8 dblocks allocated.
+
+#define DEFAULT_DBLOCK_COUNT ((size_t) 4 << 20)
+#define FILL_CHUNK ((size_t) 1 << 20)
+#define CRC_ROUNDS 4
+
+static double crc_throughput(uint32_t (*crc)(uint32_t, const void*, size_t), const byte *data, size_t n, uint32_t *result)
+{
+    uint32_t acc = 0;
+    double start = bench_now();
+    for (int r = 0; r < CRC_ROUNDS; ++r)
+    {
+        // checksum block by block like the file system does
+        for (size_t offset = 0; offset < n; offset += DEFAULT_DATA_BLOCK_SIZE) acc ^= crc(0, data + offset, DEFAULT_DATA_BLOCK_SIZE);
+    }
+    double seconds = bench_now() - start;
+    *result = acc;
+    return (double) n * CRC_ROUNDS / seconds / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t dblock_count = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_DBLOCK_COUNT;
+    if (dblock_count < 1024) dblock_count = 1024;
+
+    filesystem_t fs;
+    if (new_filesystem(&fs, 4096, dblock_count) != SUCCESS)
+    {
+        puts("cannot allocate the file system");
+        return 1;
+    }
+
+    // scrub only looks at the bitmask and the dblock contents, so the image is filled
+    // directly instead of through inode_write_data, whose dblock claiming is linear per block
+    double start = bench_now();
+    for (size_t offset = 0; offset < fs.dblock_count * DEFAULT_DATA_BLOCK_SIZE; offset += FILL_CHUNK)
+    {
+        size_t n = fs.dblock_count * DEFAULT_DATA_BLOCK_SIZE - offset;
+        bench_fill_text((char*) fs.dblocks + offset, n < FILL_CHUNK ? n : FILL_CHUNK, (unsigned) (offset / FILL_CHUNK));
+    }
+    // leave every eighth bitmask byte free so the scan has holes to skip
+    size_t bitmask_size = (fs.dblock_count + 7) / 8;
+    for (size_t i = 0; i < bitmask_size; ++i) fs.dblock_bitmask[i] = i % 8 == 7 ? 0xFF : 0x00;
+    size_t used = fs.dblock_count - available_dblocks(&fs);
+    printf("file system: %lu dblocks (%.1f MiB), %lu dblocks allocated, filled in %.2f s\n",
+        fs.dblock_count, (double) fs.dblock_count * DEFAULT_DATA_BLOCK_SIZE / MIB, used, bench_now() - start);
+
+    uint32_t table_crc, crc;
+    size_t crc_bytes = used * DEFAULT_DATA_BLOCK_SIZE;
+    double table_gbps = crc_throughput(crc32c_table, fs.dblocks, crc_bytes, &table_crc);
+    double crc_gbps = crc_throughput(crc32c, fs.dblocks, crc_bytes, &crc);
+    printf("crc32c table:    %6.2f GB/s\n", table_gbps);
+    printf("crc32c dispatch: %6.2f GB/s (%s)%s\n", crc_gbps,
+        crc32c_hardware_available() ? "sse4.2" : "table", table_crc == crc ? "" : " MISMATCH");
+
+    start = bench_now();
+    fs_enable_checksums(&fs);
+    printf("enable checksums: %.1f ms\n", (bench_now() - start) * 1e3);
+
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t thread_counts[] = { 1, 2, 4, 8, online > 0 ? (size_t) online : 1 };
+    for (size_t i = 0; i < sizeof(thread_counts) / sizeof(thread_counts[0]); ++i)
+    {
+        // skip duplicates of the online cpu count
+        if (i > 0 && thread_counts[i] <= thread_counts[i - 1]) continue;
+
+        scrub_report_t report;
+        fs_scrub(&fs, thread_counts[i], &report);
+        printf("scrub %2lu threads: %lu dblocks in %7.2f ms, %6.2f GB/s, %lu mismatches\n",
+            thread_counts[i], report.dblocks_checked, report.seconds * 1e3,
+            (double) report.dblocks_checked * DEFAULT_DATA_BLOCK_SIZE / report.seconds / 1e9, report.mismatch_count);
+    }
+
+    free_filesystem(&fs);
+    return 0;
+}
@@ -0,0 +1,78 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "filesys.h"
+#include "utility.h"
+#include "bench_util.h"
+
+// throughput of `fs_write` with small records, with and without a write buffer.
+//
+// usage: small_write_bench [total_mib]
+// writes records of 8 to 20 bytes until `total_mib` MiB (default 16) are written, once
+// straight through `fs_write` and once through handles with write buffers of several sizes.
+
+#define MIN_RECORD 8
+#define MAX_RECORD 20
+
+static double run(size_t total, size_t buffer_capacity, const char *text)
+{
+    filesystem_t fs;
+    new_filesystem(&fs, 16, bench_dblocks(total + MAX_RECORD) + 64);
+    inode_t *inode = bench_new_file(&fs, "log");
+    terminal_context_t term;
+    new_terminal(&fs, &term);
+    fs_file_t file = fs_open(&term, "log");
+    if (!file || !inode)
+    {
+        puts("cannot open the file");
+        exit(1);
+    }
+    if (buffer_capacity) fs_set_write_buffer(file, buffer_capacity);
+
+    unsigned seed = 5;
+    size_t written = 0;
+    double start = bench_now();
+    while (written < total)
+    {
+        seed = seed * 1103515245u + 12345u;
+        size_t n = MIN_RECORD + (seed >> 16) % (MAX_RECORD - MIN_RECORD + 1);
+        if (fs_write(file, (void*) (text + written % 4096), n) != n)
+        {
+            puts("write failed");
+            exit(1);
+        }
+        written += n;
+    }
+    fs_close(file);
+    double seconds = bench_now() - start;
+
+    if (inode->internal.file_size != written) printf("size mismatch: %lu != %lu\n", inode->internal.file_size, written);
+    free_filesystem(&fs);
+    return seconds;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t total_mib = argc > 1 ? strtoul(argv[1], NULL, 10) : 16;
+    if (total_mib == 0) total_mib = 1;
+    size_t total = total_mib << 20;
+
+    char text[4096 + MAX_RECORD];
+    bench_fill_text(text, sizeof(text), 11);
+
+    size_t records = total / ((MIN_RECORD + MAX_RECORD) / 2);
+    printf("writing %lu MiB in records of %d to %d bytes (~%lu records)\n", total_mib, MIN_RECORD, MAX_RECORD, records);
+
+    double direct = run(total, 0, text);
+    printf("unbuffered:          %7.1f MiB/s, %6.1f ns per record\n", (double) total / MIB / direct, direct / (double) records * 1e9);
+
+    size_t capacities[] = { 256, 4096, 65536 };
+    for (size_t i = 0; i < sizeof(capacities) / sizeof(capacities[0]); ++i)
+    {
+        double seconds = run(total, capacities[i], text);
+        printf("buffered %6lu bytes: %7.1f MiB/s, %6.1f ns per record, %.1fx\n", capacities[i],
+            (double) total / MIB / seconds, seconds / (double) records * 1e9, direct / seconds);
+    }
+    return 0;
+}
@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "filesys.h"
+#include "utility.h"
+#include "bench_util.h"
+
+// the linear and the sorted directory format side by side: file creation, lookups and
+// prefix queries in one large directory.
+//
+// usage: sorted_dir_bench [max_entries]
+// for directory sizes of 1000, 100000 and 1000000, capped by `max_entries` (default
+// 1000000) and by the inodes of the build, fills the root directory of a new file system
+// with `new_file`, opens every file once in a pseudo random order with `fs_open` and lists
+// the files starting with a pseudo random prefix with `list`, which matches about 100 of
+// them. the root is sorted with `fs_sort_directory` before it is filled for the sorted
+// format. the file system takes the wide format, so a directory can hold a million files.
+// everything runs with dblocks of 64 and of 4096 bytes.
+
+#define DEFAULT_MAX_ENTRIES 1000000
+
+// the listing of the prefix queries goes to /dev/null
+static int silence_stdout(void)
+{
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    int null = open("/dev/null", O_WRONLY);
+    dup2(null, STDOUT_FILENO);
+    close(null);
+    return saved;
+}
+
+static void restore_stdout(int saved)
+{
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+}
+
+static int run(size_t entries, int sorted, size_t block_size)
+{
+    // a sorted directory takes more dblocks than a linear one since its nodes are split
+    // half full
+    filesystem_t fs;
+    if (new_filesystem_geometry(&fs, 1, 1, block_size) != SUCCESS) return 1;
+    size_t dblocks = calculate_necessary_dblock_amount(&fs, (entries + 1) * WIDE_DIRECTORY_ENTRY_SIZE);
+    free_filesystem(&fs);
+    if (new_filesystem_geometry(&fs, entries + 1, sorted ? 4 * dblocks + 64 : dblocks, block_size) != SUCCESS)
+    {
+        puts("cannot allocate the file system");
+        return 1;
+    }
+    terminal_context_t context;
+    new_terminal(&fs, &context);
+    if (sorted && fs_sort_directory(&context, (char[]) { "." }) != 0) return 1;
+
+    char name[24]; // room for any size_t, the names themselves stay short
+    double start = bench_now();
+    for (size_t i = 0; i < entries; ++i)
+    {
+        sprintf(name, "f%zu", i);
+        if (new_file(&context, name, FS_READ | FS_WRITE) != 0)
+        {
+            printf("cannot create %s\n", name);
+            return 1;
+        }
+    }
+    double create_seconds = bench_now() - start;
+
+    unsigned seed = 42;
+    start = bench_now();
+    for (size_t n = 0; n < entries; ++n)
+    {
+        seed = seed * 1103515245u + 12345u;
+        sprintf(name, "f%zu", (size_t) (seed >> 4) % entries);
+        fs_file_t file = fs_open(&context, name);
+        if (!file)
+        {
+            printf("cannot open %s\n", name);
+            return 1;
+        }
+        fs_close(file);
+    }
+    double open_seconds = bench_now() - start;
+
+    // a prefix of all but the last two digits of a file name
+    size_t queries = entries >= 100000 ? 20 : 2000;
+    int saved = silence_stdout();
+    start = bench_now();
+    for (size_t n = 0; n < queries; ++n)
+    {
+        seed = seed * 1103515245u + 12345u;
+        sprintf(name, "f%zu*", (size_t) (seed >> 4) % (entries / 100));
+        list(&context, name);
+    }
+    double query_seconds = bench_now() - start;
+    restore_stdout(saved);
+
+    printf("%-8s %10zu %14.0f %14.0f %14.1f %10zu\n", sorted ? "sorted" : "linear", entries,
+        (double) entries / create_seconds, (double) entries / open_seconds, (double) queries / query_seconds,
+        fs.dblock_count - available_dblocks(&fs));
+    free_filesystem(&fs);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t max_entries = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_MAX_ENTRIES;
+    if (max_entries < 1000) max_entries = 1000;
+    if (max_entries > INODE_INDEX_MAX) max_entries = INODE_INDEX_MAX;
+
+    for (size_t block_size = 64; block_size <= 4096; block_size *= 64)
+    {
+        printf("%zu byte dblocks\n", block_size);
+        printf("%-8s %10s %14s %14s %14s %10s\n", "format", "entries", "creates/s", "opens/s", "prefix ls/s", "dblocks");
+        for (size_t entries = 1000; ; entries *= 100)
+        {
+            if (entries > max_entries) entries = max_entries;
+            if (run(entries, 0, block_size) != 0 || run(entries, 1, block_size) != 0) return 1;
+            if (entries == max_entries) break;
+        }
+    }
+    return 0;
+}
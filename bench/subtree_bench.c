@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "filesys.h"
+#include "utility.h"
+#include "subtree.h"
+#include "bench_util.h"
+
+// `fs_du` of a whole file system with and without subtree totals, and what keeping them
+// costs every write.
+//
+// usage: subtree_bench [inodes]
+// builds a balanced tree of `inodes` (default 1000000) inodes, FILES empty files and SUBDIRS
+// directories per directory, breadth first. `du` of the root is timed walking the tree on one
+// thread and reading the kept totals. the writes append a byte to every file and shrink it
+// back, with the totals off and on. the file system takes the wide format, so the tree can
+// hold millions of inodes.
+
+#define DEFAULT_INODES 1000000
+#define FILES 48
+#define SUBDIRS 8
+#define INSTANT_ROUNDS 1000000
+
+// fills the root breadth first until every inode is taken
+static int build_tree(filesystem_t *fs)
+{
+    inode_index_t *queue = malloc(fs->inode_count * sizeof(inode_index_t));
+    if (!queue) return 1;
+    size_t head = 0, tail = 0;
+    queue[tail++] = 0;
+
+    char name[24];
+    while (head < tail && fs->available_inode != 0)
+    {
+        inode_t *dir = &fs->inodes[queue[head++]];
+        for (size_t f = 0; f < FILES && fs->available_inode != 0; ++f)
+        {
+            sprintf(name, "f%zu", f);
+            inode_t *file = bench_new_data_inode(fs);
+            if (!file || bench_add_entry(fs, dir, file, name) != SUCCESS) return 1;
+        }
+        for (size_t d = 0; d < SUBDIRS && fs->available_inode != 0; ++d)
+        {
+            sprintf(name, "d%zu", d);
+            inode_t *sub = bench_new_directory(fs, dir, name);
+            if (!sub) return 1;
+            queue[tail++] = sub - fs->inodes;
+        }
+    }
+    free(queue);
+    return 0;
+}
+
+// appends a byte to every data file and shrinks it back
+static double touch_files(filesystem_t *fs)
+{
+    double start = bench_now();
+    for (size_t i = 0; i < fs->inode_count; ++i)
+    {
+        inode_t *inode = &fs->inodes[i];
+        if (inode->internal.file_type != DATA_FILE) continue;
+        if (inode_write_data(fs, inode, (char[]) { "x" }, 1) != SUCCESS) return -1;
+        if (inode_shrink_data(fs, inode, 0) != SUCCESS) return -1;
+    }
+    return bench_now() - start;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t inodes = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_INODES;
+    if (inodes < 1000) inodes = 1000;
+    if (inodes > INODE_INDEX_MAX) inodes = INODE_INDEX_MAX;
+
+    // the directories that are filled take FILES + SUBDIRS inodes each, the last ones
+    // created are left with `.` and `..`. every file may hold one dblock while it is touched
+    size_t filled = inodes / (FILES + SUBDIRS) + 1;
+    size_t dblocks = filled * bench_dblocks((FILES + SUBDIRS + 2) * WIDE_DIRECTORY_ENTRY_SIZE)
+        + SUBDIRS * filled * bench_dblocks(2 * WIDE_DIRECTORY_ENTRY_SIZE) + 1;
+    filesystem_t fs;
+    if (new_filesystem(&fs, inodes, dblocks) != SUCCESS)
+    {
+        puts("cannot allocate the file system");
+        return 1;
+    }
+    terminal_context_t context;
+    new_terminal(&fs, &context);
+    fs.traverse_threads = 1;
+
+    double start = bench_now();
+    if (build_tree(&fs) != 0)
+    {
+        puts("cannot build the tree");
+        return 1;
+    }
+    printf("%zu inodes built in %.1f s\n", inodes, bench_now() - start);
+
+    du_report_t walked, instant;
+    start = bench_now();
+    int failed = fs_du(&context, (char[]) { "." }, &walked);
+    double walk_seconds = bench_now() - start;
+    double touch_off = touch_files(&fs);
+
+    start = bench_now();
+    failed |= fs_enable_subtree_totals(&fs) != SUCCESS;
+    double enable_seconds = bench_now() - start;
+
+    start = bench_now();
+    for (size_t round = 0; round < INSTANT_ROUNDS; ++round) failed |= fs_du(&context, (char[]) { "." }, &instant);
+    double instant_seconds = (bench_now() - start) / INSTANT_ROUNDS;
+    double touch_on = touch_files(&fs);
+
+    if (failed || touch_off < 0 || touch_on < 0 || walked.files + walked.directories != inodes
+        || instant.files != walked.files || instant.bytes != walked.bytes || instant.dblocks != walked.dblocks)
+    {
+        puts("the totals are wrong");
+        return 1;
+    }
+    printf("du walking the tree   %12.6f s\n", walk_seconds);
+    printf("enabling the totals   %12.6f s\n", enable_seconds);
+    printf("du with the totals    %12.9f s  %.0fx\n", instant_seconds, walk_seconds / instant_seconds);
+    printf("touching %zu files  %.3f s without totals, %.3f s with them (%+.1f%%)\n", walked.files,
+        touch_off, touch_on, 100.0 * (touch_on - touch_off) / touch_off);
+    free_filesystem(&fs);
+    return 0;
+}
@@ -0,0 +1,135 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "filesys.h"
+#include "utility.h"
+#include "traverse.h"
+#include "bench_util.h"
+
+// `tree`, `fs_du` and `fs_find` over a whole file system with 1 to N worker threads.
+//
+// usage: traverse_bench [inodes] [max_threads]
+// builds a balanced tree of `inodes` (default 10000000) inodes, FILES empty files and
+// SUBDIRS directories per directory, breadth first, and walks it from the root with 1, 2,
+// 4, ... up to `max_threads` (default every online cpu) threads. `find` looks for a pattern
+// that matches one file in every directory. the output of `tree` and `find` goes to
+// /dev/null. past 65,536 inodes the file system takes the wide format, so the tree can
+// hold ten million of them.
+
+#define DEFAULT_INODES 10000000
+#define FILES 48
+#define SUBDIRS 8
+
+// the listing goes to /dev/null
+static int silence_stdout(void)
+{
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    int null = open("/dev/null", O_WRONLY);
+    dup2(null, STDOUT_FILENO);
+    close(null);
+    return saved;
+}
+
+static void restore_stdout(int saved)
+{
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+}
+
+// fills the root breadth first until every inode is taken
+static int build_tree(filesystem_t *fs)
+{
+    inode_index_t *queue = malloc(fs->inode_count * sizeof(inode_index_t));
+    if (!queue) return 1;
+    size_t head = 0, tail = 0;
+    queue[tail++] = 0;
+
+    char name[24];
+    while (head < tail && fs->available_inode != 0)
+    {
+        inode_t *dir = &fs->inodes[queue[head++]];
+        for (size_t f = 0; f < FILES && fs->available_inode != 0; ++f)
+        {
+            sprintf(name, "f%zu", f);
+            inode_t *file = bench_new_data_inode(fs);
+            if (!file || bench_add_entry(fs, dir, file, name) != SUCCESS) return 1;
+        }
+        for (size_t d = 0; d < SUBDIRS && fs->available_inode != 0; ++d)
+        {
+            sprintf(name, "d%zu", d);
+            inode_t *sub = bench_new_directory(fs, dir, name);
+            if (!sub) return 1;
+            queue[tail++] = sub - fs->inodes;
+        }
+    }
+    free(queue);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t inodes = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_INODES;
+    size_t max_threads = traverse_thread_count(argc > 2 ? strtoul(argv[2], NULL, 10) : 0);
+    if (inodes < 1000) inodes = 1000;
+    if (inodes > INODE_INDEX_MAX) inodes = INODE_INDEX_MAX;
+
+    // the directories that are filled take FILES + SUBDIRS inodes each, the last ones
+    // created are left with `.` and `..`
+    size_t filled = inodes / (FILES + SUBDIRS) + 1;
+    size_t dblocks = filled * bench_dblocks((FILES + SUBDIRS + 2) * WIDE_DIRECTORY_ENTRY_SIZE)
+        + SUBDIRS * filled * bench_dblocks(2 * WIDE_DIRECTORY_ENTRY_SIZE);
+    filesystem_t fs;
+    if (new_filesystem(&fs, inodes, dblocks) != SUCCESS)
+    {
+        puts("cannot allocate the file system");
+        return 1;
+    }
+    terminal_context_t context;
+    new_terminal(&fs, &context);
+
+    double start = bench_now();
+    if (build_tree(&fs) != 0)
+    {
+        puts("cannot build the tree");
+        return 1;
+    }
+    printf("%zu inodes built in %.1f s, %ld online cpus\n", inodes, bench_now() - start, sysconf(_SC_NPROCESSORS_ONLN));
+    printf("%8s %10s %10s %10s %10s %10s %10s\n", "threads", "tree s", "speedup", "du s", "speedup", "find s", "speedup");
+
+    double base[3] = { 0 };
+    for (size_t threads = 1; threads <= max_threads; threads = threads < max_threads && threads * 2 > max_threads ? max_threads : threads * 2)
+    {
+        fs.traverse_threads = threads;
+        double seconds[3];
+
+        int saved = silence_stdout();
+        start = bench_now();
+        int failed = tree(&context, (char[]) { "." });
+        seconds[0] = bench_now() - start;
+
+        du_report_t report;
+        start = bench_now();
+        failed |= fs_du(&context, (char[]) { "." }, &report);
+        seconds[1] = bench_now() - start;
+
+        start = bench_now();
+        failed |= fs_find(&context, (char[]) { "." }, (char[]) { "*47" });
+        seconds[2] = bench_now() - start;
+        restore_stdout(saved);
+
+        if (failed || report.files + report.directories != inodes)
+        {
+            puts("the walks failed");
+            return 1;
+        }
+        if (threads == 1) for (int w = 0; w < 3; ++w) base[w] = seconds[w];
+        printf("%8zu %10.3f %10.2f %10.3f %10.2f %10.3f %10.2f\n", threads, seconds[0], base[0] / seconds[0],
+            seconds[1], base[1] / seconds[1], seconds[2], base[2] / seconds[2]);
+    }
+    free_filesystem(&fs);
+    return 0;
+}
@@ -0,0 +1,67 @@
+#ifndef BLOCK_MAP_H
+#define BLOCK_MAP_H
+
+#include "filesys.h"
+
+/**
+ * maps the logical blocks of an inode to dblock indices.
+ *
+ * logical block `b` of an inode lives in `direct_data[b]` if `b < INODE_DIRECT_BLOCK_COUNT`.
+ * the remaining blocks are stored in the chain of index dblocks starting at
+ * `indirect_dblock`, each holding INDIRECT_DBLOCK_INDEX_COUNT(fs) entries followed by the
+ * index of the next index dblock.
+ *
+ * a cursor remembers the index dblock of its current block so walking a file in order
+ * only follows each link of the chain once. the last index dblock of each inode is also
+ * remembered by `inode_write_data`, so seeking into it does not walk the chain at all, and
+ * `inode_read_data` remembers where each read ended so the next read continues from there.
+ */
+typedef struct block_cursor
+{
+    size_t block;                // logical block the cursor points at
+    dblock_index_t index_dblock; // index dblock holding the entry of `block` (indirect blocks only)
+} block_cursor_t;
+
+/**
+ * positions a cursor at a logical block. the block must be within the file.
+ *
+ * @param fs the file system the inode is in
+ * @param inode the inode to walk
+ * @param cursor the cursor to position
+ * @param block the logical block to move to
+ */
+void block_cursor_seek(filesystem_t *fs, inode_t *inode, block_cursor_t *cursor, size_t block);
+
+/**
+ * advances a cursor to the following logical block. the following block must exist.
+ */
+void block_cursor_next(filesystem_t *fs, inode_t *inode, block_cursor_t *cursor);
+
+/**
+ * @return the dblock index storing the block the cursor points at
+ */
+dblock_index_t block_cursor_dblock(filesystem_t *fs, inode_t *inode, block_cursor_t *cursor);
+
+/**
+ * issues software prefetches for the dblocks holding a byte range of an inode and for the
+ * index dblocks needed to reach the ones after it. nothing is read or verified, so this is
+ * only a hint. compressed files are skipped.
+ *
+ * @param fs the file system the inode is in
+ * @param inode the inode to prefetch
+ * @param offset the first byte to prefetch
+ * @param n the number of bytes to prefetch, clamped to the end of the file
+ */
+void inode_prefetch_data(filesystem_t *fs, inode_t *inode, size_t offset, size_t n);
+
+/**
+ * tells the read-ahead that `n` bytes were read at `offset` of an inode.
+ *
+ * once a read continues where the previous read of the inode ended, the dblocks after it
+ * are prefetched. the window starts at a few blocks and doubles with every sequential read
+ * up to `read_ahead_blocks` of the file system, and blocks prefetched by earlier reads are
+ * not prefetched again. any other read, or a change of the file size, starts over.
+ */
+void inode_read_ahead(filesystem_t *fs, inode_t *inode, size_t offset, size_t n);
+
+#endif
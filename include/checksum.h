@@ -0,0 +1,96 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include "filesys.h"
+
+/**
+ * per dblock CRC32C checksums.
+ *
+ * checksums are optional. when `fs->dblock_checksums` is null nothing is computed or
+ * verified. when enabled, the table holds one CRC32C per dblock and is kept up to date by
+ * `inode_write_data` and `inode_modify_data`. reads verify the dblocks they touch and
+ * `fs_scrub` verifies every allocated dblock at once.
+ *
+ * the CRC uses the SSE4.2 `crc32` instruction when the cpu supports it and a table
+ * driven implementation otherwise.
+ */
+
+// marks the checksum table appended to a saved image after the dblocks
+#define CHECKSUM_TRAILER_MAGIC "CRC32C\0\0"
+#define CHECKSUM_TRAILER_MAGIC_LEN 8
+
+/**
+ * computes the CRC32C (Castagnoli) of a buffer
+ *
+ * @param crc the CRC of the preceding data, 0 to start a new checksum
+ * @param data the bytes to checksum
+ * @param n the number of bytes
+ * @return the updated CRC
+ */
+uint32_t crc32c(uint32_t crc, const void *data, size_t n);
+
+/**
+ * table driven CRC32C, always available. `crc32c` dispatches to this when the cpu lacks
+ * SSE4.2. exposed for testing and benchmarking.
+ */
+uint32_t crc32c_table(uint32_t crc, const void *data, size_t n);
+
+/**
+ * @return nonzero if `crc32c` uses the hardware instruction
+ */
+int crc32c_hardware_available(void);
+
+/**
+ * allocates the checksum table and computes the checksum of every dblock
+ *
+ * @param fs the file system to enable checksums for
+ * @return SUCCESS if checksums are enabled (or already were)
+ *         INVALID_INPUT if fs is null
+ *         SYSTEM_ERROR if the table cannot be allocated
+ */
+fs_retcode_t fs_enable_checksums(filesystem_t *fs);
+
+/**
+ * frees the checksum table. dblocks are no longer verified.
+ */
+void fs_disable_checksums(filesystem_t *fs);
+
+/**
+ * recomputes the checksum of one dblock. any code that writes to `fs->dblocks` without
+ * going through `inode_write_data` or `inode_modify_data` must call this.
+ */
+void checksum_update_dblock(filesystem_t *fs, dblock_index_t dblock);
+
+/**
+ * recomputes the checksums of the data dblocks holding bytes [offset, offset + n) of an
+ * inode and of the index dblocks referencing them. the index dblock of the block before
+ * `offset` is included since appending may have linked a new index dblock to it.
+ */
+void checksum_update_range(filesystem_t *fs, inode_t *inode, size_t offset, size_t n);
+
+/**
+ * @return SUCCESS if the dblock matches its checksum or checksums are disabled,
+ *         CHECKSUM_MISMATCH otherwise
+ */
+fs_retcode_t checksum_verify_dblock(filesystem_t *fs, dblock_index_t dblock);
+
+typedef struct scrub_report
+{
+    size_t dblocks_checked;
+    size_t mismatch_count;
+    dblock_index_t mismatches[16]; // the first mismatching dblocks in index order
+    double seconds;
+} scrub_report_t;
+
+/**
+ * verifies every allocated dblock against its checksum using several threads
+ *
+ * @param fs the file system to scrub
+ * @param thread_count the number of worker threads, 0 to use every online cpu
+ * @param report the address to store the result of the scrub in
+ * @return SUCCESS if the scrub ran, even when mismatches are found
+ *         INVALID_INPUT if fs or report is null or checksums are disabled
+ */
+fs_retcode_t fs_scrub(filesystem_t *fs, size_t thread_count, scrub_report_t *report);
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include "filesys.h"
+
+/**
+ * marks an inode whose data is stored as a compressed stream. this is not a real
+ * permission, it only shares the `file_perms` bitmask since the permission bits only
+ * use the lower three bits.
+ */
+#define FS_COMPRESSED 0x8
+
+// size of a logical chunk of file data that is compressed as one unit
+#define COMPRESS_CHUNK_SIZE 4096
+// number of decompressed chunks kept by the per filesystem chunk cache
+#define COMPRESS_CACHE_ENTRIES 4
+
+/**
+ * layout of a compressed file stream stored in the dblocks of an inode
+ *
+ *      [ compressed_header ][ uint32_t chunk_offsets[chunk_count + 1] ][ chunk payloads ]
+ *
+ * `chunk_offsets[i]` is the offset of chunk i from the start of the stream, the last
+ * offset marks the end of the final payload. a payload whose length equals the
+ * decompressed length of the chunk is stored raw.
+ */
+typedef struct compressed_header
+{
+    uint32_t magic;
+    uint32_t chunk_size;
+    uint64_t logical_size;
+    uint32_t chunk_count;
+    uint32_t reserved;
+} compressed_header_t;
+
+#define COMPRESSED_MAGIC 0x31465a4c // "LZF1"
+
+/**
+ * compresses `n` bytes of `src` into `dst` with the in-tree LZ77 codec.
+ *
+ * @param src the bytes to compress
+ * @param n the number of bytes in `src`
+ * @param dst the buffer to store the compressed bytes in
+ * @param capacity the size of `dst`
+ * @return the number of compressed bytes, 0 if the output does not fit in `capacity`
+ */
+size_t lz_compress(const byte *src, size_t n, byte *dst, size_t capacity);
+
+/**
+ * decompresses a block produced by `lz_compress`.
+ *
+ * @param src the compressed bytes
+ * @param n the number of bytes in `src`
+ * @param dst the buffer to store the decompressed bytes in
+ * @param capacity the size of `dst`
+ * @return the number of decompressed bytes, (size_t) -1 if `src` is malformed
+ */
+size_t lz_decompress(const byte *src, size_t n, byte *dst, size_t capacity);
+
+/**
+ * converts the data of a data file into a compressed stream. the file keeps the same
+ * logical content and `inode_read_data` decompresses it on demand. the file is left
+ * uncompressed if compression would not free any dblock.
+ *
+ * @param fs the file system the inode is in
+ * @param inode the data file to compress
+ * @return SUCCESS if the inode is compressed (or already was)
+ *         INVALID_INPUT if fs or inode is null, inode is not a data file or its stream
+ *                       would not fit the 32 bit chunk offsets
+ *         SYSTEM_ERROR if a temporary buffer cannot be allocated
+ *         CHECKSUM_MISMATCH if the raw data cannot be read, the file is left as it was
+ */
+fs_retcode_t inode_compress_data(filesystem_t *fs, inode_t *inode);
+
+/**
+ * converts a compressed inode back into raw dblocks. called implicitly by every write
+ * path so that writes to cold data only pay for the conversion once.
+ *
+ * @param fs the file system the inode is in
+ * @param inode the inode to decompress
+ * @return SUCCESS if the inode is raw afterwards
+ *         INVALID_INPUT if fs or inode is null
+ *         INSUFFICIENT_DBLOCKS if the raw data does not fit in the file system
+ *         INVALID_BINARY_FORMAT if the compressed stream is corrupted
+ */
+fs_retcode_t inode_decompress_data(filesystem_t *fs, inode_t *inode);
+
+/**
+ * returns the logical size of the data stored in an inode. this is `file_size` for raw
+ * inodes and the size recorded in the stream header for compressed inodes.
+ *
+ * @param fs the file system the inode is in
+ * @param inode the inode to query
+ * @return the number of bytes readable through `inode_read_data`
+ */
+size_t inode_data_size(filesystem_t *fs, inode_t *inode);
+
+/**
+ * reads logical data from a compressed inode. used by `inode_read_data`.
+ */
+fs_retcode_t compressed_read_data(filesystem_t *fs, inode_t *inode, size_t offset, void *buffer, size_t n, size_t *bytes_read);
+
+/**
+ * reads the bytes physically stored in the dblocks of an inode, ignoring compression.
+ * implemented in inode_manip.c.
+ */
+fs_retcode_t inode_read_raw_data(filesystem_t *fs, inode_t *inode, size_t offset, void *buffer, size_t n, size_t *bytes_read);
+
+/**
+ * drops every cached decompressed chunk belonging to `inode`
+ */
+void compress_cache_invalidate(filesystem_t *fs, inode_t *inode);
+
+#endif
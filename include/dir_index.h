@@ -0,0 +1,42 @@
+#ifndef DIR_INDEX_H
+#define DIR_INDEX_H
+
+#include "filesys.h"
+
+/**
+ * the hash indexes of large directories, saved with the image.
+ *
+ * a linear directory with at least 64 entries gets a hash index on its first lookup (see
+ * `fs->dir_indexes`). the indexes that match their directory when the image is saved are
+ * appended after the dblocks, and `load_filesystem` reads them back, so the first lookup in
+ * a large directory of a loaded image hashes the name instead of reading every entry.
+ *
+ * an index counts while `file_size` matches its directory. a loaded index that does not is
+ * dropped and rebuilt on the next lookup like a stale one.
+ */
+
+// marks the index table appended to a saved image after the dblocks
+#define DIR_INDEX_TRAILER_MAGIC "DIRINDEX"
+#define DIR_INDEX_TRAILER_MAGIC_LEN 8
+
+/**
+ * writes the trailer of the up to date indexes. nothing is written if there are none.
+ *
+ * @param file the image being saved, positioned after the other trailers
+ * @param fs the file system being saved
+ */
+void save_dir_indexes(FILE *file, filesystem_t *fs);
+
+/**
+ * reads the trailer written by `save_dir_indexes`, after its magic, into `fs->dir_indexes`.
+ * the inodes of `fs` must be loaded.
+ *
+ * @param file the image being loaded, positioned after the magic
+ * @param fs the file system being loaded
+ * @return SUCCESS if the table was read, even if stale indexes were dropped
+ *         INVALID_BINARY_FORMAT if the table is cut short or an index is malformed
+ *         SYSTEM_ERROR if an index cannot be allocated
+ */
+fs_retcode_t load_dir_indexes(FILE *file, filesystem_t *fs);
+
+#endif
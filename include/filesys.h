@@ -11,9 +11,52 @@
 
 #define STR(x) #x
 
-#define DATA_BLOCK_SIZE 64
+// dblocks are DATA_BLOCK_SIZE(fs) bytes, a power of two picked for each file system when it
+// is created (see `new_filesystem_geometry`) and recorded by the images that do not use the
+// default. the direct blocks size the inodes, so their count is fixed per build and can be
+// changed at compile time, e.g. -DINODE_DIRECT_BLOCK_COUNT=12
+#define DEFAULT_DATA_BLOCK_SIZE 64
+#define MIN_DATA_BLOCK_SIZE 32
+#define MAX_DATA_BLOCK_SIZE 4096
+#define DEFAULT_INODE_DIRECT_BLOCK_COUNT 4
+
+#define DATA_BLOCK_SIZE(fs) ((size_t) 1 << (fs)->block_shift)
 #define MAX_FILE_NAME_LEN 14
-#define INODE_DIRECT_BLOCK_COUNT 4
+#ifndef INODE_DIRECT_BLOCK_COUNT
+#define INODE_DIRECT_BLOCK_COUNT DEFAULT_INODE_DIRECT_BLOCK_COUNT
+#endif
+
+#if INODE_DIRECT_BLOCK_COUNT < 1
+#error "INODE_DIRECT_BLOCK_COUNT must be at least 1"
+#endif
+
+#define DEFAULT_BLOCK_GEOMETRY(fs) (DATA_BLOCK_SIZE(fs) == DEFAULT_DATA_BLOCK_SIZE && INODE_DIRECT_BLOCK_COUNT == DEFAULT_INODE_DIRECT_BLOCK_COUNT)
+
+// inode indices are held in 4 bytes in memory. an image stores them in 2 bytes in its header,
+// its free list and its directory entries, which caps it at 65,536 inodes, or in the wide
+// format in 4 bytes. `new_filesystem` picks the wide format for more inodes than that, wide
+// images start with a magic that `load_filesystem` detects
+#define NARROW_INODE_INDEX_WIDTH 2
+#define WIDE_INODE_INDEX_WIDTH 4
+#define NARROW_INODE_INDEX_MAX 0xFFFF
+
+#if MIN_DATA_BLOCK_SIZE < WIDE_INODE_INDEX_WIDTH + MAX_FILE_NAME_LEN
+#error "MIN_DATA_BLOCK_SIZE must hold at least one directory entry"
+#endif
+
+// an index dblock holds INDIRECT_DBLOCK_INDEX_COUNT entries followed by the index of the
+// next index dblock in the chain
+#define INDIRECT_DBLOCK_INDEX_COUNT(fs) (DATA_BLOCK_SIZE(fs) / sizeof(dblock_index_t) - 1)
+#define INDIRECT_DBLOCK_MAX_DATA_SIZE(fs) (DATA_BLOCK_SIZE(fs) * INDIRECT_DBLOCK_INDEX_COUNT(fs))
+#define NEXT_INDIRECT_INDEX_OFFSET(fs) (DATA_BLOCK_SIZE(fs) - sizeof(dblock_index_t))
+
+// a directory entry is the inode index followed by the name, in the width of its image
+#define NARROW_DIRECTORY_ENTRY_SIZE (NARROW_INODE_INDEX_WIDTH + MAX_FILE_NAME_LEN)
+#define WIDE_DIRECTORY_ENTRY_SIZE (WIDE_INODE_INDEX_WIDTH + MAX_FILE_NAME_LEN)
+#define DIRECTORY_ENTRY_SIZE(fs) ((fs)->entry_size)
+#define DIRECTORY_ENTRIES_PER_DATABLOCK(fs) (DATA_BLOCK_SIZE(fs) / DIRECTORY_ENTRY_SIZE(fs))
+
+#define FS_FILL_PATTERN_MAX 64
 
 #define REPORT_RETCODE(retcode) \
 do { \
@@ -22,7 +65,8 @@ do { \
 
 typedef uint8_t byte;
 typedef uint32_t dblock_index_t;
-typedef uint16_t inode_index_t;
+typedef uint32_t inode_index_t;
+#define INODE_INDEX_MAX ((inode_index_t) -1)
 
 typedef enum fs_retcode
 {
@@ -44,6 +88,7 @@ typedef enum fs_retcode
     DIRECTORY_EXIST,
     ATTEMPT_DELETE_CWD,
     NOT_IMPLEMENTED,
+    CHECKSUM_MISMATCH,
     FS_RETCODE_TOTAL
 } fs_retcode_t;
 
@@ -83,9 +128,26 @@ typedef struct filesystem
     inode_index_t available_inode; 
     inode_t *inodes;
     size_t inode_count;
+    size_t index_width; // bytes of an inode index in the image, NARROW_INODE_INDEX_WIDTH or WIDE_INODE_INDEX_WIDTH
+    size_t entry_size;  // bytes of a directory entry, the index width plus MAX_FILE_NAME_LEN
+    size_t block_shift; // dblocks are 1 << block_shift bytes, see DATA_BLOCK_SIZE
     byte *dblock_bitmask;
     byte *dblocks;
     size_t dblock_count;
+    struct chunk_cache *chunk_cache; // decompressed chunks of compressed files, allocated on first use
+    uint32_t *dblock_checksums; // one CRC32C per dblock, null when checksums are disabled
+    struct append_tail *append_tails; // last index dblock of each inode, allocated on first use
+    size_t dblock_search_start; // every dblock below this index is claimed
+    struct write_buffer *write_buffers; // write buffers of open file handles, see `fs_set_write_buffer`
+    struct read_ahead *read_aheads; // sequential read state of each inode, allocated on first use
+    struct read_resume *read_resumes; // last block read of each inode, allocated once read-ahead is enabled
+    size_t read_ahead_blocks; // dblocks prefetched in front of sequential reads, 0 (the default) disables read-ahead
+    struct dir_index **dir_indexes; // hash index of each large directory, allocated on first use or loaded with the image, see dir_index.h
+    struct dentry_cache *dentry_cache; // recent name lookups of every directory, allocated on first use
+    size_t *dir_parents; // parent of each directory plus one, 0 until it is known, allocated on first use
+    struct path_cache *path_cache; // path of the last working directory asked for, allocated on first use
+    size_t traverse_threads; // worker threads of `tree`, `fs_du` and `fs_find`, 0 (the default) uses every online cpu
+    struct subtree *subtrees; // totals of the subtree below each inode, null when they are disabled
 } filesystem_t;
 
 /*----------------------------------------------------*
@@ -126,16 +188,35 @@ typedef struct filesystem
  * 
  * the first dblock should contain one directory entry. the first directory entry
  * should have an inode index of 0 and have the entry name be '.'
+ *
+ * a file system of more than 65,536 inodes takes the wide format, see WIDE_INODE_INDEX_WIDTH
  * 
  * @param fs the file system to initialize
  * @param inode_total the total number of inodes in the file system
  * @param dblock_total the total number of data blocks in the file system
  * @return SUCCESS if file system is correctly initilaized.
  *         INVALID_INPUT if `inode_total` or `dblock_total` is equal to 0.
+ *         INVALID_INPUT if `inode_total` is more than an inode index can address.
  *         INVALID_INPUT if fs is null 
  */
 fs_retcode_t new_filesystem(filesystem_t *fs, size_t inode_total, size_t dblock_total);
 
+/**
+ * like `new_filesystem`, with dblocks of `block_size` bytes instead of
+ * DEFAULT_DATA_BLOCK_SIZE. larger dblocks take fewer index dblocks for large files, smaller
+ * ones waste less on the last dblock of small files. the size is saved with the image.
+ *
+ * @param fs the file system to initialize
+ * @param inode_total the total number of inodes in the file system
+ * @param dblock_total the total number of data blocks in the file system
+ * @param block_size the bytes of a dblock
+ * @return SUCCESS if file system is correctly initilaized.
+ *         INVALID_INPUT for the inputs `new_filesystem` refuses
+ *         INVALID_INPUT if `block_size` is not a power of two from MIN_DATA_BLOCK_SIZE to
+ *         MAX_DATA_BLOCK_SIZE
+ */
+fs_retcode_t new_filesystem_geometry(filesystem_t *fs, size_t inode_total, size_t dblock_total, size_t block_size);
+
 /**
  * free any buffer allocated for `fs`, but does not attempt to free `fs` itself.abs
  * if fs is null, then do not free anything.
@@ -169,6 +250,18 @@ size_t available_inodes(filesystem_t *fs);
  */
 size_t available_dblocks(filesystem_t *fs);
 
+/**
+ * checks whether a file system has at least `count` available data blocks
+ * 
+ * unlike `available_dblocks` the scan stops as soon as enough data blocks are found, so
+ * the cost depends on `count` rather than on the size of the file system.
+ * 
+ * @param fs the file system to check
+ * @param count the number of data blocks needed
+ * @return nonzero if at least `count` data blocks are available. if `fs` is null, 0.
+ */
+int has_available_dblocks(filesystem_t *fs, size_t count);
+
 /**
  * claims the available inode for the caller and mark it as now unavailable until
  * it is released.
@@ -201,6 +294,22 @@ fs_retcode_t claim_available_inode(filesystem_t *fs, inode_index_t *index);
  */
 fs_retcode_t claim_available_dblock(filesystem_t *fs, dblock_index_t *index);
 
+/**
+ * claims several available data blocks at once
+ * 
+ * the data blocks are the same ones, in the same order, that `count` calls to
+ * `claim_available_dblock` would return, found in a single pass over the bitmask.
+ * either every data block is claimed or none are.
+ * 
+ * @param fs the file system to claim the data blocks from
+ * @param indices the array to store the indices of the claimed data blocks in
+ * @param count the number of data blocks to claim
+ * @return SUCCESS if the data blocks are successfully claimed.
+ *         INVALID_INPUT if `fs` is null, or `indices` is null while `count` is not 0.
+ *         DBLOCK_UNAVAILABLE if there are fewer than `count` available data blocks.
+ */
+fs_retcode_t claim_available_dblocks(filesystem_t *fs, dblock_index_t *indices, size_t count);
+
 /**
  * releases a claimed inode and marks it as available now
  * 
@@ -220,6 +329,21 @@ fs_retcode_t claim_available_dblock(filesystem_t *fs, dblock_index_t *index);
  */
 fs_retcode_t release_inode(filesystem_t *fs, inode_t *inode);
 
+/**
+ * releases several claimed inodes at once
+ * 
+ * same as calling `release_inode` on each inode in order, with the free list spliced in
+ * one step. the indices are validated first so either every inode is released or none are.
+ * 
+ * @param fs the file system to release the inodes in
+ * @param indices the indices of the inodes to release
+ * @param count the number of indices
+ * @return SUCCESS if the inodes are successfully released.
+ *         INVALID_INPUT if `fs` is null, or `indices` is null while `count` is not 0.
+ *         INVALID_INPUT if an index is the root directory or outside of the file system.
+ */
+fs_retcode_t release_inodes(filesystem_t *fs, const inode_index_t *indices, size_t count);
+
 /**
  * releases a claimed data block and marks it as unavailable now
  * 
@@ -234,6 +358,22 @@ fs_retcode_t release_inode(filesystem_t *fs, inode_t *inode);
  */
 fs_retcode_t release_dblock(filesystem_t *fs, byte *dblock);
 
+/**
+ * releases several claimed data blocks at once
+ * 
+ * same as calling `release_dblock` on each data block, without the per block pointer
+ * arithmetic. the indices are validated first so either every data block is released
+ * or none are.
+ * 
+ * @param fs the file system to release the data blocks in
+ * @param indices the indices of the data blocks to release
+ * @param count the number of indices
+ * @return SUCCESS if the data blocks are successfully released.
+ *         INVALID_INPUT if `fs` is null, or `indices` is null while `count` is not 0.
+ *         INVALID_INPUT if an index is outside of the file system.
+ */
+fs_retcode_t release_dblocks(filesystem_t *fs, const dblock_index_t *indices, size_t count);
+
 /*---------------------------------------------*
  |  PART 1: LOW LEVEL INODE-DATA MANIPULATION  |
  |  functions you need to implement:           |
@@ -312,6 +452,42 @@ fs_retcode_t inode_read_data(filesystem_t *fs, inode_t *inode, size_t offset, vo
  */
 fs_retcode_t inode_modify_data(filesystem_t *fs, inode_t *inode, size_t offset, void *buffer, size_t n);
 
+/**
+ * same as `inode_modify_data` with a buffer holding `n` bytes of a repeated pattern, without
+ * the buffer. byte `offset + i` of the file is set to byte `i % pattern_size` of `pattern`.
+ * the data is copied into the dblocks a block at a time from a small tile of the pattern.
+ *
+ * @param fs the file system the inode is in
+ * @param inode the inode to modify the data
+ * @param offset the offset into the data to start filling at
+ * @param pattern the bytes to repeat
+ * @param pattern_size the number of bytes in `pattern`, at most FS_FILL_PATTERN_MAX
+ * @param n the number of bytes to fill
+ * @return SUCCESS if the data is successfully filled
+ *         INVALID_INPUT if the fs, inode or pattern is null, or `pattern_size` is 0 or too large
+ *         INVALID_INPUT if the offset exceeds the size of the file
+ *         INSUFFICIENT_DBLOCKS if there is not enough available data blocks
+ */
+fs_retcode_t inode_fill_data(filesystem_t *fs, inode_t *inode, size_t offset, const void *pattern, size_t pattern_size, size_t n);
+
+/**
+ * copies the data of one inode into another, empty, inode without going through a buffer.
+ * every dblock the copy needs is claimed up front and the data is copied from dblock to
+ * dblock. a compressed file is copied as it is stored and the copy is compressed too.
+ *
+ * if there is not enough data blocks for the copy, then the file system should NOT be
+ * modified. if a checksum of the source does not match, `dst` is left empty.
+ *
+ * @param fs the file system both inodes are in
+ * @param dst the inode to copy the data into, with a file size of 0
+ * @param src the inode to copy the data from
+ * @return SUCCESS if the data is successfully copied
+ *         INVALID_INPUT if the fs, dst or src is null, `dst` is `src` or `dst` is not empty
+ *         INSUFFICIENT_DBLOCKS if there is not enough available data blocks
+ *         CHECKSUM_MISMATCH if a dblock of `src` fails its checksum
+ */
+fs_retcode_t inode_copy_data(filesystem_t *fs, inode_t *dst, inode_t *src);
+
 /**
  * shrinks the inode file size and frees any D-block as necessary
  * 
@@ -322,7 +498,8 @@ fs_retcode_t inode_modify_data(filesystem_t *fs, inode_t *inode, size_t offset,
  * @param inode the inode to shrink
  * @param new_size the smaller inode size
  * @return SUCCESS if the inode is successfully shrunk
- *         INVALID_INPUT if fs or inode is null
+ *         INVALID_INPUT if fs or inode is null, or new_size is past the end of the data. a
+ *         compressed file is left compressed then
  */
 fs_retcode_t inode_shrink_data(filesystem_t *fs, inode_t *inode, size_t new_size);
 
@@ -402,7 +579,9 @@ void fs_close(fs_file_t file);
  * @param file the file handler returned by `fs_open`
  * @param buffer the buffer to store the data in
  * @param n the number of bytes to read from the file
- * @return the number of bytes read. if `file` is null, return 0.
+ * @return the number of bytes read. if `file` is null, return 0. a read that fails, e.g. on
+ *         a dblock whose checksum does not match, reports the error and returns the bytes
+ *         copied in front of it, and the offset only moves past those
  */
 size_t fs_read(fs_file_t file, void *buffer, size_t n);
 
@@ -433,6 +612,46 @@ typedef enum seek_mode
  */
 int fs_seek(fs_file_t file, seek_mode_t seek_mode, int offset);
 
+/**
+ * gives a file handle a write buffer so small writes are coalesced
+ * 
+ * writes smaller than the buffer are collected and written to the file in one batch
+ * when the buffer fills up, or on `fs_flush`, `fs_seek`, `fs_read` and `fs_close`.
+ * reads, seeks and writes through other handles of the same file flush the buffer first
+ * so they see the data. writes past the end of the file are only accepted if the file
+ * system has room for them, but dblocks claimed elsewhere before the flush can still
+ * make the flush fail.
+ * 
+ * any pending data is flushed before the buffer is replaced. a handle with a buffer must
+ * be closed with `fs_close` before its file system is freed.
+ * 
+ * @param file the file handler returned by `fs_open`
+ * @param capacity the size of the buffer, rounded up to whole dblocks. 0 disables buffering.
+ * @return 0 if successful, -1 if `file` is null, the flush fails or the buffer cannot be allocated
+ */
+int fs_set_write_buffer(fs_file_t file, size_t capacity);
+
+/**
+ * writes the buffered data of a file handle to the file
+ * 
+ * @param file the file handler returned by `fs_open`
+ * @return 0 if successful or nothing is buffered, -1 if `file` is null or the write fails.
+ *         on failure the buffered data is dropped and the offset moves back to where it began.
+ */
+int fs_flush(fs_file_t file);
+
+/**
+ * writes `n` bytes of a repeated pattern at the current position of a file, like `fs_write`
+ * with a buffer holding the pattern over and over. see `inode_fill_data`.
+ *
+ * @param file the file handler returned by `fs_open`
+ * @param pattern the bytes to repeat
+ * @param pattern_size the number of bytes in `pattern`, at most FS_FILL_PATTERN_MAX
+ * @param n the number of bytes to write to the file
+ * @return the number of bytes written. if `file` is null or any error, return 0.
+ */
+size_t fs_fill(fs_file_t file, const void *pattern, size_t pattern_size, size_t n);
+
 /*----------------------------------------------*
  |  PART 3: HIGH LEVEL FILE SYSTEM OPERATIONS   |
  |  functions you need to implement:            |
@@ -463,7 +682,8 @@ int fs_seek(fs_file_t file, seek_mode_t seek_mode, int offset);
  * @param context the context containing information about the file system 
  * and the parent directory
  * @param path the path to the new file
- * @param perms the permission of the file
+ * @param perms the permission of the file, bits other than FS_READ, FS_WRITE and FS_EXECUTE
+ * are ignored
  * @return 0 if successful. -1 on any failure.
  */
 int new_file(terminal_context_t *context, char *path, permission_t perms);
@@ -478,6 +698,163 @@ int new_file(terminal_context_t *context, char *path, permission_t perms);
  */
 int new_directory(terminal_context_t *context, char *path);
 
+/**
+ * copies a data file to a new file. the copy gets the permissions of the source and its
+ * data is copied from dblock to dblock inside the file system, see `inode_copy_data`.
+ * 
+ * @param context the context containing information about the file system
+ * and the current working directory
+ * @param src_path the path of the file to copy relative to the current working directory
+ * @param dst_path the path of the new file relative to the current working directory
+ * @return 0 if successful, -1 on any failure.
+ */
+int fs_copy(terminal_context_t *context, char *src_path, char *dst_path);
+
+/**
+ * renames or moves a file or directory. only directory entries change: the old entry
+ * becomes a tombstone, the new one is added, and a moved directory gets its `..` entry
+ * pointed at its new parent. no data of the object itself is copied.
+ * 
+ * @param context the context containing information about the file system
+ * and the current working directory
+ * @param old_path the path of the object relative to the current working directory
+ * @param new_path the new path of the object relative to the current working directory
+ * @return 0 if successful, -1 on any failure.
+ */
+int fs_rename(terminal_context_t *context, char *old_path, char *new_path);
+
+/**
+ * packs the entries of a directory: the live entries move to the front in their order,
+ * with `.` and `..` staying first, and the tombstones are dropped so the directory gives
+ * back the dblocks they took. directories of 64 entries or more are also compacted on
+ * their own once more than half of their entries are tombstones.
+ * 
+ * @param context the context containing information about the file system
+ * and the current working directory
+ * @param path the path of the directory relative to the current working directory
+ * @return 0 if successful, -1 on any failure.
+ */
+int fs_compact(terminal_context_t *context, char *path);
+
+/**
+ * marks a directory stored as a B+tree of dblocks sorted by name, see `fs_sort_directory`.
+ * like `FS_COMPRESSED` this is not a real permission, it only shares the `file_perms`
+ * bitmask.
+ */
+#define FS_SORTED 0x10
+
+/**
+ * converts a directory to the sorted format: its entries move into a B+tree of dblocks
+ * keyed by name and the dblocks of its old entries are given back. a name is then found
+ * by reading O(log n) dblocks, `list` and `tree` show the entries in name order and a
+ * pattern given to `list` only reads the names starting with its literal prefix. the
+ * directory stays sorted until it is removed, and `fs_compact` packs its tree again.
+ * the format needs dblocks of 64 bytes or more.
+ * 
+ * @param context the context containing information about the file system
+ * and the current working directory
+ * @param path the path of the directory relative to the current working directory
+ * @return 0 if successful (or the directory already was sorted), -1 on any failure.
+ */
+int fs_sort_directory(terminal_context_t *context, char *path);
+
+/**
+ * creates a directory and every missing directory on its path, like `mkdir -p`. the
+ * directories that already exist are kept, and the path may end with a `/`.
+ *
+ * @param context the context containing information about the file system
+ * and the current working directory
+ * @param path the path of the directory relative to the current working directory
+ * @return 0 if successful (or the directory already existed), -1 on any failure.
+ */
+int fs_make_directories(terminal_context_t *context, char *path);
+
+/**
+ * creates every path of a manifest along with the directories on the way. a path ending
+ * with `/` names a directory, any other path a new empty data file with permissions
+ * `perms`. directories that already exist are kept, a data file that already exists is a
+ * failure. the paths are sorted first and created in one pass, so the directories shared by
+ * neighbouring paths are looked up once. the objects created before a failure stay.
+ *
+ * @param context the context containing information about the file system
+ * and the current working directory
+ * @param paths the paths relative to the current working directory, left as they are
+ * @param count the number of paths
+ * @param perms the permissions of the new data files, masked like those of `new_file`
+ * @return 0 if successful, -1 on any failure.
+ */
+int fs_import_manifest(terminal_context_t *context, char **paths, size_t count, permission_t perms);
+
+/**
+ * removes a data file, or a directory with everything below it, like `rm -r`. the subtree
+ * is walked once to collect its objects before anything is released, then the data of
+ * every object goes, the inodes are released together and the entry of the top object is
+ * removed. the working directory cannot be in the subtree. a directory of the subtree whose
+ * entries cannot be read, e.g. on a dblock whose checksum does not match, fails the call
+ * before anything is released.
+ *
+ * @param context the context containing information about the file system
+ * and the current working directory
+ * @param path the path of the object relative to the current working directory
+ * @return 0 if successful, -1 on any failure.
+ */
+int remove_tree(terminal_context_t *context, char *path);
+
+typedef struct du_report
+{
+    size_t files;       // data files, counted once for every entry linking to them
+    size_t directories; // directories, the top one included
+    size_t bytes;       // sum of the sizes of the files and directories
+    size_t dblocks;     // dblocks held by the files and directories, index dblocks included
+} du_report_t;
+
+/**
+ * measures a directory and everything below it, like `du -s`. with subtree totals enabled
+ * (see subtree.h) the totals kept for the directory are returned as they are. otherwise
+ * the directories are read in parallel by `fs->traverse_threads` threads, see traverse.h.
+ * a data file is measured on its own.
+ *
+ * @param context the context containing information about the file system
+ * and the current working directory
+ * @param path the path of the object relative to the current working directory
+ * @param report the address to store the totals in
+ * @return 0 if successful, -1 on any failure.
+ */
+int fs_du(terminal_context_t *context, char *path, du_report_t *report);
+
+/**
+ * prints the path of every object below a directory whose name matches a pattern, like
+ * `find path -name pattern`. `*` stands for any run of characters and `?` for any one
+ * character, and a null pattern matches every name. the paths start with `path` and come
+ * in the order `tree` shows the objects in. the directories are read in parallel by
+ * `fs->traverse_threads` threads before anything is printed, see traverse.h.
+ *
+ * @param context the context containing information about the file system
+ * and the current working directory
+ * @param path the path of the directory relative to the current working directory
+ * @param pattern the pattern the names are matched against, or null
+ * @return 0 if successful, -1 on any failure or if nothing matches.
+ */
+int fs_find(terminal_context_t *context, char *path, char *pattern);
+
+typedef struct dentry_cache_stats
+{
+    size_t hits;          // lookups answered by the cache
+    size_t negative_hits; // hits that found the name missing
+    size_t misses;        // lookups that read the directory
+    size_t invalidations; // directory changes that dropped cached lookups
+} dentry_cache_stats_t;
+
+/**
+ * reads the counters of the dentry cache, which remembers recent lookups of a name in a
+ * directory, including lookups that found nothing. every path resolution goes through it.
+ * all counters are 0 if the cache has not been used yet.
+ * 
+ * @param fs the file system
+ * @param stats the address to store the counters in
+ */
+void fs_dentry_cache_stats(filesystem_t *fs, dentry_cache_stats_t *stats);
+
 /**
  * deletes a file in a directory 
  * 
@@ -510,7 +887,8 @@ int remove_directory(terminal_context_t *context, char *path);
 int change_directory(terminal_context_t *context, char *path);
 
 /**
- * list the contents of a directory
+ * list the contents of a directory. a last path component holding `*` or `?` is a pattern
+ * instead, and the entries of its directory whose names match it are listed
  * 
  * @param context the context the context containing information about the file system
  * and the current working directory
@@ -519,6 +897,46 @@ int change_directory(terminal_context_t *context, char *path);
  */
 int list(terminal_context_t *context, char *path);
 
+typedef struct fs_dir *fs_dir_t;
+
+typedef struct fs_dirent
+{
+    inode_index_t inode;              // the object the entry links to
+    file_type_t type;                 // the type of that object
+    size_t name_len;
+    char name[MAX_FILE_NAME_LEN + 1]; // null terminated
+} fs_dirent_t;
+
+/**
+ * opens a directory to read its entries one at a time with `fs_readdir`. the entries are
+ * read straight from the dblocks of the directory a dblock worth at a time, so nothing is
+ * allocated besides the handle and a reader can stop at any entry.
+ *
+ * @param context the context containing information about the file system
+ * and the current working directory
+ * @param path the path of the directory relative to the current working directory
+ * @return an address to the dynamically allocated directory handle, null on any error
+ */
+fs_dir_t fs_opendir(terminal_context_t *context, char *path);
+
+/**
+ * reads the next entry of an open directory, `.` and `..` included. tombstones are skipped,
+ * and a sorted directory gives its entries in name order. entries added or removed while
+ * the directory is open may or may not be read.
+ *
+ * @param dir the directory handle returned by `fs_opendir`
+ * @param entry the address to store the entry in
+ * @return 1 if an entry was read, 0 at the end of the directory or if an argument is null
+ */
+int fs_readdir(fs_dir_t dir, fs_dirent_t *entry);
+
+/**
+ * closes an open directory and frees its handle
+ *
+ * @param dir the directory handle to close
+ */
+void fs_closedir(fs_dir_t dir);
+
 /**
  * returns a string for the path of the working directory
  * 
@@ -529,7 +947,10 @@ int list(terminal_context_t *context, char *path);
 char *get_path_string(terminal_context_t *context);
 
 /**
- * displays the content of a directory as a tree
+ * displays the content of a directory as a tree. with one thread (see
+ * `fs->traverse_threads`) the entries are streamed with `fs_readdir` as they are printed.
+ * with more, the directories are read in parallel before the tree is printed in order, see
+ * traverse.h.
  * 
  * @param context the context contianing information about the file system and the current
  * working directory
@@ -555,6 +976,9 @@ int tree(terminal_context_t *context, char *path);
  * @param file the input file to load the file system from
  * @param fs the filesystem to write the content of the input file to
  * @return SUCCESS if the file system is correctly loaded
+ *         INVALID_BINARY_FORMAT if the file does not hold an image this build can load
+ *         SYSTEM_ERROR if memory runs out
+ *         nothing is left allocated in `fs` on failure
  */
 fs_retcode_t load_filesystem(FILE* file, filesystem_t *fs);
 
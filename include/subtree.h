@@ -0,0 +1,84 @@
+#ifndef SUBTREE_H
+#define SUBTREE_H
+
+#include "filesys.h"
+
+/**
+ * per directory totals of the subtree below it.
+ *
+ * the totals are optional. when `fs->subtrees` is null nothing is kept. when enabled with
+ * `fs_enable_subtree_totals`, every inode has an entry holding the directory it is linked
+ * in, what it takes itself and the totals of everything below it, itself included. a
+ * change to an inode adds its difference to the inode and every directory above it, so
+ * keeping the totals costs O(depth) per change and `fs_du` reads them in O(1).
+ *
+ * `inode_write_data`, `inode_modify_data`, `inode_copy_data` and `inode_shrink_data`
+ * account for the size of the inode they change. the directory functions link and unlink
+ * the objects they create, move and remove, and account for the nodes of sorted
+ * directories, whose dblocks do not follow from their size.
+ */
+
+// marks the subtree table appended to a saved image after the dblocks. `load_filesystem`
+// counts the totals again if a loaded entry is linked to anything but a directory
+#define SUBTREE_TRAILER_MAGIC "SUBTREES"
+#define SUBTREE_TRAILER_MAGIC_LEN 8
+
+// the fields are fixed width so the table is saved as it is
+struct subtree
+{
+    uint64_t parent;            // directory the inode is linked in plus one, 0 for the root and unlinked inodes
+    uint64_t bytes;             // size of the inode itself
+    uint64_t dblocks;           // dblocks held by the inode itself, index dblocks included
+    uint64_t total_files;       // data files of the subtree
+    uint64_t total_directories; // directories of the subtree
+    uint64_t total_bytes;       // sizes of the subtree
+    uint64_t total_dblocks;     // dblocks of the subtree
+};
+
+/**
+ * allocates the subtree table and fills it with one walk of the tree from the root
+ *
+ * @param fs the file system to keep subtree totals for
+ * @return SUCCESS if the totals are kept (or already were)
+ *         INVALID_INPUT if fs is null
+ *         SYSTEM_ERROR if the table cannot be allocated
+ */
+fs_retcode_t fs_enable_subtree_totals(filesystem_t *fs);
+
+/**
+ * frees the subtree table. `fs_du` walks the tree again.
+ */
+void fs_disable_subtree_totals(filesystem_t *fs);
+
+/**
+ * starts the entry of a newly claimed inode with no data, linked nowhere
+ */
+void subtree_reset(filesystem_t *fs, inode_t *inode);
+
+/**
+ * accounts for a change of the size of an inode. the dblocks of a sorted directory are
+ * left to `subtree_set_dblocks`.
+ */
+void subtree_update(filesystem_t *fs, inode_t *inode);
+
+/**
+ * sets the dblocks held by a sorted directory itself
+ */
+void subtree_set_dblocks(filesystem_t *fs, inode_t *dir, size_t dblocks);
+
+/**
+ * adds to the dblocks held by a sorted directory itself, when one of its nodes splits
+ */
+void subtree_add_dblocks(filesystem_t *fs, inode_t *dir, size_t dblocks);
+
+/**
+ * adds the subtree of an unlinked inode to a directory and the directories above it
+ */
+void subtree_link(filesystem_t *fs, inode_t *dir, inode_t *inode);
+
+/**
+ * takes the subtree of an inode out of the directories above it
+ */
+void subtree_unlink(filesystem_t *fs, inode_t *inode);
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef TRAVERSE_H
+#define TRAVERSE_H
+
+#include "filesys.h"
+
+/**
+ * parallel traversal of a directory tree.
+ *
+ * a traversal runs a visitor once on every directory reachable from a top directory. the
+ * visitor reads the directory and hands the subdirectories it finds back with
+ * `traverse_push`. every worker thread keeps its own deque of directories: it takes the
+ * newest one from its own deque, and once that is empty it steals the oldest one from
+ * another worker, so workers stay on their part of the tree until they run out of work.
+ *
+ * the calling thread is the first worker and starts alone. the other workers are only
+ * started once enough directories are waiting, so a small tree is walked without creating
+ * a thread. a directory is visited once even if several entries link to it.
+ *
+ * the file system must not change during a traversal and the visitor must only read it
+ * through functions that leave it untouched, which `inode_read_data` does not: it keeps
+ * read-ahead state.
+ */
+
+typedef struct traverse_worker traverse_worker_t;
+
+/**
+ * called once for every directory of a traversal, on any of its worker threads
+ *
+ * @param worker the worker running the visitor, for `traverse_push` and `traverse_worker_id`
+ * @param dir the index of the directory to visit
+ * @param arg the argument given to `fs_traverse`
+ */
+typedef void (*traverse_visit_t)(traverse_worker_t *worker, inode_index_t dir, void *arg);
+
+// the most worker threads a traversal uses
+#define TRAVERSE_MAX_THREADS 64
+
+/**
+ * visits every directory reachable from `top`, `top` included
+ *
+ * @param fs the file system to walk
+ * @param top the index of the directory to start at
+ * @param thread_count the number of worker threads, 0 to use every online cpu
+ * @param visit the visitor
+ * @param arg passed to every call of `visit`
+ * @return SUCCESS if every directory was visited.
+ *         INVALID_INPUT if `fs` or `visit` is null or `top` is not a directory.
+ *         SYSTEM_ERROR if memory ran out, in which case some directories may be left out.
+ */
+fs_retcode_t fs_traverse(filesystem_t *fs, inode_index_t top, size_t thread_count, traverse_visit_t visit, void *arg);
+
+/**
+ * queues a directory to be visited. a directory that was queued before is ignored.
+ */
+void traverse_push(traverse_worker_t *worker, inode_index_t dir);
+
+/**
+ * makes the traversal fail with SYSTEM_ERROR, for a visitor that ran out of memory. the
+ * remaining directories are still visited.
+ */
+void traverse_fail(traverse_worker_t *worker);
+
+/**
+ * @return the number of the worker, below the thread count of the traversal, so a visitor
+ * can keep per thread state in an array
+ */
+size_t traverse_worker_id(const traverse_worker_t *worker);
+
+/**
+ * @return the number of worker threads a traversal with `thread_count` threads uses
+ */
+size_t traverse_thread_count(size_t thread_count);
+
+#endif
@@ -7,9 +7,9 @@
 
 #include <stddef.h>
 
-size_t calculate_index_dblock_amount(size_t file_size);
+size_t calculate_index_dblock_amount(const filesystem_t *fs, size_t file_size);
 
-size_t calculate_necessary_dblock_amount(size_t file_size);
+size_t calculate_necessary_dblock_amount(const filesystem_t *fs, size_t file_size);
 
 dblock_index_t *cast_dblock_ptr(void *addr);
 
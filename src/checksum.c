@@ -0,0 +1,342 @@
+#include "filesys.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "debug.h"
+#include "block_map.h"
+#include "checksum.h"
+
+#define CRC32C_POLY 0x82F63B78 // reflected Castagnoli polynomial
+#define SCRUB_MAX_THREADS 64
+#define SCRUB_REPORTED_MISMATCHES (sizeof(((scrub_report_t*) 0)->mismatches) / sizeof(dblock_index_t))
+
+#define DBLOCK_ADDR(fs, idx) (&(fs)->dblocks[(size_t)(idx) * DATA_BLOCK_SIZE(fs)])
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CRC32C_HAS_SSE42_PATH 1
+#else
+#define CRC32C_HAS_SSE42_PATH 0
+#endif
+
+// ----------------------- CRC32C ----------------------- //
+
+// slicing by 8 tables for the software fallback
+static uint32_t crc_table[8][256];
+static pthread_once_t crc_table_once = PTHREAD_ONCE_INIT;
+
+static void build_crc_table(void)
+{
+    for (uint32_t i = 0; i < 256; ++i)
+    {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit) crc = (crc >> 1) ^ (CRC32C_POLY & (0u - (crc & 1)));
+        crc_table[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; ++i)
+    {
+        for (int slice = 1; slice < 8; ++slice)
+        {
+            uint32_t prev = crc_table[slice - 1][i];
+            crc_table[slice][i] = (prev >> 8) ^ crc_table[0][prev & 0xFF];
+        }
+    }
+}
+
+uint32_t crc32c_table(uint32_t crc, const void *data, size_t n)
+{
+    pthread_once(&crc_table_once, build_crc_table);
+
+    const byte *p = data;
+    crc = ~crc;
+    while (n >= 8)
+    {
+        uint32_t lo, hi;
+        memcpy(&lo, p, sizeof(lo));
+        memcpy(&hi, p + 4, sizeof(hi));
+        lo ^= crc;
+        crc = crc_table[7][lo & 0xFF] ^ crc_table[6][(lo >> 8) & 0xFF] ^
+              crc_table[5][(lo >> 16) & 0xFF] ^ crc_table[4][lo >> 24] ^
+              crc_table[3][hi & 0xFF] ^ crc_table[2][(hi >> 8) & 0xFF] ^
+              crc_table[1][(hi >> 16) & 0xFF] ^ crc_table[0][hi >> 24];
+        p += 8;
+        n -= 8;
+    }
+    while (n--) crc = (crc >> 8) ^ crc_table[0][(crc ^ *p++) & 0xFF];
+    return ~crc;
+}
+
+#if CRC32C_HAS_SSE42_PATH
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_sse42(uint32_t crc, const void *data, size_t n)
+{
+    const byte *p = data;
+    uint64_t crc64 = ~crc;
+    while (n >= 8)
+    {
+        uint64_t word;
+        memcpy(&word, p, sizeof(word));
+        crc64 = __builtin_ia32_crc32di(crc64, word);
+        p += 8;
+        n -= 8;
+    }
+    uint32_t crc32 = crc64;
+    while (n--) crc32 = __builtin_ia32_crc32qi(crc32, *p++);
+    return ~crc32;
+}
+
+// the crc32 instruction has a latency of three cycles but a throughput of one per cycle, so
+// checksumming four independent dblocks at once keeps the unit busy
+__attribute__((target("sse4.2")))
+static void dblock_crc_x4_sse42(const byte *blocks[4], size_t size, uint32_t out[4])
+{
+    uint64_t c0 = 0xFFFFFFFF, c1 = 0xFFFFFFFF, c2 = 0xFFFFFFFF, c3 = 0xFFFFFFFF;
+    for (size_t offset = 0; offset + 8 <= size; offset += 8)
+    {
+        uint64_t w0, w1, w2, w3;
+        memcpy(&w0, blocks[0] + offset, sizeof(w0));
+        memcpy(&w1, blocks[1] + offset, sizeof(w1));
+        memcpy(&w2, blocks[2] + offset, sizeof(w2));
+        memcpy(&w3, blocks[3] + offset, sizeof(w3));
+        c0 = __builtin_ia32_crc32di(c0, w0);
+        c1 = __builtin_ia32_crc32di(c1, w1);
+        c2 = __builtin_ia32_crc32di(c2, w2);
+        c3 = __builtin_ia32_crc32di(c3, w3);
+    }
+    out[0] = ~(uint32_t) c0;
+    out[1] = ~(uint32_t) c1;
+    out[2] = ~(uint32_t) c2;
+    out[3] = ~(uint32_t) c3;
+}
+#endif
+
+int crc32c_hardware_available(void)
+{
+#if CRC32C_HAS_SSE42_PATH
+    return __builtin_cpu_supports("sse4.2");
+#else
+    return 0;
+#endif
+}
+
+uint32_t crc32c(uint32_t crc, const void *data, size_t n)
+{
+#if CRC32C_HAS_SSE42_PATH
+    if (__builtin_cpu_supports("sse4.2")) return crc32c_sse42(crc, data, n);
+#endif
+    return crc32c_table(crc, data, n);
+}
+
+// ----------------------- CHECKSUM TABLE ----------------------- //
+
+static uint32_t dblock_crc(filesystem_t *fs, dblock_index_t dblock)
+{
+    return crc32c(0, DBLOCK_ADDR(fs, dblock), DATA_BLOCK_SIZE(fs));
+}
+
+static void dblock_crc_x4(filesystem_t *fs, const size_t dblocks[4], uint32_t out[4])
+{
+// every dblock size is a multiple of 8, so the blocks are read a word at a time
+#if CRC32C_HAS_SSE42_PATH
+    if (__builtin_cpu_supports("sse4.2"))
+    {
+        const byte *blocks[4] = {
+            DBLOCK_ADDR(fs, dblocks[0]), DBLOCK_ADDR(fs, dblocks[1]),
+            DBLOCK_ADDR(fs, dblocks[2]), DBLOCK_ADDR(fs, dblocks[3])
+        };
+        dblock_crc_x4_sse42(blocks, DATA_BLOCK_SIZE(fs), out);
+        return;
+    }
+#endif
+    for (size_t i = 0; i < 4; ++i) out[i] = dblock_crc(fs, dblocks[i]);
+}
+
+static int dblock_allocated(filesystem_t *fs, size_t dblock)
+{
+    return !(fs->dblock_bitmask[dblock / 8] & (1 << (7 - dblock % 8)));
+}
+
+fs_retcode_t fs_enable_checksums(filesystem_t *fs)
+{
+    if (!fs) return INVALID_INPUT;
+    if (fs->dblock_checksums) return SUCCESS;
+
+    uint32_t *table = malloc(fs->dblock_count * sizeof(uint32_t));
+    if (!table) return SYSTEM_ERROR;
+    for (size_t i = 0; i < fs->dblock_count; ++i) table[i] = dblock_crc(fs, i);
+
+    fs->dblock_checksums = table;
+    return SUCCESS;
+}
+
+void fs_disable_checksums(filesystem_t *fs)
+{
+    if (!fs) return;
+    free(fs->dblock_checksums);
+    fs->dblock_checksums = NULL;
+}
+
+void checksum_update_dblock(filesystem_t *fs, dblock_index_t dblock)
+{
+    if (!fs || !fs->dblock_checksums) return;
+    fs->dblock_checksums[dblock] = dblock_crc(fs, dblock);
+}
+
+void checksum_update_range(filesystem_t *fs, inode_t *inode, size_t offset, size_t n)
+{
+    if (!fs || !inode || !fs->dblock_checksums || n == 0) return;
+
+    size_t file_size = inode->internal.file_size;
+    if (offset >= file_size) return;
+    if (n > file_size - offset) n = file_size - offset;
+
+    size_t first = offset / DATA_BLOCK_SIZE(fs);
+    size_t last = (offset + n - 1) / DATA_BLOCK_SIZE(fs);
+    // an append starting on a block boundary may have linked a new index dblock to the
+    // index dblock of the previous block
+    if (first > 0 && offset % DATA_BLOCK_SIZE(fs) == 0) --first;
+
+    block_cursor_t cursor;
+    block_cursor_seek(fs, inode, &cursor, first);
+    int have_index = 0;
+    dblock_index_t last_index = 0;
+    for (size_t block = first; block <= last; ++block)
+    {
+        checksum_update_dblock(fs, block_cursor_dblock(fs, inode, &cursor));
+        if (block >= INODE_DIRECT_BLOCK_COUNT && (!have_index || cursor.index_dblock != last_index))
+        {
+            checksum_update_dblock(fs, cursor.index_dblock);
+            last_index = cursor.index_dblock;
+            have_index = 1;
+        }
+        if (block < last) block_cursor_next(fs, inode, &cursor);
+    }
+}
+
+fs_retcode_t checksum_verify_dblock(filesystem_t *fs, dblock_index_t dblock)
+{
+    if (!fs || !fs->dblock_checksums) return SUCCESS;
+    return fs->dblock_checksums[dblock] == dblock_crc(fs, dblock) ? SUCCESS : CHECKSUM_MISMATCH;
+}
+
+// ----------------------- SCRUB ----------------------- //
+
+struct scrub_task
+{
+    filesystem_t *fs;
+    size_t begin;
+    size_t end;
+    size_t checked;
+    size_t mismatch_count;
+    dblock_index_t mismatches[SCRUB_REPORTED_MISMATCHES];
+};
+
+static void scrub_check(struct scrub_task *task, size_t dblock, uint32_t crc)
+{
+    ++task->checked;
+    if (task->fs->dblock_checksums[dblock] == crc) return;
+    if (task->mismatch_count < SCRUB_REPORTED_MISMATCHES) task->mismatches[task->mismatch_count] = dblock;
+    ++task->mismatch_count;
+}
+
+static void *scrub_worker(void *arg)
+{
+    struct scrub_task *task = arg;
+    filesystem_t *fs = task->fs;
+
+    // allocated dblocks are batched by four so their checksums are computed together
+    size_t batch[4];
+    size_t batched = 0;
+    size_t i = task->begin;
+    while (i < task->end)
+    {
+        // skip eight free dblocks at a time
+        if (i % 8 == 0 && i + 8 <= task->end && fs->dblock_bitmask[i / 8] == 0xFF)
+        {
+            i += 8;
+            continue;
+        }
+        if (dblock_allocated(fs, i)) batch[batched++] = i;
+        if (batched == 4)
+        {
+            uint32_t crcs[4];
+            dblock_crc_x4(fs, batch, crcs);
+            for (size_t b = 0; b < 4; ++b) scrub_check(task, batch[b], crcs[b]);
+            batched = 0;
+        }
+        ++i;
+    }
+    for (size_t b = 0; b < batched; ++b) scrub_check(task, batch[b], dblock_crc(fs, batch[b]));
+    return NULL;
+}
+
+fs_retcode_t fs_scrub(filesystem_t *fs, size_t thread_count, scrub_report_t *report)
+{
+    if (!fs || !report || !fs->dblock_checksums) return INVALID_INPUT;
+
+    if (thread_count == 0)
+    {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        thread_count = online > 0 ? (size_t) online : 1;
+    }
+    if (thread_count > SCRUB_MAX_THREADS) thread_count = SCRUB_MAX_THREADS;
+
+    // ranges are split on whole bitmask bytes so every task can skip free runs
+    size_t bitmask_bytes = (fs->dblock_count + 7) / 8;
+    if (thread_count > bitmask_bytes) thread_count = bitmask_bytes ? bitmask_bytes : 1;
+    size_t bytes_per_task = (bitmask_bytes + thread_count - 1) / thread_count;
+
+    // build the software table up front so the workers never race on it
+    crc32c_table(0, NULL, 0);
+
+    struct scrub_task tasks[SCRUB_MAX_THREADS];
+    pthread_t threads[SCRUB_MAX_THREADS];
+    memset(tasks, 0, sizeof(tasks));
+
+    double start;
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        start = (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+    }
+
+    size_t started = 0;
+    for (size_t t = 0; t < thread_count; ++t)
+    {
+        tasks[t].fs = fs;
+        tasks[t].begin = t * bytes_per_task * 8;
+        tasks[t].end = (t + 1) * bytes_per_task * 8;
+        if (tasks[t].begin > fs->dblock_count) tasks[t].begin = fs->dblock_count;
+        if (tasks[t].end > fs->dblock_count) tasks[t].end = fs->dblock_count;
+
+        // the calling thread takes the first range itself
+        if (t == 0) continue;
+        if (pthread_create(&threads[t], NULL, scrub_worker, &tasks[t]) != 0) break;
+        ++started;
+    }
+    scrub_worker(&tasks[0]);
+    for (size_t t = 1; t <= started; ++t) pthread_join(threads[t], NULL);
+
+    // a worker that could not be started leaves its range unscrubbed, so finish it here
+    for (size_t t = started + 1; t < thread_count; ++t) scrub_worker(&tasks[t]);
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    memset(report, 0, sizeof(*report));
+    report->seconds = (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9 - start;
+    for (size_t t = 0; t < thread_count; ++t)
+    {
+        report->dblocks_checked += tasks[t].checked;
+        for (size_t m = 0; m < tasks[t].mismatch_count && m < SCRUB_REPORTED_MISMATCHES; ++m)
+        {
+            if (report->mismatch_count + m < SCRUB_REPORTED_MISMATCHES)
+                report->mismatches[report->mismatch_count + m] = tasks[t].mismatches[m];
+        }
+        report->mismatch_count += tasks[t].mismatch_count;
+    }
+    return SUCCESS;
+}
@@ -0,0 +1,450 @@
+#include "filesys.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "utility.h"
+#include "debug.h"
+#include "compress.h"
+
+// LZ77 codec in the style of LZ4. the compressed data is a list of sequences:
+//
+//      [ token ][ literal length ext ][ literals ][ offset (2 bytes) ][ match length ext ]
+//
+// the upper nibble of the token is the literal count, the lower nibble is the match length
+// minus LZ_MIN_MATCH. a nibble of 15 is followed by extension bytes that are summed until a
+// byte other than 255 is read. the final sequence only has literals.
+#define LZ_MIN_MATCH 4
+#define LZ_LAST_LITERALS 5
+#define LZ_MAX_OFFSET 65535
+#define LZ_HASH_BITS 12
+#define LZ_NIBBLE_MAX 15
+
+#define CHUNK_OFFSET_SIZE sizeof(uint32_t)
+
+struct chunk_cache_entry
+{
+    inode_t *inode; // null if the entry is unused
+    size_t chunk;
+    size_t length;
+    unsigned long last_use;
+    byte data[COMPRESS_CHUNK_SIZE];
+};
+
+struct chunk_cache
+{
+    unsigned long clock;
+    struct chunk_cache_entry entries[COMPRESS_CACHE_ENTRIES];
+};
+
+// ----------------------- CODEC ----------------------- //
+
+static uint32_t read_u32(const byte *p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint32_t lz_hash(uint32_t sequence)
+{
+    return (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+// number of bytes needed to store the extension of a length
+static size_t length_ext_size(size_t length)
+{
+    return length < LZ_NIBBLE_MAX ? 0 : (length - LZ_NIBBLE_MAX) / 255 + 1;
+}
+
+static byte *write_length_ext(byte *out, size_t length)
+{
+    if (length < LZ_NIBBLE_MAX) return out;
+    length -= LZ_NIBBLE_MAX;
+    while (length >= 255)
+    {
+        *out++ = 255;
+        length -= 255;
+    }
+    *out++ = (byte) length;
+    return out;
+}
+
+// emits one sequence. a match length of 0 marks the final literal only sequence.
+// returns null if the sequence does not fit.
+static byte *emit_sequence(byte *out, byte *out_end, const byte *literals, size_t literal_len, size_t offset, size_t match_len)
+{
+    size_t match_code = match_len ? match_len - LZ_MIN_MATCH : 0;
+    size_t needed = 1 + length_ext_size(literal_len) + literal_len;
+    if (match_len) needed += 2 + length_ext_size(match_code);
+    if ((size_t) (out_end - out) < needed) return NULL;
+
+    byte literal_nibble = literal_len < LZ_NIBBLE_MAX ? literal_len : LZ_NIBBLE_MAX;
+    byte match_nibble = match_code < LZ_NIBBLE_MAX ? match_code : LZ_NIBBLE_MAX;
+    *out++ = (byte) (literal_nibble << 4 | match_nibble);
+    out = write_length_ext(out, literal_len);
+    memcpy(out, literals, literal_len);
+    out += literal_len;
+
+    if (match_len)
+    {
+        *out++ = offset & 0xFF;
+        *out++ = offset >> 8;
+        out = write_length_ext(out, match_code);
+    }
+    return out;
+}
+
+size_t lz_compress(const byte *src, size_t n, byte *dst, size_t capacity)
+{
+    if (!src || !dst) return 0;
+
+    uint32_t table[1 << LZ_HASH_BITS] = { 0 };
+    byte *out = dst;
+    byte *out_end = dst + capacity;
+    size_t anchor = 0;
+
+    // matches never cover the last few bytes so the decoder can always finish on literals
+    if (n > LZ_MIN_MATCH + LZ_LAST_LITERALS)
+    {
+        size_t match_limit = n - LZ_LAST_LITERALS;
+        size_t pos = 0;
+        while (pos + LZ_MIN_MATCH <= match_limit)
+        {
+            uint32_t sequence = read_u32(src + pos);
+            uint32_t hash = lz_hash(sequence);
+            size_t candidate = table[hash];
+            table[hash] = pos;
+
+            if (candidate >= pos || pos - candidate > LZ_MAX_OFFSET || read_u32(src + candidate) != sequence)
+            {
+                ++pos;
+                continue;
+            }
+
+            size_t match_len = LZ_MIN_MATCH;
+            while (pos + match_len < match_limit && src[candidate + match_len] == src[pos + match_len]) ++match_len;
+
+            out = emit_sequence(out, out_end, src + anchor, pos - anchor, pos - candidate, match_len);
+            if (!out) return 0;
+
+            pos += match_len;
+            anchor = pos;
+        }
+    }
+
+    out = emit_sequence(out, out_end, src + anchor, n - anchor, 0, 0);
+    if (!out) return 0;
+    return out - dst;
+}
+
+// reads a length extension. returns false if the input ends early
+static int read_length_ext(const byte **in, const byte *in_end, size_t *length)
+{
+    if (*length != LZ_NIBBLE_MAX) return 1;
+    byte ext;
+    do
+    {
+        if (*in >= in_end) return 0;
+        ext = *(*in)++;
+        *length += ext;
+    } while (ext == 255);
+    return 1;
+}
+
+size_t lz_decompress(const byte *src, size_t n, byte *dst, size_t capacity)
+{
+    if (!src || !dst) return (size_t) -1;
+
+    const byte *in = src;
+    const byte *in_end = src + n;
+    byte *out = dst;
+    byte *out_end = dst + capacity;
+
+    while (in < in_end)
+    {
+        byte token = *in++;
+
+        size_t literal_len = token >> 4;
+        if (!read_length_ext(&in, in_end, &literal_len)) return (size_t) -1;
+        if ((size_t) (in_end - in) < literal_len || (size_t) (out_end - out) < literal_len) return (size_t) -1;
+        memcpy(out, in, literal_len);
+        in += literal_len;
+        out += literal_len;
+
+        // the final sequence has no match
+        if (in == in_end) break;
+
+        if (in_end - in < 2) return (size_t) -1;
+        size_t offset = in[0] | (size_t) in[1] << 8;
+        in += 2;
+        if (offset == 0 || offset > (size_t) (out - dst)) return (size_t) -1;
+
+        size_t match_len = token & LZ_NIBBLE_MAX;
+        if (!read_length_ext(&in, in_end, &match_len)) return (size_t) -1;
+        match_len += LZ_MIN_MATCH;
+        if ((size_t) (out_end - out) < match_len) return (size_t) -1;
+
+        const byte *match = out - offset;
+        if (offset >= match_len)
+        {
+            memcpy(out, match, match_len);
+            out += match_len;
+        }
+        else
+        {
+            // overlapping matches repeat the last `offset` bytes
+            for (size_t i = 0; i < match_len; ++i) *out++ = match[i];
+        }
+    }
+
+    return out - dst;
+}
+
+// ----------------------- COMPRESSED FILES ----------------------- //
+
+static fs_retcode_t read_header(filesystem_t *fs, inode_t *inode, compressed_header_t *header)
+{
+    size_t bytes_read = 0;
+    fs_retcode_t ret = inode_read_raw_data(fs, inode, 0, header, sizeof(*header), &bytes_read);
+    if (ret != SUCCESS) return ret;
+    if (bytes_read != sizeof(*header) || header->magic != COMPRESSED_MAGIC || header->chunk_size != COMPRESS_CHUNK_SIZE)
+    {
+        return INVALID_BINARY_FORMAT;
+    }
+    return SUCCESS;
+}
+
+static size_t chunk_length(compressed_header_t *header, size_t chunk)
+{
+    size_t remaining = header->logical_size - chunk * header->chunk_size;
+    return remaining < header->chunk_size ? remaining : header->chunk_size;
+}
+
+// decompresses a chunk of a compressed inode into `out` which holds COMPRESS_CHUNK_SIZE bytes
+static fs_retcode_t load_chunk(filesystem_t *fs, inode_t *inode, compressed_header_t *header, size_t chunk, byte *out)
+{
+    uint32_t bounds[2];
+    size_t bytes_read = 0;
+    fs_retcode_t ret = inode_read_raw_data(fs, inode, sizeof(*header) + chunk * CHUNK_OFFSET_SIZE, bounds, sizeof(bounds), &bytes_read);
+    if (ret != SUCCESS) return ret;
+    if (bytes_read != sizeof(bounds) || bounds[1] < bounds[0]) return INVALID_BINARY_FORMAT;
+
+    size_t payload_len = bounds[1] - bounds[0];
+    size_t length = chunk_length(header, chunk);
+    if (payload_len > length) return INVALID_BINARY_FORMAT;
+
+    // a payload as long as the chunk was stored raw
+    if (payload_len == length)
+    {
+        ret = inode_read_raw_data(fs, inode, bounds[0], out, length, &bytes_read);
+        if (ret != SUCCESS) return ret;
+        return bytes_read == length ? SUCCESS : INVALID_BINARY_FORMAT;
+    }
+
+    byte payload[COMPRESS_CHUNK_SIZE];
+    ret = inode_read_raw_data(fs, inode, bounds[0], payload, payload_len, &bytes_read);
+    if (ret != SUCCESS) return ret;
+    if (bytes_read != payload_len) return INVALID_BINARY_FORMAT;
+    if (lz_decompress(payload, payload_len, out, length) != length) return INVALID_BINARY_FORMAT;
+    return SUCCESS;
+}
+
+// returns the cache entry holding the decompressed chunk, loading it on a miss
+static fs_retcode_t cached_chunk(filesystem_t *fs, inode_t *inode, compressed_header_t *header, size_t chunk, struct chunk_cache_entry **entry)
+{
+    if (!fs->chunk_cache)
+    {
+        fs->chunk_cache = calloc(1, sizeof(struct chunk_cache));
+        if (!fs->chunk_cache) return SYSTEM_ERROR;
+    }
+
+    struct chunk_cache *cache = fs->chunk_cache;
+    struct chunk_cache_entry *victim = &cache->entries[0];
+    for (size_t i = 0; i < COMPRESS_CACHE_ENTRIES; ++i)
+    {
+        struct chunk_cache_entry *candidate = &cache->entries[i];
+        if (candidate->inode == inode && candidate->chunk == chunk)
+        {
+            candidate->last_use = ++cache->clock;
+            *entry = candidate;
+            return SUCCESS;
+        }
+        // prefer unused entries, then the least recently used one
+        if (!candidate->inode) victim = candidate;
+        else if (victim->inode && candidate->last_use < victim->last_use) victim = candidate;
+    }
+
+    victim->inode = NULL;
+    fs_retcode_t ret = load_chunk(fs, inode, header, chunk, victim->data);
+    if (ret != SUCCESS) return ret;
+
+    victim->inode = inode;
+    victim->chunk = chunk;
+    victim->length = chunk_length(header, chunk);
+    victim->last_use = ++cache->clock;
+    *entry = victim;
+    return SUCCESS;
+}
+
+void compress_cache_invalidate(filesystem_t *fs, inode_t *inode)
+{
+    if (!fs || !fs->chunk_cache) return;
+    for (size_t i = 0; i < COMPRESS_CACHE_ENTRIES; ++i)
+    {
+        if (fs->chunk_cache->entries[i].inode == inode) fs->chunk_cache->entries[i].inode = NULL;
+    }
+}
+
+fs_retcode_t compressed_read_data(filesystem_t *fs, inode_t *inode, size_t offset, void *buffer, size_t n, size_t *bytes_read)
+{
+    if (fs == NULL || inode == NULL || buffer == NULL || bytes_read == NULL) return INVALID_INPUT;
+
+    *bytes_read = 0;
+    compressed_header_t header;
+    fs_retcode_t ret = read_header(fs, inode, &header);
+    if (ret != SUCCESS) return ret;
+
+    if (offset >= header.logical_size) return SUCCESS;
+    if (n > header.logical_size - offset) n = header.logical_size - offset;
+
+    byte *dst = buffer;
+    while (*bytes_read < n)
+    {
+        size_t chunk = offset / header.chunk_size;
+        size_t in_chunk = offset % header.chunk_size;
+
+        struct chunk_cache_entry *entry;
+        ret = cached_chunk(fs, inode, &header, chunk, &entry);
+        if (ret != SUCCESS) return ret;
+
+        size_t take = entry->length - in_chunk;
+        if (take > n - *bytes_read) take = n - *bytes_read;
+        memcpy(dst + *bytes_read, entry->data + in_chunk, take);
+        *bytes_read += take;
+        offset += take;
+    }
+
+    return SUCCESS;
+}
+
+size_t inode_data_size(filesystem_t *fs, inode_t *inode)
+{
+    if (!fs || !inode) return 0;
+    if (!(inode->internal.file_perms & FS_COMPRESSED)) return inode->internal.file_size;
+
+    compressed_header_t header;
+    if (read_header(fs, inode, &header) != SUCCESS) return 0;
+    return header.logical_size;
+}
+
+fs_retcode_t inode_compress_data(filesystem_t *fs, inode_t *inode)
+{
+    if (fs == NULL || inode == NULL) return INVALID_INPUT;
+    if (inode->internal.file_type != DATA_FILE) return INVALID_INPUT;
+    if (inode->internal.file_perms & FS_COMPRESSED) return SUCCESS;
+
+    size_t logical_size = inode->internal.file_size;
+    if (logical_size == 0) return SUCCESS;
+
+    size_t chunk_count = (logical_size + COMPRESS_CHUNK_SIZE - 1) / COMPRESS_CHUNK_SIZE;
+    size_t table_size = sizeof(compressed_header_t) + (chunk_count + 1) * CHUNK_OFFSET_SIZE;
+    // the chunk offsets are 32 bits wide, so the stream has to fit below 4 GiB
+    if (logical_size > UINT32_MAX - table_size) return INVALID_INPUT;
+
+    byte *raw = malloc(logical_size);
+    // every chunk is at most stored raw, so the stream is never larger than this
+    byte *stream = malloc(table_size + logical_size);
+    if (!raw || !stream)
+    {
+        free(raw);
+        free(stream);
+        return SYSTEM_ERROR;
+    }
+
+    size_t bytes_read = 0;
+    fs_retcode_t ret = inode_read_raw_data(fs, inode, 0, raw, logical_size, &bytes_read);
+    if (ret == SUCCESS && bytes_read != logical_size) ret = INVALID_BINARY_FORMAT;
+    if (ret != SUCCESS)
+    {
+        free(raw);
+        free(stream);
+        return ret;
+    }
+
+    compressed_header_t header = {
+        .magic = COMPRESSED_MAGIC,
+        .chunk_size = COMPRESS_CHUNK_SIZE,
+        .logical_size = logical_size,
+        .chunk_count = chunk_count,
+        .reserved = 0
+    };
+    memcpy(stream, &header, sizeof(header));
+
+    size_t pos = table_size;
+    for (size_t chunk = 0; chunk < chunk_count; ++chunk)
+    {
+        uint32_t chunk_offset = pos;
+        memcpy(stream + sizeof(header) + chunk * CHUNK_OFFSET_SIZE, &chunk_offset, CHUNK_OFFSET_SIZE);
+
+        const byte *src = raw + chunk * COMPRESS_CHUNK_SIZE;
+        size_t length = chunk_length(&header, chunk);
+        // the payload must be strictly smaller than the chunk, otherwise it is stored raw
+        size_t compressed = lz_compress(src, length, stream + pos, length - 1);
+        if (compressed == 0)
+        {
+            memcpy(stream + pos, src, length);
+            compressed = length;
+        }
+        pos += compressed;
+    }
+    uint32_t stream_end = pos;
+    memcpy(stream + sizeof(header) + chunk_count * CHUNK_OFFSET_SIZE, &stream_end, CHUNK_OFFSET_SIZE);
+
+    // only switch to the compressed stream if it actually frees dblocks
+    if (calculate_necessary_dblock_amount(fs, pos) < calculate_necessary_dblock_amount(fs, logical_size))
+    {
+        inode_shrink_data(fs, inode, 0);
+        fs_assert_success(inode_write_data(fs, inode, stream, pos));
+        inode->internal.file_perms |= FS_COMPRESSED;
+        compress_cache_invalidate(fs, inode);
+    }
+
+    free(raw);
+    free(stream);
+    return SUCCESS;
+}
+
+fs_retcode_t inode_decompress_data(filesystem_t *fs, inode_t *inode)
+{
+    if (fs == NULL || inode == NULL) return INVALID_INPUT;
+    if (!(inode->internal.file_perms & FS_COMPRESSED)) return SUCCESS;
+
+    compressed_header_t header;
+    fs_retcode_t ret = read_header(fs, inode, &header);
+    if (ret != SUCCESS) return ret;
+
+    // the compressed dblocks are released before the raw data is written back
+    size_t available = available_dblocks(fs) + calculate_necessary_dblock_amount(fs, inode->internal.file_size);
+    if (available < calculate_necessary_dblock_amount(fs, header.logical_size)) return INSUFFICIENT_DBLOCKS;
+
+    byte *raw = malloc(header.logical_size ? header.logical_size : 1);
+    if (!raw) return SYSTEM_ERROR;
+
+    size_t bytes_read = 0;
+    ret = compressed_read_data(fs, inode, 0, raw, header.logical_size, &bytes_read);
+    if (ret == SUCCESS && bytes_read != header.logical_size) ret = INVALID_BINARY_FORMAT;
+    if (ret != SUCCESS)
+    {
+        free(raw);
+        return ret;
+    }
+
+    inode->internal.file_perms &= ~FS_COMPRESSED;
+    compress_cache_invalidate(fs, inode);
+    inode_shrink_data(fs, inode, 0);
+    fs_assert_success(inode_write_data(fs, inode, raw, header.logical_size));
+
+    free(raw);
+    return SUCCESS;
+}
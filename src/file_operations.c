@@ -1,972 +1,3144 @@
 #include "filesys.h"
 #include "debug.h"
 #include "utility.h"
+#include "compress.h"
+#include "block_map.h"
+#include "checksum.h"
+#include "traverse.h"
+#include "subtree.h"
+#include "dir_index.h"
 
 #include <string.h>
+#include <stdlib.h>
 
-#define DIRECTORY_ENTRY_SIZE (sizeof(inode_index_t) + MAX_FILE_NAME_LEN)
-#define DIRECTORY_ENTRIES_PER_DATABLOCK (DATA_BLOCK_SIZE / DIRECTORY_ENTRY_SIZE)
+// ----------------------- DIRECTORY ENTRIES ------------------- //
 
-// ----------------------- HELPER FUNCTION --------------------- //
-void format_token_for_comparison(char* token, char formatted_name[14]) {
-    if (token == NULL) {
-        memset(formatted_name, 0, 14);
-        return;
-    }
-    size_t len = strlen(token);
-    if (len >= 14) {
-        memcpy(formatted_name, token, 14);
-    } else {
-        strcpy(formatted_name, token);
-        memset(formatted_name + len + 1, ' ', 14 - len - 1);
+// an entry of a directory. a tombstone has an empty name. in the data of the directory it
+// is stored as the inode index in the width of the image followed by the name,
+// DIRECTORY_ENTRY_SIZE bytes without padding
+typedef struct directory_entry
+{
+    inode_index_t inode;
+    char name[MAX_FILE_NAME_LEN];
+} directory_entry_t;
+
+static void decode_entry(const filesystem_t *fs, const byte *raw, directory_entry_t *entry)
+{
+    if (fs->index_width == NARROW_INODE_INDEX_WIDTH)
+    {
+        uint16_t index;
+        memcpy(&index, raw, sizeof(index));
+        entry->inode = index;
     }
+    else memcpy(&entry->inode, raw, sizeof(inode_index_t));
+    memcpy(entry->name, raw + fs->index_width, MAX_FILE_NAME_LEN);
 }
 
-char* format_filename(char* filename) {
-    if (filename == NULL) {
-        return NULL;
-    }    
-    size_t len = strlen(filename);
-    if (len < 14) {
-        memset(filename + len + 1, ' ', 14 - len - 1);
+static void encode_entry(const filesystem_t *fs, const directory_entry_t *entry, byte *raw)
+{
+    if (fs->index_width == NARROW_INODE_INDEX_WIDTH)
+    {
+        uint16_t index = (uint16_t) entry->inode;
+        memcpy(raw, &index, sizeof(index));
     }
-    return filename;
+    else memcpy(raw, &entry->inode, sizeof(inode_index_t));
+    memcpy(raw + fs->index_width, entry->name, MAX_FILE_NAME_LEN);
 }
 
-int count_char_occurrences(const char *str, char target) {
-    int count = 0;
-    if (str != NULL) {
-        for (int i = 0; str[i] != '\0'; i++) {
-            if (str[i] == target) {
-                count++;
-            }
-        }
+// length of a name that is only null terminated if shorter than MAX_FILE_NAME_LEN
+static size_t entry_name_length(const char *name)
+{
+    size_t len = 0;
+    while (len < MAX_FILE_NAME_LEN && name[len] != '\0') ++len;
+    return len;
+}
+
+// ----------------------- SORTED DIRECTORIES ------------------ //
+
+// a sorted directory keeps its entries in a B+tree keyed by name, so a name is found by
+// reading O(log n) dblocks and the entries come out in name order. every node is a dblock
+// and nodes point to each other by dblock index, so the block map of the directory is not
+// used: `direct_data[0]` holds the root and `file_size` counts the entries as if they were
+// stored in a row. nodes are not merged when entries are removed, `fs_compact` packs the
+// tree again
+//
+//      leaf:      [ header ][ entry ] ...          sorted by name, `link` is the next leaf
+//      internal:  [ header ][ name ][ child ] ...  `link` is the child in front of the first
+//                                                  name, every name is the smallest one of
+//                                                  the child after it at the time it split
+typedef struct btree_header
+{
+    uint16_t count; // entries of a leaf, names of an internal node
+    uint16_t leaf;
+    dblock_index_t link;
+} btree_header_t;
+
+#define BTREE_NO_NODE ((dblock_index_t) -1)
+#define BTREE_KEY_SIZE (MAX_FILE_NAME_LEN + sizeof(dblock_index_t))
+#define BTREE_LEAF_MAX(fs) ((DATA_BLOCK_SIZE(fs) - sizeof(btree_header_t)) / DIRECTORY_ENTRY_SIZE(fs))
+#define BTREE_INTERNAL_MAX(fs) ((DATA_BLOCK_SIZE(fs) - sizeof(btree_header_t)) / BTREE_KEY_SIZE)
+// the most names of an internal node of the largest dblocks, which sizes the buffers
+#define BTREE_INTERNAL_BOUND ((MAX_DATA_BLOCK_SIZE - sizeof(btree_header_t)) / BTREE_KEY_SIZE)
+// every internal node has two children or more, so no tree of 2^32 dblocks is this deep
+#define BTREE_MAX_DEPTH 40
+
+// a node that overflows is split in two, so it must hold two entries or names
+static int btree_supported(const filesystem_t *fs)
+{
+    return BTREE_LEAF_MAX(fs) >= 2 && BTREE_INTERNAL_MAX(fs) >= 2;
+}
+
+static int is_sorted(const inode_t *dir)
+{
+    return (dir->internal.file_perms & FS_SORTED) != 0;
+}
+
+static byte *btree_node(filesystem_t *fs, dblock_index_t node)
+{
+    return &fs->dblocks[(size_t) node * DATA_BLOCK_SIZE(fs)];
+}
+
+static btree_header_t btree_read_header(const byte *node)
+{
+    btree_header_t header;
+    memcpy(&header, node, sizeof(header));
+    return header;
+}
+
+static void btree_write_header(byte *node, const btree_header_t *header)
+{
+    memcpy(node, header, sizeof(*header));
+}
+
+static byte *btree_entry(const filesystem_t *fs, byte *node, size_t slot)
+{
+    return node + sizeof(btree_header_t) + slot * DIRECTORY_ENTRY_SIZE(fs);
+}
+
+static byte *btree_key(byte *node, size_t slot)
+{
+    return node + sizeof(btree_header_t) + slot * BTREE_KEY_SIZE;
+}
+
+// names are compared zero padded, which orders a name in front of the longer ones it starts
+static void make_key(const char *name, size_t len, char *key)
+{
+    memset(key, 0, MAX_FILE_NAME_LEN);
+    memcpy(key, name, len);
+}
+
+// the child of an internal node to descend into for `key`: 0 for `link`, n for the child
+// after the name n - 1
+static size_t btree_child_slot(byte *node, size_t count, const char *key)
+{
+    size_t lo = 0, hi = count;
+    while (lo < hi)
+    {
+        size_t mid = (lo + hi) / 2;
+        if (memcmp(btree_key(node, mid), key, MAX_FILE_NAME_LEN) <= 0) lo = mid + 1;
+        else hi = mid;
     }
-    return count;
+    return lo;
 }
 
-inode_t* return_inode(char *path, inode_t* dir, filesystem_t* fs){
-    int slashes = count_char_occurrences(path,'/');
-    char * token = strtok(path, "/");
-    char formatted_name[14];
-    format_token_for_comparison(token,formatted_name);
-    inode_t *cur_inode = dir;
-    int is_file = 0;
-    size_t bytes_read = 0;
-    while(token != NULL && slashes>=0) {
-        
-        if (slashes == 0){
-            is_file = 1;
-        }
-        
-        byte *all_data = malloc(cur_inode->internal.file_size);
-        inode_read_data(fs,cur_inode,0,all_data,cur_inode->internal.file_size,&bytes_read);
-        byte *original_ptr = all_data;
-        for (size_t i = 0; i < (bytes_read)/16; i++){
-            inode_index_t inode_inside_idx;
-            memcpy(&inode_inside_idx,all_data,2);
-            all_data += 2;
-
-            char name_of_inode[14];
-            memcpy(name_of_inode, all_data, 14);
-            format_filename(name_of_inode);
-            all_data+=14;
-
-            if (is_file == 0){
-                if (strcmp(formatted_name,name_of_inode) == 0){
-                    inode_t *next_inode = &fs->inodes[inode_inside_idx];
-                    cur_inode = next_inode;
-                    break;
-                }
-            } else {
-                if (strcmp(formatted_name,name_of_inode) == 0){
-                    inode_t *next_inode = &fs->inodes[inode_inside_idx];
-                    return next_inode;
-                }
-            }
+static dblock_index_t btree_child(byte *node, size_t slot)
+{
+    if (slot == 0) return btree_read_header(node).link;
+    dblock_index_t child;
+    memcpy(&child, btree_key(node, slot - 1) + MAX_FILE_NAME_LEN, sizeof(child));
+    return child;
+}
 
-        }
-        format_token_for_comparison(strtok(NULL, "/"),formatted_name);
-        free(original_ptr);
-        slashes--;
+// the first entry of a leaf whose name is at least `key`
+static size_t btree_leaf_slot(const filesystem_t *fs, byte *node, size_t count, const char *key)
+{
+    size_t lo = 0, hi = count;
+    while (lo < hi)
+    {
+        size_t mid = (lo + hi) / 2;
+        if (memcmp(btree_entry(fs, node, mid) + fs->index_width, key, MAX_FILE_NAME_LEN) < 0) lo = mid + 1;
+        else hi = mid;
     }
-    return NULL;
+    return lo;
 }
 
-int verify_path(char *path, inode_t* dir, filesystem_t* fs){
-    int slashes = count_char_occurrences(path,'/');
-    
-    char * token = strtok(path, "/");
-    char formatted_name[14];
-    format_token_for_comparison(token,formatted_name);
-    
-    inode_t *cur_inode = dir;
-    
-    int is_file = 0;
-    int file_found = 0;
+// walks from the root down to the leaf where `key` belongs. the nodes on the way are
+// stored in `path` and, if `slots` is not null, the child taken in each of them in `slots`.
+// returns the depth of the leaf
+static size_t btree_descend(filesystem_t *fs, inode_t *dir, const char *key, dblock_index_t *path, size_t *slots)
+{
+    dblock_index_t node = dir->internal.direct_data[0];
+    size_t depth = 0;
+    for (;;)
+    {
+        path[depth] = node;
+        byte *raw = btree_node(fs, node);
+        btree_header_t header = btree_read_header(raw);
+        if (header.leaf || depth + 1 == BTREE_MAX_DEPTH) return depth;
+        size_t slot = btree_child_slot(raw, header.count, key);
+        if (slots) slots[depth] = slot;
+        node = btree_child(raw, slot);
+        ++depth;
+    }
+}
 
-    size_t bytes_read = 0;
+// looks up a name in a sorted directory. returns 1 and stores the entry in `found`, if it
+// is not null, if there is one
+static int btree_find(filesystem_t *fs, inode_t *dir, const char *name, size_t len, directory_entry_t *found)
+{
+    char key[MAX_FILE_NAME_LEN];
+    make_key(name, len, key);
+    dblock_index_t path[BTREE_MAX_DEPTH];
+    byte *leaf = btree_node(fs, path[btree_descend(fs, dir, key, path, NULL)]);
+    size_t count = btree_read_header(leaf).count;
+    size_t slot = btree_leaf_slot(fs, leaf, count, key);
+    if (slot == count || memcmp(btree_entry(fs, leaf, slot) + fs->index_width, key, MAX_FILE_NAME_LEN) != 0) return 0;
+    if (found) decode_entry(fs, btree_entry(fs, leaf, slot), found);
+    return 1;
+}
 
-    //int count = 0;
-    while(token != NULL && slashes>=0) {
-
-        if (slashes == 0){
-            is_file = 1;
-        }
-
-        byte *all_data = malloc(cur_inode->internal.file_size);
-        inode_read_data(fs,cur_inode,0,all_data,cur_inode->internal.file_size,&bytes_read);
-        byte *original_ptr = all_data;
-
-        for (size_t i = 0; i < (bytes_read)/16; i++){
-            inode_index_t inode_inside_idx;
-            memcpy(&inode_inside_idx,all_data,2);
-            all_data += 2;
-
-            char name_of_inode[14];
-            memcpy(name_of_inode, all_data, 14);
-            format_filename(name_of_inode);
-            all_data+=14;
-
-            if (is_file == 0){
-                if (strcmp(formatted_name,name_of_inode) == 0){
-                    inode_t *next_inode = &fs->inodes[inode_inside_idx];
-                    if (next_inode->internal.file_type == DIRECTORY){
-                        cur_inode = next_inode;
-                        file_found = 1;
-                        break;
-                    } else {
-                        continue;
-                    }
-                } else {
-                    continue;
-                }
-            } else {
-                if (strcmp(formatted_name,name_of_inode) == 0){
-                    inode_t *next_inode = &fs->inodes[inode_inside_idx];
-                    
-                    if (next_inode->internal.file_type != DATA_FILE){
-                        REPORT_RETCODE(INVALID_FILE_TYPE);
-                        return 0;
-                    }
-
-                    if (next_inode->internal.file_type == DATA_FILE){
-                        cur_inode = next_inode;
-                        file_found = 1;
-                        break;
-                    } else {
-                        continue;
-                    }
-                } else {
-                    continue;
-                }
-            }
+// dblocks `btree_insert` can claim: one for every level whose node splits and a new root
+static size_t btree_insert_dblocks(filesystem_t *fs, inode_t *dir)
+{
+    char key[MAX_FILE_NAME_LEN] = { 0 };
+    dblock_index_t path[BTREE_MAX_DEPTH];
+    return btree_descend(fs, dir, key, path, NULL) + 2;
+}
 
+// adds `child`, whose names are at least `separator`, next to the child taken in each node
+// of `path` above `depth`. nodes that overflow split on the way up, and the root gets a new
+// root above it when it splits
+static void btree_insert_child(filesystem_t *fs, inode_t *dir, const dblock_index_t *path, const size_t *slots, size_t depth, char *separator, dblock_index_t child)
+{
+    while (depth-- > 0)
+    {
+        byte *node = btree_node(fs, path[depth]);
+        btree_header_t header = btree_read_header(node);
+        size_t slot = slots[depth];
+
+        byte row[(BTREE_INTERNAL_BOUND + 1) * BTREE_KEY_SIZE];
+        memcpy(row, btree_key(node, 0), slot * BTREE_KEY_SIZE);
+        memcpy(row + slot * BTREE_KEY_SIZE, separator, MAX_FILE_NAME_LEN);
+        memcpy(row + slot * BTREE_KEY_SIZE + MAX_FILE_NAME_LEN, &child, sizeof(child));
+        memcpy(row + (slot + 1) * BTREE_KEY_SIZE, btree_key(node, slot), (header.count - slot) * BTREE_KEY_SIZE);
+        size_t count = header.count + 1;
+        if (count <= BTREE_INTERNAL_MAX(fs))
+        {
+            memcpy(btree_key(node, 0), row, count * BTREE_KEY_SIZE);
+            header.count = count;
+            btree_write_header(node, &header);
+            checksum_update_dblock(fs, path[depth]);
+            return;
         }
 
-        if (file_found == 0 && is_file == 0){
-            REPORT_RETCODE(DIR_NOT_FOUND);
-            return 0;
-        } else if (file_found == 0 && is_file == 1){
-            REPORT_RETCODE(FILE_NOT_FOUND);
-            return 0;
-        }
+        // the middle name moves up, and the child after it becomes `link` of the new node
+        size_t left = count / 2;
+        dblock_index_t right;
+        fs_assert_success(claim_available_dblock(fs, &right));
+        subtree_add_dblocks(fs, dir, 1);
+        byte *right_node = btree_node(fs, right);
+        memset(right_node, 0, DATA_BLOCK_SIZE(fs));
+        btree_header_t right_header = { count - left - 1, 0, 0 };
+        memcpy(&right_header.link, row + left * BTREE_KEY_SIZE + MAX_FILE_NAME_LEN, sizeof(dblock_index_t));
+        btree_write_header(right_node, &right_header);
+        memcpy(btree_key(right_node, 0), row + (left + 1) * BTREE_KEY_SIZE, right_header.count * BTREE_KEY_SIZE);
+        header.count = left;
+        btree_write_header(node, &header);
+        memcpy(btree_key(node, 0), row, left * BTREE_KEY_SIZE);
+        memset(btree_key(node, left), 0, (count - 1 - left) * BTREE_KEY_SIZE);
+        checksum_update_dblock(fs, path[depth]);
+        checksum_update_dblock(fs, right);
+
+        memcpy(separator, row + left * BTREE_KEY_SIZE, MAX_FILE_NAME_LEN);
+        child = right;
+    }
 
-        format_token_for_comparison(strtok(NULL, "/"),formatted_name);
+    dblock_index_t root;
+    fs_assert_success(claim_available_dblock(fs, &root));
+    subtree_add_dblocks(fs, dir, 1);
+    byte *node = btree_node(fs, root);
+    memset(node, 0, DATA_BLOCK_SIZE(fs));
+    btree_header_t header = { 1, 0, dir->internal.direct_data[0] };
+    btree_write_header(node, &header);
+    memcpy(btree_key(node, 0), separator, MAX_FILE_NAME_LEN);
+    memcpy(btree_key(node, 0) + MAX_FILE_NAME_LEN, &child, sizeof(child));
+    checksum_update_dblock(fs, root);
+    dir->internal.direct_data[0] = root;
+}
 
-        free(original_ptr);
-        slashes--;
-        file_found = 0;
+// adds an entry to a sorted directory, or points the entry of that name at `index` if
+// there is one. the dblocks must have been checked with `btree_insert_dblocks`
+static void btree_insert(filesystem_t *fs, inode_t *dir, inode_index_t index, const char *name, size_t len)
+{
+    directory_entry_t entry = { index, { 0 } };
+    memcpy(entry.name, name, len);
+    dblock_index_t path[BTREE_MAX_DEPTH];
+    size_t slots[BTREE_MAX_DEPTH];
+    size_t depth = btree_descend(fs, dir, entry.name, path, slots);
+
+    byte *leaf = btree_node(fs, path[depth]);
+    btree_header_t header = btree_read_header(leaf);
+    size_t slot = btree_leaf_slot(fs, leaf, header.count, entry.name);
+    if (slot < header.count && memcmp(btree_entry(fs, leaf, slot) + fs->index_width, entry.name, MAX_FILE_NAME_LEN) == 0)
+    {
+        encode_entry(fs, &entry, btree_entry(fs, leaf, slot));
+        checksum_update_dblock(fs, path[depth]);
+        return;
     }
+    dir->internal.file_size += DIRECTORY_ENTRY_SIZE(fs);
+    subtree_update(fs, dir);
+
+    byte row[MAX_DATA_BLOCK_SIZE - sizeof(btree_header_t) + WIDE_DIRECTORY_ENTRY_SIZE];
+    memcpy(row, btree_entry(fs, leaf, 0), slot * DIRECTORY_ENTRY_SIZE(fs));
+    encode_entry(fs, &entry, row + slot * DIRECTORY_ENTRY_SIZE(fs));
+    memcpy(row + (slot + 1) * DIRECTORY_ENTRY_SIZE(fs), btree_entry(fs, leaf, slot), (header.count - slot) * DIRECTORY_ENTRY_SIZE(fs));
+    size_t count = header.count + 1;
+    if (count <= BTREE_LEAF_MAX(fs))
+    {
+        memcpy(btree_entry(fs, leaf, 0), row, count * DIRECTORY_ENTRY_SIZE(fs));
+        header.count = count;
+        btree_write_header(leaf, &header);
+        checksum_update_dblock(fs, path[depth]);
+        return;
+    }
+
+    // the upper half moves to a new leaf after this one, and its first name goes up
+    size_t left = (count + 1) / 2;
+    dblock_index_t right;
+    fs_assert_success(claim_available_dblock(fs, &right));
+    subtree_add_dblocks(fs, dir, 1);
+    byte *right_leaf = btree_node(fs, right);
+    memset(right_leaf, 0, DATA_BLOCK_SIZE(fs));
+    btree_header_t right_header = { count - left, 1, header.link };
+    btree_write_header(right_leaf, &right_header);
+    memcpy(btree_entry(fs, right_leaf, 0), row + left * DIRECTORY_ENTRY_SIZE(fs), right_header.count * DIRECTORY_ENTRY_SIZE(fs));
+    header.count = left;
+    header.link = right;
+    btree_write_header(leaf, &header);
+    memcpy(btree_entry(fs, leaf, 0), row, left * DIRECTORY_ENTRY_SIZE(fs));
+    memset(btree_entry(fs, leaf, left), 0, (count - 1 - left) * DIRECTORY_ENTRY_SIZE(fs));
+    checksum_update_dblock(fs, path[depth]);
+    checksum_update_dblock(fs, right);
+
+    char separator[MAX_FILE_NAME_LEN];
+    memcpy(separator, row + left * DIRECTORY_ENTRY_SIZE(fs) + fs->index_width, MAX_FILE_NAME_LEN);
+    btree_insert_child(fs, dir, path, slots, depth, separator, right);
+}
+
+// removes the entry of a name from a sorted directory. returns 1 if there was one
+static int btree_remove(filesystem_t *fs, inode_t *dir, const char *name, size_t len)
+{
+    char key[MAX_FILE_NAME_LEN];
+    make_key(name, len, key);
+    dblock_index_t path[BTREE_MAX_DEPTH];
+    size_t depth = btree_descend(fs, dir, key, path, NULL);
+
+    byte *leaf = btree_node(fs, path[depth]);
+    btree_header_t header = btree_read_header(leaf);
+    size_t slot = btree_leaf_slot(fs, leaf, header.count, key);
+    if (slot == header.count || memcmp(btree_entry(fs, leaf, slot) + fs->index_width, key, MAX_FILE_NAME_LEN) != 0) return 0;
+
+    memmove(btree_entry(fs, leaf, slot), btree_entry(fs, leaf, slot + 1), (header.count - slot - 1) * DIRECTORY_ENTRY_SIZE(fs));
+    --header.count;
+    memset(btree_entry(fs, leaf, header.count), 0, DIRECTORY_ENTRY_SIZE(fs));
+    btree_write_header(leaf, &header);
+    checksum_update_dblock(fs, path[depth]);
+    dir->internal.file_size -= DIRECTORY_ENTRY_SIZE(fs);
+    subtree_update(fs, dir);
     return 1;
 }
 
-inode_t* return_inode_v2(char *path, inode_t* dir, filesystem_t* fs){
-    int slashes = count_char_occurrences(path,'/');
-    char * token = strtok(path, "/");
-    char formatted_name[14];
-    format_token_for_comparison(token,formatted_name);
-    inode_t *cur_inode = dir;
-    int is_file = 0;
-    size_t bytes_read = 0;
-    while(token != NULL && slashes>=0) {
-        
-        if (slashes == 1){
-            is_file = 1;
-        }
-        
-        byte *all_data = malloc(cur_inode->internal.file_size);
-        inode_read_data(fs,cur_inode,0,all_data,cur_inode->internal.file_size,&bytes_read);
-        byte *original_ptr = all_data;
-        for (size_t i = 0; i < (bytes_read)/16; i++){
-            inode_index_t inode_inside_idx;
-            memcpy(&inode_inside_idx,all_data,2);
-            all_data += 2;
-
-            char name_of_inode[14];
-            memcpy(name_of_inode, all_data, 14);
-            format_filename(name_of_inode);
-            all_data+=14;
-
-            if (is_file == 0){
-                if (strcmp(formatted_name,name_of_inode) == 0){
-                    inode_t *next_inode = &fs->inodes[inode_inside_idx];
-                    cur_inode = next_inode;
-                    break;
-                }
-            } else {
-                if (strcmp(formatted_name,name_of_inode) == 0){
-                    inode_t *next_inode = &fs->inodes[inode_inside_idx];
-                    return next_inode;
-                }
-            }
+// the leaf and the slot of the first entry whose name is at least `key`
+static void btree_seek(filesystem_t *fs, inode_t *dir, const char *key, dblock_index_t *leaf, size_t *slot)
+{
+    dblock_index_t path[BTREE_MAX_DEPTH];
+    *leaf = path[btree_descend(fs, dir, key, path, NULL)];
+    byte *node = btree_node(fs, *leaf);
+    *slot = btree_leaf_slot(fs, node, btree_read_header(node).count, key);
+}
 
-        }
-        format_token_for_comparison(strtok(NULL, "/"),formatted_name);
-        free(original_ptr);
-        slashes--;
+// gives back the dblocks of a node and everything below it
+static void btree_release(filesystem_t *fs, dblock_index_t node, size_t depth)
+{
+    byte *raw = btree_node(fs, node);
+    btree_header_t header = btree_read_header(raw);
+    if (!header.leaf && depth + 1 < BTREE_MAX_DEPTH)
+    {
+        for (size_t slot = 0; slot <= header.count; ++slot) btree_release(fs, btree_child(raw, slot), depth + 1);
     }
-    return NULL;
+    fs_assert_success(release_dblock(fs, raw));
 }
 
-int verify_path_v2(char *path, inode_t* dir, filesystem_t* fs){
-    int slashes = count_char_occurrences(path,'/');
-    
-    char * token = strtok(path, "/");
-    char formatted_name[14];
-    format_token_for_comparison(token,formatted_name);
-    
-    inode_t *cur_inode = dir;
-    
-    int is_file = 0;
-    int file_found = 0;
+// counts the dblocks of a node and everything below it
+static size_t btree_count(filesystem_t *fs, dblock_index_t node, size_t depth)
+{
+    byte *raw = btree_node(fs, node);
+    btree_header_t header = btree_read_header(raw);
+    size_t count = 1;
+    if (!header.leaf && depth + 1 < BTREE_MAX_DEPTH)
+    {
+        for (size_t slot = 0; slot <= header.count; ++slot) count += btree_count(fs, btree_child(raw, slot), depth + 1);
+    }
+    return count;
+}
 
-    size_t bytes_read = 0;
+// dblocks of a packed tree of `count` entries
+static size_t btree_build_dblocks(const filesystem_t *fs, size_t count)
+{
+    size_t nodes = count > 0 ? (count + BTREE_LEAF_MAX(fs) - 1) / BTREE_LEAF_MAX(fs) : 1;
+    size_t total = nodes;
+    while (nodes > 1)
+    {
+        nodes = (nodes + BTREE_INTERNAL_MAX(fs)) / (BTREE_INTERNAL_MAX(fs) + 1);
+        total += nodes;
+    }
+    return total;
+}
 
-    //int count = 0;
-    while(token != NULL && slashes>=0) {
-
-        if (slashes == 0){
-            is_file = 1;
-        }
-
-        byte *all_data = malloc(cur_inode->internal.file_size);
-        inode_read_data(fs,cur_inode,0,all_data,cur_inode->internal.file_size,&bytes_read);
-        byte *original_ptr = all_data;
-
-        for (size_t i = 0; i < (bytes_read)/16; i++){
-            inode_index_t inode_inside_idx;
-            memcpy(&inode_inside_idx,all_data,2);
-            all_data += 2;
-
-            char name_of_inode[14];
-            memcpy(name_of_inode, all_data, 14);
-            format_filename(name_of_inode);
-            all_data+=14;
-
-            if (is_file == 0){
-                if (strcmp(formatted_name,name_of_inode) == 0){
-                    inode_t *next_inode = &fs->inodes[inode_inside_idx];
-                    if (next_inode->internal.file_type == DIRECTORY){
-                        cur_inode = next_inode;
-                        file_found = 1;
-                        break;
-                    } else {
-                        continue;
-                    }
-                } else {
-                    continue;
-                }
-            } else {
-                if (strcmp(formatted_name,name_of_inode) == 0){
-                   REPORT_RETCODE(FILE_EXIST);
-                   return 0;
-                }
+// a node of a packed tree under construction and the smallest name below it
+struct btree_child
+{
+    char key[MAX_FILE_NAME_LEN];
+    dblock_index_t node;
+};
+
+// builds a packed tree out of `count` entries sorted by name and stores its root in `root`.
+// the dblocks must have been checked with `btree_build_dblocks`. returns SUCCESS or
+// SYSTEM_ERROR
+static fs_retcode_t btree_build(filesystem_t *fs, const directory_entry_t *entries, size_t count, dblock_index_t *root)
+{
+    size_t nodes = btree_build_dblocks(fs, count);
+    struct btree_child *level = malloc(nodes * sizeof(struct btree_child));
+    if (!level) return SYSTEM_ERROR;
+
+    // the leaves are filled up in order, each linked to the one after it
+    nodes = 0;
+    size_t at = 0;
+    do
+    {
+        dblock_index_t leaf;
+        fs_assert_success(claim_available_dblock(fs, &leaf));
+        if (nodes > 0)
+        {
+            byte *previous = btree_node(fs, level[nodes - 1].node);
+            btree_header_t header = btree_read_header(previous);
+            header.link = leaf;
+            btree_write_header(previous, &header);
+            checksum_update_dblock(fs, level[nodes - 1].node);
+        }
+        byte *node = btree_node(fs, leaf);
+        btree_header_t header = { count - at < BTREE_LEAF_MAX(fs) ? count - at : BTREE_LEAF_MAX(fs), 1, BTREE_NO_NODE };
+        memset(node, 0, DATA_BLOCK_SIZE(fs));
+        btree_write_header(node, &header);
+        for (size_t slot = 0; slot < header.count; ++slot) encode_entry(fs, &entries[at + slot], btree_entry(fs, node, slot));
+        checksum_update_dblock(fs, leaf);
+
+        memset(level[nodes].key, 0, MAX_FILE_NAME_LEN);
+        if (header.count > 0) memcpy(level[nodes].key, entries[at].name, MAX_FILE_NAME_LEN);
+        level[nodes++].node = leaf;
+        at += header.count;
+    } while (at < count);
+
+    // every level above takes the nodes of the one below in groups
+    while (nodes > 1)
+    {
+        size_t parents = 0;
+        for (size_t first = 0; first < nodes; first += BTREE_INTERNAL_MAX(fs) + 1)
+        {
+            size_t children = nodes - first < BTREE_INTERNAL_MAX(fs) + 1 ? nodes - first : BTREE_INTERNAL_MAX(fs) + 1;
+            dblock_index_t parent;
+            fs_assert_success(claim_available_dblock(fs, &parent));
+            byte *node = btree_node(fs, parent);
+            btree_header_t header = { children - 1, 0, level[first].node };
+            memset(node, 0, DATA_BLOCK_SIZE(fs));
+            btree_write_header(node, &header);
+            for (size_t slot = 1; slot < children; ++slot)
+            {
+                memcpy(btree_key(node, slot - 1), level[first + slot].key, MAX_FILE_NAME_LEN);
+                memcpy(btree_key(node, slot - 1) + MAX_FILE_NAME_LEN, &level[first + slot].node, sizeof(dblock_index_t));
             }
+            checksum_update_dblock(fs, parent);
 
+            // `first` moves ahead of `parents`, so the level is rewritten in place
+            memmove(level[parents].key, level[first].key, MAX_FILE_NAME_LEN);
+            level[parents++].node = parent;
         }
+        nodes = parents;
+    }
 
-        if (file_found == 0 && is_file == 0){
-            REPORT_RETCODE(DIR_NOT_FOUND);
-            return 0;
-        } 
+    *root = level[0].node;
+    free(level);
+    return SUCCESS;
+}
 
-        format_token_for_comparison(strtok(NULL, "/"),formatted_name);
+// entries a cursor reads at a time: a dblock worth, and at least 32 so small dblocks are
+// not read a few entries per call. the buffer holds that many of the wide entries for the
+// largest dblocks
+#define ENTRY_CURSOR_ENTRIES(fs) (DATA_BLOCK_SIZE(fs) / NARROW_DIRECTORY_ENTRY_SIZE > 32 ? DATA_BLOCK_SIZE(fs) / NARROW_DIRECTORY_ENTRY_SIZE : 32)
+#define ENTRY_CURSOR_BOUND (MAX_DATA_BLOCK_SIZE / NARROW_DIRECTORY_ENTRY_SIZE > 32 ? MAX_DATA_BLOCK_SIZE / NARROW_DIRECTORY_ENTRY_SIZE : 32)
+
+// walks the entries of a directory in order. they are read ENTRY_CURSOR_ENTRIES at a time
+// into the cursor, so iterating needs no allocation. a sorted directory is walked along its
+// leaves, in name order and without tombstones
+typedef struct entry_cursor
+{
+    inode_t *dir;
+    size_t offset;       // of the next entry, its position in name order in a sorted directory
+    size_t buffered;     // bytes of `raw` holding entries, starting at `offset`
+    size_t next;         // position of the next entry in `raw`
+    dblock_index_t leaf; // leaf of a sorted directory holding the next entry
+    size_t slot;         // of the next entry in `leaf`
+    int shared;          // whether the dblocks are read where they lie, see `entry_cursor_start_shared`
+    block_cursor_t blocks; // block of the last read of a shared cursor
+    fs_retcode_t error;  // of the read that ended the walk early, SUCCESS otherwise
+    byte raw[ENTRY_CURSOR_BOUND * WIDE_DIRECTORY_ENTRY_SIZE];
+} entry_cursor_t;
+
+// bytes of entries a cursor reads at a time
+static size_t entry_cursor_capacity(const filesystem_t *fs)
+{
+    return ENTRY_CURSOR_ENTRIES(fs) * DIRECTORY_ENTRY_SIZE(fs);
+}
 
-        free(original_ptr);
-        slashes--;
-        file_found = 0;
+// starts a cursor at `offset`. a sorted directory is always walked from its first entry
+static void entry_cursor_start(filesystem_t *fs, inode_t *dir, size_t offset, entry_cursor_t *cursor)
+{
+    cursor->dir = dir;
+    cursor->offset = offset;
+    cursor->buffered = 0;
+    cursor->next = 0;
+    cursor->shared = 0;
+    cursor->error = SUCCESS;
+    if (is_sorted(dir))
+    {
+        char key[MAX_FILE_NAME_LEN] = { 0 };
+        cursor->offset = 0;
+        btree_seek(fs, dir, key, &cursor->leaf, &cursor->slot);
     }
-    return 1;
 }
 
-int verify_path_v3(char *path, inode_t* dir, filesystem_t* fs){
-    int slashes = count_char_occurrences(path,'/');
-    
-    char * token = strtok(path, "/");
-    char formatted_name[14];
-    format_token_for_comparison(token,formatted_name);
-    
-    inode_t *cur_inode = dir;
-    
-    int is_file = 0;
-    int file_found = 0;
+// starts a cursor at the first entry whose name is at least the `len` bytes at `name`,
+// which only skips entries in a sorted directory. the others are walked from the start
+static void entry_cursor_seek(filesystem_t *fs, inode_t *dir, const char *name, size_t len, entry_cursor_t *cursor)
+{
+    entry_cursor_start(fs, dir, 0, cursor);
+    if (!is_sorted(dir)) return;
+    char key[MAX_FILE_NAME_LEN];
+    make_key(name, len < MAX_FILE_NAME_LEN ? len : MAX_FILE_NAME_LEN, key);
+    btree_seek(fs, dir, key, &cursor->leaf, &cursor->slot);
+}
 
-    size_t bytes_read = 0;
+// starts a cursor at the first entry that copies the entries of a linear directory straight
+// from its dblocks instead of going through `inode_read_data`. it leaves the file system
+// untouched, so cursors of several threads can walk at once, but checksums are not verified
+static void entry_cursor_start_shared(filesystem_t *fs, inode_t *dir, entry_cursor_t *cursor)
+{
+    entry_cursor_start(fs, dir, 0, cursor);
+    cursor->shared = 1;
+    block_cursor_seek(fs, dir, &cursor->blocks, 0);
+}
 
-    //int count = 0;
-    while(token != NULL && slashes>=0) {
-
-        if (slashes == 0){
-            is_file = 1;
-        }
-
-        byte *all_data = malloc(cur_inode->internal.file_size);
-        inode_read_data(fs,cur_inode,0,all_data,cur_inode->internal.file_size,&bytes_read);
-        byte *original_ptr = all_data;
-
-        for (size_t i = 0; i < (bytes_read)/16; i++){
-            inode_index_t inode_inside_idx;
-            memcpy(&inode_inside_idx,all_data,2);
-            all_data += 2;
-
-            char name_of_inode[14];
-            memcpy(name_of_inode, all_data, 14);
-            format_filename(name_of_inode);
-            all_data+=14;
-
-            if (is_file == 0){
-                if (strcmp(formatted_name,name_of_inode) == 0){
-                    inode_t *next_inode = &fs->inodes[inode_inside_idx];
-                    if (next_inode->internal.file_type == DIRECTORY){
-                        cur_inode = next_inode;
-                        file_found = 1;
-                        break;
-                    } else {
-                        continue;
-                    }
-                } else {
-                    continue;
-                }
-            } else {
-                if (strcmp(formatted_name,name_of_inode) == 0){
-                    inode_t *next_inode = &fs->inodes[inode_inside_idx];
-                    
-                    if (next_inode->internal.file_type != DATA_FILE){
-                        REPORT_RETCODE(INVALID_FILE_TYPE);
-                        return 0;
-                    }
-
-                    if (next_inode->internal.file_type == DATA_FILE){
-                        cur_inode = next_inode;
-                        file_found = 1;
-                        break;
-                    } else {
-                        continue;
-                    }
-                } else {
-                    continue;
-                }
+// fills the buffer of a shared cursor with the bytes from its offset on. returns the number
+// of bytes copied
+static size_t entry_cursor_read_shared(filesystem_t *fs, entry_cursor_t *cursor)
+{
+    size_t n = cursor->dir->internal.file_size - cursor->offset;
+    if (n > entry_cursor_capacity(fs)) n = entry_cursor_capacity(fs);
+    size_t done = 0;
+    while (done < n)
+    {
+        size_t at = cursor->offset + done;
+        while (cursor->blocks.block < at / DATA_BLOCK_SIZE(fs)) block_cursor_next(fs, cursor->dir, &cursor->blocks);
+        dblock_index_t dblock = block_cursor_dblock(fs, cursor->dir, &cursor->blocks);
+        if (dblock >= fs->dblock_count) break;
+        size_t take = DATA_BLOCK_SIZE(fs) - at % DATA_BLOCK_SIZE(fs);
+        if (take > n - done) take = n - done;
+        memcpy(cursor->raw + done, fs->dblocks + (size_t) dblock * DATA_BLOCK_SIZE(fs) + at % DATA_BLOCK_SIZE(fs), take);
+        done += take;
+    }
+    return done;
+}
+
+// reads the next entry and its offset, tombstones included. returns 0 at the end of the
+// directory, or when the entries could not be read, which leaves the error in `cursor->error`
+static int entry_cursor_next(filesystem_t *fs, entry_cursor_t *cursor, directory_entry_t *entry, size_t *offset)
+{
+    if (is_sorted(cursor->dir))
+    {
+        // leaves emptied by removals are passed over
+        while (cursor->leaf != BTREE_NO_NODE)
+        {
+            byte *leaf = btree_node(fs, cursor->leaf);
+            btree_header_t header = btree_read_header(leaf);
+            if (cursor->slot < header.count) break;
+            cursor->leaf = header.link;
+            cursor->slot = 0;
+        }
+        if (cursor->leaf == BTREE_NO_NODE) return 0;
+        decode_entry(fs, btree_entry(fs, btree_node(fs, cursor->leaf), cursor->slot++), entry);
+    }
+    else
+    {
+        if (cursor->next == cursor->buffered)
+        {
+            if (cursor->offset >= cursor->dir->internal.file_size) return 0;
+            if (cursor->shared) cursor->buffered = entry_cursor_read_shared(fs, cursor);
+            else
+            {
+                cursor->error = inode_read_data(fs, cursor->dir, cursor->offset, cursor->raw, entry_cursor_capacity(fs), &cursor->buffered);
+                if (cursor->error != SUCCESS) return 0;
             }
+            cursor->buffered -= cursor->buffered % DIRECTORY_ENTRY_SIZE(fs);
+            cursor->next = 0;
+            if (cursor->buffered == 0) return 0;
+        }
+        decode_entry(fs, cursor->raw + cursor->next, entry);
+        cursor->next += DIRECTORY_ENTRY_SIZE(fs);
+    }
+    if (offset) *offset = cursor->offset;
+    cursor->offset += DIRECTORY_ENTRY_SIZE(fs);
+    return 1;
+}
+
+// ----------------------- ENTRY SCAN -------------------------- //
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define ENTRY_SCAN_HAS_SSE2_PATH 1
+#include <emmintrin.h>
+#else
+#define ENTRY_SCAN_HAS_SSE2_PATH 0
+#endif
+
+// the names of a linear directory are compared in place, without decoding the entries. each
+// entry is looked at through the ENTRY_KEY_SIZE bytes that end with it, which hold the whole
+// name, and compared in one go with a key under a mask
+#define ENTRY_KEY_SIZE 16
+#define ENTRY_KEY_NAME (ENTRY_KEY_SIZE - MAX_FILE_NAME_LEN) // where the name starts in the key
+
+// a name padded like the bytes of an entry holding it. the mask covers the name and the null
+// that ends it if it is shorter than MAX_FILE_NAME_LEN, so whatever follows that null does
+// not count, as with `entry_name_length`
+typedef struct entry_key
+{
+    byte bytes[ENTRY_KEY_SIZE];
+    byte mask[ENTRY_KEY_SIZE];
+} entry_key_t;
+
+static void make_entry_key(const char *name, size_t len, entry_key_t *key)
+{
+    memset(key, 0, sizeof(entry_key_t));
+    memcpy(key->bytes + ENTRY_KEY_NAME, name, len);
+    memset(key->mask + ENTRY_KEY_NAME, 0xFF, len < MAX_FILE_NAME_LEN ? len + 1 : MAX_FILE_NAME_LEN);
+}
 
+#if ENTRY_SCAN_HAS_SSE2_PATH
+// one compare and one movemask per entry
+static size_t entry_scan_sse2(const byte *raw, size_t count, size_t entry_size, const entry_key_t *key)
+{
+    __m128i bytes = _mm_loadu_si128((const __m128i*) key->bytes);
+    __m128i mask = _mm_loadu_si128((const __m128i*) key->mask);
+    const byte *window = raw + entry_size - ENTRY_KEY_SIZE;
+    for (size_t n = 0; n < count; ++n, window += entry_size)
+    {
+        __m128i entry = _mm_and_si128(_mm_loadu_si128((const __m128i*) window), mask);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(entry, bytes)) == 0xFFFF) return n;
+    }
+    return count;
+}
+#else
+// two masked words per entry
+static size_t entry_scan_words(const byte *raw, size_t count, size_t entry_size, const entry_key_t *key)
+{
+    uint64_t bytes[2], mask[2];
+    memcpy(bytes, key->bytes, sizeof(bytes));
+    memcpy(mask, key->mask, sizeof(mask));
+    const byte *window = raw + entry_size - ENTRY_KEY_SIZE;
+    for (size_t n = 0; n < count; ++n, window += entry_size)
+    {
+        uint64_t entry[2];
+        memcpy(entry, window, sizeof(entry));
+        if ((entry[0] & mask[0]) == bytes[0] && (entry[1] & mask[1]) == bytes[1]) return n;
+    }
+    return count;
+}
+#endif
+
+// the position of the first of the `count` raw entries of `entry_size` bytes at `raw`
+// holding the name of `key`, or `count` if there is none
+static size_t entry_scan(const byte *raw, size_t count, size_t entry_size, const entry_key_t *key)
+{
+#if ENTRY_SCAN_HAS_SSE2_PATH
+    return entry_scan_sse2(raw, count, entry_size, key);
+#else
+    return entry_scan_words(raw, count, entry_size, key);
+#endif
+}
+
+// ----------------------- DIRECTORY INDEX --------------------- //
+
+// directories with at least this many entries get a hash index, smaller ones are scanned
+#define DIR_INDEX_MIN_ENTRIES 64
+
+// an in-memory hash index of a large directory: a copy of its entries chained by the hash
+// of their names, and a bitmap of its tombstones so a free slot is found without a scan.
+// the index only counts while `file_size` matches the directory, so data written around
+// `add_entry` makes it stale and it is rebuilt on the next lookup. the index is one
+// allocation so `free_filesystem` can release it without knowing its layout
+struct dir_index
+{
+    size_t file_size;
+    size_t count;              // entries of the directory
+    size_t capacity;           // entries that fit, a power of two that is also the bucket count
+    size_t tombstones;
+    size_t first_free;         // no word of `free_slots` in front of this one has a bit set
+    uint32_t *buckets;         // first entry of each bucket plus one, 0 for an empty bucket
+    uint32_t *chain;           // next entry in the bucket of each entry plus one
+    uint64_t *free_slots;      // bit n is set if entry n is a tombstone
+    directory_entry_t *entries;
+};
+
+// bits in a word of `free_slots`
+#define FREE_SLOT_BITS 64
+
+// FNV-1a
+static uint32_t name_hash(const char *name, size_t len)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; ++i) hash = (hash ^ (byte) name[i]) * 16777619u;
+    return hash;
+}
+
+static struct dir_index *dir_index_alloc(size_t capacity)
+{
+    size_t words = capacity / FREE_SLOT_BITS;
+    struct dir_index *index = malloc(sizeof(struct dir_index) + words * sizeof(uint64_t)
+        + 2 * capacity * sizeof(uint32_t) + capacity * sizeof(directory_entry_t));
+    if (!index) return NULL;
+    index->count = 0;
+    index->capacity = capacity;
+    index->tombstones = 0;
+    index->first_free = 0;
+    // the widest members go first so everything stays aligned
+    index->free_slots = (uint64_t*) (index + 1);
+    index->entries = (directory_entry_t*) (index->free_slots + words);
+    index->buckets = (uint32_t*) (index->entries + capacity);
+    index->chain = index->buckets + capacity;
+    memset(index->free_slots, 0, words * sizeof(uint64_t));
+    memset(index->buckets, 0, capacity * sizeof(uint32_t));
+    return index;
+}
+
+static void dir_index_link(struct dir_index *index, size_t n)
+{
+    const char *name = index->entries[n].name;
+    size_t len = entry_name_length(name);
+    if (len == 0)
+    {
+        ++index->tombstones;
+        index->free_slots[n / FREE_SLOT_BITS] |= (uint64_t) 1 << (n % FREE_SLOT_BITS);
+        if (n / FREE_SLOT_BITS < index->first_free) index->first_free = n / FREE_SLOT_BITS;
+        return;
+    }
+    uint32_t *bucket = &index->buckets[name_hash(name, len) & (index->capacity - 1)];
+    index->chain[n] = *bucket;
+    *bucket = n + 1;
+}
+
+static void dir_index_unlink(struct dir_index *index, size_t n)
+{
+    const char *name = index->entries[n].name;
+    size_t len = entry_name_length(name);
+    if (len == 0)
+    {
+        --index->tombstones;
+        index->free_slots[n / FREE_SLOT_BITS] &= ~((uint64_t) 1 << (n % FREE_SLOT_BITS));
+        return;
+    }
+    uint32_t *link = &index->buckets[name_hash(name, len) & (index->capacity - 1)];
+    while (*link != n + 1) link = &index->chain[*link - 1];
+    *link = index->chain[n];
+}
+
+// moves the entries into an index with room for `capacity` entries. frees `index`
+static struct dir_index *dir_index_grow(struct dir_index *index, size_t capacity)
+{
+    struct dir_index *grown = dir_index_alloc(capacity);
+    if (grown)
+    {
+        grown->file_size = index->file_size;
+        grown->count = index->count;
+        memcpy(grown->entries, index->entries, index->count * sizeof(directory_entry_t));
+        for (size_t n = 0; n < grown->count; ++n) dir_index_link(grown, n);
+    }
+    free(index);
+    return grown;
+}
+
+// a new empty index with room for twice `count` entries
+static struct dir_index *dir_index_sized(size_t count)
+{
+    size_t capacity = DIR_INDEX_MIN_ENTRIES;
+    while (capacity < 2 * count) capacity *= 2;
+    return dir_index_alloc(capacity);
+}
+
+// reads every entry of a directory into a new index
+static struct dir_index *dir_index_build(filesystem_t *fs, inode_t *dir)
+{
+    size_t count = dir->internal.file_size / DIRECTORY_ENTRY_SIZE(fs);
+    struct dir_index *index = dir_index_sized(count);
+    if (!index) return NULL;
+    index->file_size = dir->internal.file_size;
+
+    entry_cursor_t cursor;
+    entry_cursor_start(fs, dir, 0, &cursor);
+    while (index->count < count)
+    {
+        if (!entry_cursor_next(fs, &cursor, &index->entries[index->count], NULL))
+        {
+            free(index);
+            return NULL;
         }
+        dir_index_link(index, index->count++);
+    }
+    return index;
+}
 
-        if (file_found == 0 && is_file == 0){
-            REPORT_RETCODE(DIR_NOT_FOUND);
-            return 0;
-        } else if (file_found == 0 && is_file == 1){
-            REPORT_RETCODE(NOT_FOUND);
-            return 0;
+// the index of a directory, built or rebuilt if it is missing or stale. returns NULL for
+// small directories and when memory is short, which leaves lookups to a scan
+static struct dir_index *dir_index_get(filesystem_t *fs, inode_t *dir)
+{
+    if (dir->internal.file_size / DIRECTORY_ENTRY_SIZE(fs) < DIR_INDEX_MIN_ENTRIES) return NULL;
+    if (!fs->dir_indexes)
+    {
+        fs->dir_indexes = calloc(fs->inode_count, sizeof(struct dir_index*));
+        if (!fs->dir_indexes) return NULL;
+    }
+    struct dir_index **index = &fs->dir_indexes[dir - fs->inodes];
+    if (*index && (*index)->file_size == dir->internal.file_size) return *index;
+    free(*index);
+    *index = dir_index_build(fs, dir);
+    return *index;
+}
+
+// mirrors an entry written at `offset` of a directory that had `old_size` bytes into its
+// index, if it has an up to date one
+static void dir_index_store(filesystem_t *fs, inode_t *dir, size_t old_size, size_t offset, const directory_entry_t *entry)
+{
+    if (!fs->dir_indexes) return;
+    struct dir_index **index = &fs->dir_indexes[dir - fs->inodes];
+    if (!*index) return;
+    if ((*index)->file_size != old_size)
+    {
+        free(*index);
+        *index = NULL;
+        return;
+    }
+
+    size_t n = offset / DIRECTORY_ENTRY_SIZE(fs);
+    if (n == (*index)->count)
+    {
+        if ((*index)->count == (*index)->capacity)
+        {
+            *index = dir_index_grow(*index, 2 * (*index)->capacity);
+            if (!*index) return;
         }
+        ++(*index)->count;
+    }
+    else dir_index_unlink(*index, n);
+    (*index)->entries[n] = *entry;
+    dir_index_link(*index, n);
+    (*index)->file_size = dir->internal.file_size;
+}
+
+// drops the entries past the end of a directory that shrank from `old_size` bytes from its
+// index, if it has an up to date one
+static void dir_index_truncate(filesystem_t *fs, inode_t *dir, size_t old_size)
+{
+    if (!fs->dir_indexes) return;
+    struct dir_index *index = fs->dir_indexes[dir - fs->inodes];
+    if (!index || index->file_size != old_size) return;
 
-        format_token_for_comparison(strtok(NULL, "/"),formatted_name);
+    size_t count = dir->internal.file_size / DIRECTORY_ENTRY_SIZE(fs);
+    while (index->count > count) dir_index_unlink(index, --index->count);
+    index->file_size = dir->internal.file_size;
+}
 
-        free(original_ptr);
-        slashes--;
-        file_found = 0;
+// looks up a name, or a tombstone with a `len` of 0, in an index. returns the entry number
+// or -1
+static ptrdiff_t dir_index_find(filesystem_t *fs, struct dir_index *index, const char *name, size_t len)
+{
+    if (len == 0)
+    {
+        if (index->tombstones == 0) return -1;
+        // the first tombstone is in the first word with a bit set, and the words skipped to
+        // get there stay skipped until a tombstone in front of them comes back
+        size_t words = (index->count + FREE_SLOT_BITS - 1) / FREE_SLOT_BITS;
+        size_t word = index->first_free;
+        while (word < words && index->free_slots[word] == 0) ++word;
+        index->first_free = word;
+        for (; word < words; ++word)
+        {
+            for (uint64_t bits = index->free_slots[word]; bits; bits &= bits - 1)
+            {
+                size_t n = word * FREE_SLOT_BITS + __builtin_ctzll(bits);
+                if (index->entries[n].inode < fs->inode_count) return n;
+            }
+        }
+        return -1;
     }
-    return 1;
+    for (uint32_t link = index->buckets[name_hash(name, len) & (index->capacity - 1)]; link; link = index->chain[link - 1])
+    {
+        directory_entry_t *entry = &index->entries[link - 1];
+        if (entry->inode >= fs->inode_count) continue;
+        if (entry_name_length(entry->name) == len && memcmp(entry->name, name, len) == 0) return link - 1;
+    }
+    return -1;
 }
 
-int verify_path_v4(char *path, inode_t* dir, filesystem_t* fs){
-    int slashes = count_char_occurrences(path,'/');
-    
-    char * token = strtok(path, "/");
-    char formatted_name[14];
-    format_token_for_comparison(token,formatted_name);
-    
-    inode_t *cur_inode = dir;
-    
-    int is_file = 0;
-    int file_found = 0;
+// entries encoded at a time when an index is saved or loaded
+#define DIR_INDEX_IO_ENTRIES 64
 
-    size_t bytes_read = 0;
+// whether inode `n` has an index that matches its directory
+static int dir_index_current(filesystem_t *fs, size_t n)
+{
+    struct dir_index *index = fs->dir_indexes[n];
+    inode_t *dir = &fs->inodes[n];
+    return index && dir->internal.file_type == DIRECTORY && !is_sorted(dir) && index->file_size == dir->internal.file_size;
+}
+
+// the trailer holds the inode and directory size of each index followed by its entries,
+// encoded like in the directory. the chains and the tombstone bitmap are linked again as
+// the entries are read, which costs no more than checking saved ones would, and no dblock
+// of the directory is read
+void save_dir_indexes(FILE *file, filesystem_t *fs)
+{
+    if (!fs->dir_indexes) return;
+    uint64_t saved = 0;
+    for (size_t n = 0; n < fs->inode_count; ++n) saved += dir_index_current(fs, n);
+    if (saved == 0) return;
+
+    fwrite(DIR_INDEX_TRAILER_MAGIC, sizeof(byte), DIR_INDEX_TRAILER_MAGIC_LEN, file);
+    fwrite(&saved, sizeof(saved), 1, file);
+    byte raw[DIR_INDEX_IO_ENTRIES * WIDE_DIRECTORY_ENTRY_SIZE];
+    for (size_t n = 0; n < fs->inode_count; ++n)
+    {
+        if (!dir_index_current(fs, n)) continue;
+        struct dir_index *index = fs->dir_indexes[n];
+        uint64_t header[2] = { n, index->file_size };
+        fwrite(header, sizeof(uint64_t), 2, file);
+        for (size_t at = 0; at < index->count; at += DIR_INDEX_IO_ENTRIES)
+        {
+            size_t take = index->count - at < DIR_INDEX_IO_ENTRIES ? index->count - at : DIR_INDEX_IO_ENTRIES;
+            for (size_t k = 0; k < take; ++k) encode_entry(fs, &index->entries[at + k], raw + k * DIRECTORY_ENTRY_SIZE(fs));
+            fwrite(raw, DIRECTORY_ENTRY_SIZE(fs), take, file);
+        }
+    }
+}
 
-    //int count = 0;
-    while(token != NULL && slashes>=0) {
-
-        if (slashes == 0){
-            is_file = 1;
-        }
-
-        byte *all_data = malloc(cur_inode->internal.file_size);
-        inode_read_data(fs,cur_inode,0,all_data,cur_inode->internal.file_size,&bytes_read);
-        byte *original_ptr = all_data;
-
-        for (size_t i = 0; i < (bytes_read)/16; i++){
-            inode_index_t inode_inside_idx;
-            memcpy(&inode_inside_idx,all_data,2);
-            all_data += 2;
-
-            char name_of_inode[14];
-            memcpy(name_of_inode, all_data, 14);
-            format_filename(name_of_inode);
-            all_data+=14;
-
-            if (is_file == 0){
-                if (strcmp(formatted_name,name_of_inode) == 0){
-                    
-                    inode_t *next_inode = &fs->inodes[inode_inside_idx];
-
-                    if (next_inode->internal.file_type != DIRECTORY){
-                        REPORT_RETCODE(DIR_NOT_FOUND);
-                        return 0;
-                    }
-
-                    if (next_inode->internal.file_type == DIRECTORY){
-                        cur_inode = next_inode;
-                        file_found = 1;
-                        break;
-                    } else {
-                        continue;
-                    }
-                } else {
-                    continue;
-                }
-            } else {
-                if (strcmp(formatted_name,name_of_inode) == 0){
-                    inode_t *next_inode = &fs->inodes[inode_inside_idx];
-                    
-                    if (next_inode->internal.file_type != DIRECTORY){
-                        REPORT_RETCODE(DIR_NOT_FOUND);
-                        return 0;
-                    }
-
-                    if (cur_inode->internal.file_size > 32){
-                        REPORT_RETCODE(DIR_NOT_EMPTY);
-                        return 1;
-                    } 
-
-                    else return 0;
-
-                    if (next_inode->internal.file_type == DIRECTORY){
-                        cur_inode = next_inode;
-                        file_found = 1;
-                        break;
-                    } else {
-                        continue;
-                    }
-                } else {
-                    continue;
-                }
+fs_retcode_t load_dir_indexes(FILE *file, filesystem_t *fs)
+{
+    uint64_t saved;
+    if (fread(&saved, sizeof(saved), 1, file) != 1 || saved > fs->inode_count) return INVALID_BINARY_FORMAT;
+    if (!fs->dir_indexes)
+    {
+        fs->dir_indexes = calloc(fs->inode_count, sizeof(struct dir_index*));
+        if (!fs->dir_indexes) return SYSTEM_ERROR;
+    }
+    // a directory cannot hold more entries than fit in the dblocks of the image
+    size_t max_entries = fs->dblock_count * DATA_BLOCK_SIZE(fs) / DIRECTORY_ENTRY_SIZE(fs);
+    byte raw[DIR_INDEX_IO_ENTRIES * WIDE_DIRECTORY_ENTRY_SIZE];
+    for (uint64_t i = 0; i < saved; ++i)
+    {
+        uint64_t header[2];
+        if (fread(header, sizeof(uint64_t), 2, file) != 2) return INVALID_BINARY_FORMAT;
+        size_t count = header[1] / DIRECTORY_ENTRY_SIZE(fs);
+        if (header[0] >= fs->inode_count || header[1] % DIRECTORY_ENTRY_SIZE(fs) != 0 || count > max_entries) return INVALID_BINARY_FORMAT;
+
+        struct dir_index *index = dir_index_sized(count);
+        if (!index) return SYSTEM_ERROR;
+        index->file_size = header[1];
+        while (index->count < count)
+        {
+            size_t take = count - index->count < DIR_INDEX_IO_ENTRIES ? count - index->count : DIR_INDEX_IO_ENTRIES;
+            if (fread(raw, DIRECTORY_ENTRY_SIZE(fs), take, file) != take)
+            {
+                free(index);
+                return INVALID_BINARY_FORMAT;
             }
+            for (size_t k = 0; k < take; ++k)
+            {
+                decode_entry(fs, raw + k * DIRECTORY_ENTRY_SIZE(fs), &index->entries[index->count]);
+                dir_index_link(index, index->count++);
+            }
+        }
+        // an index that does not match its directory is dropped like a stale one
+        size_t n = header[0];
+        if (fs->dir_indexes[n] || count < DIR_INDEX_MIN_ENTRIES)
+        {
+            free(index);
+            continue;
+        }
+        fs->dir_indexes[n] = index;
+        if (!dir_index_current(fs, n))
+        {
+            free(index);
+            fs->dir_indexes[n] = NULL;
+        }
+    }
+    return SUCCESS;
+}
+
+// looks for the first entry of a directory named by the `len` bytes at `name`, with a `len`
+// of 0 looking for a tombstone. the entry and its offset are stored in `found` and `offset`
+// if they are not null. returns 1 if there is one
+static int find_entry(filesystem_t *fs, inode_t *dir, const char *name, size_t len, directory_entry_t *found, size_t *offset)
+{
+    if (len > MAX_FILE_NAME_LEN) return 0;
+    if (is_sorted(dir))
+    {
+        // a sorted directory has no tombstones, and the offsets of its entries mean nothing
+        if (len == 0 || !btree_find(fs, dir, name, len, found)) return 0;
+        if (offset) *offset = 0;
+        return 1;
+    }
+
+    struct dir_index *index = dir_index_get(fs, dir);
+    if (index)
+    {
+        ptrdiff_t n = dir_index_find(fs, index, name, len);
+        if (n < 0) return 0;
+        if (found) *found = index->entries[n];
+        if (offset) *offset = n * DIRECTORY_ENTRY_SIZE(fs);
+        return 1;
+    }
 
+    if (len == 0)
+    {
+        entry_cursor_t cursor;
+        entry_cursor_start(fs, dir, 0, &cursor);
+        directory_entry_t entry;
+        size_t at;
+        while (entry_cursor_next(fs, &cursor, &entry, &at))
+        {
+            if (entry.inode >= fs->inode_count || entry_name_length(entry.name) != 0) continue;
+            if (found) *found = entry;
+            if (offset) *offset = at;
+            return 1;
         }
+        return 0;
+    }
 
-        if (file_found == 0 && is_file == 0){
-            REPORT_RETCODE(DIR_NOT_FOUND);
-            return 0;
-        } else if (file_found == 0 && is_file == 1){
-            REPORT_RETCODE(DIR_NOT_FOUND);
-            return 0;
+    // a dblock worth of entries is read at a time and scanned where it lies
+    entry_key_t key;
+    make_entry_key(name, len, &key);
+    byte raw[MAX_DATA_BLOCK_SIZE];
+    size_t start = 0;
+    while (start < dir->internal.file_size)
+    {
+        size_t bytes_read;
+        if (inode_read_data(fs, dir, start, raw, DIRECTORY_ENTRIES_PER_DATABLOCK(fs) * DIRECTORY_ENTRY_SIZE(fs), &bytes_read) != SUCCESS) return 0;
+        size_t count = bytes_read / DIRECTORY_ENTRY_SIZE(fs);
+        if (count == 0) return 0;
+        size_t n = entry_scan(raw, count, DIRECTORY_ENTRY_SIZE(fs), &key);
+        while (n < count)
+        {
+            directory_entry_t entry;
+            decode_entry(fs, raw + n * DIRECTORY_ENTRY_SIZE(fs), &entry);
+            if (entry.inode < fs->inode_count)
+            {
+                if (found) *found = entry;
+                if (offset) *offset = start + n * DIRECTORY_ENTRY_SIZE(fs);
+                return 1;
+            }
+            n += 1 + entry_scan(raw + (n + 1) * DIRECTORY_ENTRY_SIZE(fs), count - n - 1, DIRECTORY_ENTRY_SIZE(fs), &key);
         }
+        start += count * DIRECTORY_ENTRY_SIZE(fs);
+    }
+    return 0;
+}
+
+// ----------------------- DENTRY CACHE ------------------------ //
 
-        format_token_for_comparison(strtok(NULL, "/"),formatted_name);
+// slots of the dentry cache, a power of two
+#define DENTRY_CACHE_SIZE 4096
 
-        free(original_ptr);
-        slashes--;
-        file_found = 0;
+// a cached lookup of a name in a directory. a negative entry records that the name is not
+// there. an entry only counts while the generation and the size of the directory match, so
+// entries written through `add_entry`, which bumps the generation, and entries written
+// around it, which change the size, both make it stale
+struct dentry
+{
+    size_t parent;       // inode index of the directory plus one, 0 for an unused slot
+    size_t parent_size;
+    uint32_t generation;
+    int negative;
+    inode_index_t child;
+    size_t offset;       // of the entry in the directory
+    char name[MAX_FILE_NAME_LEN];
+};
+
+// a direct mapped cache of dentries and the generation of every directory, in one
+// allocation so `free_filesystem` can release it without knowing its layout
+struct dentry_cache
+{
+    dentry_cache_stats_t stats;
+    uint32_t *generations;
+    struct dentry slots[DENTRY_CACHE_SIZE];
+};
+
+static struct dentry_cache *dentry_cache_get(filesystem_t *fs)
+{
+    if (!fs->dentry_cache)
+    {
+        fs->dentry_cache = calloc(1, sizeof(struct dentry_cache) + fs->inode_count * sizeof(uint32_t));
+        if (!fs->dentry_cache) return NULL;
+        fs->dentry_cache->generations = (uint32_t*) (fs->dentry_cache + 1);
     }
-    return 1;
+    return fs->dentry_cache;
 }
 
-int verify_path_v2_1(char *path, inode_t* dir, filesystem_t* fs){
-    int slashes = count_char_occurrences(path,'/');
-    
-    char * token = strtok(path, "/");
-    char formatted_name[14];
-    format_token_for_comparison(token,formatted_name);
-    
-    inode_t *cur_inode = dir;
-    
-    int is_file = 0;
-    int file_found = 0;
+// drops every cached lookup in a directory whose entries changed
+static void dentry_invalidate(filesystem_t *fs, inode_t *dir)
+{
+    if (!fs->dentry_cache) return;
+    ++fs->dentry_cache->generations[dir - fs->inodes];
+    ++fs->dentry_cache->stats.invalidations;
+}
 
-    size_t bytes_read = 0;
+// looks up a name in a directory through the dentry cache. returns 1 and stores the inode
+// index of the entry in `child` if there is one, and its offset in `offset` if that is not
+// null
+static int lookup_entry(filesystem_t *fs, inode_t *dir, const char *name, size_t len, inode_index_t *child, size_t *offset)
+{
+    if (len == 0 || len > MAX_FILE_NAME_LEN) return 0;
+    struct dentry_cache *cache = dentry_cache_get(fs);
+    directory_entry_t entry;
+    size_t at;
+    if (!cache)
+    {
+        if (!find_entry(fs, dir, name, len, &entry, &at)) return 0;
+        *child = entry.inode;
+        if (offset) *offset = at;
+        return 1;
+    }
 
-    //int count = 0;
-    while(token != NULL && slashes>=0) {
-
-        if (slashes == 0){
-            is_file = 1;
-        }
-
-        byte *all_data = malloc(cur_inode->internal.file_size);
-        inode_read_data(fs,cur_inode,0,all_data,cur_inode->internal.file_size,&bytes_read);
-        byte *original_ptr = all_data;
-
-        for (size_t i = 0; i < (bytes_read)/16; i++){
-            inode_index_t inode_inside_idx;
-            memcpy(&inode_inside_idx,all_data,2);
-            all_data += 2;
-
-            char name_of_inode[14];
-            memcpy(name_of_inode, all_data, 14);
-            format_filename(name_of_inode);
-            all_data+=14;
-
-            if (is_file == 0){
-                if (strcmp(formatted_name,name_of_inode) == 0){
-                    inode_t *next_inode = &fs->inodes[inode_inside_idx];
-                    if (next_inode->internal.file_type == DIRECTORY){
-                        cur_inode = next_inode;
-                        file_found = 1;
-                        break;
-                    } else {
-                        continue;
-                    }
-                } else {
-                    continue;
-                }
-            } else {
-                if (strcmp(formatted_name,name_of_inode) == 0){
-                   REPORT_RETCODE(DIRECTORY_EXIST);
-                   return 0;
-                }
-            }
+    size_t parent = dir - fs->inodes;
+    struct dentry *slot = &cache->slots[(name_hash(name, len) ^ (uint32_t) (parent * 2654435761u)) & (DENTRY_CACHE_SIZE - 1)];
+    if (slot->parent == parent + 1 && slot->generation == cache->generations[parent]
+        && slot->parent_size == dir->internal.file_size
+        && entry_name_length(slot->name) == len && memcmp(slot->name, name, len) == 0)
+    {
+        ++cache->stats.hits;
+        if (slot->negative)
+        {
+            ++cache->stats.negative_hits;
+            return 0;
+        }
+        *child = slot->child;
+        if (offset) *offset = slot->offset;
+        return 1;
+    }
+
+    ++cache->stats.misses;
+    int found = find_entry(fs, dir, name, len, &entry, &at);
+    slot->parent = parent + 1;
+    slot->parent_size = dir->internal.file_size;
+    slot->generation = cache->generations[parent];
+    slot->negative = !found;
+    slot->child = found ? entry.inode : 0;
+    slot->offset = found ? at : 0;
+    memset(slot->name, 0, MAX_FILE_NAME_LEN);
+    memcpy(slot->name, name, len);
+    if (found)
+    {
+        *child = entry.inode;
+        if (offset) *offset = at;
+    }
+    return found;
+}
+
+void fs_dentry_cache_stats(filesystem_t *fs, dentry_cache_stats_t *stats)
+{
+    if (!stats) return;
+    memset(stats, 0, sizeof(*stats));
+    if (fs && fs->dentry_cache) *stats = fs->dentry_cache->stats;
+}
+
+// `.` and `..` are the links every directory keeps to itself and its parent
+static int is_dot_name(const char *name, size_t len)
+{
+    return (len == 1 && name[0] == '.') || (len == 2 && name[0] == '.' && name[1] == '.');
+}
 
+// where a path leads. the last component points into the path and is not copied
+typedef struct path_walk
+{
+    inode_t *parent;  // directory holding the last component
+    inode_t *child;   // object the last component names, the parent itself if it is empty
+    size_t offset;    // of the entry of `child` in `parent`
+    const char *name; // the last component, `len` bytes
+    size_t len;
+} path_walk_t;
+
+// walks `path` from the working directory in a single pass. the components are read in
+// place and looked up with `lookup_entry`, so nothing is copied or allocated. returns
+// DIR_NOT_FOUND if a directory on the way does not exist, NOT_FOUND with a null `child` if
+// only the last component does not, and SUCCESS otherwise. nothing is reported
+static fs_retcode_t walk_path(terminal_context_t *context, const char *path, path_walk_t *walk)
+{
+    filesystem_t *fs = context->fs;
+    inode_t *dir = context->working_directory;
+    const char *component = path;
+    inode_index_t child;
+    for (const char *slash; (slash = strchr(component, '/')) != NULL; component = slash + 1)
+    {
+        // repeated slashes are skipped
+        if (slash == component) continue;
+
+        if (!lookup_entry(fs, dir, component, slash - component, &child, NULL)
+            || fs->inodes[child].internal.file_type != DIRECTORY)
+        {
+            return DIR_NOT_FOUND;
         }
+        dir = &fs->inodes[child];
+    }
 
-        if (file_found == 0 && is_file == 0){
-            REPORT_RETCODE(DIR_NOT_FOUND);
-            return 0;
-        } 
+    walk->parent = dir;
+    walk->name = component;
+    walk->len = strlen(component);
+    walk->offset = 0;
+    if (walk->len == 0)
+    {
+        walk->child = dir;
+        return SUCCESS;
+    }
+    walk->child = lookup_entry(fs, dir, component, walk->len, &child, &walk->offset) ? &fs->inodes[child] : NULL;
+    return walk->child ? SUCCESS : NOT_FOUND;
+}
+
+// walks `path` and reports a failure, with `missing` reported for a last component that
+// does not exist. returns 1 if the path leads to an object
+static int walk_existing(terminal_context_t *context, const char *path, fs_retcode_t missing, path_walk_t *walk)
+{
+    fs_retcode_t ret = walk_path(context, path, walk);
+    if (ret == SUCCESS) return 1;
+    REPORT_RETCODE(ret == NOT_FOUND ? missing : ret);
+    return 0;
+}
+
+// walks the path of a new directory entry and checks that its directory exists and its
+// name is valid and unused. reports the problem and returns 0 if not
+static int walk_new_entry(terminal_context_t *context, const char *path, file_type_t type, path_walk_t *walk)
+{
+    fs_retcode_t ret = walk_path(context, path, walk);
+    if (ret == DIR_NOT_FOUND)
+    {
+        REPORT_RETCODE(DIR_NOT_FOUND);
+        return 0;
+    }
+    if (walk->len == 0)
+    {
+        REPORT_RETCODE(EMPTY_FILENAME);
+        return 0;
+    }
+    if (walk->len > MAX_FILE_NAME_LEN || is_dot_name(walk->name, walk->len))
+    {
+        REPORT_RETCODE(INVALID_FILENAME);
+        return 0;
+    }
+    if (ret == SUCCESS)
+    {
+        REPORT_RETCODE(type == DIRECTORY ? DIRECTORY_EXIST : FILE_EXIST);
+        return 0;
+    }
+    return 1;
+}
+
+// the parent of every directory is remembered once its `..` entry has been read, so going
+// up a path follows inodes without reading any directory. `..` entries are only written by
+// `add_entry`, which keeps the link in step
+static size_t *parent_link(filesystem_t *fs, inode_t *dir)
+{
+    if (!fs->dir_parents)
+    {
+        fs->dir_parents = calloc(fs->inode_count, sizeof(size_t));
+        if (!fs->dir_parents) return NULL;
+    }
+    return &fs->dir_parents[dir - fs->inodes];
+}
+
+// forgets the parent of a directory that is removed
+static void parent_link_clear(filesystem_t *fs, inode_t *dir)
+{
+    if (fs->dir_parents) fs->dir_parents[dir - fs->inodes] = 0;
+}
+
+// the directory named by the `..` entry of `dir`, or NULL if it has none
+static inode_t *parent_of(filesystem_t *fs, inode_t *dir)
+{
+    size_t *link = parent_link(fs, dir);
+    if (link && *link != 0) return &fs->inodes[*link - 1];
+
+    inode_index_t parent;
+    if (!lookup_entry(fs, dir, "..", 2, &parent, NULL)) return NULL;
+    if (link) *link = (size_t) parent + 1;
+    return &fs->inodes[parent];
+}
+
+// the path `get_path_string` built last, kept for the directory it belongs to. a prompt
+// asks for the path of the same working directory before every command, and
+// `change_directory` moves the path along one level at a time instead of building it again.
+// renaming a directory may rename any part of it, so that drops it
+struct path_cache
+{
+    inode_t *dir; // null when no path is kept
+    size_t length;
+    size_t capacity;
+    char path[];
+};
+
+// makes room for a path of `length` characters in the path cache
+static struct path_cache *path_cache_reserve(filesystem_t *fs, size_t length)
+{
+    struct path_cache *cache = fs->path_cache;
+    if (cache && length < cache->capacity) return cache;
+
+    size_t capacity = cache ? cache->capacity : 64;
+    while (capacity <= length) capacity *= 2;
+    cache = realloc(cache, sizeof(struct path_cache) + capacity);
+    if (!cache) return NULL;
+    if (!fs->path_cache) cache->dir = NULL;
+    cache->capacity = capacity;
+    fs->path_cache = cache;
+    return cache;
+}
+
+static void path_cache_invalidate(filesystem_t *fs)
+{
+    if (fs->path_cache) fs->path_cache->dir = NULL;
+}
+
+// moves the kept path from `from` to `to` when one of them holds the other, and drops it
+// on any other jump
+static void path_cache_follow(filesystem_t *fs, inode_t *from, inode_t *to)
+{
+    struct path_cache *cache = fs->path_cache;
+    if (!cache || cache->dir != from || from == to) return;
+
+    inode_t *root = &fs->inodes[0];
+    if (from != root && parent_of(fs, from) == to) {
+        cache->length -= 1 + entry_name_length(from->internal.file_name);
+        cache->path[cache->length] = '\0';
+        cache->dir = to;
+        return;
+    }
+    if (to != root && parent_of(fs, to) == from) {
+        size_t len = entry_name_length(to->internal.file_name);
+        cache = path_cache_reserve(fs, cache->length + 1 + len);
+        if (cache) {
+            cache->path[cache->length++] = '/';
+            memcpy(cache->path + cache->length, to->internal.file_name, len);
+            cache->length += len;
+            cache->path[cache->length] = '\0';
+            cache->dir = to;
+            return;
+        }
+    }
+    path_cache_invalidate(fs);
+}
+
+// checks that a directory holds nothing but `.`, `..` and tombstones
+static int directory_is_empty(filesystem_t *fs, inode_t *dir)
+{
+    entry_cursor_t cursor;
+    entry_cursor_start(fs, dir, 0, &cursor);
+    directory_entry_t entry;
+    while (entry_cursor_next(fs, &cursor, &entry, NULL))
+    {
+        size_t len = entry_name_length(entry.name);
+        if (len != 0 && !is_dot_name(entry.name, len)) return 0;
+    }
+    return 1;
+}
+
+// reports INODE_UNAVAILABLE and returns 0 if no inode can be claimed
+static int check_inode_available(filesystem_t *fs)
+{
+    if (fs->available_inode != 0) return 1;
+    REPORT_RETCODE(INODE_UNAVAILABLE);
+    return 0;
+}
+
+// picks the offset for a new entry in a directory: the first tombstone, or the end of the
+// directory. returns the number of dblocks the directory grows by when the entry is added,
+// which for a sorted directory is the most an insert can claim
+static size_t entry_slot(filesystem_t *fs, inode_t *dir, size_t *offset)
+{
+    if (is_sorted(dir))
+    {
+        *offset = 0;
+        return btree_insert_dblocks(fs, dir);
+    }
+    if (find_entry(fs, dir, "", 0, NULL, offset)) return 0;
+    size_t size = dir->internal.file_size;
+    *offset = size;
+    return calculate_necessary_dblock_amount(fs, size + DIRECTORY_ENTRY_SIZE(fs)) - calculate_necessary_dblock_amount(fs, size);
+}
+
+// writes an entry over the one at `offset`, or at an offset picked by `entry_slot` after
+// checking the dblocks it needs. a sorted directory puts the entry in its place by name,
+// replacing an entry of the same name
+static void add_entry(filesystem_t *fs, inode_t *dir, size_t offset, inode_index_t index, const char *name, size_t len)
+{
+    if (len == 2 && name[0] == '.' && name[1] == '.')
+    {
+        size_t *link = parent_link(fs, dir);
+        if (link) *link = (size_t) index + 1;
+    }
+    if (is_sorted(dir))
+    {
+        btree_insert(fs, dir, index, name, len);
+        dentry_invalidate(fs, dir);
+        return;
+    }
+    directory_entry_t entry = { index, { 0 } };
+    memcpy(entry.name, name, len);
+    byte raw[WIDE_DIRECTORY_ENTRY_SIZE];
+    encode_entry(fs, &entry, raw);
+    size_t old_size = dir->internal.file_size;
+    fs_assert_success(inode_modify_data(fs, dir, offset, raw, DIRECTORY_ENTRY_SIZE(fs)));
+    dir_index_store(fs, dir, old_size, offset, &entry);
+    dentry_invalidate(fs, dir);
+}
+
+// turns the entry a walk led to into a tombstone. a sorted directory drops it instead
+static void remove_entry(filesystem_t *fs, const path_walk_t *walk)
+{
+    if (is_sorted(walk->parent))
+    {
+        btree_remove(fs, walk->parent, walk->name, walk->len);
+        dentry_invalidate(fs, walk->parent);
+        return;
+    }
+    add_entry(fs, walk->parent, walk->offset, 0, "", 0);
+}
+
+// packed entries a compaction collects before writing them back
+#define COMPACT_BUFFER_ENTRIES 64
+
+// moves the live entries of a directory to its front, in order, so `.` and `..` stay first,
+// and gives back the dblocks the tombstones took. returns the number of tombstones dropped
+static size_t compact_directory(filesystem_t *fs, inode_t *dir)
+{
+    byte packed[COMPACT_BUFFER_ENTRIES * WIDE_DIRECTORY_ENTRY_SIZE];
+    size_t buffered = 0;
+    size_t write_at = 0; // where the entries in `packed` go
+    size_t dropped = 0;
+
+    // the packed entries never pass the entry just read, so the ones the cursor has yet to
+    // return are not overwritten
+    entry_cursor_t cursor;
+    entry_cursor_start(fs, dir, 0, &cursor);
+    directory_entry_t entry;
+    size_t at;
+    while (entry_cursor_next(fs, &cursor, &entry, &at))
+    {
+        if (entry.name[0] == '\0')
+        {
+            ++dropped;
+            continue;
+        }
+        // the entries in front of the first tombstone stay where they are
+        if (dropped == 0)
+        {
+            write_at = at + DIRECTORY_ENTRY_SIZE(fs);
+            continue;
+        }
+        encode_entry(fs, &entry, packed + buffered);
+        buffered += DIRECTORY_ENTRY_SIZE(fs);
+        if (buffered + DIRECTORY_ENTRY_SIZE(fs) > sizeof(packed))
+        {
+            fs_assert_success(inode_modify_data(fs, dir, write_at, packed, buffered));
+            write_at += buffered;
+            buffered = 0;
+        }
+    }
+    if (dropped == 0) return 0;
+
+    if (buffered > 0) fs_assert_success(inode_modify_data(fs, dir, write_at, packed, buffered));
+    fs_assert_success(inode_shrink_data(fs, dir, write_at + buffered));
+
+    // every entry after the first tombstone moved, so cached offsets are dropped and the
+    // index is rebuilt on the next lookup
+    if (fs->dir_indexes)
+    {
+        free(fs->dir_indexes[dir - fs->inodes]);
+        fs->dir_indexes[dir - fs->inodes] = NULL;
+    }
+    dentry_invalidate(fs, dir);
+    return dropped;
+}
+
+// compacts a directory once more than half of its entries are tombstones. only directories
+// with an index keep count of their tombstones, so smaller ones are left as they are
+static void compact_if_sparse(filesystem_t *fs, inode_t *dir)
+{
+    if (!fs->dir_indexes) return;
+    struct dir_index *index = fs->dir_indexes[dir - fs->inodes];
+    if (!index || index->file_size != dir->internal.file_size) return;
+    if (2 * index->tombstones > index->count) compact_directory(fs, dir);
+}
+
+// removes the entry a walk led to for good: it becomes a tombstone, and if it is the last
+// entry it is cut off with the tombstones in front of it, so a directory shrinks again once
+// its last entries are deleted. a directory left mostly empty is compacted
+static void delete_entry(filesystem_t *fs, const path_walk_t *walk)
+{
+    remove_entry(fs, walk);
+    if (is_sorted(walk->parent)) return;
+
+    inode_t *dir = walk->parent;
+    size_t offset = walk->offset;
+    size_t size = dir->internal.file_size;
+    if (offset + DIRECTORY_ENTRY_SIZE(fs) == size)
+    {
+        size_t new_size = offset;
+        while (new_size > 0)
+        {
+            byte raw[WIDE_DIRECTORY_ENTRY_SIZE];
+            size_t bytes_read;
+            directory_entry_t entry;
+            if (inode_read_data(fs, dir, new_size - DIRECTORY_ENTRY_SIZE(fs), raw, DIRECTORY_ENTRY_SIZE(fs), &bytes_read) != SUCCESS
+                || bytes_read != DIRECTORY_ENTRY_SIZE(fs)) break;
+            decode_entry(fs, raw, &entry);
+            if (entry.name[0] != '\0') break;
+            new_size -= DIRECTORY_ENTRY_SIZE(fs);
+        }
+        fs_assert_success(inode_shrink_data(fs, dir, new_size));
+        dir_index_truncate(fs, dir, size);
+    }
+    compact_if_sparse(fs, dir);
+}
+
+static int compare_entry_names(const void *a, const void *b)
+{
+    return memcmp(((const directory_entry_t*) a)->name, ((const directory_entry_t*) b)->name, MAX_FILE_NAME_LEN);
+}
+
+// stores the entries of a directory in a new packed tree, which makes it sorted, and gives
+// back the dblocks of the entries it had before. this is also how a sorted directory is
+// compacted. returns SUCCESS, INSUFFICIENT_DBLOCKS or SYSTEM_ERROR
+static fs_retcode_t sort_directory(filesystem_t *fs, inode_t *dir)
+{
+    size_t capacity = dir->internal.file_size / DIRECTORY_ENTRY_SIZE(fs);
+    directory_entry_t *entries = malloc((capacity > 0 ? capacity : 1) * sizeof(directory_entry_t));
+    if (!entries) return SYSTEM_ERROR;
+
+    size_t count = 0;
+    entry_cursor_t cursor;
+    entry_cursor_start(fs, dir, 0, &cursor);
+    while (count < capacity && entry_cursor_next(fs, &cursor, &entries[count], NULL))
+    {
+        if (entries[count].name[0] != '\0' && entries[count].inode < fs->inode_count) ++count;
+    }
+    // the tree holds a name once, so a name written twice around `add_entry` keeps one entry
+    if (!is_sorted(dir))
+    {
+        qsort(entries, count, sizeof(directory_entry_t), compare_entry_names);
+        size_t unique = 0;
+        for (size_t n = 0; n < count; ++n)
+        {
+            if (unique > 0 && compare_entry_names(&entries[unique - 1], &entries[n]) == 0) continue;
+            entries[unique++] = entries[n];
+        }
+        count = unique;
+    }
+
+    if (!has_available_dblocks(fs, btree_build_dblocks(fs, count)))
+    {
+        free(entries);
+        return INSUFFICIENT_DBLOCKS;
+    }
+    dblock_index_t root;
+    fs_retcode_t ret = btree_build(fs, entries, count, &root);
+    free(entries);
+    if (ret != SUCCESS) return ret;
+
+    if (is_sorted(dir)) btree_release(fs, dir->internal.direct_data[0], 0);
+    else fs_assert_success(inode_release_data(fs, dir));
+    if (fs->dir_indexes)
+    {
+        free(fs->dir_indexes[dir - fs->inodes]);
+        fs->dir_indexes[dir - fs->inodes] = NULL;
+    }
+    dir->internal.file_perms |= FS_SORTED;
+    dir->internal.file_size = count * DIRECTORY_ENTRY_SIZE(fs);
+    memset(dir->internal.direct_data, 0, sizeof(dir->internal.direct_data));
+    dir->internal.direct_data[0] = root;
+    dir->internal.indirect_dblock = 0;
+    subtree_set_dblocks(fs, dir, btree_build_dblocks(fs, count));
+    subtree_update(fs, dir);
+    dentry_invalidate(fs, dir);
+    return SUCCESS;
+}
+
+// gives back the dblocks of a directory in either format
+static void release_directory_data(filesystem_t *fs, inode_t *dir)
+{
+    if (!is_sorted(dir))
+    {
+        fs_assert_success(inode_release_data(fs, dir));
+        return;
+    }
+    btree_release(fs, dir->internal.direct_data[0], 0);
+    dir->internal.file_perms &= ~FS_SORTED;
+    dir->internal.file_size = 0;
+    dir->internal.direct_data[0] = 0;
+    subtree_update(fs, dir);
+}
+
+// claims the available inode, which must exist, for an empty object
+static inode_t *claim_new_inode(filesystem_t *fs, file_type_t type, permission_t perms, const char *name, size_t len)
+{
+    inode_index_t index;
+    fs_assert_success(claim_available_inode(fs, &index));
+
+    inode_t *inode = &fs->inodes[index];
+    inode->internal.file_type = type;
+    inode->internal.file_perms = perms;
+    memcpy(inode->internal.file_name, name, len);
+    if (len < MAX_FILE_NAME_LEN) inode->internal.file_name[len] = '\0';
+    inode->internal.file_size = 0;
+    memset(inode->internal.direct_data, 0, sizeof(inode->internal.direct_data));
+    inode->internal.indirect_dblock = 0;
+    subtree_reset(fs, inode);
+    return inode;
+}
+
+// creates an object named by the `len` bytes at `name` in `parent`, which holds no entry of
+// that name, along with the `.` and `..` entries of a directory. only the permission bits
+// of `perms` are kept, FS_COMPRESSED and FS_SORTED are set by the code that lays the data
+// out. reports the problem and returns NULL if the inode or the dblocks it needs are not
+// available
+static inode_t *create_object(filesystem_t *fs, inode_t *parent, const char *name, size_t len, file_type_t type, permission_t perms)
+{
+    if (!check_inode_available(fs)) return NULL;
+
+    // the file system is only modified once the entries are known to fit
+    size_t offset;
+    size_t dblocks_needed = entry_slot(fs, parent, &offset);
+    if (type == DIRECTORY) dblocks_needed += calculate_necessary_dblock_amount(fs, 2 * DIRECTORY_ENTRY_SIZE(fs));
+    if (!has_available_dblocks(fs, dblocks_needed)){
+        REPORT_RETCODE(INSUFFICIENT_DBLOCKS);
+        return NULL;
+    }
+
+    inode_t *inode = claim_new_inode(fs, type, perms & (FS_READ | FS_WRITE | FS_EXECUTE), name, len);
+    if (type == DIRECTORY){
+        add_entry(fs, inode, 0, inode - fs->inodes, ".", 1);
+        add_entry(fs, inode, DIRECTORY_ENTRY_SIZE(fs), parent - fs->inodes, "..", 2);
+    }
+    add_entry(fs, parent, offset, inode - fs->inodes, name, len);
+    subtree_link(fs, parent, inode);
+    return inode;
+}
+
+// ----------------------- DIRECTORY STREAMS ----------------------- //
+
+// an open directory
+struct fs_dir
+{
+    filesystem_t *fs;
+    entry_cursor_t cursor;
+};
+
+// starts a stream at the first entry whose name is at least the `len` bytes at `name`,
+// which only skips entries in a sorted directory, see `entry_cursor_seek`. without
+// checksums to verify, a linear directory is copied from its dblocks where they lie
+static void dir_stream_start(filesystem_t *fs, inode_t *dir, const char *name, size_t len, struct fs_dir *stream)
+{
+    stream->fs = fs;
+    if (fs->dblock_checksums == NULL && !is_sorted(dir)) entry_cursor_start_shared(fs, dir, &stream->cursor);
+    else entry_cursor_seek(fs, dir, name, len, &stream->cursor);
+}
+
+// opens a stream of a directory from its first entry. returns NULL if memory ran out
+static struct fs_dir *dir_stream_open(filesystem_t *fs, inode_t *dir)
+{
+    struct fs_dir *stream = malloc(sizeof(struct fs_dir));
+    if (stream) dir_stream_start(fs, dir, "", 0, stream);
+    return stream;
+}
+
+fs_dir_t fs_opendir(terminal_context_t *context, char *path)
+{
+    if (context == NULL){
+        return NULL;
+    }
+    if (path == NULL){
+        REPORT_RETCODE(DIR_NOT_FOUND);
+        return NULL;
+    }
+
+    path_walk_t walk;
+    if (!walk_existing(context, path, DIR_NOT_FOUND, &walk)){
+        return NULL;
+    }
+    if (walk.child->internal.file_type != DIRECTORY){
+        REPORT_RETCODE(DIR_NOT_FOUND);
+        return NULL;
+    }
+
+    fs_dir_t dir = dir_stream_open(context->fs, walk.child);
+    if (dir == NULL){
+        REPORT_RETCODE(SYSTEM_ERROR);
+    }
+    return dir;
+}
+
+int fs_readdir(fs_dir_t dir, fs_dirent_t *entry)
+{
+    if (dir == NULL || entry == NULL){
+        return 0;
+    }
+    filesystem_t *fs = dir->fs;
+
+    directory_entry_t found;
+    while (entry_cursor_next(fs, &dir->cursor, &found, NULL))
+    {
+        size_t len = entry_name_length(found.name);
+        if (len == 0 || found.inode >= fs->inode_count) continue;
+        entry->inode = found.inode;
+        entry->type = fs->inodes[found.inode].internal.file_type;
+        entry->name_len = len;
+        memcpy(entry->name, found.name, len);
+        entry->name[len] = '\0';
+        return 1;
+    }
+    return 0;
+}
+
+void fs_closedir(fs_dir_t dir)
+{
+    free(dir);
+}
+
+// ----------------------- PARALLEL WALKS ----------------------- //
+
+// the live entries of a directory other than `.` and `..`, in the order a cursor walks them
+typedef struct listing
+{
+    size_t count;
+    directory_entry_t entries[];
+} listing_t;
+
+typedef struct listing_walk
+{
+    filesystem_t *fs;
+    listing_t **listings; // one per inode, null for the objects that are not walked directories
+} listing_walk_t;
+
+// reads a directory with a shared cursor and queues its subdirectories
+static void listing_visit(traverse_worker_t *worker, inode_index_t dir, void *arg)
+{
+    listing_walk_t *walk = arg;
+    filesystem_t *fs = walk->fs;
+    inode_t *inode = &fs->inodes[dir];
+
+    size_t capacity = inode->internal.file_size / DIRECTORY_ENTRY_SIZE(fs);
+    listing_t *listing = malloc(sizeof(listing_t) + capacity * sizeof(directory_entry_t));
+    if (!listing){
+        traverse_fail(worker);
+        return;
+    }
+    listing->count = 0;
+
+    entry_cursor_t cursor;
+    entry_cursor_start_shared(fs, inode, &cursor);
+    directory_entry_t entry;
+    while (listing->count < capacity && entry_cursor_next(fs, &cursor, &entry, NULL))
+    {
+        size_t len = entry_name_length(entry.name);
+        if (len == 0 || is_dot_name(entry.name, len) || entry.inode >= fs->inode_count) continue;
+        listing->entries[listing->count++] = entry;
+        if (fs->inodes[entry.inode].internal.file_type == DIRECTORY) traverse_push(worker, entry.inode);
+    }
+    walk->listings[dir] = listing;
+}
+
+static void free_listings(filesystem_t *fs, listing_t **listings)
+{
+    for (size_t i = 0; i < fs->inode_count; ++i) free(listings[i]);
+    free(listings);
+}
+
+// reads `top` and every directory below it in parallel. returns the listing of each of
+// them, indexed by inode, or null if memory ran out
+static listing_t **collect_listings(filesystem_t *fs, inode_t *top)
+{
+    listing_walk_t walk = { fs, calloc(fs->inode_count, sizeof(listing_t*)) };
+    if (!walk.listings) return NULL;
+    if (fs_traverse(fs, top - fs->inodes, fs->traverse_threads, listing_visit, &walk) != SUCCESS){
+        free_listings(fs, walk.listings);
+        return NULL;
+    }
+    return walk.listings;
+}
+
+// ----------------------- CORE FUNCTION ----------------------- //
+int new_file(terminal_context_t *context, char *path, permission_t perms)
+{
+    if (context == NULL || path == NULL){
+        return 0;
+    }
+
+    path_walk_t walk;
+    if (!walk_new_entry(context, path, DATA_FILE, &walk)
+        || !create_object(context->fs, walk.parent, walk.name, walk.len, DATA_FILE, perms)){
+        return -1;
+    }
+    return 0;
+}
+
+int new_directory(terminal_context_t *context, char *path)
+{
+    if (context == NULL || path == NULL){
+        return 0;
+    }
+
+    path_walk_t walk;
+    if (!walk_new_entry(context, path, DIRECTORY, &walk)
+        || !create_object(context->fs, walk.parent, walk.name, walk.len, DIRECTORY, 0)){
+        return -1;
+    }
+    return 0;
+}
+
+// defined with the write buffers, dropped when their inode is released
+static void drop_inode_writers(filesystem_t *fs, inode_t *inode);
+
+int remove_file(terminal_context_t *context, char *path)
+{
+    if (context == NULL || path == NULL){
+        return 0;
+    }
+    filesystem_t *fs = context->fs;
+
+    path_walk_t walk;
+    if (!walk_existing(context, path, FILE_NOT_FOUND, &walk)){
+        return -1;
+    }
+    if (walk.len == 0 || walk.child->internal.file_type != DATA_FILE){
+        REPORT_RETCODE(FILE_NOT_FOUND);
+        return -1;
+    }
+
+    subtree_unlink(fs, walk.child);
+    if (fs->write_buffers) drop_inode_writers(fs, walk.child);
+    fs_assert_success(inode_release_data(fs, walk.child));
+    fs_assert_success(release_inode(fs, walk.child));
+    delete_entry(fs, &walk);
+    return 0;
+}
+
+// we can only delete a directory if it is empty!!
+int remove_directory(terminal_context_t *context, char *path)
+{
+    if (context == NULL || path == NULL){
+        return 0;
+    }
+    filesystem_t *fs = context->fs;
+
+    path_walk_t walk;
+    fs_retcode_t ret = walk_path(context, path, &walk);
+    if (ret == DIR_NOT_FOUND){
+        REPORT_RETCODE(DIR_NOT_FOUND);
+        return -1;
+    }
+    // `.` and `..` are removed with the directory holding them
+    if (walk.len == 0 || is_dot_name(walk.name, walk.len)){
+        REPORT_RETCODE(INVALID_FILENAME);
+        return -1;
+    }
+    if (ret == NOT_FOUND || walk.child->internal.file_type != DIRECTORY){
+        REPORT_RETCODE(DIR_NOT_FOUND);
+        return -1;
+    }
+    if (walk.child == context->working_directory){
+        REPORT_RETCODE(ATTEMPT_DELETE_CWD);
+        return -1;
+    }
+    if (!directory_is_empty(fs, walk.child)){
+        REPORT_RETCODE(DIR_NOT_EMPTY);
+        return -1;
+    }
+
+    subtree_unlink(fs, walk.child);
+    release_directory_data(fs, walk.child);
+    parent_link_clear(fs, walk.child);
+    if (fs->path_cache && fs->path_cache->dir == walk.child) path_cache_invalidate(fs);
+    fs_assert_success(release_inode(fs, walk.child));
+    delete_entry(fs, &walk);
+    return 0;
+}
+
+int change_directory(terminal_context_t *context, char *path)
+{
+    if (context == NULL || path == NULL){
+        return 0;
+    }
+
+    path_walk_t walk;
+    if (!walk_existing(context, path, DIR_NOT_FOUND, &walk)){
+        return -1;
+    }
+    if (walk.child->internal.file_type != DIRECTORY){
+        REPORT_RETCODE(DIR_NOT_FOUND);
+        return -1;
+    }
+
+    path_cache_follow(context->fs, context->working_directory, walk.child);
+    context->working_directory = walk.child;
+    return 0;
+}
+
+// prints a line of `list` for an object shown under the name `name`
+static void list_object(filesystem_t *fs, inode_t *inode, const char *name, size_t len, const char *target)
+{
+    permission_t perms = inode->internal.file_perms;
+    printf("%c%c%c%c\t%zu\t%.*s",
+        inode->internal.file_type == DIRECTORY ? 'd' : 'f',
+        perms & FS_READ ? 'r' : '-',
+        perms & FS_WRITE ? 'w' : '-',
+        perms & FS_EXECUTE ? 'x' : '-',
+        inode_data_size(fs, inode), (int) len, name);
+    // `.` and `..` show the directory they link to
+    if (target) printf(" -> %.*s", (int) entry_name_length(target), target);
+    printf("\n");
+}
+
+// whether a name holds a `*` or a `?`, which makes it a pattern for `list`
+static int is_pattern(const char *name, size_t len)
+{
+    return memchr(name, '*', len) != NULL || memchr(name, '?', len) != NULL;
+}
+
+// matches a name against a pattern where `*` stands for any run of characters and `?` for
+// any one character
+static int pattern_match(const char *pattern, size_t pattern_len, const char *name, size_t len)
+{
+    size_t p = 0, n = 0;
+    size_t star = pattern_len, resume = 0; // the last `*` and where its match ends so far
+    while (n < len)
+    {
+        if (p < pattern_len && (pattern[p] == '?' || pattern[p] == name[n])){
+            ++p;
+            ++n;
+        } else if (p < pattern_len && pattern[p] == '*'){
+            star = p++;
+            resume = n;
+        } else if (star < pattern_len){
+            // the `*` takes one more character
+            p = star + 1;
+            n = ++resume;
+        } else {
+            return 0;
+        }
+    }
+    while (p < pattern_len && pattern[p] == '*') ++p;
+    return p == pattern_len;
+}
+
+// lists the entries of a directory whose names match a pattern, leaving out `.` and `..`.
+// in a sorted directory only the names starting with the part of the pattern in front of
+// its first wildcard are read
+static int list_matches(filesystem_t *fs, inode_t *dir, const char *pattern, size_t len)
+{
+    size_t prefix = 0;
+    while (prefix < len && pattern[prefix] != '*' && pattern[prefix] != '?') ++prefix;
+
+    size_t matches = 0;
+    struct fs_dir stream;
+    dir_stream_start(fs, dir, pattern, prefix, &stream);
+    fs_dirent_t entry;
+    while (fs_readdir(&stream, &entry))
+    {
+        size_t entry_len = entry.name_len;
+        if (is_dot_name(entry.name, entry_len)) continue;
+        if (entry_len < prefix || memcmp(entry.name, pattern, prefix) != 0){
+            // the names with the prefix are all behind the cursor once one without it
+            // comes up in name order
+            if (is_sorted(dir) && memcmp(entry.name, pattern, entry_len < prefix ? entry_len : prefix) > 0) break;
+            continue;
+        }
+        if (!pattern_match(pattern, len, entry.name, entry_len)) continue;
+        list_object(fs, &fs->inodes[entry.inode], entry.name, entry_len, NULL);
+        ++matches;
+    }
+
+    if (matches == 0){
+        REPORT_RETCODE(NOT_FOUND);
+        return -1;
+    }
+    return 0;
+}
+
+int list(terminal_context_t *context, char *path)
+{
+    if (context == NULL || path == NULL){
+        return 0;
+    }
+    filesystem_t *fs = context->fs;
+
+    // a last component with wildcards lists what it matches
+    path_walk_t walk;
+    fs_retcode_t ret = walk_path(context, path, &walk);
+    if (ret != DIR_NOT_FOUND && is_pattern(walk.name, walk.len)){
+        return list_matches(fs, walk.parent, walk.name, walk.len);
+    }
+    if (ret != SUCCESS){
+        REPORT_RETCODE(ret);
+        return -1;
+    }
+    inode_t *object = walk.child;
+    if (object->internal.file_type != DIRECTORY){
+        list_object(fs, object, object->internal.file_name, entry_name_length(object->internal.file_name), NULL);
+        return 0;
+    }
+
+    // the entries are printed as they are read
+    struct fs_dir stream;
+    dir_stream_start(fs, object, "", 0, &stream);
+    fs_dirent_t entry;
+    while (fs_readdir(&stream, &entry))
+    {
+        inode_t *inode = &fs->inodes[entry.inode];
+        list_object(fs, inode, entry.name, entry.name_len, is_dot_name(entry.name, entry.name_len) ? inode->internal.file_name : NULL);
+    }
+    return 0;
+}
+
+char *get_path_string(terminal_context_t *context)
+{
+    if (context == NULL) {
+        char *empty_str = malloc(1);
+        if (empty_str) {
+            empty_str[0] = '\0';
+        }
+        return empty_str;
+    }
+    filesystem_t *fs = context->fs;
+    inode_t *root = &fs->inodes[0];
+
+    // the path of the working directory is usually kept from the last call
+    struct path_cache *cache = fs->path_cache;
+    if (cache && cache->dir == context->working_directory) {
+        char *path = malloc(cache->length + 1);
+        if (path) {
+            memcpy(path, cache->path, cache->length + 1);
+        }
+        return path;
+    }
+
+    // the names are met going up from the working directory, so a first walk up measures
+    // the path and a second fills it in from its end. every inode keeps its own name and
+    // its parent link, so once the links are known no directory is read
+    size_t length = strlen("root");
+    inode_t *dir = context->working_directory;
+    for (size_t depth = 0; dir != NULL && dir != root; ++depth)
+    {
+        // a loop of `..` entries never reaches the root
+        if (depth == fs->inode_count) {
+            dir = NULL;
+            break;
+        }
+        length += 1 + entry_name_length(dir->internal.file_name);
+        dir = parent_of(fs, dir);
+    }
+
+    char *path = malloc(dir != NULL ? length + 1 : 1);
+    if (path == NULL) {
+        return NULL;
+    }
+    if (dir == NULL) {
+        path[0] = '\0';
+        return path;
+    }
+
+    size_t end = length;
+    path[length] = '\0';
+    for (dir = context->working_directory; dir != root; dir = parent_of(fs, dir))
+    {
+        size_t len = entry_name_length(dir->internal.file_name);
+        length -= len;
+        memcpy(path + length, dir->internal.file_name, len);
+        path[--length] = '/';
+    }
+    memcpy(path, "root", strlen("root"));
+
+    cache = path_cache_reserve(fs, end);
+    if (cache) {
+        memcpy(cache->path, path, end + 1);
+        cache->length = end;
+        cache->dir = context->working_directory;
+    }
+    return path;
+}
+
+// prints an object and, for a directory, everything below it indented by its depth, reading
+// the entries of each directory as they are printed. one stream is open per level. returns
+// 0, or -1 if memory ran out
+static int tree_stream(filesystem_t *fs, inode_index_t index, const char *name, size_t len, int depth)
+{
+    printf("%*s%.*s\n", 3 * depth, "", (int) len, name);
+    inode_t *inode = &fs->inodes[index];
+    if (inode->internal.file_type != DIRECTORY) return 0;
+
+    fs_dir_t dir = dir_stream_open(fs, inode);
+    if (dir == NULL) return -1;
+    int ret = 0;
+    fs_dirent_t entry;
+    while (ret == 0 && fs_readdir(dir, &entry))
+    {
+        if (is_dot_name(entry.name, entry.name_len)) continue;
+        ret = tree_stream(fs, entry.inode, entry.name, entry.name_len, depth + 1);
+    }
+    fs_closedir(dir);
+    return ret;
+}
+
+// prints an object and, for a directory, everything below it indented by its depth, from
+// the listings of a parallel walk
+static void tree_object(listing_t **listings, inode_index_t index, const char *name, size_t len, int depth)
+{
+    printf("%*s%.*s\n", 3 * depth, "", (int) len, name);
+    listing_t *listing = listings[index];
+    if (listing == NULL) return;
+
+    for (size_t n = 0; n < listing->count; ++n)
+    {
+        const directory_entry_t *entry = &listing->entries[n];
+        tree_object(listings, entry->inode, entry->name, entry_name_length(entry->name), depth + 1);
+    }
+}
+
+int tree(terminal_context_t *context, char *path)
+{
+    if (context == NULL || path == NULL){
+        return 0;
+    }
+    filesystem_t *fs = context->fs;
+
+    path_walk_t walk;
+    if (!walk_existing(context, path, NOT_FOUND, &walk)){
+        return -1;
+    }
+    // `.` and `..` are shown under the name of the directory they link to
+    inode_t *object = walk.child;
+    const char *name = object->internal.file_name;
+    if (object->internal.file_type != DIRECTORY){
+        printf("%.*s\n", (int) entry_name_length(name), name);
+        return 0;
+    }
+
+    // a single thread streams the entries. several read the directories in parallel, then
+    // the tree is printed in order
+    if (traverse_thread_count(fs->traverse_threads) == 1){
+        if (tree_stream(fs, object - fs->inodes, name, entry_name_length(name), 0) != 0){
+            REPORT_RETCODE(SYSTEM_ERROR);
+            return -1;
+        }
+        return 0;
+    }
+    listing_t **listings = collect_listings(fs, object);
+    if (listings == NULL){
+        REPORT_RETCODE(SYSTEM_ERROR);
+        return -1;
+    }
+    tree_object(listings, object - fs->inodes, name, entry_name_length(name), 0);
+    free_listings(fs, listings);
+    return 0;
+}
+
+//Part 2
+void new_terminal(filesystem_t *fs, terminal_context_t *term)
+{
+    if (fs==NULL) return;
+    term->fs = fs;
+    term->working_directory = &(fs->inodes[0]);
+}
+
+fs_file_t fs_open(terminal_context_t *context, char *path)
+{
+    if (context==NULL){
+        return NULL;
+    }
+    
+    if (path==NULL){
+        REPORT_RETCODE(DIR_NOT_FOUND);
+        return NULL;
+    }
+
+    path_walk_t walk;
+    if (!walk_existing(context, path, FILE_NOT_FOUND, &walk)){
+        return NULL;
+    }
+    if (walk.child->internal.file_type != DATA_FILE){
+        REPORT_RETCODE(INVALID_FILE_TYPE);
+        return NULL;
+    }
+
+    fs_file_t file = (struct fs_file*)malloc(sizeof(struct fs_file));
+    if (file == NULL){
+        REPORT_RETCODE(SYSTEM_ERROR);
+        return NULL;
+    }
+
+    file->offset = 0;
+    file->inode = walk.child;
+    file->fs = context->fs;
+
+    return file;
+}
+
+// ----------------------- WRITE BUFFER --------------------- //
+
+// the buffer of a file handle. kept in a list on the file system rather than in `fs_file`
+// so handles built by callers without `fs_open` stay valid
+struct write_buffer
+{
+    fs_file_t file;
+    byte *data;
+    size_t capacity;
+    size_t buffered; // pending bytes, ending at `file->offset`
+    size_t verified; // dblocks known to be free for the pending bytes
+    struct write_buffer *next;
+};
+
+static struct write_buffer *find_write_buffer(fs_file_t file)
+{
+    for (struct write_buffer *iter = file->fs->write_buffers; iter; iter = iter->next)
+    {
+        if (iter->file == file) return iter;
+    }
+    return NULL;
+}
+
+static int flush_write_buffer(struct write_buffer *wb)
+{
+    if (wb->buffered == 0) return 0;
+
+    fs_file_t file = wb->file;
+    size_t start = file->offset - wb->buffered;
+    fs_retcode_t ret = inode_modify_data(file->fs, file->inode, start, wb->data, wb->buffered);
+    wb->buffered = 0;
+    wb->verified = 0;
+    if (ret != SUCCESS)
+    {
+        file->offset = start;
+        return -1;
+    }
+    return 0;
+}
+
+// flushes every handle with buffered writes to `inode` except `except`
+static void flush_inode_writers(filesystem_t *fs, inode_t *inode, fs_file_t except)
+{
+    for (struct write_buffer *iter = fs->write_buffers; iter; iter = iter->next)
+    {
+        if (iter->buffered && iter->file->inode == inode && iter->file != except) flush_write_buffer(iter);
+    }
+}
+
+// discards the buffered writes of every handle to `inode`, which is being released. the
+// handles stay open but no longer write into the inode once it is reused
+static void drop_inode_writers(filesystem_t *fs, inode_t *inode)
+{
+    for (struct write_buffer *iter = fs->write_buffers; iter; iter = iter->next)
+    {
+        if (iter->buffered && iter->file->inode == inode)
+        {
+            iter->file->offset -= iter->buffered;
+            iter->buffered = 0;
+            iter->verified = 0;
+        }
+    }
+}
+
+static void remove_write_buffer(fs_file_t file)
+{
+    for (struct write_buffer **link = &file->fs->write_buffers; *link; link = &(*link)->next)
+    {
+        if ((*link)->file == file)
+        {
+            struct write_buffer *wb = *link;
+            flush_write_buffer(wb);
+            *link = wb->next;
+            free(wb->data);
+            free(wb);
+            return;
+        }
+    }
+}
+
+int fs_flush(fs_file_t file)
+{
+    if (file == NULL) return -1;
+    struct write_buffer *wb = file->fs->write_buffers ? find_write_buffer(file) : NULL;
+    return wb ? flush_write_buffer(wb) : 0;
+}
+
+int fs_set_write_buffer(fs_file_t file, size_t capacity)
+{
+    if (file == NULL) return -1;
+    if (fs_flush(file) != 0) return -1;
+    remove_write_buffer(file);
+    if (capacity == 0) return 0;
+
+    struct write_buffer *wb = malloc(sizeof(struct write_buffer));
+    if (wb == NULL) return -1;
+    wb->capacity = (capacity + DATA_BLOCK_SIZE(file->fs) - 1) / DATA_BLOCK_SIZE(file->fs) * DATA_BLOCK_SIZE(file->fs);
+    wb->data = malloc(wb->capacity);
+    if (wb->data == NULL)
+    {
+        free(wb);
+        return -1;
+    }
+    wb->file = file;
+    wb->buffered = 0;
+    wb->verified = 0;
+    wb->next = file->fs->write_buffers;
+    file->fs->write_buffers = wb;
+    return 0;
+}
+
+// collects a write in the buffer of the handle. returns 0 if it has to be written directly instead
+static int buffer_write(struct write_buffer *wb, void *buffer, size_t n)
+{
+    fs_file_t file = wb->file;
+    if (n >= wb->capacity) return 0;
+    if (file->inode->internal.file_perms & FS_COMPRESSED) return 0;
+    if (wb->buffered + n > wb->capacity && flush_write_buffer(wb) != 0) return 0;
+
+    // the buffered run must fit in the file system once it is flushed. the first check of
+    // a run tries to cover a full buffer so later writes of the run skip the scan
+    size_t file_size = file->inode->internal.file_size;
+    size_t end = file->offset + n;
+    if (end > file_size)
+    {
+        size_t dblocks_needed = calculate_necessary_dblock_amount(file->fs, end) - calculate_necessary_dblock_amount(file->fs, file_size);
+        if (dblocks_needed > wb->verified)
+        {
+            size_t run_end = file->offset - wb->buffered + wb->capacity;
+            size_t dblocks_for_run = calculate_necessary_dblock_amount(file->fs, run_end > end ? run_end : end) - calculate_necessary_dblock_amount(file->fs, file_size);
+            if (has_available_dblocks(file->fs, dblocks_for_run)) wb->verified = dblocks_for_run;
+            else if (has_available_dblocks(file->fs, dblocks_needed)) wb->verified = dblocks_needed;
+            else return 0;
+        }
+    }
+
+    memcpy(wb->data + wb->buffered, buffer, n);
+    wb->buffered += n;
+    file->offset += n;
+
+    if (wb->buffered == wb->capacity) flush_write_buffer(wb);
+    return 1;
+}
+
+void fs_close(fs_file_t file)
+{
+    if (file == NULL) return;
+    if (file->fs->write_buffers) remove_write_buffer(file);
+    free(file);
+}
+
+size_t fs_read(fs_file_t file, void *buffer, size_t n)
+{
+    if (file == NULL) return 0;
+    if (file->fs->write_buffers) flush_inode_writers(file->fs, file->inode, NULL);
+
+    size_t offset = file->offset;
+    size_t file_size = inode_data_size(file->fs, file->inode);
+    size_t bytes_read = 0;
+    fs_retcode_t ret = inode_read_data(file->fs, file->inode, file->offset, buffer, n, &bytes_read);
+    if (ret != SUCCESS){
+        // a read stopping at a corrupted dblock returns what was copied in front of it
+        REPORT_RETCODE(ret);
+    }
+    else{
+        inode_read_ahead(file->fs, file->inode, offset, bytes_read);
+    }
+
+    // the count is only ever lowered, to the end of the file
+    size_t remaining = offset < file_size ? file_size - offset : 0;
+    if (bytes_read > remaining){
+        bytes_read = remaining;
+    }
+
+    file->offset += bytes_read;
+    
+    return bytes_read;
+}
+
+size_t fs_write(fs_file_t file, void *buffer, size_t n)
+{
+    if (file == NULL) return 0;
+    if (file->fs->write_buffers)
+    {
+        flush_inode_writers(file->fs, file->inode, file);
+        struct write_buffer *wb = find_write_buffer(file);
+        if (wb && buffer_write(wb, buffer, n)) return n;
+        if (wb && flush_write_buffer(wb) != 0) return 0;
+    }
+
+    fs_retcode_t ret = inode_modify_data(file->fs, file->inode, file->offset, buffer, n);
+    
+    if (ret != SUCCESS) {
+        return 0;  // Return 0 bytes written
+    }
+    
+    file->offset += n;
+    
+    return n;  // Return the number of bytes written
+}
+
+size_t fs_fill(fs_file_t file, const void *pattern, size_t pattern_size, size_t n)
+{
+    if (file == NULL) return 0;
+    if (file->fs->write_buffers) flush_inode_writers(file->fs, file->inode, NULL);
+
+    if (inode_fill_data(file->fs, file->inode, file->offset, pattern, pattern_size, n) != SUCCESS) return 0;
+    file->offset += n;
+    return n;
+}
+
+int fs_seek(fs_file_t file, seek_mode_t seek_mode, int offset)
+{
+    if (file == NULL) return -1;
+    if (seek_mode>4) return -1;
+    if (file->fs->write_buffers) flush_inode_writers(file->fs, file->inode, NULL);
+
+    long new_offset = 0; 
+    size_t file_size = inode_data_size(file->fs, file->inode);
+
+    // Calculate new position based on seek mode
+    if (seek_mode == FS_SEEK_START) {
+        new_offset = offset;
+    } else if (seek_mode == FS_SEEK_CURRENT) {
+        new_offset = (long)file->offset + offset;
+    } else if (seek_mode == FS_SEEK_END) {
+        if (offset<=0){
+            offset = offset*-1;
+            new_offset = (long)file_size - offset;
+        } else {
+            new_offset = file_size;
+        }
+    } else {
+        return -1;
+    }
 
-        format_token_for_comparison(strtok(NULL, "/"),formatted_name);
+    if (new_offset < 0) {
+        return -1;
+    }
 
-        free(original_ptr);
-        slashes--;
-        file_found = 0;
+    if ((size_t)new_offset > file_size) {
+        file->offset = file_size;
+    } else {
+        file->offset = (size_t)new_offset;
     }
-    return 1;
+
+    return 0; // Success
 }
 
-// ----------------------- CORE FUNCTION ----------------------- //
-int new_file(terminal_context_t *context, char *path, permission_t perms)
-{
+// ----------------------- COPY ----------------------- //
 
-    if (context == NULL || path == NULL){
+int fs_copy(terminal_context_t *context, char *src_path, char *dst_path)
+{
+    if (context == NULL || src_path == NULL || dst_path == NULL){
         return 0;
-    } 
+    }
+    filesystem_t *fs = context->fs;
 
-    if (verify_path_v2(path,context->working_directory,context->fs) == 0){
+    path_walk_t walk;
+    if (!walk_existing(context, src_path, FILE_NOT_FOUND, &walk)){
         return -1;
     }
+    inode_t *src = walk.child;
+    if (src->internal.file_type != DATA_FILE){
+        REPORT_RETCODE(INVALID_FILE_TYPE);
+        return -1;
+    }
+    // buffered writes to the source are part of what gets copied
+    flush_inode_writers(fs, src, NULL);
 
-    inode_index_t new_inode_idx;
-
-    fprintf(stderr,"path= %s",path);
-    
-    if (claim_available_inode(context->fs, &new_inode_idx) != SUCCESS) {
-        REPORT_RETCODE(INODE_UNAVAILABLE);
+    if (!walk_new_entry(context, dst_path, DATA_FILE, &walk) || !check_inode_available(fs)){
         return -1;
     }
 
-    /*
-    inode_t* new_inode = &context->fs->inodes[new_inode_idx];
-    inode_t *cur_inode;
+    // the dblocks of the entry and of the data are checked together so a failed copy
+    // leaves the file system as it was
+    size_t offset;
+    size_t dblocks_needed = entry_slot(fs, walk.parent, &offset) + calculate_necessary_dblock_amount(fs, src->internal.file_size);
+    if (!has_available_dblocks(fs, dblocks_needed)){
+        REPORT_RETCODE(INSUFFICIENT_DBLOCKS);
+        return -1;
+    }
 
-    if (count_char_occurrences(path,'/') == 0){
-        cur_inode = context->working_directory;
-    } else {
-        cur_inode = return_inode_v2(path,context->working_directory,context->fs);
+    inode_t *dst = claim_new_inode(fs, DATA_FILE, src->internal.file_perms & (FS_READ | FS_WRITE | FS_EXECUTE), walk.name, walk.len);
+    fs_retcode_t ret = inode_copy_data(fs, dst, src);
+    if (ret != SUCCESS){
+        release_inode(fs, dst);
+        REPORT_RETCODE(ret);
+        return -1;
     }
+    add_entry(fs, walk.parent, offset, dst - fs->inodes, walk.name, walk.len);
+    subtree_link(fs, walk.parent, dst);
+    return 0;
+}
 
-    new_inode->internal.file_type = DATA_FILE;
-    new_inode->internal.file_perms = perms;
+// ----------------------- RENAME ----------------------- //
 
-    char* basename = strrchr(path, '/');
-    
-    if (basename == NULL) {
-        basename = path;
-    } else {
-        basename++;
+// checks that `dir` is not `moved` or inside of it by following `..` up to the root
+static int outside_of(filesystem_t *fs, inode_t *dir, inode_t *moved)
+{
+    for (size_t depth = 0; depth < fs->inode_count && dir != &fs->inodes[0]; ++depth)
+    {
+        if (dir == moved) return 0;
+        dir = parent_of(fs, dir);
+        if (dir == NULL) return 1;
     }
-        */
-    
-   return 0;
+    return dir != moved;
 }
 
-int new_directory(terminal_context_t *context, char *path)
+int fs_rename(terminal_context_t *context, char *old_path, char *new_path)
 {
-    if (context == NULL || path == NULL){
+    if (context == NULL || old_path == NULL || new_path == NULL){
         return 0;
-    } 
+    }
+    filesystem_t *fs = context->fs;
 
-    if (verify_path_v2_1(path,context->working_directory,context->fs) == 0){
+    path_walk_t from;
+    fs_retcode_t ret = walk_path(context, old_path, &from);
+    if (ret == DIR_NOT_FOUND){
+        REPORT_RETCODE(DIR_NOT_FOUND);
         return -1;
     }
+    if (is_dot_name(from.name, from.len)){
+        REPORT_RETCODE(INVALID_FILENAME);
+        return -1;
+    }
+    if (ret == NOT_FOUND || from.len == 0){
+        REPORT_RETCODE(NOT_FOUND);
+        return -1;
+    }
+    inode_t *inode = from.child;
+    file_type_t type = inode->internal.file_type;
 
-    inode_index_t new_inode_idx;
-
-    fprintf(stderr,"path= %s",path);
-    
-    if (claim_available_inode(context->fs, &new_inode_idx) != SUCCESS) {
-        REPORT_RETCODE(INODE_UNAVAILABLE);
+    path_walk_t to;
+    if (!walk_new_entry(context, new_path, type, &to)){
+        return -1;
+    }
+    // a directory cannot be moved into itself
+    if (type == DIRECTORY && !outside_of(fs, to.parent, inode)){
+        REPORT_RETCODE(INVALID_INPUT);
         return -1;
     }
 
-    return -2;
+    inode_index_t index = inode - fs->inodes;
+    if (to.parent == from.parent && !is_sorted(from.parent)){
+        // renaming within a directory rewrites the entry in place
+        add_entry(fs, from.parent, from.offset, index, to.name, to.len);
+    } else {
+        // a sorted directory keeps the new name in its place by name, so it is moved there
+        size_t new_offset;
+        if (!has_available_dblocks(fs, entry_slot(fs, to.parent, &new_offset))){
+            REPORT_RETCODE(INSUFFICIENT_DBLOCKS);
+            return -1;
+        }
+        add_entry(fs, to.parent, new_offset, index, to.name, to.len);
+        delete_entry(fs, &from);
+        if (to.parent != from.parent){
+            subtree_unlink(fs, inode);
+            subtree_link(fs, to.parent, inode);
+        }
+
+        size_t parent_offset;
+        if (type == DIRECTORY && to.parent != from.parent && find_entry(fs, inode, "..", 2, NULL, &parent_offset)){
+            add_entry(fs, inode, parent_offset, to.parent - fs->inodes, "..", 2);
+        }
+    }
+
+    memset(inode->internal.file_name, 0, MAX_FILE_NAME_LEN);
+    memcpy(inode->internal.file_name, to.name, to.len);
+    if (type == DIRECTORY) path_cache_invalidate(fs);
+    return 0;
 }
 
-int remove_file(terminal_context_t *context, char *path)
+// ----------------------- COMPACT ----------------------- //
+
+int fs_compact(terminal_context_t *context, char *path)
 {
     if (context == NULL || path == NULL){
         return 0;
-    } 
+    }
 
-    if (verify_path(path,context->working_directory,context->fs) == 0){
+    path_walk_t walk;
+    if (!walk_existing(context, path, DIR_NOT_FOUND, &walk)){
+        return -1;
+    }
+    if (walk.child->internal.file_type != DIRECTORY){
+        REPORT_RETCODE(DIR_NOT_FOUND);
         return -1;
     }
 
-    return -1;
+    // a sorted directory has no tombstones, compacting it packs its tree again
+    if (is_sorted(walk.child)){
+        fs_retcode_t ret = sort_directory(context->fs, walk.child);
+        if (ret != SUCCESS){
+            REPORT_RETCODE(ret);
+            return -1;
+        }
+        return 0;
+    }
+    compact_directory(context->fs, walk.child);
+    return 0;
 }
 
-// we can only delete a directory if it is empty!!
-int remove_directory(terminal_context_t *context, char *path)
+// ----------------------- SORT ----------------------- //
+
+int fs_sort_directory(terminal_context_t *context, char *path)
 {
     if (context == NULL || path == NULL){
         return 0;
-    } 
+    }
 
-    if (verify_path_v4(path,context->working_directory,context->fs) == 0){
+    path_walk_t walk;
+    if (!walk_existing(context, path, DIR_NOT_FOUND, &walk)){
         return -1;
     }
+    if (walk.child->internal.file_type != DIRECTORY){
+        REPORT_RETCODE(DIR_NOT_FOUND);
+        return -1;
+    }
+    if (!btree_supported(context->fs)){
+        REPORT_RETCODE(NOT_IMPLEMENTED);
+        return -1;
+    }
+    if (is_sorted(walk.child)){
+        return 0;
+    }
 
-    if (return_inode(path,context->working_directory,context->fs) == context->working_directory){
-        REPORT_RETCODE(ATTEMPT_DELETE_CWD);
+    fs_retcode_t ret = sort_directory(context->fs, walk.child);
+    if (ret != SUCCESS){
+        REPORT_RETCODE(ret);
         return -1;
     }
+    return 0;
+}
 
-    //inode_t *cur_inode = context->working_directory;
+// ----------------------- MANIFEST ----------------------- //
 
-    return -1;
+// a directory on the path of the last created path, and the length of the prefix of that
+// path naming it
+typedef struct manifest_dir
+{
+    size_t end;
+    inode_t *dir;
+} manifest_dir_t;
+
+// the directories on the path of the last created path, from the outermost one down
+typedef struct manifest_walk
+{
+    const char *previous;
+    manifest_dir_t *dirs;
+    size_t depth;
+    size_t capacity;
+} manifest_walk_t;
+
+static int compare_paths(const void *a, const void *b)
+{
+    return strcmp(*(const char* const*) a, *(const char* const*) b);
 }
 
-int change_directory(terminal_context_t *context, char *path)
+// creates a path and the directories on its way, starting from the deepest directory it
+// shares with the path created before it. a path ending with `/`, or any path if
+// `directory` is set, names a directory. reports the problem and returns 0 on a failure
+static int create_path(terminal_context_t *context, manifest_walk_t *walk, const char *path, int directory, permission_t perms)
 {
-    if (context == NULL || path == NULL){
+    filesystem_t *fs = context->fs;
+    if (path[strspn(path, "/")] == '\0'){
+        REPORT_RETCODE(EMPTY_FILENAME);
         return 0;
-    } 
-
-    if (verify_path_v4(path,context->working_directory,context->fs) == 0){
-        return -1;
     }
 
-    return -2;
+    // the directories the previous path named with the same components are kept
+    size_t common = 0;
+    while (path[common] != '\0' && path[common] == walk->previous[common]) ++common;
+    while (walk->depth > 0 && (walk->dirs[walk->depth - 1].end > common || path[walk->dirs[walk->depth - 1].end] != '/')) --walk->depth;
+    walk->previous = path;
+
+    inode_t *dir = walk->depth > 0 ? walk->dirs[walk->depth - 1].dir : context->working_directory;
+    const char *component = path + (walk->depth > 0 ? walk->dirs[walk->depth - 1].end : 0);
+    while (*component == '/') ++component;
+
+    while (*component != '\0')
+    {
+        size_t len = strcspn(component, "/");
+        const char *next = component + len;
+        while (*next == '/') ++next;
+        file_type_t type = *next != '\0' || directory || next[-1] == '/' ? DIRECTORY : DATA_FILE;
+        if (len > MAX_FILE_NAME_LEN || (type == DATA_FILE && is_dot_name(component, len))){
+            REPORT_RETCODE(INVALID_FILENAME);
+            return 0;
+        }
+
+        inode_index_t child;
+        inode_t *inode;
+        if (lookup_entry(fs, dir, component, len, &child, NULL)){
+            inode = &fs->inodes[child];
+            if (type == DATA_FILE){
+                REPORT_RETCODE(FILE_EXIST);
+                return 0;
+            }
+            if (inode->internal.file_type != DIRECTORY){
+                REPORT_RETCODE(*next != '\0' ? DIR_NOT_FOUND : DIRECTORY_EXIST);
+                return 0;
+            }
+        } else {
+            inode = create_object(fs, dir, component, len, type, type == DATA_FILE ? perms : 0);
+            if (!inode) return 0;
+        }
+        if (type == DATA_FILE) return 1;
+
+        if (walk->depth == walk->capacity){
+            size_t capacity = walk->capacity ? 2 * walk->capacity : 16;
+            manifest_dir_t *dirs = realloc(walk->dirs, capacity * sizeof(manifest_dir_t));
+            if (!dirs){
+                REPORT_RETCODE(SYSTEM_ERROR);
+                return 0;
+            }
+            walk->dirs = dirs;
+            walk->capacity = capacity;
+        }
+        walk->dirs[walk->depth].end = component + len - path;
+        walk->dirs[walk->depth++].dir = inode;
+        dir = inode;
+        component = next;
+    }
+    return 1;
 }
 
-int list(terminal_context_t *context, char *path)
+int fs_make_directories(terminal_context_t *context, char *path)
 {
     if (context == NULL || path == NULL){
         return 0;
-    } 
-
-    if (verify_path_v3(path,context->working_directory,context->fs) == 0){
-        return -1;
     }
 
-    return -2;
+    manifest_walk_t walk = { "", NULL, 0, 0 };
+    int created = create_path(context, &walk, path, 1, 0);
+    free(walk.dirs);
+    return created ? 0 : -1;
 }
 
-char *get_path_string(terminal_context_t *context)
+int fs_import_manifest(terminal_context_t *context, char **paths, size_t count, permission_t perms)
 {
-    if (context == NULL) {
-        char *empty_str = malloc(1);
-        if (empty_str) {
-            empty_str[0] = '\0';
-        }
-        return empty_str;
+    if (context == NULL || paths == NULL){
+        return 0;
     }
 
-    if (context->working_directory == &context->fs->inodes[0]) {
-        char *root_path = malloc(5);
-        if (root_path) {
-            strcpy(root_path, "root");
-        }
-        return root_path;
+    // sorted, the paths below a directory follow each other
+    char **sorted = malloc((count > 0 ? count : 1) * sizeof(char*));
+    if (!sorted){
+        REPORT_RETCODE(SYSTEM_ERROR);
+        return -1;
     }
+    memcpy(sorted, paths, count * sizeof(char*));
+    qsort(sorted, count, sizeof(char*), compare_paths);
+
+    manifest_walk_t walk = { "", NULL, 0, 0 };
+    int created = 1;
+    for (size_t n = 0; n < count && created; ++n) created = create_path(context, &walk, sorted[n], 0, perms);
+    free(walk.dirs);
+    free(sorted);
+    return created ? 0 : -1;
+}
 
-    typedef struct {
-        inode_index_t inode_idx;
-        char name[14];
-    } dir_entry_t;
+// ----------------------- REMOVE TREE ----------------------- //
 
-    typedef struct name_node {
-        char name[15];
-        size_t name_len;
-        struct name_node *next;
-    } name_node_t;
+// the objects of a subtree, the top one first. the array is also the queue of the walk:
+// the directories are read in the order they were found, so every object comes after the
+// directory holding it
+typedef struct tree_objects
+{
+    inode_index_t *indices;
+    size_t count;
+    size_t capacity;
+    byte *seen; // a bit per inode, so an object named twice is only taken once
+} tree_objects_t;
 
-    name_node_t *stack = NULL;
-    
-    inode_t *cur_dir = context->working_directory;
-    
-    while (cur_dir != &context->fs->inodes[0]) {
-        dir_entry_t parent_entry;
-        size_t bytes_read;
-        
-        if (inode_read_data(context->fs, cur_dir, 16, 
-                          &parent_entry, sizeof(dir_entry_t), &bytes_read) != SUCCESS) {
-            while (stack) {
-                name_node_t *temp = stack;
-                stack = stack->next;
-                free(temp);
-            }
-            char *empty_str = malloc(1);
-            if (empty_str) empty_str[0] = '\0';
-            return empty_str;
-        }
-        
-        inode_t *parent_dir = &context->fs->inodes[parent_entry.inode_idx];
-        
-        dir_entry_t entry;
-        size_t offset = 0;
-        int found = 0;
-        
-        while (offset < parent_dir->internal.file_size) {
-            if (inode_read_data(context->fs, parent_dir, offset, &entry, sizeof(dir_entry_t), &bytes_read) != SUCCESS) break;
-            
-            if (entry.inode_idx == (cur_dir - context->fs->inodes)) {
-                if (!(entry.name[0] == '.' && entry.name[1] == '\0') && 
-                    !(entry.name[0] == '.' && entry.name[1] == '.' && entry.name[2] == '\0')) {
-                    
-                    name_node_t *new_node = malloc(sizeof(name_node_t));
-                    if (!new_node) {
-                        while (stack) {
-                            name_node_t *temp = stack;
-                            stack = stack->next;
-                            free(temp);
-                        }
-                        char *empty_str = malloc(1);
-                        if (empty_str) empty_str[0] = '\0';
-                        return empty_str;
-                    }
-                    
-                    memcpy(new_node->name, entry.name, 14);
-                    
-                    size_t name_len = 14;
-                    for (size_t i = 0; i < 14; i++) {
-                        if (entry.name[i] == '\0') {
-                            name_len = i;
-                            break;
-                        }
-                    }
-                    
-                    new_node->name_len = name_len;
-                    new_node->name[14] = '\0';
-                    
-                    new_node->next = stack;
-                    stack = new_node;
-                    
-                    found = 1;
-                    break;
-                }
-            }
-            
-            offset += sizeof(dir_entry_t);
-        }
-        
-        if (!found) {
-            while (stack) {
-                name_node_t *temp = stack;
-                stack = stack->next;
-                free(temp);
-            }
-            char *empty_str = malloc(1);
-            if (empty_str) empty_str[0] = '\0';
-            return empty_str;
-        }
-        
-        cur_dir = parent_dir;
-    }
-    
-    size_t path_len = 4;
-    name_node_t *node = stack;
-    while (node) {
-        path_len += node->name_len + 1;
-        node = node->next;
+static int tree_objects_add(filesystem_t *fs, tree_objects_t *objects, inode_index_t index)
+{
+    if (objects->seen[index / 8] & (1 << (index % 8))) return 1;
+    if (objects->count == objects->capacity){
+        size_t capacity = 2 * objects->capacity;
+        inode_index_t *indices = realloc(objects->indices, capacity * sizeof(inode_index_t));
+        if (!indices) return 0;
+        objects->indices = indices;
+        objects->capacity = capacity;
     }
-    
-    char *path = malloc(path_len + 1);
-    if (!path) {
-        while (stack) {
-            name_node_t *temp = stack;
-            stack = stack->next;
-            free(temp);
+    objects->seen[index / 8] |= 1 << (index % 8);
+    objects->indices[objects->count++] = index;
+    return 1;
+}
+
+// collects `top` and every object below it. returns SUCCESS, SYSTEM_ERROR, or the error of
+// a directory whose entries could not be read, as its objects would be left behind
+static fs_retcode_t collect_tree(filesystem_t *fs, inode_t *top, tree_objects_t *objects)
+{
+    objects->count = 0;
+    objects->capacity = 64;
+    objects->indices = malloc(objects->capacity * sizeof(inode_index_t));
+    objects->seen = calloc((fs->inode_count + 7) / 8, 1);
+    if (!objects->indices || !objects->seen) return SYSTEM_ERROR;
+    // the root is never in a subtree, so the `..` of the top object is not followed
+    objects->seen[0] |= 1;
+    tree_objects_add(fs, objects, top - fs->inodes);
+
+    for (size_t n = 0; n < objects->count; ++n)
+    {
+        inode_t *dir = &fs->inodes[objects->indices[n]];
+        if (dir->internal.file_type != DIRECTORY) continue;
+
+        entry_cursor_t cursor;
+        entry_cursor_start(fs, dir, 0, &cursor);
+        directory_entry_t entry;
+        while (entry_cursor_next(fs, &cursor, &entry, NULL))
+        {
+            size_t len = entry_name_length(entry.name);
+            if (len == 0 || is_dot_name(entry.name, len) || entry.inode >= fs->inode_count) continue;
+            if (!tree_objects_add(fs, objects, entry.inode)) return SYSTEM_ERROR;
         }
-        char *empty_str = malloc(1);
-        if (empty_str) empty_str[0] = '\0';
-        return empty_str;
+        if (cursor.error != SUCCESS) return cursor.error;
     }
-    
-    strcpy(path, "root");
-    size_t cur_pos = 4;
-    
-    while (stack) {
-        path[cur_pos] = '/';
-        cur_pos++;
-        
-        name_node_t *temp = stack;
-        stack = stack->next;
-        
-        memcpy(path + cur_pos, temp->name, temp->name_len);
-        cur_pos += temp->name_len;
-        
-        free(temp);
+    return SUCCESS;
+}
+
+// gives back the data of an object of a removed subtree and forgets what is kept about it
+static void release_tree_object(filesystem_t *fs, inode_t *inode)
+{
+    if (inode->internal.file_type != DIRECTORY){
+        if (fs->write_buffers) drop_inode_writers(fs, inode);
+        fs_assert_success(inode_release_data(fs, inode));
+        return;
+    }
+    release_directory_data(fs, inode);
+    parent_link_clear(fs, inode);
+    dentry_invalidate(fs, inode);
+    if (fs->dir_indexes){
+        free(fs->dir_indexes[inode - fs->inodes]);
+        fs->dir_indexes[inode - fs->inodes] = NULL;
     }
-    
-    path[cur_pos] = '\0';
-    
-    return path;
 }
 
-int tree(terminal_context_t *context, char *path)
+int remove_tree(terminal_context_t *context, char *path)
 {
     if (context == NULL || path == NULL){
         return 0;
-    } 
+    }
+    filesystem_t *fs = context->fs;
+
+    path_walk_t walk;
+    if (!walk_existing(context, path, NOT_FOUND, &walk)){
+        return -1;
+    }
+    // `.` and `..` are removed with the directory holding them
+    if (walk.len == 0 || is_dot_name(walk.name, walk.len)){
+        REPORT_RETCODE(INVALID_FILENAME);
+        return -1;
+    }
+    if (!outside_of(fs, context->working_directory, walk.child)){
+        REPORT_RETCODE(ATTEMPT_DELETE_CWD);
+        return -1;
+    }
 
-    if (verify_path_v3(path,context->working_directory,context->fs) == 0){
+    // nothing is touched until the whole subtree has been read
+    tree_objects_t objects;
+    fs_retcode_t ret = collect_tree(fs, walk.child, &objects);
+    if (ret != SUCCESS){
+        free(objects.indices);
+        free(objects.seen);
+        REPORT_RETCODE(ret);
         return -1;
     }
 
-    printf("root");
+    // the deepest objects go first, and their inodes are spliced into the free list at once
+    subtree_unlink(fs, walk.child);
+    for (size_t n = objects.count; n-- > 0; ) release_tree_object(fs, &fs->inodes[objects.indices[n]]);
+    fs_assert_success(release_inodes(fs, objects.indices, objects.count));
+    delete_entry(fs, &walk);
+    path_cache_invalidate(fs);
 
-    return -1;
+    free(objects.indices);
+    free(objects.seen);
+    return 0;
 }
 
-//Part 2
-void new_terminal(filesystem_t *fs, terminal_context_t *term)
+// ----------------------- DU AND FIND ----------------------- //
+
+// the totals of one worker, kept on their own cache line
+typedef struct du_slot
 {
-    if (fs==NULL) return;
-    term->fs = fs;
-    term->working_directory = &(fs->inodes[0]);
+    _Alignas(64) du_report_t report;
+} du_slot_t;
+
+typedef struct du_walk
+{
+    filesystem_t *fs;
+    du_slot_t slots[TRAVERSE_MAX_THREADS];
+} du_walk_t;
+
+// dblocks held by an object itself, index dblocks included
+static size_t object_dblocks(filesystem_t *fs, inode_t *inode)
+{
+    if (is_sorted(inode)) return btree_count(fs, inode->internal.direct_data[0], 0);
+    return calculate_necessary_dblock_amount(fs, inode->internal.file_size);
 }
 
-fs_file_t fs_open(terminal_context_t *context, char *path)
+static void du_visit(traverse_worker_t *worker, inode_index_t dir, void *arg)
+{
+    du_walk_t *walk = arg;
+    filesystem_t *fs = walk->fs;
+    du_report_t *report = &walk->slots[traverse_worker_id(worker)].report;
+    inode_t *inode = &fs->inodes[dir];
+    ++report->directories;
+    report->bytes += inode->internal.file_size;
+    report->dblocks += object_dblocks(fs, inode);
+
+    entry_cursor_t cursor;
+    entry_cursor_start_shared(fs, inode, &cursor);
+    directory_entry_t entry;
+    while (entry_cursor_next(fs, &cursor, &entry, NULL))
+    {
+        size_t len = entry_name_length(entry.name);
+        if (len == 0 || is_dot_name(entry.name, len) || entry.inode >= fs->inode_count) continue;
+        inode_t *child = &fs->inodes[entry.inode];
+        if (child->internal.file_type == DIRECTORY){
+            traverse_push(worker, entry.inode);
+            continue;
+        }
+        ++report->files;
+        report->bytes += child->internal.file_size;
+        report->dblocks += object_dblocks(fs, child);
+    }
+}
+
+int fs_du(terminal_context_t *context, char *path, du_report_t *report)
 {
-    char* path_copy = NULL;
-    if (path != NULL) path_copy = strdup(path);
+    if (context == NULL || path == NULL || report == NULL){
+        return 0;
+    }
+    filesystem_t *fs = context->fs;
 
-    if (context==NULL){
-        return NULL;
+    path_walk_t walk;
+    if (!walk_existing(context, path, NOT_FOUND, &walk)){
+        return -1;
     }
-    
-    if (path==NULL){
-        REPORT_RETCODE(DIR_NOT_FOUND);
-        return NULL;
+    memset(report, 0, sizeof(*report));
+    inode_t *object = walk.child;
+    if (object->internal.file_type != DIRECTORY){
+        report->files = 1;
+        report->bytes = object->internal.file_size;
+        report->dblocks = object_dblocks(fs, object);
+        return 0;
+    }
+    if (fs->subtrees){
+        struct subtree *totals = &fs->subtrees[object - fs->inodes];
+        report->files = totals->total_files;
+        report->directories = totals->total_directories;
+        report->bytes = totals->total_bytes;
+        report->dblocks = totals->total_dblocks;
+        return 0;
     }
 
-    if (verify_path(path,context->working_directory,context->fs) == 0){
-        return NULL;
+    du_walk_t *du = calloc(1, sizeof(du_walk_t));
+    if (du == NULL){
+        REPORT_RETCODE(SYSTEM_ERROR);
+        return -1;
+    }
+    du->fs = fs;
+    fs_retcode_t ret = fs_traverse(fs, object - fs->inodes, fs->traverse_threads, du_visit, du);
+    for (size_t t = 0; t < TRAVERSE_MAX_THREADS; ++t)
+    {
+        report->files += du->slots[t].report.files;
+        report->directories += du->slots[t].report.directories;
+        report->bytes += du->slots[t].report.bytes;
+        report->dblocks += du->slots[t].report.dblocks;
+    }
+    free(du);
+    if (ret != SUCCESS){
+        REPORT_RETCODE(ret);
+        return -1;
     }
+    return 0;
+}
 
-    fs_file_t file = (struct fs_file*)malloc(sizeof(struct fs_file));
+fs_retcode_t fs_enable_subtree_totals(filesystem_t *fs)
+{
+    if (!fs) return INVALID_INPUT;
+    if (fs->subtrees) return SUCCESS;
+
+    struct subtree *table = calloc(fs->inode_count, sizeof(struct subtree));
+    inode_index_t *order = malloc(fs->inode_count * sizeof(inode_index_t));
+    if (!table || !order){
+        free(table);
+        free(order);
+        return SYSTEM_ERROR;
+    }
 
-    file->offset = 0;
-    file->inode = return_inode(path_copy, context->working_directory, context->fs);
-    file->fs = context->fs;
+    // the objects are found breadth first, so every directory comes before what it holds.
+    // an object is counted when it is found, which also marks it as seen
+    size_t count = 0;
+    order[count++] = 0;
+    table[0].total_directories = 1;
+    for (size_t n = 0; n < count; ++n)
+    {
+        inode_t *inode = &fs->inodes[order[n]];
+        struct subtree *entry = &table[order[n]];
+        entry->bytes = entry->total_bytes = inode->internal.file_size;
+        entry->dblocks = entry->total_dblocks = object_dblocks(fs, inode);
+        if (inode->internal.file_type != DIRECTORY) continue;
+
+        entry_cursor_t cursor;
+        entry_cursor_start(fs, inode, 0, &cursor);
+        directory_entry_t found;
+        while (entry_cursor_next(fs, &cursor, &found, NULL))
+        {
+            size_t len = entry_name_length(found.name);
+            if (len == 0 || is_dot_name(found.name, len) || found.inode >= fs->inode_count) continue;
+            struct subtree *child = &table[found.inode];
+            if (found.inode == 0 || child->total_files + child->total_directories != 0) continue;
+            child->parent = (uint64_t) order[n] + 1;
+            if (fs->inodes[found.inode].internal.file_type == DIRECTORY) child->total_directories = 1;
+            else child->total_files = 1;
+            order[count++] = found.inode;
+        }
+    }
 
-    return file;
+    // the totals are summed from the deepest objects up
+    for (size_t n = count; n-- > 1; )
+    {
+        struct subtree *entry = &table[order[n]];
+        struct subtree *parent = &table[entry->parent - 1];
+        parent->total_files += entry->total_files;
+        parent->total_directories += entry->total_directories;
+        parent->total_bytes += entry->total_bytes;
+        parent->total_dblocks += entry->total_dblocks;
+    }
+
+    free(order);
+    fs->subtrees = table;
+    return SUCCESS;
 }
 
-void fs_close(fs_file_t file)
+void fs_disable_subtree_totals(filesystem_t *fs)
 {
-    if (file == NULL) return;
-    free(file);
+    if (!fs) return;
+    free(fs->subtrees);
+    fs->subtrees = NULL;
 }
 
-size_t fs_read(fs_file_t file, void *buffer, size_t n)
+typedef struct find_walk
 {
-    if (file == NULL) return 0;
-    (void)file;
-    (void)buffer;
-    (void)n;
-
-    size_t offset = file->offset;
-    size_t file_size = file->inode->internal.file_size;
-    size_t bytes_read = 0;
-    inode_read_data(file->fs, file->inode, file->offset, buffer, n, &bytes_read);
-
-    if ((offset+n) > file_size){
-        bytes_read = file_size-offset;
+    listing_t **listings;
+    const char *pattern; // null matches every name
+    size_t pattern_len;
+    char *path;          // of the object being looked at
+    size_t length;
+    size_t capacity;
+    size_t matches;
+} find_walk_t;
+
+// appends `/name` to the path of a find walk. returns 0 if memory ran out
+static int find_path_append(find_walk_t *walk, const char *name, size_t len)
+{
+    if (walk->length + len + 2 > walk->capacity){
+        size_t capacity = 2 * (walk->length + len + 2);
+        char *path = realloc(walk->path, capacity);
+        if (!path) return 0;
+        walk->path = path;
+        walk->capacity = capacity;
     }
-
-    file->offset += bytes_read;
-    
-    return bytes_read;
+    walk->path[walk->length++] = '/';
+    memcpy(walk->path + walk->length, name, len);
+    walk->length += len;
+    return 1;
 }
 
-size_t fs_write(fs_file_t file, void *buffer, size_t n)
+// prints the matches below a directory in the order of `tree`. returns 0 if memory ran out
+static int find_below(find_walk_t *walk, inode_index_t dir)
 {
-    if (file == NULL) return 0;
-
-    fs_retcode_t ret = inode_modify_data(file->fs, file->inode, file->offset, buffer, n);
-    
-    if (ret != SUCCESS) {
-        return 0;  // Return 0 bytes written
+    listing_t *listing = walk->listings[dir];
+    if (listing == NULL) return 1;
+
+    size_t length = walk->length;
+    for (size_t n = 0; n < listing->count; ++n)
+    {
+        const directory_entry_t *entry = &listing->entries[n];
+        size_t len = entry_name_length(entry->name);
+        if (!find_path_append(walk, entry->name, len)) return 0;
+        if (walk->pattern == NULL || pattern_match(walk->pattern, walk->pattern_len, entry->name, len)){
+            printf("%.*s\n", (int) walk->length, walk->path);
+            ++walk->matches;
+        }
+        if (!find_below(walk, entry->inode)) return 0;
+        walk->length = length;
     }
-    
-    file->offset += n;
-    
-    return n;  // Return the number of bytes written
+    return 1;
 }
 
-int fs_seek(fs_file_t file, seek_mode_t seek_mode, int offset)
+int fs_find(terminal_context_t *context, char *path, char *pattern)
 {
-    if (file == NULL) return -1;
-    if (seek_mode>4) return -1;
-
-    long new_offset = 0; 
-    size_t file_size = file->inode->internal.file_size;
+    if (context == NULL || path == NULL){
+        return 0;
+    }
+    filesystem_t *fs = context->fs;
 
-    // Calculate new position based on seek mode
-    if (seek_mode == FS_SEEK_START) {
-        new_offset = offset;
-    } else if (seek_mode == FS_SEEK_CURRENT) {
-        new_offset = (long)file->offset + offset;
-    } else if (seek_mode == FS_SEEK_END) {
-        if (offset<=0){
-            offset = offset*-1;
-            new_offset = (long)file_size - offset;
-        } else {
-            new_offset = file_size;
-        }
-    } else {
+    path_walk_t walk;
+    if (!walk_existing(context, path, DIR_NOT_FOUND, &walk)){
         return -1;
     }
-
-    if (new_offset < 0) {
+    if (walk.child->internal.file_type != DIRECTORY){
+        REPORT_RETCODE(DIR_NOT_FOUND);
         return -1;
     }
 
-    if ((size_t)new_offset > file_size) {
-        file->offset = file_size;
-    } else {
-        file->offset = (size_t)new_offset;
+    // the paths start with `path` as it was given, without the slashes it ends with
+    find_walk_t find = { 0 };
+    find.pattern = pattern;
+    find.pattern_len = pattern ? strlen(pattern) : 0;
+    find.length = strlen(path);
+    while (find.length > 0 && path[find.length - 1] == '/') --find.length;
+    find.capacity = find.length + MAX_FILE_NAME_LEN + 2;
+    find.path = malloc(find.capacity);
+    find.listings = find.path ? collect_listings(fs, walk.child) : NULL;
+    if (find.listings == NULL){
+        free(find.path);
+        REPORT_RETCODE(SYSTEM_ERROR);
+        return -1;
     }
+    memcpy(find.path, path, find.length);
 
-    return 0; // Success
+    int done = find_below(&find, walk.child - fs->inodes);
+    free_listings(fs, find.listings);
+    free(find.path);
+    if (!done){
+        REPORT_RETCODE(SYSTEM_ERROR);
+        return -1;
+    }
+    if (find.matches == 0){
+        REPORT_RETCODE(NOT_FOUND);
+        return -1;
+    }
+    return 0;
 }
-
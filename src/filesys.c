@@ -8,12 +8,6 @@
 
 #define DBLOCK_MASK_SIZE(blk_count) (((blk_count) + 7) / (sizeof(byte) * 8))
 
-#define INDIRECT_DBLOCK_INDEX_COUNT (DATA_BLOCK_SIZE / sizeof(dblock_index_t) - 1)
-#define INDIRECT_DBLOCK_MAX_DATA_SIZE ( DATA_BLOCK_SIZE * INDIRECT_DBLOCK_INDEX_COUNT )
-
-#define DIRECTORY_ENTRY_SIZE (sizeof(inode_index_t) + MAX_FILE_NAME_LEN)
-#define DIRECTORY_ENTRIES_PER_DATABLOCK (DATA_BLOCK_SIZE / DIRECTORY_ENTRY_SIZE)
-
 // ----------------------- UTILITY FUNCTION ----------------------- //
 
 // marks the nth dblock as being used 
@@ -30,9 +24,18 @@ static void mark_dblock_as_unused(byte *dblock_bitmask, size_t n)
 // ----------------------- CORE FUNCTION ----------------------- //
 
 fs_retcode_t new_filesystem(filesystem_t *fs, size_t inode_total, size_t dblock_total)
+{
+    return new_filesystem_geometry(fs, inode_total, dblock_total, DEFAULT_DATA_BLOCK_SIZE);
+}
+
+fs_retcode_t new_filesystem_geometry(filesystem_t *fs, size_t inode_total, size_t dblock_total, size_t block_size)
 {
     if (!fs) return INVALID_INPUT;
     if (inode_total == 0 || dblock_total == 0) return INVALID_INPUT;
+    if (block_size < MIN_DATA_BLOCK_SIZE || block_size > MAX_DATA_BLOCK_SIZE || (block_size & (block_size - 1)) != 0) return INVALID_INPUT;
+    if (inode_total - 1 > INODE_INDEX_MAX) return INVALID_INPUT;
+    // the narrow format is kept for every file system it can hold
+    size_t index_width = inode_total - 1 > NARROW_INODE_INDEX_MAX ? WIDE_INODE_INDEX_WIDTH : NARROW_INODE_INDEX_WIDTH;
 
     // allocate the inodes
     inode_t *inodes = calloc(inode_total, sizeof(inode_t));
@@ -42,7 +45,7 @@ fs_retcode_t new_filesystem(filesystem_t *fs, size_t inode_total, size_t dblock_
     inodes[inode_total - 1].next_free_inode = 0;
 
     // allocate the dblocks
-    byte *dblocks = calloc(dblock_total, DATA_BLOCK_SIZE);
+    byte *dblocks = calloc(dblock_total, block_size);
     if (!dblocks) return SYSTEM_ERROR;
 
     // allocate the bitmask for the dblock availability
@@ -55,7 +58,7 @@ fs_retcode_t new_filesystem(filesystem_t *fs, size_t inode_total, size_t dblock_
     inodes[0].internal.file_type = DIRECTORY;
     inodes[0].internal.file_perms = FS_READ | FS_WRITE | FS_EXECUTE;
     // we will set this the size of one directory entry
-    inodes[0].internal.file_size = DIRECTORY_ENTRY_SIZE;
+    inodes[0].internal.file_size = index_width + MAX_FILE_NAME_LEN;
     inodes[0].internal.direct_data[0] = 0; // point to the first data block
     strcpy(inodes[0].internal.file_name, "root");
     size_t available_inode = 1; // next available inode is index 1
@@ -67,15 +70,32 @@ fs_retcode_t new_filesystem(filesystem_t *fs, size_t inode_total, size_t dblock_
     // first copy the inode index
     // however we exploit how we calloced the memory so it is already set to 0
     // now we set the '.' directory
-    dblocks[sizeof(inode_index_t)] = '.'; 
+    dblocks[index_width] = '.'; 
 
     // finally write the data when there is no errors
     fs->available_inode = inode_total > 1 ? available_inode : 0;
     fs->inodes = inodes;
     fs->inode_count = inode_total;
+    fs->index_width = index_width;
+    fs->entry_size = index_width + MAX_FILE_NAME_LEN;
+    fs->block_shift = __builtin_ctzll(block_size);
     fs->dblock_bitmask = dblock_bitmask;
     fs->dblocks = dblocks;
     fs->dblock_count = dblock_total;
+    fs->chunk_cache = NULL;
+    fs->dblock_checksums = NULL;
+    fs->append_tails = NULL;
+    fs->dblock_search_start = 0;
+    fs->write_buffers = NULL;
+    fs->read_aheads = NULL;
+    fs->read_resumes = NULL;
+    fs->dir_indexes = NULL;
+    fs->dentry_cache = NULL;
+    fs->dir_parents = NULL;
+    fs->path_cache = NULL;
+    fs->read_ahead_blocks = 0;
+    fs->traverse_threads = 0;
+    fs->subtrees = NULL;
 
     return SUCCESS;
 }
@@ -86,6 +106,30 @@ void free_filesystem(filesystem_t *fs)
     free(fs->inodes);
     free(fs->dblock_bitmask);
     free(fs->dblocks);
+    free(fs->chunk_cache);
+    fs->chunk_cache = NULL;
+    free(fs->dblock_checksums);
+    fs->dblock_checksums = NULL;
+    free(fs->subtrees);
+    fs->subtrees = NULL;
+    free(fs->append_tails);
+    fs->append_tails = NULL;
+    free(fs->read_aheads);
+    fs->read_aheads = NULL;
+    free(fs->read_resumes);
+    fs->read_resumes = NULL;
+    if (fs->dir_indexes)
+    {
+        for (size_t i = 0; i < fs->inode_count; ++i) free(fs->dir_indexes[i]);
+        free(fs->dir_indexes);
+        fs->dir_indexes = NULL;
+    }
+    free(fs->dentry_cache);
+    fs->dentry_cache = NULL;
+    free(fs->dir_parents);
+    fs->dir_parents = NULL;
+    free(fs->path_cache);
+    fs->path_cache = NULL;
 }
 
 size_t available_inodes(filesystem_t *fs)
@@ -125,26 +169,84 @@ fs_retcode_t claim_available_inode(filesystem_t *fs, inode_index_t *index)
     return SUCCESS;
 }
 
+int has_available_dblocks(filesystem_t *fs, size_t count)
+{
+    if (!fs) return 0;
+    size_t found = 0;
+    size_t i = fs->dblock_search_start;
+    while (found < count && i < fs->dblock_count)
+    {
+        // whole bytes of the mask are counted at once
+        if (i % 8 == 0 && i + 8 <= fs->dblock_count)
+        {
+            found += __builtin_popcount(fs->dblock_bitmask[i / 8]);
+            i += 8;
+            continue;
+        }
+        if (fs->dblock_bitmask[i / 8] & (1 << (7 - i % 8))) ++found;
+        ++i;
+    }
+    return found >= count;
+}
+
 fs_retcode_t claim_available_dblock(filesystem_t *fs, dblock_index_t *index)
 {
     if (!fs || !index) return INVALID_INPUT;
 
-    for (size_t i = 0; i < fs->dblock_count; ++i)
+    // the search resumes after the last claimed dblock instead of rescanning the claimed prefix
+    size_t i = fs->dblock_search_start;
+    while (i < fs->dblock_count)
     {
         size_t block_idx = i / 8;
         size_t bit_idx = i % 8;
+        if (bit_idx == 0 && fs->dblock_bitmask[block_idx] == 0x00)
+        {
+            i += 8;
+            continue;
+        }
         // check if dblock is available via the mask
         if (fs->dblock_bitmask[block_idx] & (1 << (7 - bit_idx)))
         {
             // claim the data block
             *index = i;
             mark_dblock_as_used(fs->dblock_bitmask, i);
+            fs->dblock_search_start = i + 1;
             return SUCCESS;
         }
+        ++i;
     }
+    fs->dblock_search_start = fs->dblock_count;
     return DBLOCK_UNAVAILABLE;
 }
 
+fs_retcode_t claim_available_dblocks(filesystem_t *fs, dblock_index_t *indices, size_t count)
+{
+    if (!fs || (!indices && count)) return INVALID_INPUT;
+    if (!has_available_dblocks(fs, count)) return DBLOCK_UNAVAILABLE;
+
+    // one pass over the bitmask from where the last claim stopped
+    size_t found = 0;
+    size_t i = fs->dblock_search_start;
+    while (found < count)
+    {
+        size_t block_idx = i / 8;
+        size_t bit_idx = i % 8;
+        if (bit_idx == 0 && fs->dblock_bitmask[block_idx] == 0x00)
+        {
+            i += 8;
+            continue;
+        }
+        if (fs->dblock_bitmask[block_idx] & (1 << (7 - bit_idx)))
+        {
+            indices[found++] = i;
+            mark_dblock_as_used(fs->dblock_bitmask, i);
+        }
+        ++i;
+    }
+    fs->dblock_search_start = i;
+    return SUCCESS;
+}
+
 fs_retcode_t release_inode(filesystem_t *fs, inode_t *inode)
 {
     if (!fs || !inode) return INVALID_INPUT;
@@ -161,18 +263,54 @@ fs_retcode_t release_inode(filesystem_t *fs, inode_t *inode)
     return SUCCESS;
 }
 
+fs_retcode_t release_inodes(filesystem_t *fs, const inode_index_t *indices, size_t count)
+{
+    if (!fs || (!indices && count)) return INVALID_INPUT;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (indices[i] == 0 || indices[i] >= fs->inode_count) return INVALID_INPUT;
+    }
+    if (count == 0) return SUCCESS;
+
+    // the last index released ends up at the front of the free list
+    fs->inodes[indices[0]].next_free_inode = fs->available_inode;
+    for (size_t i = 1; i < count; ++i) fs->inodes[indices[i]].next_free_inode = indices[i - 1];
+    fs->available_inode = indices[count - 1];
+
+    return SUCCESS;
+}
+
 fs_retcode_t release_dblock(filesystem_t *fs, byte *dblock)
 {
     if (!fs || !dblock) return INVALID_INPUT;
 
     // determine the index of dblock in fs. then check if valid
     ptrdiff_t dblock_diff = dblock - fs->dblocks;
-    if (dblock_diff % DATA_BLOCK_SIZE != 0) return INVALID_INPUT;
-    ptrdiff_t dblock_idx = dblock_diff / DATA_BLOCK_SIZE;
+    if (dblock_diff % (ptrdiff_t) DATA_BLOCK_SIZE(fs) != 0) return INVALID_INPUT;
+    ptrdiff_t dblock_idx = dblock_diff / (ptrdiff_t) DATA_BLOCK_SIZE(fs);
     // if (dblock_idx < 0 || dblock_idx >= (long) fs->dblock_count) return INVALID_INPUT;
 
     // enable bit in the bitmask marking availablity
     mark_dblock_as_unused(fs->dblock_bitmask, dblock_idx);
+    if ((size_t) dblock_idx < fs->dblock_search_start) fs->dblock_search_start = dblock_idx;
+
+    return SUCCESS;
+}
+
+fs_retcode_t release_dblocks(filesystem_t *fs, const dblock_index_t *indices, size_t count)
+{
+    if (!fs || (!indices && count)) return INVALID_INPUT;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (indices[i] >= fs->dblock_count) return INVALID_INPUT;
+    }
+    for (size_t i = 0; i < count; ++i)
+    {
+        mark_dblock_as_unused(fs->dblock_bitmask, indices[i]);
+        if (indices[i] < fs->dblock_search_start) fs->dblock_search_start = indices[i];
+    }
 
     return SUCCESS;
 }
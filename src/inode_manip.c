@@ -1,636 +1,662 @@
 #include "filesys.h"
 
 #include <string.h>
+#include <stdlib.h>
 #include <assert.h>
 
 #include "utility.h"
 #include "debug.h"
+#include "block_map.h"
+#include "compress.h"
+#include "checksum.h"
+#include "subtree.h"
 
-#define INDIRECT_DBLOCK_INDEX_COUNT (DATA_BLOCK_SIZE / sizeof(dblock_index_t) - 1)
-#define INDIRECT_DBLOCK_MAX_DATA_SIZE ( DATA_BLOCK_SIZE * INDIRECT_DBLOCK_INDEX_COUNT )
-
-#define NEXT_INDIRECT_INDEX_OFFSET (DATA_BLOCK_SIZE - sizeof(dblock_index_t))
+#define DBLOCK_ADDR(fs, idx) (&(fs)->dblocks[(size_t)(idx) * DATA_BLOCK_SIZE(fs)])
+#define BLOCKS_FOR_SIZE(fs, size) (((size) + DATA_BLOCK_SIZE(fs) - 1) / DATA_BLOCK_SIZE(fs))
+#define RELEASE_BATCH_SIZE 64
+#define CLAIM_BATCH_SIZE 64
+#define READ_AHEAD_MIN_BLOCKS 4
 
 // ----------------------- UTILITY FUNCTION ----------------------- //
-// Debug Functions
-void free_indirect(filesystem_t *fs, inode_t *inode, size_t offset){
-    size_t size_of_indirect = inode->internal.file_size-256;
-    size_t data_dblocks_of_indirect = (size_of_indirect)/64;
 
-    size_t offset_dblocks = ((offset+63)/64);
+static dblock_index_t read_index_entry(filesystem_t *fs, dblock_index_t index_dblock, size_t slot)
+{
+    dblock_index_t value;
+    memcpy(&value, DBLOCK_ADDR(fs, index_dblock) + slot * sizeof(dblock_index_t), sizeof(dblock_index_t));
+    return value;
+}
+
+static void write_index_entry(filesystem_t *fs, dblock_index_t index_dblock, size_t slot, dblock_index_t value)
+{
+    memcpy(DBLOCK_ADDR(fs, index_dblock) + slot * sizeof(dblock_index_t), &value, sizeof(dblock_index_t));
+}
+
+static dblock_index_t next_index_dblock(filesystem_t *fs, dblock_index_t index_dblock)
+{
+    dblock_index_t next;
+    memcpy(&next, DBLOCK_ADDR(fs, index_dblock) + NEXT_INDIRECT_INDEX_OFFSET(fs), sizeof(dblock_index_t));
+    return next;
+}
 
-    size_t consider_offset = 0;
+// the last index dblock of an inode, remembered so appends do not walk the chain.
+// an entry only counts while `file_size` matches the inode, and files whose blocks are all
+// direct are never cached, so a zeroed entry is invalid.
+struct append_tail
+{
+    size_t file_size;
+    dblock_index_t index_dblock;
+};
 
-    if (offset>0){
-        consider_offset = 1;
+static struct append_tail *append_tail_entry(filesystem_t *fs, inode_t *inode, int allocate)
+{
+    if (inode < fs->inodes || inode >= fs->inodes + fs->inode_count) return NULL;
+    if (!fs->append_tails)
+    {
+        if (!allocate) return NULL;
+        fs->append_tails = calloc(fs->inode_count, sizeof(struct append_tail));
+        if (!fs->append_tails) return NULL;
     }
-    
+    return &fs->append_tails[inode - fs->inodes];
+}
 
-    dblock_index_t cur_index = inode->internal.indirect_dblock;
+static void append_tail_store(filesystem_t *fs, inode_t *inode, dblock_index_t index_dblock)
+{
+    if (BLOCKS_FOR_SIZE(fs, inode->internal.file_size) <= INODE_DIRECT_BLOCK_COUNT) return;
+    struct append_tail *tail = append_tail_entry(fs, inode, 1);
+    if (!tail) return;
+    tail->file_size = inode->internal.file_size;
+    tail->index_dblock = index_dblock;
+}
 
-    size_t data_dblocks_read = 0;
+static void append_tail_invalidate(filesystem_t *fs, inode_t *inode)
+{
+    struct append_tail *tail = append_tail_entry(fs, inode, 0);
+    if (tail) tail->file_size = 0;
+}
 
-    size_t is_first = 0;
+// sequential read state of an inode, kept by `inode_read_ahead`. the prefetch cursor only
+// counts while `file_size` matches the inode, so a zeroed entry is invalid.
+struct read_ahead
+{
+    size_t file_size;
+    size_t next_offset;    // where the reader continues if it reads sequentially
+    size_t window;         // blocks kept prefetched in front of the reader
+    int positioned;        // whether `cursor` is valid
+    block_cursor_t cursor; // first block not prefetched yet
+};
+
+// last block of the previous read of an inode, kept by `inode_read_raw_data` so the next
+// read does not walk the chain from the start. it counts until the file shrinks, so a
+// zeroed entry is invalid. the table is only allocated once read-ahead is enabled
+struct read_resume
+{
+    int resumable;         // whether `cursor` is valid
+    block_cursor_t cursor;
+};
 
-    // free all indirect index dblock first
-    for (size_t i = 0; i < calculate_index_dblock_amount(size_of_indirect); i++){
-        for (size_t i = 0; i<15 && data_dblocks_read<data_dblocks_of_indirect; i++){
-            if (data_dblocks_read < offset_dblocks) {
-                data_dblocks_read++;
-                continue;
-            }
-            dblock_index_t cur_dblock_idx;
-            memcpy(&cur_dblock_idx,&fs->dblocks[cur_index*64]+i*4,4);
-            release_dblock(fs,&fs->dblocks[cur_dblock_idx*64]);
-            data_dblocks_read++;
-        }
+static struct read_ahead *read_ahead_entry(filesystem_t *fs, inode_t *inode, int allocate)
+{
+    if (inode < fs->inodes || inode >= fs->inodes + fs->inode_count) return NULL;
+    if (!fs->read_aheads)
+    {
+        if (!allocate) return NULL;
+        fs->read_aheads = calloc(fs->inode_count, sizeof(struct read_ahead));
+        if (!fs->read_aheads) return NULL;
+    }
+    return &fs->read_aheads[inode - fs->inodes];
+}
 
-        if (consider_offset == 0){
-            release_dblock(fs,&fs->dblocks[cur_index*64]);       
-        } else {
-            if (is_first == 0){
-                is_first = 1;
-            } else {
-                release_dblock(fs,&fs->dblocks[cur_index*64]);  
-            }
-        }
-        memcpy(&cur_index,&fs->dblocks[cur_index*64]+60,4);
+static struct read_resume *read_resume_entry(filesystem_t *fs, inode_t *inode, int allocate)
+{
+    if (inode < fs->inodes || inode >= fs->inodes + fs->inode_count) return NULL;
+    if (!fs->read_resumes)
+    {
+        if (!allocate) return NULL;
+        fs->read_resumes = calloc(fs->inode_count, sizeof(struct read_resume));
+        if (!fs->read_resumes) return NULL;
     }
+    return &fs->read_resumes[inode - fs->inodes];
 }
 
-// ----------------------- CORE FUNCTION ----------------------- //
+static void read_ahead_invalidate(filesystem_t *fs, inode_t *inode)
+{
+    struct read_ahead *ra = read_ahead_entry(fs, inode, 0);
+    if (ra)
+    {
+        ra->file_size = 0;
+        ra->positioned = 0;
+    }
+    struct read_resume *resume = read_resume_entry(fs, inode, 0);
+    if (resume) resume->resumable = 0;
+}
 
-void write_to_dblock(filesystem_t *fs, dblock_index_t dblock_idx, size_t offset_val, void *data, size_t n){
-    memcpy(&fs->dblocks[(dblock_idx*64)+offset_val],data,n);
+// number of the index dblock in the chain holding the entry of an indirect block
+static size_t index_dblock_number(const filesystem_t *fs, size_t block)
+{
+    return (block - INODE_DIRECT_BLOCK_COUNT) / INDIRECT_DBLOCK_INDEX_COUNT(fs);
 }
 
-fs_retcode_t inode_write_data(filesystem_t *fs, inode_t *inode, void *data, size_t n)
+void block_cursor_seek(filesystem_t *fs, inode_t *inode, block_cursor_t *cursor, size_t block)
 {
-    //Check for valid input
-    if (fs == NULL || inode == NULL){return INVALID_INPUT;}
-    if (n == 0){return SUCCESS;} 
-    if (available_dblocks(fs) < calculate_necessary_dblock_amount(n)) {
-        return INSUFFICIENT_DBLOCKS;
-    }
+    cursor->block = block;
+    cursor->index_dblock = inode->internal.indirect_dblock;
+    if (block < INODE_DIRECT_BLOCK_COUNT) return;
 
-    // If inode is empty
-    if (inode->internal.file_size == 0){
-        size_t blocks_needed = calculate_necessary_dblock_amount(n);
-        if (available_dblocks(fs) < blocks_needed) {
-            return INSUFFICIENT_DBLOCKS;
-        }
-        
-        // Write data to the direct dblocks
-        for (int i = 0; i < 4 && n > 0; i++){
-            dblock_index_t temp_dblock;
-            if (claim_available_dblock(fs, &temp_dblock) != SUCCESS) return INSUFFICIENT_DBLOCKS;
-            if (n>=64){
-                write_to_dblock(fs,temp_dblock,0,data,64);
-                inode->internal.file_size += 64;
-                data = (void *)((byte *)data + 64);
-                n = (n - 64);
-            } else {
-                write_to_dblock(fs,temp_dblock,0,data,n);
-                inode->internal.file_size += n;
-                data = (void *)((byte *)data + n);
-                n = 0;
-            }
-            inode->internal.direct_data[i] = temp_dblock; // Add dblock index value
-        }
+    // blocks in the last index dblock come straight from the append tail
+    size_t hops = index_dblock_number(fs, block);
+    struct append_tail *tail = append_tail_entry(fs, inode, 0);
+    size_t file_size = inode->internal.file_size;
+    if (tail && tail->file_size != 0 && tail->file_size == file_size && hops == index_dblock_number(fs, BLOCKS_FOR_SIZE(fs, file_size) - 1))
+    {
+        cursor->index_dblock = tail->index_dblock;
+        return;
+    }
 
-        // Check to see if data left
-        if (n==0) {return SUCCESS;}
-
-        // Write Remaining Data to Indirect Dblock
-        size_t dblocks_needed = calculate_necessary_dblock_amount(n); // (idx dblock + data dblock)
-        size_t idx_dblocks_needed = calculate_index_dblock_amount(n); // (idx dblock)
-        size_t data_dblocks_needed = (dblocks_needed-idx_dblocks_needed);
-
-        dblock_index_t temp_previous_idx_dblock;
-
-        for (size_t i = 0; i < idx_dblocks_needed && n > 0; i++){
-            dblock_index_t temp_idx_dblock;
-            if (claim_available_dblock(fs, &temp_idx_dblock) != SUCCESS) return INSUFFICIENT_DBLOCKS;
-
-            if (i==0) inode->internal.indirect_dblock = temp_idx_dblock;
-            else write_to_dblock(fs, temp_previous_idx_dblock, 60, &temp_idx_dblock, 4);
-
-            for (int j = 0; n > 0 && j < 15; j++){
-                dblock_index_t temp_dblock;
-                if (claim_available_dblock(fs, &temp_dblock) != SUCCESS) return INSUFFICIENT_DBLOCKS;
-                if (n>=64){
-                    write_to_dblock(fs,temp_dblock,0,data,64);
-                    inode->internal.file_size += 64;
-                    data = (void *)((byte *)data + 64);
-                    n = (n - 64);
-                } else {
-                    write_to_dblock(fs,temp_dblock,0,data,n);
-                    inode->internal.file_size += n;
-                    data = (void *)((byte *)data + n);
-                    n = 0;
-                }
-
-                // Storing the index value of data dblock inside index dblock
-                write_to_dblock(fs, temp_idx_dblock, j*4, &temp_dblock, 4);
-                data_dblocks_needed--;
-            }
+    // a read continuing after the previous one starts from the index dblock where that ended
+    struct read_resume *resume = read_resume_entry(fs, inode, 0);
+    if (resume && resume->resumable && resume->cursor.block >= INODE_DIRECT_BLOCK_COUNT && resume->cursor.block <= block)
+    {
+        cursor->index_dblock = resume->cursor.index_dblock;
+        hops -= index_dblock_number(fs, resume->cursor.block);
+    }
 
-            temp_previous_idx_dblock = temp_idx_dblock;
-        }
-    } else {
-        size_t byte_in_last_data_dblock = (inode->internal.file_size%64);
-        if (byte_in_last_data_dblock == 0) byte_in_last_data_dblock = 64;
-        size_t data_dblocks_in_inode = ((inode->internal.file_size+63)/64);
-
-        // Is direct dblock being used
-        if (data_dblocks_in_inode<=4){
-            size_t space_left_last_data_dblock = 64-byte_in_last_data_dblock;
-            dblock_index_t last_data_dblock = inode->internal.direct_data[data_dblocks_in_inode-1];
-            
-            write_to_dblock(fs,last_data_dblock,byte_in_last_data_dblock,data,space_left_last_data_dblock);
-
-            inode->internal.file_size += space_left_last_data_dblock;
-            data = (void *)((byte *)data + space_left_last_data_dblock);
-            n = (n - space_left_last_data_dblock);
-
-            // BEGINNING OF THE COPY PASTE (im so sorry)
-            size_t blocks_needed = calculate_necessary_dblock_amount(n);
-            if (available_dblocks(fs) < blocks_needed) {
-                return INSUFFICIENT_DBLOCKS;
-            }
-            
-            // Check to see if data left
-            if (n==0) {return SUCCESS;}
-            
-            // Write data to the direct dblocks
-            for (int i = data_dblocks_in_inode; i < 4 && n > 0; i++){
-                dblock_index_t temp_dblock;
-                if (claim_available_dblock(fs, &temp_dblock) != SUCCESS) return INSUFFICIENT_DBLOCKS;
-                if (n>=64){
-                    write_to_dblock(fs,temp_dblock,0,data,64);
-                    inode->internal.file_size += 64;
-                    data = (void *)((byte *)data + 64);
-                    n = (n - 64);
-                } else {
-                    write_to_dblock(fs,temp_dblock,0,data,n);
-                    inode->internal.file_size += n;
-                    data = (void *)((byte *)data + n);
-                    n = 0;
-                }
-                inode->internal.direct_data[i] = temp_dblock; // Add dblock index value
-            }
+    // follow the chain up to the index dblock that holds the entry of `block`
+    for (size_t i = 0; i < hops; ++i) cursor->index_dblock = next_index_dblock(fs, cursor->index_dblock);
+}
 
-            // Check to see if data left
-            if (n==0) {return SUCCESS;}
-
-            dblock_index_t temp_previous_idx_dblock;
-
-            for (size_t i = 0; n > 0; i++){
-                dblock_index_t temp_idx_dblock;
-                if (claim_available_dblock(fs, &temp_idx_dblock) != SUCCESS) return INSUFFICIENT_DBLOCKS;
-
-                if (i==0) inode->internal.indirect_dblock = temp_idx_dblock;
-                else write_to_dblock(fs, temp_previous_idx_dblock, 60, &temp_idx_dblock, 4);
-
-                for (int j = 0; n > 0 && j < 15; j++){
-                    dblock_index_t temp_dblock;
-                    if (claim_available_dblock(fs, &temp_dblock) != SUCCESS) return INSUFFICIENT_DBLOCKS;
-                    if (n>=64){
-                        write_to_dblock(fs,temp_dblock,0,data,64);
-                        inode->internal.file_size += 64;
-                        data = (void *)((byte *)data + 64);
-                        n = (n - 64);
-                    } else {
-                        write_to_dblock(fs,temp_dblock,0,data,n);
-                        inode->internal.file_size += n;
-                        data = (void *)((byte *)data + n);
-                        n = 0;
-                    }
-
-                    // Storing the index value of data dblock inside index dblock
-                    write_to_dblock(fs, temp_idx_dblock, j*4, &temp_dblock, 4);
-                }
-
-                temp_previous_idx_dblock = temp_idx_dblock;
-            }
-        } else { // If all the data in Indirect data block
-            size_t indirect_data_dblocks_in_inode = (data_dblocks_in_inode-4);
-            size_t indirect_idx_dblocks_in_inode;
-            
-            if (byte_in_last_data_dblock == 64) indirect_idx_dblocks_in_inode = calculate_index_dblock_amount(indirect_data_dblocks_in_inode*64);
-            else indirect_idx_dblocks_in_inode = calculate_index_dblock_amount((indirect_data_dblocks_in_inode-1)*64+byte_in_last_data_dblock);
-
-            dblock_index_t index_for_last_idx_dblock = inode->internal.indirect_dblock;
-            
-            for (size_t i = 0; i < indirect_idx_dblocks_in_inode-1; i++){
-                memcpy(&index_for_last_idx_dblock, &fs->dblocks[index_for_last_idx_dblock*64+60], 4);
-            }
+void block_cursor_next(filesystem_t *fs, inode_t *inode, block_cursor_t *cursor)
+{
+    ++cursor->block;
+    if (cursor->block <= INODE_DIRECT_BLOCK_COUNT) return; // still direct, or the first indirect block
 
-            size_t indirect_data_dblocks_last_index_node = (indirect_data_dblocks_in_inode%15);
-            dblock_index_t index_for_indirect_data_dblocks_last_index_node;
-            
-            if (indirect_data_dblocks_last_index_node > 0){
-                memcpy(&index_for_indirect_data_dblocks_last_index_node, &fs->dblocks[index_for_last_idx_dblock*64+((indirect_data_dblocks_last_index_node-1)*4)], 4);
-                write_to_dblock(fs,index_for_indirect_data_dblocks_last_index_node,byte_in_last_data_dblock,data,64-byte_in_last_data_dblock);
-                data = (void *)((byte *)data + (64-byte_in_last_data_dblock));
-                
-                if (n > (64-byte_in_last_data_dblock)){
-                    n = (n - (64-byte_in_last_data_dblock));
-                    inode->internal.file_size += (64-byte_in_last_data_dblock);
-                }
-                
-                // Fill up remaining datablocks in the index dblock
-                for (int j = indirect_data_dblocks_last_index_node; j < 15 && n > 0; j++){
-                    dblock_index_t temp_dblock;
-                    if (claim_available_dblock(fs, &temp_dblock) != SUCCESS) return INSUFFICIENT_DBLOCKS;
-
-                    if (n>=64){
-                        write_to_dblock(fs,temp_dblock,0,data,64);
-                        inode->internal.file_size += 64;
-                        data = (void *)((byte *)data + 64);
-                        n = (n - 64);
-                    } else {
-                        write_to_dblock(fs,temp_dblock,0,data,n);
-                        inode->internal.file_size += n;
-                        data = (void *)((byte *)data + n);
-                        n = 0;
-                    }
-
-                    write_to_dblock(fs, index_for_last_idx_dblock, j*4, &temp_dblock, 4);
-                }
-            }     
-
-            // Check to see if data left
-            if (n==0) {return SUCCESS;}
-
-            dblock_index_t temp_previous_idx_dblock = index_for_last_idx_dblock;
-
-            for (size_t i = 0; n > 0; i++){
-                dblock_index_t temp_idx_dblock;
-                if (claim_available_dblock(fs, &temp_idx_dblock) != SUCCESS) return INSUFFICIENT_DBLOCKS;
-
-                write_to_dblock(fs, temp_previous_idx_dblock, 60, &temp_idx_dblock, 4);
-
-                for (int j = 0; n > 0 && j < 15; j++){
-                    dblock_index_t temp_dblock;
-                    if (claim_available_dblock(fs, &temp_dblock) != SUCCESS) return INSUFFICIENT_DBLOCKS;
-
-                    if (n>=64){
-                        write_to_dblock(fs,temp_dblock,0,data,64);
-                        inode->internal.file_size += 64;
-                        data = (void *)((byte *)data + 64);
-                        n = (n - 64);
-                    } else {
-                        write_to_dblock(fs,temp_dblock,0,data,n);
-                        inode->internal.file_size += n;
-                        data = (void *)((byte *)data + n);
-                        n = 0;
-                    }
-
-                    // Storing the index value of data dblock inside index dblock
-                    write_to_dblock(fs, temp_idx_dblock, j*4, &temp_dblock, 4);
-                }
-
-                temp_previous_idx_dblock = temp_idx_dblock;
-            }
-        }
+    // moving past the last entry of an index dblock means moving to the next one in the chain
+    if ((cursor->block - INODE_DIRECT_BLOCK_COUNT) % INDIRECT_DBLOCK_INDEX_COUNT(fs) == 0)
+    {
+        cursor->index_dblock = next_index_dblock(fs, cursor->index_dblock);
     }
+}
 
-    return SUCCESS;
+dblock_index_t block_cursor_dblock(filesystem_t *fs, inode_t *inode, block_cursor_t *cursor)
+{
+    if (cursor->block < INODE_DIRECT_BLOCK_COUNT) return inode->internal.direct_data[cursor->block];
+    size_t slot = (cursor->block - INODE_DIRECT_BLOCK_COUNT) % INDIRECT_DBLOCK_INDEX_COUNT(fs);
+    return read_index_entry(fs, cursor->index_dblock, slot);
 }
 
-fs_retcode_t inode_read_data(filesystem_t *fs, inode_t *inode, size_t offset, void *buffer, size_t n, size_t *bytes_read)
-{   
-    // Check inputs
-    if (fs == NULL || inode == NULL || buffer == NULL || bytes_read == NULL) 
-        return INVALID_INPUT;
-    
-    size_t size_of_inode = inode->internal.file_size;
-    
-    // If offset is beyond file or file is empty, read 0 bytes
-    if (offset >= size_of_inode || size_of_inode == 0) {
-        return SUCCESS;
-    }
+// prefetches the dblock the cursor points at. on the first entry of an index dblock the next
+// index dblock of the chain is prefetched as well, unless this is the last one of the file
+static void prefetch_block(filesystem_t *fs, inode_t *inode, block_cursor_t *cursor, size_t file_blocks)
+{
+    dblock_index_t dblock = block_cursor_dblock(fs, inode, cursor);
+    if (dblock < fs->dblock_count) __builtin_prefetch(DBLOCK_ADDR(fs, dblock));
+
+    if (cursor->block < INODE_DIRECT_BLOCK_COUNT) return;
+    if ((cursor->block - INODE_DIRECT_BLOCK_COUNT) % INDIRECT_DBLOCK_INDEX_COUNT(fs) != 0) return;
+    if (index_dblock_number(fs, cursor->block) >= index_dblock_number(fs, file_blocks - 1)) return;
+    dblock_index_t next = next_index_dblock(fs, cursor->index_dblock);
+    if (next < fs->dblock_count) __builtin_prefetch(DBLOCK_ADDR(fs, next));
+}
 
-    *bytes_read = 0;
-    
-    // Calculate how many bytes we can actually read
-    size_t bytes_to_read = n;
-    if (offset + bytes_to_read > size_of_inode) {
-        bytes_to_read = size_of_inode - offset;
+// moves `cursor` up to block `until`, prefetching the blocks it passes if `prefetch` is set.
+// `until` may be one past the last block of the file. returns 0 if the chain leads outside
+// of the file system, which only happens when the cursor is stale
+static int prefetch_until(filesystem_t *fs, inode_t *inode, block_cursor_t *cursor, size_t until, size_t file_blocks, int prefetch)
+{
+    while (cursor->block < until)
+    {
+        if (prefetch) prefetch_block(fs, inode, cursor, file_blocks);
+        block_cursor_next(fs, inode, cursor);
+        if (cursor->block < file_blocks && cursor->block >= INODE_DIRECT_BLOCK_COUNT && cursor->index_dblock >= fs->dblock_count) return 0;
     }
+    return 1;
+}
 
-    size_t bytes_to_read_direct_dblock = bytes_to_read;
-    size_t bytes_to_read_indirect_dblock = bytes_to_read;
-    
-    // Read all direct blocks into buffer
-    if (offset<256){
-        byte *entire_direct_dblock = malloc(64 * 4);
-        size_t last_data_block_index = (size_of_inode - 1) / 64;
-        for (size_t i = 0; i <= last_data_block_index && i < 4; ++i) {
-            memcpy(entire_direct_dblock + (i * 64), &fs->dblocks[inode->internal.direct_data[i] * 64], 64);
-        }
-
-        if (bytes_to_read + offset > 256) {
-            bytes_to_read_indirect_dblock = (bytes_to_read + offset) - 256;
-            bytes_to_read_direct_dblock = bytes_to_read - bytes_to_read_indirect_dblock;
-            offset = 0;
-        }
+void inode_prefetch_data(filesystem_t *fs, inode_t *inode, size_t offset, size_t n)
+{
+    if (fs == NULL || inode == NULL || n == 0) return;
+    if (inode->internal.file_perms & FS_COMPRESSED) return;
+    size_t file_size = inode->internal.file_size;
+    if (offset >= file_size) return;
+    if (n > file_size - offset) n = file_size - offset;
 
-        memcpy(buffer, entire_direct_dblock + offset, bytes_to_read_direct_dblock);
-        *bytes_read += bytes_to_read_direct_dblock;
-        free(entire_direct_dblock);
+    block_cursor_t cursor;
+    block_cursor_seek(fs, inode, &cursor, offset / DATA_BLOCK_SIZE(fs));
+    prefetch_until(fs, inode, &cursor, (offset + n - 1) / DATA_BLOCK_SIZE(fs) + 1, BLOCKS_FOR_SIZE(fs, file_size), 1);
+}
 
-    } else {
-        offset = offset - 256;
-        bytes_to_read_indirect_dblock = bytes_to_read;
+void inode_read_ahead(filesystem_t *fs, inode_t *inode, size_t offset, size_t n)
+{
+    if (fs == NULL || inode == NULL || fs->read_ahead_blocks == 0 || n == 0) return;
+    if (inode->internal.file_perms & FS_COMPRESSED) return;
+    size_t file_size = inode->internal.file_size;
+    if (offset >= file_size) return;
+    if (n > file_size - offset) n = file_size - offset;
+
+    struct read_ahead *ra = read_ahead_entry(fs, inode, 1);
+    if (!ra) return;
+
+    // a read that does not continue the previous one only arms the detection
+    size_t end = offset + n;
+    int sequential = ra->file_size == file_size && ra->next_offset == offset;
+    ra->next_offset = end;
+    if (!sequential)
+    {
+        ra->file_size = file_size;
+        ra->window = 0;
+        ra->positioned = 0;
+        return;
     }
 
-    if (size_of_inode<=256 || bytes_to_read == *bytes_read){
-        // No Indirect Block, quit program
-        return SUCCESS;
+    // the window starts small and doubles with every sequential read
+    ra->window = ra->window ? ra->window * 2 : READ_AHEAD_MIN_BLOCKS;
+    if (ra->window > fs->read_ahead_blocks) ra->window = fs->read_ahead_blocks;
+
+    size_t file_blocks = BLOCKS_FOR_SIZE(fs, file_size);
+    size_t from = end / DATA_BLOCK_SIZE(fs);
+    if (from >= file_blocks) return;
+    size_t until = from + ra->window < file_blocks ? from + ra->window : file_blocks;
+
+    // blocks already prefetched by earlier reads are skipped. a reader that overtook the
+    // window moves the cursor forward along the chain instead of seeking from the start
+    if (!ra->positioned)
+    {
+        block_cursor_seek(fs, inode, &ra->cursor, from);
+        ra->positioned = 1;
     }
+    ra->positioned = prefetch_until(fs, inode, &ra->cursor, from, file_blocks, 0)
+        && prefetch_until(fs, inode, &ra->cursor, until, file_blocks, 1);
+}
 
-    // If: offset is at indirect dblock, 
-    // Then: offset = some non zero value, bytes_to_read_indirect_block
+// dblocks claimed for an append that was already checked to fit. they are claimed
+// CLAIM_BATCH_SIZE at a time with `claim_available_dblocks` and handed out in order, which
+// is the order `claim_available_dblock` would have returned them in
+struct dblock_batch
+{
+    size_t remaining; // dblocks of the append not claimed yet
+    size_t count;
+    size_t next;
+    dblock_index_t indices[CLAIM_BATCH_SIZE];
+};
 
-    size_t offset_idx_dblock = calculate_index_dblock_amount(offset);
-    size_t offset_data_dblocks_to_read = calculate_necessary_dblock_amount(offset) - offset_idx_dblock;
-    size_t offset_byte_block = (offset%64);
-    size_t bytes_last_indirect_dblock = (bytes_to_read_indirect_dblock%64);
+static dblock_index_t batch_take(filesystem_t *fs, struct dblock_batch *batch)
+{
+    if (batch->next == batch->count)
+    {
+        batch->count = batch->remaining < CLAIM_BATCH_SIZE ? batch->remaining : CLAIM_BATCH_SIZE;
+        batch->next = 0;
+        batch->remaining -= batch->count;
+        fs_assert_success(claim_available_dblocks(fs, batch->indices, batch->count));
+    }
+    return batch->indices[batch->next++];
+}
 
-    dblock_index_t idx_next_indirect_dblock = inode->internal.indirect_dblock;
-    size_t last_idx_dblock = calculate_index_dblock_amount(bytes_to_read_indirect_dblock);
-    size_t data_dblocks_to_read = calculate_necessary_dblock_amount(bytes_to_read_indirect_dblock) - last_idx_dblock;
+// releases the dblocks of a batch that were claimed but not handed out
+static void batch_release(filesystem_t *fs, struct dblock_batch *batch)
+{
+    fs_assert_success(release_dblocks(fs, batch->indices + batch->next, batch->count - batch->next));
+    batch->count = batch->next = 0;
+}
 
-    size_t total_dblock_counter = 0;
+// takes a dblock for logical block `block` from `batch` and links it into the inode. `index_dblock`
+// is the index dblock of the previous block and is updated when a new index dblock is started.
+static void append_dblock(filesystem_t *fs, inode_t *inode, size_t block, struct dblock_batch *batch, dblock_index_t *index_dblock, dblock_index_t *dblock)
+{
+    if (block < INODE_DIRECT_BLOCK_COUNT)
+    {
+        *dblock = batch_take(fs, batch);
+        inode->internal.direct_data[block] = *dblock;
+        return;
+    }
 
-    for (size_t i = 0; i <= last_idx_dblock; i++){
+    size_t slot = (block - INODE_DIRECT_BLOCK_COUNT) % INDIRECT_DBLOCK_INDEX_COUNT(fs);
+    if (slot == 0)
+    {
+        // the index dblock is taken before the data dblock it points to
+        dblock_index_t new_index = batch_take(fs, batch);
+        if (block == INODE_DIRECT_BLOCK_COUNT) inode->internal.indirect_dblock = new_index;
+        else memcpy(DBLOCK_ADDR(fs, *index_dblock) + NEXT_INDIRECT_INDEX_OFFSET(fs), &new_index, sizeof(dblock_index_t));
+        *index_dblock = new_index;
+    }
 
-        size_t dblock_counter = 0;
+    *dblock = batch_take(fs, batch);
+    write_index_entry(fs, *index_dblock, slot, *dblock);
+}
 
-        while (dblock_counter<15 && data_dblocks_to_read>0){
+// ----------------------- CORE FUNCTION ----------------------- //
 
-            if ((total_dblock_counter < offset_data_dblocks_to_read-1) && ((offset+bytes_to_read)%64 == (size_of_inode-256)%64) && (offset != 0)){
-                dblock_counter++;
-                total_dblock_counter++;
-                continue;
-            }
+// the source of byte `i` of a write. with a `period` of 0 the source is read in order,
+// otherwise it is a tile repeating a pattern of `period` bytes, see `inode_fill_data`
+static const byte *source_at(const byte *src, size_t i, size_t period)
+{
+    return period ? src + i % period : src + i;
+}
 
-            dblock_index_t index_for_data_dblock;
-            memcpy(&index_for_data_dblock, &fs->dblocks[idx_next_indirect_dblock*64] + 4*dblock_counter, 4);
+// appends to a raw (not compressed) file
+static fs_retcode_t write_raw_data(filesystem_t *fs, inode_t *inode, const byte *src, size_t n, size_t period)
+{
+    if (n == 0) return SUCCESS;
+
+    size_t old_size = inode->internal.file_size;
+    size_t new_size = old_size + n;
+
+    // the file system is not modified unless every dblock can be claimed
+    size_t dblocks_needed = calculate_necessary_dblock_amount(fs, new_size) - calculate_necessary_dblock_amount(fs, old_size);
+    if (!has_available_dblocks(fs, dblocks_needed)) return INSUFFICIENT_DBLOCKS;
+    struct dblock_batch batch = { .remaining = dblocks_needed };
+
+    size_t old_blocks = BLOCKS_FOR_SIZE(fs, old_size);
+    size_t used_in_last = old_size % DATA_BLOCK_SIZE(fs);
+    size_t done = 0;
+
+    // the cursor tracks the last block of the file so we know its index dblock
+    block_cursor_t cursor = { 0, inode->internal.indirect_dblock };
+    if (old_blocks > 0) block_cursor_seek(fs, inode, &cursor, old_blocks - 1);
+
+    // top off the partially filled last block
+    if (used_in_last != 0)
+    {
+        size_t take = DATA_BLOCK_SIZE(fs) - used_in_last;
+        if (take > n) take = n;
+        memcpy(DBLOCK_ADDR(fs, block_cursor_dblock(fs, inode, &cursor)) + used_in_last, src, take);
+        done += take;
+    }
 
-            if (data_dblocks_to_read != 1){
-                memcpy(buffer+*bytes_read,&fs->dblocks[index_for_data_dblock*64 + offset_byte_block],64);
-                *bytes_read += 64;
-            } else {
-                memcpy(buffer+*bytes_read,&fs->dblocks[index_for_data_dblock*64 + offset_byte_block],bytes_last_indirect_dblock);
-                *bytes_read += bytes_last_indirect_dblock;
-            }
-            offset_byte_block = 0;
-            data_dblocks_to_read--;
-            dblock_counter++;
-            total_dblock_counter++;
-        }
-        memcpy(&idx_next_indirect_dblock, &fs->dblocks[idx_next_indirect_dblock*64] + 60, 4);
+    // every remaining byte goes into a freshly claimed block
+    dblock_index_t index_dblock = cursor.index_dblock;
+    for (size_t block = old_blocks; done < n; ++block)
+    {
+        dblock_index_t dblock;
+        append_dblock(fs, inode, block, &batch, &index_dblock, &dblock);
+
+        size_t take = n - done < DATA_BLOCK_SIZE(fs) ? n - done : DATA_BLOCK_SIZE(fs);
+        memcpy(DBLOCK_ADDR(fs, dblock), source_at(src, done, period), take);
+        done += take;
     }
+
+    inode->internal.file_size = new_size;
+    append_tail_store(fs, inode, index_dblock);
+    checksum_update_range(fs, inode, old_size, new_size - old_size);
+    subtree_update(fs, inode);
     return SUCCESS;
 }
 
-fs_retcode_t inode_modify_data(filesystem_t *fs, inode_t *inode, size_t offset, void *buffer, size_t n)
-{   
+fs_retcode_t inode_write_data(filesystem_t *fs, inode_t *inode, void *data, size_t n)
+{
     if (fs == NULL || inode == NULL) return INVALID_INPUT;
-    if (offset > inode->internal.file_size) return INVALID_INPUT;
-
-    //calculate the final filesize and verify there are enough blocks to support it
-    size_t file_size = inode->internal.file_size;
-    size_t upper_bound = offset+n; // Exclusive
-
-    if (upper_bound > file_size && ((upper_bound-file_size)/64 > available_dblocks(fs))) return INSUFFICIENT_DBLOCKS; // When assigning blocks to direct block
-
-
-    size_t indirect_bytes = upper_bound-256;
-    size_t indirect_file_size = file_size-256;
-
-    size_t ib_index_blocks = calculate_index_dblock_amount(indirect_bytes);
-    size_t ifz_index_blocks = calculate_index_dblock_amount(indirect_file_size);
-
-    if (ifz_index_blocks<ib_index_blocks){
-        if ((ib_index_blocks-ifz_index_blocks)>available_dblocks(fs)) return INSUFFICIENT_DBLOCKS;
+    if (inode->internal.file_perms & FS_COMPRESSED)
+    {
+        fs_retcode_t ret = inode_decompress_data(fs, inode);
+        if (ret != SUCCESS) return ret;
     }
+    return write_raw_data(fs, inode, data, n, 0);
+}
 
-    if (offset >= file_size){ // If offset is larger, just append data
-        inode_write_data(fs,inode,buffer,n);
-        return SUCCESS;
-    };
-
-    size_t buffer_written = 0;
+fs_retcode_t inode_read_raw_data(filesystem_t *fs, inode_t *inode, size_t offset, void *buffer, size_t n, size_t *bytes_read)
+{
+    if (fs == NULL || inode == NULL || buffer == NULL || bytes_read == NULL) return INVALID_INPUT;
 
-    // Manage Modifying just the Direct Datablock
-    if (offset<256 && upper_bound<256){
-        if (upper_bound > file_size){
-            upper_bound = file_size;
+    *bytes_read = 0;
+    size_t file_size = inode->internal.file_size;
+    if (offset >= file_size) return SUCCESS;
+    if (n > file_size - offset) n = file_size - offset;
+
+    byte *dst = buffer;
+    size_t in_block = offset % DATA_BLOCK_SIZE(fs);
+    block_cursor_t cursor;
+    block_cursor_seek(fs, inode, &cursor, offset / DATA_BLOCK_SIZE(fs));
+
+    // for reads spanning several blocks a second cursor runs `read_ahead_blocks` in front of
+    // the copy and prefetches the dblocks and index dblocks it passes
+    size_t file_blocks = BLOCKS_FOR_SIZE(fs, file_size);
+    size_t read_end = (offset + n - 1) / DATA_BLOCK_SIZE(fs) + 1;
+    size_t distance = read_end - cursor.block > 1 ? fs->read_ahead_blocks : 0;
+    block_cursor_t ahead = cursor;
+
+    size_t done = 0;
+    dblock_index_t verified_index = inode->internal.indirect_dblock;
+    int index_verified = 0;
+    while (done < n)
+    {
+        if (distance && ahead.block < read_end)
+        {
+            size_t until = cursor.block + distance < read_end ? cursor.block + distance : read_end;
+            prefetch_until(fs, inode, &ahead, until, file_blocks, 1);
         }
-        size_t lower_offset_block_index = offset / 64;
-        size_t upper_offset_block_index = (upper_bound - 1) / 64;  // upper_bound is exclusive
-        
-        size_t bytes_in_lower_offset_block = offset % 64;          // Starting byte in first block
-        size_t bytes_in_upper_offset_block = (upper_bound - 1) % 64 + 1;  // Bytes to write in last block        
-
-        for (size_t i = lower_offset_block_index; i <= upper_offset_block_index; i++){
-
-            if (i == upper_offset_block_index && i == lower_offset_block_index ){
-                memcpy(&fs->dblocks[(inode->internal.direct_data[i])*64]+bytes_in_lower_offset_block,buffer+buffer_written,upper_bound-offset);
-                buffer_written += (upper_bound-offset);
-                continue;
-            }
 
-            if (i == lower_offset_block_index){
-                memcpy(&fs->dblocks[(inode->internal.direct_data[i])*64]+bytes_in_lower_offset_block,buffer+buffer_written,(64-bytes_in_lower_offset_block));
-                buffer_written += (64-bytes_in_lower_offset_block);
-                continue;
+        dblock_index_t dblock = block_cursor_dblock(fs, inode, &cursor);
+        if (fs->dblock_checksums)
+        {
+            // an index dblock is verified once however many of its entries we use
+            if (cursor.block >= INODE_DIRECT_BLOCK_COUNT && (!index_verified || cursor.index_dblock != verified_index))
+            {
+                if (checksum_verify_dblock(fs, cursor.index_dblock) != SUCCESS) break;
+                verified_index = cursor.index_dblock;
+                index_verified = 1;
             }
-
-            if (i == upper_offset_block_index){
-                memcpy(&fs->dblocks[(inode->internal.direct_data[i])*64],buffer+buffer_written,bytes_in_upper_offset_block);
-                buffer_written += bytes_in_upper_offset_block;
-                continue;
-            }
-
-            memcpy(&fs->dblocks[(inode->internal.direct_data[i])*64],buffer+buffer_written,64);
-            buffer_written += 64;
-        }
-    } else if (offset<256 && upper_bound>=256){
-        
-        size_t indirect_bytes = upper_bound-256;
-
-        size_t lower_offset_block_index = offset / 64;
-        size_t bytes_in_lower_offset_block = offset % 64;    
-
-        for (size_t i = lower_offset_block_index; i <= 3; i++){
-            memcpy(&fs->dblocks[(inode->internal.direct_data[i])*64]+bytes_in_lower_offset_block,buffer+buffer_written,(64-bytes_in_lower_offset_block));
-            buffer_written += (64-bytes_in_lower_offset_block);
-            bytes_in_lower_offset_block = 0;    
+            if (checksum_verify_dblock(fs, dblock) != SUCCESS) break;
         }
 
-        if (file_size == 256){
-            inode_write_data(fs,inode,buffer,((offset+n)-256));
-            return SUCCESS;
-        }
+        size_t take = DATA_BLOCK_SIZE(fs) - in_block;
+        if (take > n - done) take = n - done;
+        memcpy(dst + done, DBLOCK_ADDR(fs, dblock) + in_block, take);
+        done += take;
+        in_block = 0;
+        // only follow the chain if there is more to read. the link after the last block is garbage
+        if (done < n) block_cursor_next(fs, inode, &cursor);
+    }
 
-        if (indirect_bytes > (file_size-256)){
-            indirect_bytes = file_size;
+    // remember where the read ended so the next one does not walk the chain from the start.
+    // the table is not allocated for file systems that never enable read-ahead
+    if (cursor.block >= INODE_DIRECT_BLOCK_COUNT && (fs->read_resumes || fs->read_ahead_blocks))
+    {
+        struct read_resume *resume = read_resume_entry(fs, inode, 1);
+        if (resume)
+        {
+            resume->cursor = cursor;
+            resume->resumable = 1;
         }
+    }
 
-        size_t upper_bound_indirect_data_block = (indirect_bytes - 1) / 64; 
-        size_t upper_bound_bytes = (indirect_bytes - 1) % 64 + 1;
-
-        size_t data_dblocks_read = 0;
-        size_t data_dblocks_per_idx_read = 0;
-
-        dblock_index_t cur_index = inode->internal.indirect_dblock;
-
-        while (data_dblocks_read <= upper_bound_indirect_data_block){
-            size_t idx_of_data_dblock = 0;
-            memcpy(&idx_of_data_dblock,&fs->dblocks[cur_index*64]+data_dblocks_per_idx_read*4,4);
-
-            if (data_dblocks_read == upper_bound_indirect_data_block){
-                memcpy(&fs->dblocks[idx_of_data_dblock*64],buffer+buffer_written,upper_bound_bytes);
-                buffer_written += upper_bound_bytes;
-                data_dblocks_read++;
-                data_dblocks_per_idx_read++;
-                continue;
-            }
+    *bytes_read = done;
+    return done == n ? SUCCESS : CHECKSUM_MISMATCH;
+}
 
-            if (data_dblocks_read < (upper_bound_indirect_data_block)){
-                memcpy(&fs->dblocks[idx_of_data_dblock*64],buffer+buffer_written,64);
-                buffer_written += 64;
-            }
+fs_retcode_t inode_read_data(filesystem_t *fs, inode_t *inode, size_t offset, void *buffer, size_t n, size_t *bytes_read)
+{
+    if (fs == NULL || inode == NULL || buffer == NULL || bytes_read == NULL) return INVALID_INPUT;
+    if (inode->internal.file_perms & FS_COMPRESSED) return compressed_read_data(fs, inode, offset, buffer, n, bytes_read);
+    return inode_read_raw_data(fs, inode, offset, buffer, n, bytes_read);
+}
 
-            data_dblocks_read++;
-            data_dblocks_per_idx_read++;
+static fs_retcode_t modify_raw_data(filesystem_t *fs, inode_t *inode, size_t offset, const byte *src, size_t n, size_t period)
+{
+    size_t file_size = inode->internal.file_size;
+    if (offset > file_size) return INVALID_INPUT;
+
+    // the file system is not modified unless the bytes past the end of the file fit
+    size_t end = offset + n;
+    if (end > file_size)
+    {
+        size_t dblocks_needed = calculate_necessary_dblock_amount(fs, end) - calculate_necessary_dblock_amount(fs, file_size);
+        if (!has_available_dblocks(fs, dblocks_needed)) return INSUFFICIENT_DBLOCKS;
+    }
 
-            if (data_dblocks_read%15 == 0){
-                memcpy(&cur_index,&fs->dblocks[cur_index*64]+60,4);
-                data_dblocks_per_idx_read = 0;
-            }
+    // overwrite the bytes that already exist in place
+    size_t in_place = end < file_size ? n : file_size - offset;
+    if (in_place > 0)
+    {
+        size_t in_block = offset % DATA_BLOCK_SIZE(fs);
+        block_cursor_t cursor;
+        block_cursor_seek(fs, inode, &cursor, offset / DATA_BLOCK_SIZE(fs));
+
+        size_t done = 0;
+        while (done < in_place)
+        {
+            size_t take = DATA_BLOCK_SIZE(fs) - in_block;
+            if (take > in_place - done) take = in_place - done;
+            memcpy(DBLOCK_ADDR(fs, block_cursor_dblock(fs, inode, &cursor)) + in_block, source_at(src, done, period), take);
+            done += take;
+            in_block = 0;
+            if (done < in_place) block_cursor_next(fs, inode, &cursor);
         }
-    } else {
-        size_t indirect_bytes = upper_bound-256;
-        
-        size_t total_data_dblocks = ((offset-256) / 64);
-        size_t lower_offset_data_dblock_index = total_data_dblocks%15;
-        size_t bytes_in_lower_offset_block = (offset-256) % 64;    
-
-        size_t upper_bound_indirect_data_block = (indirect_bytes - 1) / 64; 
-        size_t upper_bound_bytes = (indirect_bytes - 1) % 64 + 1;
+    }
 
-        size_t data_dblocks_read = total_data_dblocks;
-        size_t data_dblocks_per_idx_read = lower_offset_data_dblock_index;
+    // the rest is appended
+    if (in_place < n) return write_raw_data(fs, inode, source_at(src, in_place, period), n - in_place, period);
+    return SUCCESS;
+}
 
-        dblock_index_t cur_index = inode->internal.indirect_dblock;
+static fs_retcode_t modify_data(filesystem_t *fs, inode_t *inode, size_t offset, const byte *src, size_t n, size_t period)
+{
+    if (inode->internal.file_perms & FS_COMPRESSED)
+    {
+        fs_retcode_t ret = inode_decompress_data(fs, inode);
+        if (ret != SUCCESS) return ret;
+    }
 
-        for (size_t i = 0; i < calculate_index_dblock_amount(total_data_dblocks); i++){
-            memcpy(&cur_index,&fs->dblocks[cur_index*64]+60,4);
-        }
+    // the appended part refreshes its own checksums in write_raw_data
+    size_t file_size = inode->internal.file_size;
+    fs_retcode_t ret = modify_raw_data(fs, inode, offset, src, n, period);
+    if (ret == SUCCESS && offset < file_size) checksum_update_range(fs, inode, offset, n < file_size - offset ? n : file_size - offset);
+    return ret;
+}
 
-        while (data_dblocks_read <= upper_bound_indirect_data_block){
-            size_t idx_of_data_dblock = 0;
-            memcpy(&idx_of_data_dblock,&fs->dblocks[cur_index*64]+data_dblocks_per_idx_read*4,4);
+fs_retcode_t inode_modify_data(filesystem_t *fs, inode_t *inode, size_t offset, void *buffer, size_t n)
+{
+    if (fs == NULL || inode == NULL) return INVALID_INPUT;
+    return modify_data(fs, inode, offset, buffer, n, 0);
+}
 
-            if (data_dblocks_read == upper_bound_indirect_data_block){
-                memcpy(&fs->dblocks[idx_of_data_dblock*64]+bytes_in_lower_offset_block,buffer+buffer_written,upper_bound_bytes-bytes_in_lower_offset_block);
-                buffer_written += upper_bound_bytes-bytes_in_lower_offset_block;
-            } else if (data_dblocks_read < (upper_bound_indirect_data_block)){
-                memcpy(&fs->dblocks[idx_of_data_dblock*64]+bytes_in_lower_offset_block,buffer+buffer_written,64-bytes_in_lower_offset_block);
-                buffer_written += 64-bytes_in_lower_offset_block;
-            }
+fs_retcode_t inode_fill_data(filesystem_t *fs, inode_t *inode, size_t offset, const void *pattern, size_t pattern_size, size_t n)
+{
+    if (fs == NULL || inode == NULL || pattern == NULL) return INVALID_INPUT;
+    if (pattern_size == 0 || pattern_size > FS_FILL_PATTERN_MAX) return INVALID_INPUT;
 
-            bytes_in_lower_offset_block = 0;
+    // every copy is at most one block and starts less than two pattern lengths into the tile:
+    // the phase of the pattern at the copy plus the phase at which the append started
+    byte tile[MAX_DATA_BLOCK_SIZE + 2 * FS_FILL_PATTERN_MAX];
+    const byte *bytes = pattern;
+    if (pattern_size == 1) memset(tile, bytes[0], sizeof(tile));
+    else for (size_t i = 0; i < sizeof(tile); ++i) tile[i] = bytes[i % pattern_size];
 
-            data_dblocks_read++;
-            data_dblocks_per_idx_read++;
+    return modify_data(fs, inode, offset, tile, n, pattern_size);
+}
 
-            if (data_dblocks_read%15 == 0){
-                memcpy(&cur_index,&fs->dblocks[cur_index*64]+60,4);
-                data_dblocks_per_idx_read = 0;
+fs_retcode_t inode_copy_data(filesystem_t *fs, inode_t *dst, inode_t *src)
+{
+    if (fs == NULL || dst == NULL || src == NULL || dst == src) return INVALID_INPUT;
+    if (dst->internal.file_size != 0) return INVALID_INPUT;
+
+    // a compressed file is copied as its stored stream, so it is never decompressed
+    size_t size = src->internal.file_size;
+    size_t blocks = BLOCKS_FOR_SIZE(fs, size);
+    size_t dblocks_needed = calculate_necessary_dblock_amount(fs, size);
+    if (!has_available_dblocks(fs, dblocks_needed)) return INSUFFICIENT_DBLOCKS;
+    struct dblock_batch batch = { .remaining = dblocks_needed };
+
+    block_cursor_t cursor;
+    if (blocks > 0) block_cursor_seek(fs, src, &cursor, 0);
+    dblock_index_t index_dblock = 0;
+    dblock_index_t verified_index = 0;
+    size_t block = 0;
+    for (; block < blocks; ++block)
+    {
+        dblock_index_t from = block_cursor_dblock(fs, src, &cursor);
+        if (fs->dblock_checksums)
+        {
+            if (block >= INODE_DIRECT_BLOCK_COUNT && (block == INODE_DIRECT_BLOCK_COUNT || cursor.index_dblock != verified_index))
+            {
+                if (checksum_verify_dblock(fs, cursor.index_dblock) != SUCCESS) break;
+                verified_index = cursor.index_dblock;
             }
+            if (checksum_verify_dblock(fs, from) != SUCCESS) break;
         }
+
+        dblock_index_t to;
+        append_dblock(fs, dst, block, &batch, &index_dblock, &to);
+        size_t take = block + 1 < blocks ? DATA_BLOCK_SIZE(fs) : size - block * DATA_BLOCK_SIZE(fs);
+        memcpy(DBLOCK_ADDR(fs, to), DBLOCK_ADDR(fs, from), take);
+        if (block + 1 < blocks) block_cursor_next(fs, src, &cursor);
     }
 
-    if ((offset+n)>file_size){
-        size_t rem_data = (offset+n)-file_size;
-        inode_write_data(fs,inode,buffer,rem_data);
+    if (block < blocks)
+    {
+        // hand back everything claimed for the copy so far
+        batch_release(fs, &batch);
+        dst->internal.file_size = block * DATA_BLOCK_SIZE(fs);
+        inode_release_data(fs, dst);
+        return CHECKSUM_MISMATCH;
     }
 
-    //For the new data, call "inode_write_data" and return
+    dst->internal.file_size = size;
+    dst->internal.file_perms = (dst->internal.file_perms & ~FS_COMPRESSED) | (src->internal.file_perms & FS_COMPRESSED);
+    append_tail_store(fs, dst, index_dblock);
+    checksum_update_range(fs, dst, 0, size);
+    subtree_update(fs, dst);
     return SUCCESS;
 }
 
 fs_retcode_t inode_shrink_data(filesystem_t *fs, inode_t *inode, size_t new_size)
 {
-
     if (fs == NULL || inode == NULL) return INVALID_INPUT;
-    if (new_size>inode->internal.file_size) return INVALID_INPUT;
 
-    //Calculate how many blocks to remove
+    // checked against the logical size first so a refused call leaves a compressed file as it is
+    if (new_size > inode_data_size(fs, inode)) return INVALID_INPUT;
 
-    if (new_size==0){
-        size_t index_to_clear_to = (inode->internal.file_size/64);
-        for (size_t i = 0; i <= index_to_clear_to && i < 4; i++){
-            release_dblock(fs,&fs->dblocks[inode->internal.direct_data[i]*64]);
+    if (inode->internal.file_perms & FS_COMPRESSED)
+    {
+        if (new_size == 0)
+        {
+            // dropping everything does not need the logical data
+            inode->internal.file_perms &= ~FS_COMPRESSED;
+            compress_cache_invalidate(fs, inode);
         }
-
-        if (index_to_clear_to>=4){
-            free_indirect(fs,inode,0);
+        else
+        {
+            fs_retcode_t ret = inode_decompress_data(fs, inode);
+            if (ret != SUCCESS) return ret;
         }
-        inode->internal.file_size = 0;
-        return SUCCESS;
     }
 
-    if (new_size<256){
-        size_t index_to_clear_to = (inode->internal.file_size/64);
-        size_t index_to_clear_from = (new_size/64)+1;
-        for (size_t i = index_to_clear_from; i <= index_to_clear_to && i < 4; i++){
-            release_dblock(fs,&fs->dblocks[inode->internal.direct_data[i]*64]);
-        }
+    size_t file_size = inode->internal.file_size;
+    size_t old_blocks = BLOCKS_FOR_SIZE(fs, file_size);
+    size_t new_blocks = BLOCKS_FOR_SIZE(fs, new_size);
+    size_t kept_index_blocks = calculate_index_dblock_amount(fs, new_size);
+
+    dblock_index_t batch[RELEASE_BATCH_SIZE];
+    size_t batched = 0;
+
+    // only the freed suffix is visited. seeking hops along the index chain without touching
+    // the data dblocks in front of the new end
+    if (new_blocks < old_blocks)
+    {
+        block_cursor_t cursor;
+        block_cursor_seek(fs, inode, &cursor, new_blocks);
+        for (size_t block = new_blocks; block < old_blocks; ++block)
+        {
+            if (block >= INODE_DIRECT_BLOCK_COUNT)
+            {
+                size_t slot = (block - INODE_DIRECT_BLOCK_COUNT) % INDIRECT_DBLOCK_INDEX_COUNT(fs);
+                size_t index_number = (block - INODE_DIRECT_BLOCK_COUNT) / INDIRECT_DBLOCK_INDEX_COUNT(fs);
+                // an index dblock goes once none of its entries are kept
+                if ((block == new_blocks || slot == 0) && index_number >= kept_index_blocks) batch[batched++] = cursor.index_dblock;
+            }
+            batch[batched++] = block_cursor_dblock(fs, inode, &cursor);
 
-        if (index_to_clear_to>=4){
-            free_indirect(fs,inode,0);
-        }
-    } else {
-        size_t new_offset = new_size-256;
-        size_t new_offset_index_dblock = calculate_index_dblock_amount(new_offset);
-        size_t original_index_dblock = calculate_index_dblock_amount(inode->internal.file_size-256);
-
-        if (new_offset_index_dblock != original_index_dblock){
-            free_indirect(fs,inode,new_offset);
-        } else {
-            size_t size_of_indirect = inode->internal.file_size-256;
-            size_t data_dblocks_of_indirect = (size_of_indirect)/64;
-
-            size_t offset_dblocks = ((new_offset+63)/64);            
-
-            dblock_index_t cur_index = inode->internal.indirect_dblock;
-
-            size_t data_dblocks_read = 0;
-            for (size_t i = 0; i < calculate_index_dblock_amount(size_of_indirect); i++){
-                for (size_t i = 0; i<15 && data_dblocks_read<data_dblocks_of_indirect; i++){
-                    if (data_dblocks_read < offset_dblocks) {
-                        data_dblocks_read++;
-                        continue;
-                    }
-                    dblock_index_t cur_dblock_idx;
-                    memcpy(&cur_dblock_idx,&fs->dblocks[cur_index*64]+i*4,4);
-                    release_dblock(fs,&fs->dblocks[cur_dblock_idx*64]);
-                    data_dblocks_read++;
-                }
-                memcpy(&cur_index,&fs->dblocks[cur_index*64]+60,4);
+            if (batched + 2 > RELEASE_BATCH_SIZE)
+            {
+                fs_assert_success(release_dblocks(fs, batch, batched));
+                batched = 0;
             }
+            if (block + 1 < old_blocks) block_cursor_next(fs, inode, &cursor);
         }
     }
+    fs_assert_success(release_dblocks(fs, batch, batched));
+    append_tail_invalidate(fs, inode);
+    read_ahead_invalidate(fs, inode);
 
     inode->internal.file_size = new_size;
+    subtree_update(fs, inode);
     return SUCCESS;
 }
 
@@ -638,6 +664,5 @@ fs_retcode_t inode_shrink_data(filesystem_t *fs, inode_t *inode, size_t new_size
 fs_retcode_t inode_release_data(filesystem_t *fs, inode_t *inode)
 {
     if (fs == NULL || inode == NULL) return INVALID_INPUT;
-    inode_shrink_data(fs,inode,0);
-    return SUCCESS;
+    return inode_shrink_data(fs, inode, 0);
 }
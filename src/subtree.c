@@ -0,0 +1,76 @@
+#include "filesys.h"
+
+#include <string.h>
+
+#include "utility.h"
+#include "subtree.h"
+
+// adds to the totals of an inode and of every directory above it. the differences wrap
+// around like any unsigned arithmetic, so a decrease is added as its two's complement
+static void propagate(filesystem_t *fs, size_t index, uint64_t files, uint64_t directories, uint64_t bytes, uint64_t dblocks)
+{
+    // a loop of parents never reaches the root
+    for (size_t depth = 0; depth <= fs->inode_count; ++depth)
+    {
+        struct subtree *entry = &fs->subtrees[index];
+        entry->total_files += files;
+        entry->total_directories += directories;
+        entry->total_bytes += bytes;
+        entry->total_dblocks += dblocks;
+        if (entry->parent == 0) return;
+        index = entry->parent - 1;
+    }
+}
+
+void subtree_reset(filesystem_t *fs, inode_t *inode)
+{
+    if (!fs->subtrees) return;
+    struct subtree *entry = &fs->subtrees[inode - fs->inodes];
+    memset(entry, 0, sizeof(*entry));
+    if (inode->internal.file_type == DIRECTORY) entry->total_directories = 1;
+    else entry->total_files = 1;
+}
+
+void subtree_update(filesystem_t *fs, inode_t *inode)
+{
+    if (!fs->subtrees) return;
+    struct subtree *entry = &fs->subtrees[inode - fs->inodes];
+    uint64_t bytes = inode->internal.file_size;
+    uint64_t dblocks = inode->internal.file_perms & FS_SORTED ? entry->dblocks : calculate_necessary_dblock_amount(fs, bytes);
+    if (bytes == entry->bytes && dblocks == entry->dblocks) return;
+    propagate(fs, inode - fs->inodes, 0, 0, bytes - entry->bytes, dblocks - entry->dblocks);
+    entry->bytes = bytes;
+    entry->dblocks = dblocks;
+}
+
+void subtree_set_dblocks(filesystem_t *fs, inode_t *dir, size_t dblocks)
+{
+    if (!fs->subtrees) return;
+    struct subtree *entry = &fs->subtrees[dir - fs->inodes];
+    propagate(fs, dir - fs->inodes, 0, 0, 0, dblocks - entry->dblocks);
+    entry->dblocks = dblocks;
+}
+
+void subtree_add_dblocks(filesystem_t *fs, inode_t *dir, size_t dblocks)
+{
+    if (!fs->subtrees) return;
+    fs->subtrees[dir - fs->inodes].dblocks += dblocks;
+    propagate(fs, dir - fs->inodes, 0, 0, 0, dblocks);
+}
+
+void subtree_link(filesystem_t *fs, inode_t *dir, inode_t *inode)
+{
+    if (!fs->subtrees) return;
+    struct subtree *entry = &fs->subtrees[inode - fs->inodes];
+    entry->parent = (uint64_t) (dir - fs->inodes) + 1;
+    propagate(fs, dir - fs->inodes, entry->total_files, entry->total_directories, entry->total_bytes, entry->total_dblocks);
+}
+
+void subtree_unlink(filesystem_t *fs, inode_t *inode)
+{
+    if (!fs->subtrees) return;
+    struct subtree *entry = &fs->subtrees[inode - fs->inodes];
+    if (entry->parent == 0) return;
+    propagate(fs, entry->parent - 1, -entry->total_files, -entry->total_directories, -entry->total_bytes, -entry->total_dblocks);
+    entry->parent = 0;
+}
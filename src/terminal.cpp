@@ -1,8 +1,11 @@
 #include <iostream>
 #include <string>
+#include <fstream>
 #include <vector>
 #include <cstring>
 #include <memory>
+#include <algorithm>
+#include <iterator>
 
 /**
  * !! DO NOT MODIFY THIS FILE !!
@@ -12,6 +15,9 @@ extern "C"
 {
     #include "filesys.h"
     #include "debug.h"
+    #include "compress.h"
+    #include "checksum.h"
+    #include "subtree.h"
 }
 
 template<typename CharT>
@@ -237,17 +243,18 @@ struct new_fs_command
         using namespace std::string_view_literals;
         if (args[0].compare("new"sv) != 0) return false;
 
-        if (args.size() != 3)
+        if (args.size() < 3 || args.size() > 4)
         {
             puts("Incorrect number of arguments for new.");
             return true;
         }
 
-        size_t inode_count, dblock_count; 
+        size_t inode_count, dblock_count, block_size = DEFAULT_DATA_BLOCK_SIZE; 
         try
         {
             inode_count = std::stoul(std::string{ args[1] });
             dblock_count = std::stoul(std::string{ args[2] });
+            if (args.size() == 4) block_size = std::stoul(std::string{ args[3] });
         }
         catch (std::invalid_argument&)
         {
@@ -255,16 +262,24 @@ struct new_fs_command
             return true;
         }
         
+        filesystem_t created;
+        fs_retcode_t ret = new_filesystem_geometry(&created, inode_count, dblock_count, block_size);
+        if (ret != SUCCESS)
+        {
+            REPORT_RETCODE(ret);
+            return true;
+        }
+
         free_filesystem(&fs_env::instance().get());
-        new_filesystem(&fs_env::instance().get(), inode_count, dblock_count);
+        fs_env::instance().get() = created;
         new_terminal(&fs_env::instance().get(), &terminal_env::instance().get());
         return true;
     }  
 };
 
 const char * const new_fs_command::help_messages[help_message_len] = {
-    "new num_of_inodes num_of_dblocks",
-    "\tCreates a new empty file system with `num_of_inodes` inodes and `num_of_dblocks` dblocks."
+    "new num_of_inodes num_of_dblocks [block_size]",
+    "\tCreates a new empty file system with `num_of_inodes` inodes and `num_of_dblocks` dblocks of `block_size` bytes (64 by default)."
 };
 
 struct display_fs_command
@@ -313,9 +328,35 @@ const char * const available_command::help_messages[help_message_len] = {
     "\tDisplays the number of available inodes and dblocks in the file system."
 };
 
+struct stats_command
+{
+    static constexpr std::size_t help_message_len = 2;
+    static const char* const help_messages[help_message_len];
+
+    static bool exec(const std::vector<std::string_view>& args)
+    {
+        using namespace std::string_view_literals;
+        if (args[0].compare("stats"sv) != 0) return false;
+
+        dentry_cache_stats_t stats;
+        fs_dentry_cache_stats(&fs_env::instance().get(), &stats);
+        size_t lookups = stats.hits + stats.misses;
+        double ratio = lookups ? 100.0 * static_cast<double>(stats.hits) / static_cast<double>(lookups) : 0.0;
+        printf("Dentry cache: %zu lookups, %zu hits (%zu negative), %zu misses, %.2f%% hit ratio\n",
+            lookups, stats.hits, stats.negative_hits, stats.misses, ratio);
+        printf("Dentry cache: %zu invalidations\n", stats.invalidations);
+        return true;
+    } 
+};
+
+const char * const stats_command::help_messages[help_message_len] = {
+    "stats",
+    "\tDisplays the hit ratio of the dentry cache used by path lookups."
+};
+
 struct ls_command
 {
-    static constexpr std::size_t help_message_len = 3;
+    static constexpr std::size_t help_message_len = 4;
     static const char* const help_messages[help_message_len];
 
     static bool exec(const std::vector<std::string_view>& args)
@@ -339,7 +380,8 @@ struct ls_command
 const char * const ls_command::help_messages[help_message_len] = {
     "ls path",
     "\tIf the file at path is a directory, display the content of the directory.",
-    "\tIf the file at path is a data file, display the file entry."
+    "\tIf the file at path is a data file, display the file entry.",
+    "\tIf the last name of path holds `*` or `?`, display the entries matching it."
 };
 
 struct tree_command
@@ -371,6 +413,107 @@ const char * const tree_command::help_messages[help_message_len] = {
     "\tIf the file at path is a data file, display the tree representation starting from the file."
 };
 
+struct du_command
+{
+    static constexpr std::size_t help_message_len = 3;
+    static const char* const help_messages[help_message_len];
+
+    static bool exec(const std::vector<std::string_view>& args)
+    {
+        using namespace std::string_view_literals;
+        if (args[0].compare("du"sv) != 0) return false;
+
+        if (args.size() > 2)
+        {
+            puts("Incorrect number of arguments for du.");
+            return true;
+        }
+
+        du_report_t report;
+        std::string path{ args.size() == 1 ? "."sv : args[1] };
+        if (fs_du(&terminal_env::instance().get(), path.data(), &report) != 0) return true;
+        printf("%lu bytes in %lu dblocks, %lu files and %lu directories\n", report.bytes, report.dblocks, report.files, report.directories);
+
+        return true;
+    }
+};
+
+const char * const du_command::help_messages[help_message_len] = {
+    "du [path]",
+    "\tDisplays the bytes and dblocks taken by the file or directory at path and everything below it.",
+    "\tThe directories are read in parallel, unless subtree totals are kept (see `totals`)."
+};
+
+struct totals_command
+{
+    static constexpr std::size_t help_message_len = 3;
+    static const char* const help_messages[help_message_len];
+
+    static bool exec(const std::vector<std::string_view>& args)
+    {
+        using namespace std::string_view_literals;
+        if (args[0].compare("totals"sv) != 0) return false;
+
+        if (args.size() != 2)
+        {
+            puts("Incorrect number of arguments for totals.");
+            return true;
+        }
+
+        filesystem_t& fs = fs_env::instance().get();
+        if (args[1].compare("on"sv) == 0)
+        {
+            fs_retcode_t ret = fs_enable_subtree_totals(&fs);
+            if (ret != SUCCESS) REPORT_RETCODE(ret);
+        }
+        else if (args[1].compare("off"sv) == 0)
+        {
+            fs_disable_subtree_totals(&fs);
+        }
+        else
+        {
+            puts("Argument must be on or off.");
+        }
+
+        return true;
+    }
+};
+
+const char * const totals_command::help_messages[help_message_len] = {
+    "totals on|off",
+    "\tEnables or disables the totals kept for every directory. Enabling walks the whole tree once.",
+    "\tWhile they are kept, every change updates the directories above it and `du` answers at once."
+};
+
+struct find_command
+{
+    static constexpr std::size_t help_message_len = 3;
+    static const char* const help_messages[help_message_len];
+
+    static bool exec(const std::vector<std::string_view>& args)
+    {
+        using namespace std::string_view_literals;
+        if (args[0].compare("find"sv) != 0) return false;
+
+        if (args.size() < 2 || args.size() > 3)
+        {
+            puts("Incorrect number of arguments for find.");
+            return true;
+        }
+
+        std::string pattern{ args.size() == 3 ? args[2] : ""sv };
+        fs_find(&terminal_env::instance().get(), std::string{ args[1] }.data(), args.size() == 3 ? pattern.data() : NULL);
+
+        return true;
+    }
+};
+
+const char * const find_command::help_messages[help_message_len] = {
+    "find path [pattern]",
+    "\tDisplays the path of every object below the directory at path whose name matches pattern,",
+    "\twhere `*` stands for any run of characters and `?` for any one character. The directories are read in parallel."
+};
+
 struct new_file_command
 {
     static constexpr std::size_t help_message_len = 3;
@@ -414,7 +557,7 @@ const char * const new_file_command::help_messages[help_message_len] = {
 
 struct new_directory_command
 {
-    static constexpr std::size_t help_message_len = 2;
+    static constexpr std::size_t help_message_len = 4;
     static const char* const help_messages[help_message_len];
 
     static bool exec(const std::vector<std::string_view>& args)
@@ -422,22 +565,83 @@ struct new_directory_command
         using namespace std::string_view_literals;
         if (args[0].compare("newdir"sv) != 0) return false;
 
-        if (args.size() != 2)
+        bool parents = args.size() == 3 && args[1].compare("-p"sv) == 0;
+        if (args.size() != 2 && !parents)
         {
             puts("Incorrect number of arguments for newdir.");
             return true;
         }
 
-        std::string filename{ args[1] };
+        std::string filename{ args.back() };
 
-        new_directory(&terminal_env::instance().get(), filename.data());
+        if (parents) fs_make_directories(&terminal_env::instance().get(), filename.data());
+        else new_directory(&terminal_env::instance().get(), filename.data());
         return true;
     }
 };
 
 const char * const new_directory_command::help_messages[help_message_len] = {
-    "newfile path_to_new_file perms",
-    "\tCreates a new empty data file at the location `path_to_new_file` with permissions `perms`."
+    "newdir [-p] path_to_new_directory",
+    "\tCreates a new empty directory at the location `path_to_new_directory`.",
+    "\tWith `-p`, the missing directories on the way are created too and an existing",
+    "\tdirectory is not an error."
+};
+
+struct import_manifest_command
+{
+    static constexpr std::size_t help_message_len = 4;
+    static const char* const help_messages[help_message_len];
+
+    static bool exec(const std::vector<std::string_view>& args)
+    {
+        using namespace std::string_view_literals;
+        if (args[0].compare("import-manifest"sv) != 0) return false;
+
+        if (args.size() != 3)
+        {
+            puts("Incorrect number of arguments for import-manifest.");
+            return true;
+        }
+
+        size_t perms;
+        try
+        {
+            perms = std::stoul(std::string{ args[2] });
+        }
+        catch (std::invalid_argument&)
+        {
+            puts("Argument for the permission is not valid.");
+            return true;
+        }
+
+        std::string file_name{ args[1] };
+        std::ifstream manifest{ file_name };
+        if (!manifest)
+        {
+            printf("File with name %s does not exist.\n", file_name.data());
+            return true;
+        }
+
+        std::vector<std::string> lines;
+        for (std::string line; std::getline(manifest, line); )
+        {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (!line.empty()) lines.push_back(std::move(line));
+        }
+        std::vector<char*> paths;
+        paths.reserve(lines.size());
+        for (std::string& line : lines) paths.push_back(line.data());
+
+        fs_import_manifest(&terminal_env::instance().get(), paths.data(), paths.size(), (permission_t) perms);
+        return true;
+    }
+};
+
+const char * const import_manifest_command::help_messages[help_message_len] = {
+    "import-manifest path_to_manifest perms",
+    "\tCreates every path listed in the file `path_to_manifest`, one per line, with the directories on the way.",
+    "\tA path ending with `/` is a directory, any other path an empty data file with permissions `perms`.",
+    "\t`perms` is the decimal integer value of the permission bitmask. READ = 1 / WRITE = 2 / EXECUTE = 4."
 };
 
 struct remove_file_command
@@ -496,6 +700,37 @@ const char * const remove_dir_command::help_messages[help_message_len] = {
     "\tDeletes a directory at the location `path_to_file`."
 };
 
+struct rm_command
+{
+    static constexpr std::size_t help_message_len = 3;
+    static const char* const help_messages[help_message_len];
+
+    static bool exec(const std::vector<std::string_view>& args)
+    {
+        using namespace std::string_view_literals;
+        if (args[0].compare("rm"sv) != 0) return false;
+
+        bool recursive = args.size() == 3 && args[1].compare("-r"sv) == 0;
+        if (args.size() != 2 && !recursive)
+        {
+            puts("Incorrect number of arguments for rm.");
+            return true;
+        }
+
+        std::string filename{ args.back() };
+
+        if (recursive) remove_tree(&terminal_env::instance().get(), filename.data());
+        else remove_file(&terminal_env::instance().get(), filename.data());
+        return true;
+    }
+};
+
+const char * const rm_command::help_messages[help_message_len] = {
+    "rm [-r] path_to_file",
+    "\tDeletes a data file at the location `path_to_file`.",
+    "\tWith `-r`, a directory is deleted too, along with everything below it."
+};
+
 struct cd_command
 {
     static constexpr std::size_t help_message_len = 2;
@@ -582,7 +817,7 @@ struct cat_command
         fs_file_t f = fs_open(&terminal_env::instance().get(), filename.data());
         if (!f) return true;
 
-        size_t file_sz = f->inode->internal.file_size;
+        size_t file_sz = inode_data_size(f->fs, f->inode);
         std::unique_ptr<char[]> buf{ new char[file_sz + 1]{ 0 } };
         fs_read(f, buf.get(), file_sz);
         fs_close(f);
@@ -598,6 +833,122 @@ const char * const cat_command::help_messages[help_message_len] = {
     "\tPrints the data in the data file at `path_to_file` to the terminal."
 };
 
+struct cp_command
+{
+    static constexpr std::size_t help_message_len = 3;
+    static const char* const help_messages[help_message_len];
+
+    static bool exec(const std::vector<std::string_view>& args)
+    {
+        using namespace std::string_view_literals;
+        if (args[0].compare("cp"sv) != 0) return false;
+
+        if (args.size() != 3)
+        {
+            puts("Incorrect number of arguments for cp.");
+            return true;
+        }
+
+        std::string src{ args[1] };
+        std::string dst{ args[2] };
+
+        fs_copy(&terminal_env::instance().get(), src.data(), dst.data());
+        return true;
+    }
+};
+
+const char * const cp_command::help_messages[help_message_len] = {
+    "cp path_to_file path_to_new_file",
+    "\tCopies the data file at `path_to_file` to a new data file at `path_to_new_file`.",
+    "\tThe data is copied between dblocks inside the file system without a buffer."
+};
+
+struct mv_command
+{
+    static constexpr std::size_t help_message_len = 3;
+    static const char* const help_messages[help_message_len];
+
+    static bool exec(const std::vector<std::string_view>& args)
+    {
+        using namespace std::string_view_literals;
+        if (args[0].compare("mv"sv) != 0) return false;
+
+        if (args.size() != 3)
+        {
+            puts("Incorrect number of arguments for mv.");
+            return true;
+        }
+
+        std::string old_path{ args[1] };
+        std::string new_path{ args[2] };
+
+        fs_rename(&terminal_env::instance().get(), old_path.data(), new_path.data());
+        return true;
+    }
+};
+
+const char * const mv_command::help_messages[help_message_len] = {
+    "mv path_to_object new_path",
+    "\tMoves or renames the file or directory at `path_to_object` to `new_path`.",
+    "\tOnly directory entries are changed, the data of the object stays where it is."
+};
+
+struct compact_command
+{
+    static constexpr std::size_t help_message_len = 3;
+    static const char* const help_messages[help_message_len];
+
+    static bool exec(const std::vector<std::string_view>& args)
+    {
+        using namespace std::string_view_literals;
+        if (args[0].compare("compact"sv) != 0) return false;
+
+        if (args.size() > 2)
+        {
+            puts("Incorrect number of arguments for compact.");
+            return true;
+        }
+
+        if (args.size() == 1) fs_compact(&terminal_env::instance().get(), std::string{ "." }.data());
+        else fs_compact(&terminal_env::instance().get(), std::string{ args[1] }.data());
+        return true;
+    }
+};
+
+const char * const compact_command::help_messages[help_message_len] = {
+    "compact path",
+    "\tDrops the tombstones of the directory at path, or the working directory, and moves",
+    "\tits entries to the front so it can give back dblocks."
+};
+
+struct sortdir_command
+{
+    static constexpr std::size_t help_message_len = 3;
+    static const char* const help_messages[help_message_len];
+
+    static bool exec(const std::vector<std::string_view>& args)
+    {
+        using namespace std::string_view_literals;
+        if (args[0].compare("sortdir"sv) != 0) return false;
+
+        if (args.size() > 2)
+        {
+            puts("Incorrect number of arguments for sortdir.");
+            return true;
+        }
+
+        if (args.size() == 1) fs_sort_directory(&terminal_env::instance().get(), std::string{ "." }.data());
+        else fs_sort_directory(&terminal_env::instance().get(), std::string{ args[1] }.data());
+        return true;
+    }
+};
+
+const char * const sortdir_command::help_messages[help_message_len] = {
+    "sortdir path",
+    "\tStores the directory at path, or the working directory, as a B+tree sorted by name.",
+    "\tLookups read O(log n) dblocks and ls shows the entries in name order."
+};
+
 struct dump_command
 {
     static constexpr std::size_t help_message_len = 2;
@@ -632,12 +983,7 @@ struct dump_command
             return true;
         }
 
-        std::unique_ptr<char[]> buf{ new char[count] };
-        for (size_t i = 0; i < count; ++i)
-        {
-            buf[i] = MARKER;
-        }
-        int ret = fs_write(f, buf.get(), count);
+        size_t ret = fs_fill(f, &MARKER, 1, count);
         if (ret == 0 && count != 0) puts("Error: dump failed.");
 
         fs_close(f);
@@ -689,12 +1035,8 @@ struct patch_command
         }
 
         fs_seek(f, FS_SEEK_START, offset);
-        std::unique_ptr<char[]> buf{ new char[n] };
-        for (size_t i = 0; i < n; ++i)
-        {
-            buf[i] = static_cast<char>(value);
-        }
-        int ret = fs_write(f, buf.get(), n);
+        char byte_value = static_cast<char>(value);
+        size_t ret = fs_fill(f, &byte_value, 1, n);
         if (ret == 0 && n != 0) puts("Error: patch failed.");
         fs_close(f);
 
@@ -707,6 +1049,186 @@ const char * const patch_command::help_messages[help_message_len] = {
     "\tDumps the `num_of_bytes` bytes of the value `value` into in the data file at `path_to_file` starting at offset `offset`."
 };
 
+struct compress_command
+{
+    static constexpr std::size_t help_message_len = 3;
+    static const char* const help_messages[help_message_len];
+
+    static bool exec(const std::vector<std::string_view>& args)
+    {
+        using namespace std::string_view_literals;
+        if (args[0].compare("compress"sv) != 0) return false;
+
+        if (args.size() != 2)
+        {
+            puts("Incorrect number of arguments for compress.");
+            return true;
+        }
+
+        std::string filename{ args[1] };
+
+        fs_file_t f = fs_open(&terminal_env::instance().get(), filename.data());
+        if (!f) return true;
+
+        fs_retcode_t ret = inode_compress_data(f->fs, f->inode);
+        if (ret != SUCCESS) REPORT_RETCODE(ret);
+        fs_close(f);
+
+        return true;
+    }
+};
+
+const char * const compress_command::help_messages[help_message_len] = {
+    "compress path_to_file",
+    "\tStores the data file at `path_to_file` as a compressed stream. Reads decompress on demand.",
+    "\tThe file is left as is if compression would not free any dblock."
+};
+
+struct decompress_command
+{
+    static constexpr std::size_t help_message_len = 2;
+    static const char* const help_messages[help_message_len];
+
+    static bool exec(const std::vector<std::string_view>& args)
+    {
+        using namespace std::string_view_literals;
+        if (args[0].compare("decompress"sv) != 0) return false;
+
+        if (args.size() != 2)
+        {
+            puts("Incorrect number of arguments for decompress.");
+            return true;
+        }
+
+        std::string filename{ args[1] };
+
+        fs_file_t f = fs_open(&terminal_env::instance().get(), filename.data());
+        if (!f) return true;
+
+        fs_retcode_t ret = inode_decompress_data(f->fs, f->inode);
+        if (ret != SUCCESS) REPORT_RETCODE(ret);
+        fs_close(f);
+
+        return true;
+    }
+};
+
+const char * const decompress_command::help_messages[help_message_len] = {
+    "decompress path_to_file",
+    "\tStores the compressed data file at `path_to_file` as raw dblocks again."
+};
+
+struct checksum_command
+{
+    static constexpr std::size_t help_message_len = 3;
+    static const char* const help_messages[help_message_len];
+
+    static bool exec(const std::vector<std::string_view>& args)
+    {
+        using namespace std::string_view_literals;
+        if (args[0].compare("checksum"sv) != 0) return false;
+
+        if (args.size() != 2)
+        {
+            puts("Incorrect number of arguments for checksum.");
+            return true;
+        }
+
+        filesystem_t& fs = fs_env::instance().get();
+        if (args[1].compare("on"sv) == 0)
+        {
+            fs_retcode_t ret = fs_enable_checksums(&fs);
+            if (ret != SUCCESS) REPORT_RETCODE(ret);
+        }
+        else if (args[1].compare("off"sv) == 0)
+        {
+            fs_disable_checksums(&fs);
+        }
+        else
+        {
+            puts("Argument must be on or off.");
+        }
+
+        return true;
+    }
+};
+
+const char * const checksum_command::help_messages[help_message_len] = {
+    "checksum on|off",
+    "\tEnables or disables per dblock CRC32C checksums. Enabling computes the checksum of every dblock.",
+    "\tReads fail with a checksum mismatch when a dblock they touch is corrupted."
+};
+
+struct scrub_command
+{
+    static constexpr std::size_t help_message_len = 3;
+    static const char* const help_messages[help_message_len];
+
+    static bool exec(const std::vector<std::string_view>& args)
+    {
+        using namespace std::string_view_literals;
+        if (args[0].compare("scrub"sv) != 0) return false;
+
+        if (args.size() > 2)
+        {
+            puts("Incorrect number of arguments for scrub.");
+            return true;
+        }
+
+        size_t thread_count = 0;
+        if (args.size() == 2)
+        {
+            try
+            {
+                thread_count = std::stoul(std::string{ args[1] });
+            }
+            catch (std::invalid_argument&)
+            {
+                puts("Argument is not an integer.");
+                return true;
+            }
+        }
+
+        filesystem_t& fs = fs_env::instance().get();
+        if (!fs.dblock_checksums)
+        {
+            puts("Checksums are disabled. Run `checksum on` first.");
+            return true;
+        }
+
+        scrub_report_t report;
+        fs_retcode_t ret = fs_scrub(&fs, thread_count, &report);
+        if (ret != SUCCESS)
+        {
+            REPORT_RETCODE(ret);
+            return true;
+        }
+
+        double mib = static_cast<double>(report.dblocks_checked) * DATA_BLOCK_SIZE(&fs) / (1024.0 * 1024.0);
+        double gbps = report.seconds > 0 ? static_cast<double>(report.dblocks_checked) * DATA_BLOCK_SIZE(&fs) / report.seconds / 1e9 : 0.0;
+        printf("Scrubbed %lu dblocks (%.2f MiB) in %.3f ms, %.2f GB/s\n",
+            report.dblocks_checked, mib, report.seconds * 1e3, gbps);
+
+        if (report.mismatch_count == 0)
+        {
+            puts("No checksum mismatches.");
+            return true;
+        }
+        printf("%lu checksum mismatches:", report.mismatch_count);
+        size_t shown = std::min(report.mismatch_count, std::size(report.mismatches));
+        for (size_t i = 0; i < shown; ++i) printf(" %u", report.mismatches[i]);
+        puts(report.mismatch_count > shown ? " ..." : "");
+
+        return true;
+    }
+};
+
+const char * const scrub_command::help_messages[help_message_len] = {
+    "scrub [num_of_threads]",
+    "\tVerifies every allocated dblock against its checksum and reports the mismatching dblocks.",
+    "\tUses every online cpu unless `num_of_threads` is given."
+};
+
 template<typename Command>
 void display_command()
 {
@@ -804,17 +1326,31 @@ int main(int argc, char *argv[])
             new_fs_command,
             display_fs_command,
             available_command,
+            stats_command,
             ls_command,
             tree_command,
+            du_command,
+            totals_command,
+            find_command,
             new_file_command,
             new_directory_command,
+            import_manifest_command,
             remove_file_command,
             remove_dir_command,
+            rm_command,
             cd_command,
             write_command,
             cat_command,
+            cp_command,
+            mv_command,
+            compact_command,
+            sortdir_command,
             dump_command,
-            patch_command
+            patch_command,
+            compress_command,
+            decompress_command,
+            checksum_command,
+            scrub_command
         >{}.start();
     }
     else
@@ -825,16 +1361,30 @@ int main(int argc, char *argv[])
             new_fs_command,
             display_fs_command,
             available_command,
+            stats_command,
             ls_command,
             tree_command,
+            du_command,
+            totals_command,
+            find_command,
             new_file_command,
             new_directory_command,
+            import_manifest_command,
             remove_file_command,
             remove_dir_command,
+            rm_command,
             cd_command,
             cat_command,
+            cp_command,
+            mv_command,
+            compact_command,
+            sortdir_command,
             dump_command,
-            patch_command
+            patch_command,
+            compress_command,
+            decompress_command,
+            checksum_command,
+            scrub_command
         >{ argv[1] }.start();
     }
 
@@ -0,0 +1,221 @@
+#include "filesys.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include "traverse.h"
+
+#define TRAVERSE_DEQUE_MIN 64     // capacity of a deque when its first directory comes in
+#define TRAVERSE_SPAWN_BACKLOG 16 // queued directories that make the first worker start the others
+
+// the directories a worker holds. the owner pushes and pops at the back, thieves take from
+// the front. `front` and `back` only grow, position p is kept in slot p % capacity
+struct traverse_deque
+{
+    pthread_mutex_t lock;
+    inode_index_t *items;
+    size_t capacity; // 0 or a power of two
+    size_t front;
+    size_t back;
+};
+
+struct traverse_worker
+{
+    struct traversal *traversal;
+    size_t id;
+    struct traverse_deque deque;
+};
+
+struct traversal
+{
+    filesystem_t *fs;
+    traverse_visit_t visit;
+    void *arg;
+    size_t thread_count;
+    atomic_uchar *queued;  // whether each inode has been queued
+    atomic_size_t pending; // directories queued and not visited yet
+    atomic_int failed;
+    int spawned;           // whether the first worker started the others
+    size_t started;        // workers started besides the first one
+    pthread_t threads[TRAVERSE_MAX_THREADS];
+    struct traverse_worker workers[TRAVERSE_MAX_THREADS];
+};
+
+// ----------------------- DEQUES ----------------------- //
+
+// doubles the capacity of a full deque. the caller holds its lock
+static int deque_grow(struct traverse_deque *deque)
+{
+    size_t capacity = deque->capacity ? 2 * deque->capacity : TRAVERSE_DEQUE_MIN;
+    inode_index_t *items = malloc(capacity * sizeof(inode_index_t));
+    if (!items) return 0;
+    for (size_t p = deque->front; p < deque->back; ++p) items[p % capacity] = deque->items[p % deque->capacity];
+    free(deque->items);
+    deque->items = items;
+    deque->capacity = capacity;
+    return 1;
+}
+
+// takes the newest directory of the deque of the worker itself
+static int deque_pop(struct traverse_deque *deque, inode_index_t *dir)
+{
+    pthread_mutex_lock(&deque->lock);
+    int found = deque->back > deque->front;
+    if (found) *dir = deque->items[--deque->back % deque->capacity];
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+// takes the oldest directory of the deque of another worker. the oldest directories are
+// the closest to the top, so they tend to carry the most work with them
+static int deque_steal(struct traverse_deque *deque, inode_index_t *dir)
+{
+    pthread_mutex_lock(&deque->lock);
+    int found = deque->back > deque->front;
+    if (found) *dir = deque->items[deque->front++ % deque->capacity];
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+// ----------------------- WORKERS ----------------------- //
+
+void traverse_push(traverse_worker_t *worker, inode_index_t dir)
+{
+    struct traversal *traversal = worker->traversal;
+    if (dir >= traversal->fs->inode_count) return;
+    if (atomic_exchange(&traversal->queued[dir], 1)) return;
+
+    // counted before a thief can see it, so the count never drops to 0 while work is left
+    atomic_fetch_add(&traversal->pending, 1);
+    struct traverse_deque *deque = &worker->deque;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->back - deque->front == deque->capacity && !deque_grow(deque))
+    {
+        pthread_mutex_unlock(&deque->lock);
+        atomic_fetch_sub(&traversal->pending, 1);
+        traverse_fail(worker);
+        return;
+    }
+    deque->items[deque->back++ % deque->capacity] = dir;
+    pthread_mutex_unlock(&deque->lock);
+}
+
+void traverse_fail(traverse_worker_t *worker)
+{
+    atomic_store(&worker->traversal->failed, 1);
+}
+
+size_t traverse_worker_id(const traverse_worker_t *worker)
+{
+    return worker->id;
+}
+
+size_t traverse_thread_count(size_t thread_count)
+{
+    if (thread_count == 0)
+    {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        thread_count = online > 0 ? (size_t) online : 1;
+    }
+    return thread_count > TRAVERSE_MAX_THREADS ? TRAVERSE_MAX_THREADS : thread_count;
+}
+
+// tries the other workers in turn, starting with the next one
+static int steal(struct traverse_worker *worker, inode_index_t *dir)
+{
+    struct traversal *traversal = worker->traversal;
+    for (size_t k = 1; k < traversal->thread_count; ++k)
+    {
+        struct traverse_worker *victim = &traversal->workers[(worker->id + k) % traversal->thread_count];
+        if (deque_steal(&victim->deque, dir)) return 1;
+    }
+    return 0;
+}
+
+static void *worker_main(void *arg);
+
+// a worker that could not be started keeps an empty deque and the others do its share
+static void spawn_workers(struct traversal *traversal)
+{
+    traversal->spawned = 1;
+    for (size_t t = 1; t < traversal->thread_count; ++t)
+    {
+        if (pthread_create(&traversal->threads[t], NULL, worker_main, &traversal->workers[t]) != 0) break;
+        ++traversal->started;
+    }
+}
+
+// visits directories until every queued one is visited
+static void work(struct traverse_worker *worker)
+{
+    struct traversal *traversal = worker->traversal;
+    for (;;)
+    {
+        inode_index_t dir;
+        if (deque_pop(&worker->deque, &dir) || steal(worker, &dir))
+        {
+            traversal->visit(worker, dir, traversal->arg);
+            atomic_fetch_sub(&traversal->pending, 1);
+            if (worker->id == 0 && !traversal->spawned && traversal->thread_count > 1
+                && atomic_load(&traversal->pending) >= TRAVERSE_SPAWN_BACKLOG) spawn_workers(traversal);
+            continue;
+        }
+        // the directories being visited may still queue more
+        if (atomic_load(&traversal->pending) == 0) return;
+        sched_yield();
+    }
+}
+
+static void *worker_main(void *arg)
+{
+    work(arg);
+    return NULL;
+}
+
+// ----------------------- TRAVERSAL ----------------------- //
+
+fs_retcode_t fs_traverse(filesystem_t *fs, inode_index_t top, size_t thread_count, traverse_visit_t visit, void *arg)
+{
+    if (!fs || !visit || top >= fs->inode_count || fs->inodes[top].internal.file_type != DIRECTORY) return INVALID_INPUT;
+
+    struct traversal *traversal = malloc(sizeof(struct traversal));
+    if (!traversal) return SYSTEM_ERROR;
+    memset(traversal, 0, sizeof(*traversal));
+    traversal->queued = calloc(fs->inode_count, sizeof(atomic_uchar));
+    if (!traversal->queued)
+    {
+        free(traversal);
+        return SYSTEM_ERROR;
+    }
+    traversal->fs = fs;
+    traversal->visit = visit;
+    traversal->arg = arg;
+    traversal->thread_count = traverse_thread_count(thread_count);
+    atomic_init(&traversal->pending, 0);
+    atomic_init(&traversal->failed, 0);
+    for (size_t t = 0; t < traversal->thread_count; ++t)
+    {
+        traversal->workers[t].traversal = traversal;
+        traversal->workers[t].id = t;
+        pthread_mutex_init(&traversal->workers[t].deque.lock, NULL);
+    }
+
+    // the calling thread is the first worker
+    traverse_push(&traversal->workers[0], top);
+    work(&traversal->workers[0]);
+    for (size_t t = 1; t <= traversal->started; ++t) pthread_join(traversal->threads[t], NULL);
+
+    fs_retcode_t ret = atomic_load(&traversal->failed) ? SYSTEM_ERROR : SUCCESS;
+    for (size_t t = 0; t < traversal->thread_count; ++t)
+    {
+        pthread_mutex_destroy(&traversal->workers[t].deque.lock);
+        free(traversal->workers[t].deque.items);
+    }
+    free(traversal->queued);
+    free(traversal);
+    return ret;
+}
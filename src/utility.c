@@ -1,5 +1,8 @@
 #include "filesys.h"
 #include "utility.h"
+#include "checksum.h"
+#include "subtree.h"
+#include "dir_index.h"
 
 #include <string.h>
 #include <stdlib.h>
@@ -9,9 +12,15 @@
  */
 
 #define DBLOCK_MASK_SIZE(blk_count) (((blk_count) + 7) / (sizeof(byte) * 8))
-#define INDIRECT_DBLOCK_INDEX_COUNT (DATA_BLOCK_SIZE / sizeof(dblock_index_t) - 1)
-#define INDIRECT_DBLOCK_MAX_DATA_SIZE ( DATA_BLOCK_SIZE * INDIRECT_DBLOCK_INDEX_COUNT )
-#define NEXT_INDIRECT_INDEX_OFFSET (DATA_BLOCK_SIZE - sizeof(dblock_index_t))
+#define GEOMETRY_MAGIC "GEOMETRY"
+#define GEOMETRY_MAGIC_LEN 8
+_Static_assert(GEOMETRY_MAGIC_LEN == sizeof(size_t), "the geometry magic must have the size of the inode count");
+#if SUBTREE_TRAILER_MAGIC_LEN != CHECKSUM_TRAILER_MAGIC_LEN || DIR_INDEX_TRAILER_MAGIC_LEN != CHECKSUM_TRAILER_MAGIC_LEN
+#error "trailer magics must have the same length"
+#endif
+#define WIDE_FORMAT_MAGIC "FSWIDE32"
+#define WIDE_FORMAT_MAGIC_LEN 8
+_Static_assert(WIDE_FORMAT_MAGIC_LEN == sizeof(size_t), "the wide format magic must have the size of the inode count");
 #define DBLOCK_DISPLAY_LEN 16
 
 const char *fs_retcode_string_table[FS_RETCODE_TOTAL] = {
@@ -32,7 +41,8 @@ const char *fs_retcode_string_table[FS_RETCODE_TOTAL] = {
     "File already exists",
     "Directory already exists",
     "Cannot delete current working directory",
-    "Function not implemented"
+    "Function not implemented",
+    "Checksum mismatch in dblock"
 };
 
 // -------------------------------- HELPER FUNCTIONS -------------------------------- //
@@ -54,7 +64,7 @@ static void extract_filename(inode_t *inode, char *buffer)
 static void display_direct_dblock_indices(filesystem_t *fs, inode_t *node)
 {
     size_t file_size = node->internal.file_size;
-    size_t dblocks_needed = (file_size + DATA_BLOCK_SIZE - 1) / DATA_BLOCK_SIZE;
+    size_t dblocks_needed = (file_size + DATA_BLOCK_SIZE(fs) - 1) / DATA_BLOCK_SIZE(fs);
     
     size_t direct_dblocks_used = dblocks_needed < INODE_DIRECT_BLOCK_COUNT ? dblocks_needed : INODE_DIRECT_BLOCK_COUNT;
 
@@ -77,7 +87,7 @@ static void set_inode_mask(filesystem_t *fs, byte *mask)
 static void display_indirect_dblock_indices(filesystem_t *fs, inode_t *node)
 {
     size_t file_size = node->internal.file_size;
-    size_t dblocks_needed = (file_size + DATA_BLOCK_SIZE - 1) / DATA_BLOCK_SIZE;
+    size_t dblocks_needed = (file_size + DATA_BLOCK_SIZE(fs) - 1) / DATA_BLOCK_SIZE(fs);
 
     // since this func is only called if we know there must be indirect data block indices
     size_t indirect_dblocks_needed = dblocks_needed - INODE_DIRECT_BLOCK_COUNT;
@@ -87,16 +97,16 @@ static void display_indirect_dblock_indices(filesystem_t *fs, inode_t *node)
     size_t i = 0;
     while (i < indirect_dblocks_needed)
     {
-        size_t indirect_idx_offset = i % INDIRECT_DBLOCK_INDEX_COUNT;
+        size_t indirect_idx_offset = i % INDIRECT_DBLOCK_INDEX_COUNT(fs);
         // if we have looked through all the indices stored inside of an index block, we update to look at the next index block
         if (i != 0 && indirect_idx_offset == 0)
         {
-            index_blk_idx = *cast_dblock_ptr(&fs->dblocks[ index_blk_idx * DATA_BLOCK_SIZE + NEXT_INDIRECT_INDEX_OFFSET ]);
+            index_blk_idx = *cast_dblock_ptr(&fs->dblocks[ index_blk_idx * DATA_BLOCK_SIZE(fs) + NEXT_INDIRECT_INDEX_OFFSET(fs) ]);
         }
-        // index_blk_idx * DATA_BLOCK_SIZE is the number of bytes into the byte array that data block number index_blk_idx begins
+        // index_blk_idx * DATA_BLOCK_SIZE(fs) is the number of bytes into the byte array that data block number index_blk_idx begins
         // indirect_idx_offset * sizeof(dblock_index_t) is the number of bytes into the data block that the indirect_dblock_index index begins.
         // so, the line below returns the dblock index at index indirect_idx_offset in the index_blk_idx index block.
-        dblock_index_t indirect_dblock_index = *cast_dblock_ptr(&fs->dblocks[ index_blk_idx * DATA_BLOCK_SIZE + indirect_idx_offset * sizeof(dblock_index_t) ]);
+        dblock_index_t indirect_dblock_index = *cast_dblock_ptr(&fs->dblocks[ index_blk_idx * DATA_BLOCK_SIZE(fs) + indirect_idx_offset * sizeof(dblock_index_t) ]);
         printf("%u ", indirect_dblock_index);
         ++i;
     };  
@@ -105,7 +115,7 @@ static void display_indirect_dblock_indices(filesystem_t *fs, inode_t *node)
 static void display_indirect_index_indices(filesystem_t *fs, inode_t *node)
 {
     size_t file_size = node->internal.file_size;
-    size_t dblocks_needed = (file_size + DATA_BLOCK_SIZE - 1) / DATA_BLOCK_SIZE;
+    size_t dblocks_needed = (file_size + DATA_BLOCK_SIZE(fs) - 1) / DATA_BLOCK_SIZE(fs);
 
     // since this func is only called if we know there must be indirect data block indices
     size_t indirect_dblocks_needed = dblocks_needed - INODE_DIRECT_BLOCK_COUNT;
@@ -115,31 +125,31 @@ static void display_indirect_index_indices(filesystem_t *fs, inode_t *node)
     size_t i = 0;
     while (i < indirect_dblocks_needed)
     {
-        size_t indirect_idx_offset = i % INDIRECT_DBLOCK_INDEX_COUNT;
+        size_t indirect_idx_offset = i % INDIRECT_DBLOCK_INDEX_COUNT(fs);
         // if we have looked through all the indices stored inside of an index block, we update to look at the next index block
         if (i != 0 && indirect_idx_offset == 0)
         {
-            index_blk_idx = *cast_dblock_ptr(&fs->dblocks[ index_blk_idx * DATA_BLOCK_SIZE + NEXT_INDIRECT_INDEX_OFFSET ]);
+            index_blk_idx = *cast_dblock_ptr(&fs->dblocks[ index_blk_idx * DATA_BLOCK_SIZE(fs) + NEXT_INDIRECT_INDEX_OFFSET(fs) ]);
         }
         printf("%u ", index_blk_idx);
-        i += INDIRECT_DBLOCK_INDEX_COUNT;
+        i += INDIRECT_DBLOCK_INDEX_COUNT(fs);
     };  
 }
 
 // -------------------------------- CORE FUNCTIONS -------------------------------- //
 
 // calculates the number of index dblocks used for a file size
-size_t calculate_index_dblock_amount(size_t file_size)
+size_t calculate_index_dblock_amount(const filesystem_t *fs, size_t file_size)
 {
-    if (file_size < DATA_BLOCK_SIZE * INODE_DIRECT_BLOCK_COUNT) return 0;
-    return (file_size - DATA_BLOCK_SIZE * INODE_DIRECT_BLOCK_COUNT + INDIRECT_DBLOCK_MAX_DATA_SIZE - 1) / INDIRECT_DBLOCK_MAX_DATA_SIZE; 
+    if (file_size < DATA_BLOCK_SIZE(fs) * INODE_DIRECT_BLOCK_COUNT) return 0;
+    return (file_size - DATA_BLOCK_SIZE(fs) * INODE_DIRECT_BLOCK_COUNT + INDIRECT_DBLOCK_MAX_DATA_SIZE(fs) - 1) / INDIRECT_DBLOCK_MAX_DATA_SIZE(fs); 
 }
 
 // calculates the number of dblocks necessary for a file_size
 // includes all data dblocks and index_dblocks
-size_t calculate_necessary_dblock_amount(size_t file_size)
+size_t calculate_necessary_dblock_amount(const filesystem_t *fs, size_t file_size)
 {
-    return (file_size + DATA_BLOCK_SIZE - 1) / DATA_BLOCK_SIZE + calculate_index_dblock_amount(file_size);
+    return (file_size + DATA_BLOCK_SIZE(fs) - 1) / DATA_BLOCK_SIZE(fs) + calculate_index_dblock_amount(fs, file_size);
 }   
 
 // non UB way to convert byte pointer to dblock_index_t pointer
@@ -157,8 +167,23 @@ fs_retcode_t save_filesystem(FILE* file, filesystem_t *fs)
 {
     if (!fs || !file) return INVALID_INPUT;
 
+    // images with the default geometry carry no tag so they stay readable by every build.
+    // the others are tagged up front like wide images, as their dblocks cannot be read
+    // without it, and builds that do not know the tag take it for a bad inode count
+    if (!DEFAULT_BLOCK_GEOMETRY(fs))
+    {
+        uint32_t geometry[2] = { DATA_BLOCK_SIZE(fs), INODE_DIRECT_BLOCK_COUNT };
+        fwrite(GEOMETRY_MAGIC, sizeof(byte), GEOMETRY_MAGIC_LEN, file);
+        fwrite(geometry, sizeof(uint32_t), 2, file);
+    }
+
+    // wide images are tagged up front so readers of the narrow format reject them before
+    // reading the header
+    if (fs->index_width == WIDE_INODE_INDEX_WIDTH) fwrite(WIDE_FORMAT_MAGIC, sizeof(byte), WIDE_FORMAT_MAGIC_LEN, file);
+
     fwrite(&fs->inode_count, sizeof(fs->inode_count), 1, file); // write the inode count
-    fwrite(&fs->available_inode, sizeof(fs->available_inode), 1, file); // write the next available inode
+    // write the next available inode, in the low bytes of the index for the narrow format
+    fwrite(&fs->available_inode, fs->index_width, 1, file);
     fwrite(&fs->dblock_count, sizeof(fs->dblock_count), 1, file); // write the dblock count
 
     fwrite(fs->inodes, sizeof(inode_t), fs->inode_count, file); // write the inodes to file
@@ -166,33 +191,157 @@ fs_retcode_t save_filesystem(FILE* file, filesystem_t *fs)
     size_t block_bitmask_size = DBLOCK_MASK_SIZE(fs->dblock_count);
     fwrite(fs->dblock_bitmask, sizeof(byte), block_bitmask_size, file); // write the dblock bit masks
 
-    fwrite(fs->dblocks, DATA_BLOCK_SIZE, fs->dblock_count, file); // write the data blocks
+    fwrite(fs->dblocks, DATA_BLOCK_SIZE(fs), fs->dblock_count, file); // write the data blocks
+
+    // the checksum table is an optional trailer so images without it stay readable
+    if (fs->dblock_checksums)
+    {
+        fwrite(CHECKSUM_TRAILER_MAGIC, sizeof(byte), CHECKSUM_TRAILER_MAGIC_LEN, file);
+        fwrite(fs->dblock_checksums, sizeof(uint32_t), fs->dblock_count, file);
+    }
+
+    // so are the subtree totals, which would take a walk of the whole tree to rebuild
+    if (fs->subtrees)
+    {
+        fwrite(SUBTREE_TRAILER_MAGIC, sizeof(byte), SUBTREE_TRAILER_MAGIC_LEN, file);
+        fwrite(fs->subtrees, sizeof(struct subtree), fs->inode_count, file);
+    }
+
+    // and the indexes of large directories, which would take a read of every entry
+    save_dir_indexes(file, fs);
 
     return SUCCESS;
 }
 
+// frees what a failed load allocated and returns `ret`
+static fs_retcode_t load_failed(filesystem_t *fs, fs_retcode_t ret)
+{
+    free_filesystem(fs);
+    fs->inodes = NULL;
+    fs->dblock_bitmask = NULL;
+    fs->dblocks = NULL;
+    return ret;
+}
+
+// whether every entry of a loaded subtree table is linked in a directory of the image. the
+// totals are only followed up these links, so a table failing this is rebuilt
+static int subtrees_valid(filesystem_t *fs)
+{
+    for (size_t i = 0; i < fs->inode_count; ++i)
+    {
+        uint64_t parent = fs->subtrees[i].parent;
+        if (parent == 0) continue;
+        if (parent - 1 >= fs->inode_count || fs->inodes[parent - 1].internal.file_type != DIRECTORY) return 0;
+    }
+    return 1;
+}
+
 fs_retcode_t load_filesystem(FILE* file, filesystem_t *fs)
 {
     if (!fs || !file) return INVALID_INPUT;
-    // read the inode count 
+    fs->inodes = NULL;
+    fs->dblock_bitmask = NULL;
+    fs->dblocks = NULL;
+    fs->chunk_cache = NULL;
+    fs->dblock_checksums = NULL;
+    fs->append_tails = NULL;
+    fs->dblock_search_start = 0;
+    fs->write_buffers = NULL;
+    fs->read_aheads = NULL;
+    fs->read_resumes = NULL;
+    fs->dir_indexes = NULL;
+    fs->dentry_cache = NULL;
+    fs->dir_parents = NULL;
+    fs->path_cache = NULL;
+    fs->read_ahead_blocks = 0;
+    fs->traverse_threads = 0;
+    fs->subtrees = NULL;
+    // read the inode count, which an image of another geometry precedes with its geometry
+    // and a wide image with its magic
     if (fread(&fs->inode_count, sizeof(fs->inode_count), 1, file) != 1) return INVALID_BINARY_FORMAT;
+    fs->block_shift = __builtin_ctzll(DEFAULT_DATA_BLOCK_SIZE);
+    if (memcmp(&fs->inode_count, GEOMETRY_MAGIC, GEOMETRY_MAGIC_LEN) == 0)
+    {
+        uint32_t geometry[2];
+        if (fread(geometry, sizeof(uint32_t), 2, file) != 2) return INVALID_BINARY_FORMAT;
+        // the direct blocks size the inodes, so only their count of this build can be read
+        if (geometry[0] < MIN_DATA_BLOCK_SIZE || geometry[0] > MAX_DATA_BLOCK_SIZE || (geometry[0] & (geometry[0] - 1)) != 0
+            || geometry[1] != INODE_DIRECT_BLOCK_COUNT) return INVALID_BINARY_FORMAT;
+        fs->block_shift = __builtin_ctzll(geometry[0]);
+        if (fread(&fs->inode_count, sizeof(fs->inode_count), 1, file) != 1) return INVALID_BINARY_FORMAT;
+    }
+    // an untagged image was written with the default geometry
+    else if (INODE_DIRECT_BLOCK_COUNT != DEFAULT_INODE_DIRECT_BLOCK_COUNT) return INVALID_BINARY_FORMAT;
+    int is_wide = memcmp(&fs->inode_count, WIDE_FORMAT_MAGIC, WIDE_FORMAT_MAGIC_LEN) == 0;
+    if (is_wide && fread(&fs->inode_count, sizeof(fs->inode_count), 1, file) != 1) return INVALID_BINARY_FORMAT;
+    fs->index_width = is_wide ? WIDE_INODE_INDEX_WIDTH : NARROW_INODE_INDEX_WIDTH;
+    fs->entry_size = fs->index_width + MAX_FILE_NAME_LEN;
+    if (fs->inode_count == 0 || fs->inode_count - 1 > (is_wide ? INODE_INDEX_MAX : NARROW_INODE_INDEX_MAX)) return INVALID_BINARY_FORMAT;
     // read the next available inode
-    if (fread(&fs->available_inode, sizeof(fs->available_inode), 1, file) != 1) return INVALID_BINARY_FORMAT; 
+    fs->available_inode = 0;
+    if (fread(&fs->available_inode, fs->index_width, 1, file) != 1) return INVALID_BINARY_FORMAT; 
     // read the dblock count
     if (fread(&fs->dblock_count, sizeof(fs->dblock_count), 1, file) != 1) return INVALID_BINARY_FORMAT; 
 
     fs->inodes = malloc(fs->inode_count * sizeof(inode_t));
+    if (!fs->inodes) return load_failed(fs, SYSTEM_ERROR);
     // read the inodes
-    if (fread(fs->inodes, sizeof(inode_t), fs->inode_count, file) != fs->inode_count) return INVALID_BINARY_FORMAT; 
+    if (fread(fs->inodes, sizeof(inode_t), fs->inode_count, file) != fs->inode_count) return load_failed(fs, INVALID_BINARY_FORMAT); 
+    // a free inode of a narrow image only holds the next one in its low bytes
+    if (!is_wide)
+    {
+        inode_index_t free_inode = fs->available_inode;
+        for (size_t n = 0; free_inode != 0 && free_inode < fs->inode_count && n < fs->inode_count; ++n)
+        {
+            fs->inodes[free_inode].next_free_inode &= NARROW_INODE_INDEX_MAX;
+            free_inode = fs->inodes[free_inode].next_free_inode;
+        }
+    }
 
     size_t block_bitmask_size = DBLOCK_MASK_SIZE(fs->dblock_count);
     fs->dblock_bitmask = malloc(block_bitmask_size * sizeof(byte));
+    if (!fs->dblock_bitmask) return load_failed(fs, SYSTEM_ERROR);
     // read the data blocks
-    if (fread(fs->dblock_bitmask, sizeof(byte), block_bitmask_size, file) != block_bitmask_size) return INVALID_BINARY_FORMAT; 
+    if (fread(fs->dblock_bitmask, sizeof(byte), block_bitmask_size, file) != block_bitmask_size) return load_failed(fs, INVALID_BINARY_FORMAT); 
 
-    fs->dblocks = malloc(fs->dblock_count * DATA_BLOCK_SIZE);
+    fs->dblocks = malloc(fs->dblock_count * DATA_BLOCK_SIZE(fs));
+    if (!fs->dblocks) return load_failed(fs, SYSTEM_ERROR);
     // read the data blocks
-    if (fread(fs->dblocks, DATA_BLOCK_SIZE, fs->dblock_count, file) != fs->dblock_count) return INVALID_BINARY_FORMAT; 
+    if (fread(fs->dblocks, DATA_BLOCK_SIZE(fs), fs->dblock_count, file) != fs->dblock_count) return load_failed(fs, INVALID_BINARY_FORMAT); 
+
+    // read the optional trailers. their magics have the same length
+    char magic[CHECKSUM_TRAILER_MAGIC_LEN];
+    size_t magic_read;
+    while ((magic_read = fread(magic, sizeof(char), CHECKSUM_TRAILER_MAGIC_LEN, file)) == CHECKSUM_TRAILER_MAGIC_LEN)
+    {
+        if (memcmp(magic, CHECKSUM_TRAILER_MAGIC, CHECKSUM_TRAILER_MAGIC_LEN) == 0 && !fs->dblock_checksums)
+        {
+            fs->dblock_checksums = malloc(fs->dblock_count * sizeof(uint32_t));
+            if (!fs->dblock_checksums) return load_failed(fs, SYSTEM_ERROR);
+            if (fread(fs->dblock_checksums, sizeof(uint32_t), fs->dblock_count, file) != fs->dblock_count) return load_failed(fs, INVALID_BINARY_FORMAT);
+        }
+        else if (memcmp(magic, SUBTREE_TRAILER_MAGIC, SUBTREE_TRAILER_MAGIC_LEN) == 0 && !fs->subtrees)
+        {
+            fs->subtrees = malloc(fs->inode_count * sizeof(struct subtree));
+            if (!fs->subtrees) return load_failed(fs, SYSTEM_ERROR);
+            if (fread(fs->subtrees, sizeof(struct subtree), fs->inode_count, file) != fs->inode_count) return load_failed(fs, INVALID_BINARY_FORMAT);
+        }
+        else if (memcmp(magic, DIR_INDEX_TRAILER_MAGIC, DIR_INDEX_TRAILER_MAGIC_LEN) == 0 && !fs->dir_indexes)
+        {
+            fs_retcode_t ret = load_dir_indexes(file, fs);
+            if (ret != SUCCESS) return load_failed(fs, ret);
+        }
+        else return load_failed(fs, INVALID_BINARY_FORMAT);
+    }
+    if (magic_read != 0) return load_failed(fs, INVALID_BINARY_FORMAT);
+
+    // totals linked to something other than a directory are counted again from the tree
+    if (fs->subtrees && !subtrees_valid(fs))
+    {
+        fs_disable_subtree_totals(fs);
+        fs_retcode_t ret = fs_enable_subtree_totals(fs);
+        if (ret != SUCCESS) return load_failed(fs, ret);
+    }
 
     return SUCCESS;
 }
@@ -257,7 +406,7 @@ void display_filesystem(filesystem_t *fs, fs_display_flag_t flag)
                     display_direct_dblock_indices(fs, inode);
                     puts("");
                     
-                    if (file_size > DATA_BLOCK_SIZE * INODE_DIRECT_BLOCK_COUNT)
+                    if (file_size > DATA_BLOCK_SIZE(fs) * INODE_DIRECT_BLOCK_COUNT)
                     {
                         printf("\t\tIndirect Data Blocks: ");
                         display_indirect_dblock_indices(fs, inode);
@@ -284,10 +433,10 @@ void display_filesystem(filesystem_t *fs, fs_display_flag_t flag)
             if (!(fs->dblock_bitmask[block_idx] & (1 << (7 - bit_idx))))
             {
                 printf("\tdblock index %ld", idx);
-                for (size_t k = 0; k < DATA_BLOCK_SIZE; ++k)
+                for (size_t k = 0; k < DATA_BLOCK_SIZE(fs); ++k)
                 {
                     if (k % DBLOCK_DISPLAY_LEN == 0) printf("\n\t\t");
-                    printf("%02x ", fs->dblocks[idx * DATA_BLOCK_SIZE + k]);
+                    printf("%02x ", fs->dblocks[idx * DATA_BLOCK_SIZE(fs) + k]);
                 }
                 printf("\n");
             }
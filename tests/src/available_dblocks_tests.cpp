@@ -61,4 +61,18 @@ TEST_F(AvailableDBlocksSuite, Test4)
 
     ASSERT_EQ(expected_val, output_val);
     free_filesystem(&fs);
-}
\ No newline at end of file
+}
+// early exit check agrees with the full count
+TEST_F(AvailableDBlocksSuite, HasAvailable0)
+{
+    filesystem_t fs;
+    load_fs(INPUT "medium.bin", fs);
+
+    size_t available = available_dblocks(&fs);
+    ASSERT_FALSE(has_available_dblocks(NULL, 0));
+    ASSERT_TRUE(has_available_dblocks(&fs, 0));
+    ASSERT_TRUE(has_available_dblocks(&fs, available));
+    ASSERT_FALSE(has_available_dblocks(&fs, available + 1));
+
+    free_filesystem(&fs);
+}
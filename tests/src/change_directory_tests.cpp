@@ -206,4 +206,34 @@ TEST_F(ChangeDirectorySuite, ChangeDir2)
     check_stdout(OUTPUT "Empty.txt");
     check_fs(INPUT "medium.bin", fs);
     free_filesystem(&fs);
-}
\ No newline at end of file
+}
+// repeated and trailing slashes are skipped, and the path is left as it was
+TEST_F(ChangeDirectorySuite, ChangeDir3)
+{
+    constexpr size_t inode_index = 0;
+    constexpr const char *path = "a//b/c/";
+
+    constexpr int expected_ret = 0;
+    constexpr size_t expected_inode_index = 3;
+
+    filesystem_t fs;
+    load_fs(INPUT "medium.bin", fs);
+    int ret;
+    std::string buffer{ path };
+
+    terminal_context_t ctx { &fs, &fs.inodes[inode_index] };
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ret = change_directory(&ctx, buffer.data());
+    }   // end stdout logging
+
+    ASSERT_EQ(ret, expected_ret) << "Incorrect return value";
+    ASSERT_EQ(buffer, path) << "The path should not be modified.";
+
+    ASSERT_EQ(ctx.working_directory, &fs.inodes[expected_inode_index]) << "Working directory of terminal_context_t is not correct.";
+
+    check_stdout(OUTPUT "Empty.txt");
+    check_fs(INPUT "medium.bin", fs);
+    free_filesystem(&fs);
+}
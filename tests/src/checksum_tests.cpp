@@ -0,0 +1,151 @@
+#include "test_util.hpp"
+
+#include <vector>
+
+extern "C"
+{
+    #include "checksum.h"
+    #include "utility.h"
+}
+
+using ChecksumSuite = fs_internal_test;
+
+static inode_t *empty_data_file(filesystem_t& fs)
+{
+    inode_index_t index;
+    if (claim_available_inode(&fs, &index) != SUCCESS) return nullptr;
+    inode_t *inode = &fs.inodes[index];
+    memset(inode, 0, sizeof(*inode));
+    inode->internal.file_type = DATA_FILE;
+    inode->internal.file_perms = FS_READ;
+    return inode;
+}
+
+static std::vector<char> pattern(std::size_t size)
+{
+    std::vector<char> data(size);
+    for (std::size_t i = 0; i < size; ++i) data[i] = static_cast<char>('a' + i % 23);
+    return data;
+}
+
+// check the standard CRC32C test vector on every implementation
+TEST_F(ChecksumSuite, Crc32cVector)
+{
+    const char digits[] = "123456789";
+    ASSERT_EQ(crc32c_table(0, digits, 9), 0xE3069283u);
+    ASSERT_EQ(crc32c(0, digits, 9), 0xE3069283u);
+    ASSERT_EQ(crc32c(crc32c(0, digits, 4), digits + 4, 5), 0xE3069283u) << "CRCs must chain across calls.";
+
+    std::vector<char> data = pattern(1000);
+    ASSERT_EQ(crc32c(0, data.data(), data.size()), crc32c_table(0, data.data(), data.size()));
+}
+
+// check for basic invalid inputs
+TEST_F(ChecksumSuite, InvalidInput)
+{
+    filesystem_t fs;
+    new_filesystem(&fs, 1, 8);
+    scrub_report_t report;
+
+    ASSERT_EQ( fs_enable_checksums(NULL), INVALID_INPUT );
+    ASSERT_EQ( fs_scrub(&fs, 1, &report), INVALID_INPUT ) << "Scrubbing requires checksums.";
+    ASSERT_EQ( fs_enable_checksums(&fs), SUCCESS );
+    ASSERT_EQ( fs_scrub(&fs, 1, NULL), INVALID_INPUT );
+    ASSERT_EQ( fs_scrub(NULL, 1, &report), INVALID_INPUT );
+
+    free_filesystem(&fs);
+}
+
+// writes and modifications keep the checksums of data and index dblocks current
+TEST_F(ChecksumSuite, WriteKeepsChecksums0)
+{
+    filesystem_t fs;
+    new_filesystem(&fs, 4, 256);
+    ASSERT_EQ(fs_enable_checksums(&fs), SUCCESS);
+    inode_t *inode = empty_data_file(fs);
+
+    std::vector<char> data = pattern(3000);
+    // odd sized appends cross block and index dblock boundaries at varying offsets
+    for (std::size_t offset = 0; offset < data.size(); offset += 61)
+    {
+        std::size_t n = std::min<std::size_t>(61, data.size() - offset);
+        ASSERT_EQ(inode_write_data(&fs, inode, data.data() + offset, n), SUCCESS);
+    }
+    ASSERT_EQ(inode_modify_data(&fs, inode, 1000, (void*) "XYZ", 3), SUCCESS);
+    memcpy(data.data() + 1000, "XYZ", 3);
+
+    scrub_report_t report;
+    ASSERT_EQ(fs_scrub(&fs, 3, &report), SUCCESS);
+    ASSERT_EQ(report.mismatch_count, 0u);
+    ASSERT_EQ(report.dblocks_checked, fs.dblock_count - available_dblocks(&fs));
+
+    std::vector<char> output(data.size());
+    size_t bytes_read = 0;
+    ASSERT_EQ(inode_read_data(&fs, inode, 0, output.data(), output.size(), &bytes_read), SUCCESS);
+    ASSERT_EQ(bytes_read, data.size());
+    ASSERT_EQ(output, data);
+
+    free_filesystem(&fs);
+}
+
+// a corrupted dblock is reported by scrub and fails reads that touch it
+TEST_F(ChecksumSuite, DetectCorruption0)
+{
+    filesystem_t fs;
+    new_filesystem(&fs, 4, 256);
+    ASSERT_EQ(fs_enable_checksums(&fs), SUCCESS);
+    inode_t *inode = empty_data_file(fs);
+    std::vector<char> data = pattern(2000);
+    ASSERT_EQ(inode_write_data(&fs, inode, data.data(), data.size()), SUCCESS);
+
+    // flip a bit in the data dblock holding byte 900
+    dblock_index_t data_dblock = 0;
+    {
+        size_t block = 900 / DATA_BLOCK_SIZE(&fs) - INODE_DIRECT_BLOCK_COUNT;
+        ASSERT_LT(block, 15u);
+        memcpy(&data_dblock, &fs.dblocks[inode->internal.indirect_dblock * DATA_BLOCK_SIZE(&fs) + block * sizeof(dblock_index_t)], sizeof(dblock_index_t));
+    }
+    fs.dblocks[data_dblock * DATA_BLOCK_SIZE(&fs) + 7] ^= 0x10;
+
+    scrub_report_t report;
+    ASSERT_EQ(fs_scrub(&fs, 2, &report), SUCCESS);
+    ASSERT_EQ(report.mismatch_count, 1u);
+    ASSERT_EQ(report.mismatches[0], data_dblock);
+
+    char output[100];
+    size_t bytes_read = 0;
+    ASSERT_EQ(inode_read_data(&fs, inode, 0, output, sizeof(output), &bytes_read), SUCCESS) << "Reads away from the corruption succeed.";
+    ASSERT_EQ(inode_read_data(&fs, inode, 850, output, sizeof(output), &bytes_read), CHECKSUM_MISMATCH);
+    ASSERT_LT(bytes_read, sizeof(output));
+
+    free_filesystem(&fs);
+}
+
+// the checksum table survives a save and load round trip
+TEST_F(ChecksumSuite, SaveLoad0)
+{
+    filesystem_t fs;
+    new_filesystem(&fs, 4, 64);
+    ASSERT_EQ(fs_enable_checksums(&fs), SUCCESS);
+    inode_t *inode = empty_data_file(fs);
+    std::vector<char> data = pattern(700);
+    ASSERT_EQ(inode_write_data(&fs, inode, data.data(), data.size()), SUCCESS);
+
+    FILE *file = tmpfile();
+    ASSERT_NE(file, nullptr);
+    ASSERT_EQ(save_filesystem(file, &fs), SUCCESS);
+    rewind(file);
+
+    filesystem_t loaded;
+    ASSERT_EQ(load_filesystem(file, &loaded), SUCCESS);
+    fclose(file);
+    ASSERT_NE(loaded.dblock_checksums, nullptr);
+    ASSERT_EQ(memcmp(loaded.dblock_checksums, fs.dblock_checksums, fs.dblock_count * sizeof(uint32_t)), 0);
+
+    scrub_report_t report;
+    ASSERT_EQ(fs_scrub(&loaded, 1, &report), SUCCESS);
+    ASSERT_EQ(report.mismatch_count, 0u);
+
+    free_filesystem(&loaded);
+    free_filesystem(&fs);
+}
@@ -106,4 +106,53 @@ TEST_F(ClaimAvailableDBlockSuite, DBlockComplexClaim0)
 
     check_fs(OUTPUT "DBlockComplexClaim0.bin", fs);
     free_filesystem(&fs);
-}
\ No newline at end of file
+}
+// released dblocks are claimed again first, even after the search moved past them
+TEST_F(ClaimAvailableDBlockSuite, ClaimAfterRelease0)
+{
+    dblock_index_t released[] = { 22, 4, 17 };
+    dblock_index_t expected_claimed_list[] = { 4, 17, 22 };
+
+    filesystem_t fs;
+    load_fs(INPUT "empty_random_inode_fragmented.bin", fs);
+
+    dblock_index_t tmp;
+    while (claim_available_dblock(&fs, &tmp) == SUCCESS);
+    for (auto&& idx : released) ASSERT_EQ(release_dblock(&fs, &fs.dblocks[idx * DATA_BLOCK_SIZE(&fs)]), SUCCESS);
+
+    for (auto&& expected : expected_claimed_list)
+    {
+        ASSERT_EQ(claim_available_dblock(&fs, &tmp), SUCCESS);
+        ASSERT_EQ(tmp, expected) << "The lowest available dblock must be claimed first!";
+    }
+    ASSERT_EQ(claim_available_dblock(&fs, &tmp), DBLOCK_UNAVAILABLE);
+
+    free_filesystem(&fs);
+}
+
+// a batch claims the same dblocks as claiming them one at a time, or none at all
+TEST_F(ClaimAvailableDBlockSuite, BatchClaim0)
+{
+    dblock_index_t expected_claimed_list[] = {
+        1, 3, 4, 5, 6, 8, 9, 14, 16, 17, 18, 19, 22, 25, 26, 29
+    };
+    constexpr size_t count = sizeof(expected_claimed_list) / sizeof(expected_claimed_list[0]);
+    dblock_index_t output_claimed_list[count + 1];
+
+    filesystem_t fs;
+    load_fs(INPUT "empty_random_inode_fragmented.bin", fs);
+
+    ASSERT_EQ(claim_available_dblocks(NULL, output_claimed_list, 1), INVALID_INPUT);
+    ASSERT_EQ(claim_available_dblocks(&fs, NULL, 1), INVALID_INPUT);
+    ASSERT_EQ(claim_available_dblocks(&fs, output_claimed_list, count + 1), DBLOCK_UNAVAILABLE);
+    ASSERT_EQ(available_dblocks(&fs), count) << "A failed batch must not claim anything!";
+
+    ASSERT_EQ(claim_available_dblocks(&fs, output_claimed_list, 5), SUCCESS);
+    ASSERT_EQ(claim_available_dblocks(&fs, output_claimed_list + 5, count - 5), SUCCESS);
+    for (size_t i = 0; i < count; ++i)
+    {
+        ASSERT_EQ(output_claimed_list[i], expected_claimed_list[i]) << "D-Block claimed at position " << i << " is incorrect!";
+    }
+    check_fs(OUTPUT "DBlockComplexClaim0.bin", fs);
+    free_filesystem(&fs);
+}
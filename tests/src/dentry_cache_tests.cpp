@@ -0,0 +1,129 @@
+#include "test_util.hpp"
+
+using DentryCacheSuite = fs_internal_test;
+
+static dentry_cache_stats_t stats_of(filesystem_t *fs)
+{
+    dentry_cache_stats_t stats;
+    fs_dentry_cache_stats(fs, &stats);
+    return stats;
+}
+
+TEST_F(DentryCacheSuite, InvalidInput)
+{
+    dentry_cache_stats_t stats;
+    memset(&stats, 0xFF, sizeof(stats));
+    fs_dentry_cache_stats(NULL, &stats);
+    ASSERT_EQ(stats.hits, 0u);
+    ASSERT_EQ(stats.misses, 0u);
+    fs_dentry_cache_stats(NULL, NULL);
+}
+
+// opening the same path again is answered by the cache for every component
+TEST_F(DentryCacheSuite, Hit0)
+{
+    filesystem_t fs;
+    load_fs(INPUT "medium.bin", fs);
+    terminal_context_t ctx { &fs, &fs.inodes[0] };
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        for (int i = 0; i < 3; ++i)
+        {
+            fs_file_t file = fs_open(&ctx, PATH("a/b/hello.txt"));
+            ASSERT_NE( file, nullptr );
+            ASSERT_EQ( file->inode, &fs.inodes[5] );
+            fs_close(file);
+        }
+    }   // end stdout logging
+
+    check_stdout(OUTPUT "Empty.txt");
+    dentry_cache_stats_t stats = stats_of(&fs);
+    ASSERT_EQ(stats.misses, 3u);
+    ASSERT_EQ(stats.hits, 6u);
+    ASSERT_EQ(stats.negative_hits, 0u);
+    free_filesystem(&fs);
+}
+
+// a missing name is cached until a file of that name is created
+TEST_F(DentryCacheSuite, Negative0)
+{
+    filesystem_t fs;
+    load_fs(INPUT "medium.bin", fs);
+    terminal_context_t ctx { &fs, &fs.inodes[0] };
+    fs_file_t missing, created;
+    int ret;
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        missing = fs_open(&ctx, PATH("a/b/new.txt"));
+        ret = new_file(&ctx, PATH("a/b/new.txt"), FS_READ);
+        created = fs_open(&ctx, PATH("a/b/new.txt"));
+    }   // end stdout logging
+
+    check_stdout(OUTPUT "FileNotFound.txt");
+    ASSERT_EQ( missing, nullptr );
+    ASSERT_EQ( ret, 0 );
+    ASSERT_NE( created, nullptr );
+    ASSERT_STREQ( created->inode->internal.file_name, "new.txt" );
+    fs_close(created);
+
+    dentry_cache_stats_t stats = stats_of(&fs);
+    ASSERT_EQ( stats.negative_hits, 1u ) << "`new_file` finds the name missing in the cache.";
+    ASSERT_EQ( stats.invalidations, 1u );
+    free_filesystem(&fs);
+}
+
+// a rename drops the cached lookups of the old and the new name
+TEST_F(DentryCacheSuite, Rename0)
+{
+    filesystem_t fs;
+    load_fs(INPUT "medium.bin", fs);
+    terminal_context_t ctx { &fs, &fs.inodes[0] };
+    fs_file_t before, old_name, new_name;
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        before = fs_open(&ctx, PATH("book.txt"));
+        ASSERT_EQ( fs_rename(&ctx, PATH("book.txt"), PATH("a/novel.txt")), 0 );
+        new_name = fs_open(&ctx, PATH("a/novel.txt"));
+        old_name = fs_open(&ctx, PATH("book.txt"));
+    }   // end stdout logging
+
+    check_stdout(OUTPUT "FileNotFound.txt");
+    ASSERT_NE( before, nullptr );
+    ASSERT_NE( new_name, nullptr );
+    ASSERT_EQ( new_name->inode, before->inode );
+    ASSERT_EQ( old_name, nullptr );
+    fs_close(before);
+    fs_close(new_name);
+    free_filesystem(&fs);
+}
+
+// an entry written to the directory data without the directory functions is seen
+TEST_F(DentryCacheSuite, DirectWrite0)
+{
+    filesystem_t fs;
+    load_fs(INPUT "medium.bin", fs);
+    terminal_context_t ctx { &fs, &fs.inodes[0] };
+    fs_file_t missing, found;
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        missing = fs_open(&ctx, PATH("alias"));
+
+        inode_index_t index = 4;
+        byte entry[WIDE_DIRECTORY_ENTRY_SIZE] = { 0 };
+        memcpy(entry, &index, fs.index_width);
+        memcpy(entry + fs.index_width, "alias", 5);
+        ASSERT_EQ( inode_write_data(&fs, &fs.inodes[0], entry, DIRECTORY_ENTRY_SIZE(&fs)), SUCCESS );
+        found = fs_open(&ctx, PATH("alias"));
+    }   // end stdout logging
+
+    check_stdout(OUTPUT "FileNotFound.txt");
+    ASSERT_EQ( missing, nullptr );
+    ASSERT_NE( found, nullptr );
+    ASSERT_EQ( found->inode, &fs.inodes[4] );
+    fs_close(found);
+    free_filesystem(&fs);
+}
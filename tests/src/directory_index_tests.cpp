@@ -0,0 +1,378 @@
+#include "test_util.hpp"
+
+#include <string>
+
+using DirectoryIndexSuite = fs_internal_test;
+
+// enough files for the root directory to get a hash index
+static constexpr size_t file_count = 300;
+
+static std::string file_name(size_t i)
+{
+    return "file" + std::to_string(i) + ".txt";
+}
+
+// fills the root directory of a new file system with `file_count` files
+static void make_large_directory(filesystem_t *fs, terminal_context_t *ctx)
+{
+    ASSERT_EQ( new_filesystem(fs, file_count + 8, 512), SUCCESS );
+    new_terminal(fs, ctx);
+    for (size_t i = 0; i < file_count; ++i)
+    {
+        ASSERT_EQ( new_file(ctx, file_name(i).data(), FS_READ), 0 );
+    }
+}
+
+// every file of a large directory is found through the index
+TEST_F(DirectoryIndexSuite, Lookup0)
+{
+    filesystem_t fs;
+    terminal_context_t ctx;
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        make_large_directory(&fs, &ctx);
+        for (size_t i = 0; i < file_count; ++i)
+        {
+            fs_file_t file = fs_open(&ctx, file_name(i).data());
+            ASSERT_NE( file, nullptr );
+            ASSERT_EQ( file->inode, &fs.inodes[i + 1] );
+            fs_close(file);
+        }
+    }   // end stdout logging
+
+    check_stdout(OUTPUT "Empty.txt");
+    ASSERT_EQ( fs.inodes[0].internal.file_size, (file_count + 1) * DIRECTORY_ENTRY_SIZE(&fs) );
+    free_filesystem(&fs);
+}
+
+// a name of a large directory cannot be created twice
+TEST_F(DirectoryIndexSuite, Exists0)
+{
+    filesystem_t fs;
+    terminal_context_t ctx;
+    int ret;
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        make_large_directory(&fs, &ctx);
+        ret = new_file(&ctx, PATH("file123.txt"), FS_READ);
+    }   // end stdout logging
+
+    ASSERT_EQ(ret, -1) << "Incorrect return value";
+    check_stdout(OUTPUT "FileExist.txt");
+    free_filesystem(&fs);
+}
+
+// renames and moves keep the index in step with the directory, and a new file takes the
+// tombstone a move leaves behind
+TEST_F(DirectoryIndexSuite, Rename0)
+{
+    filesystem_t fs;
+    terminal_context_t ctx;
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        make_large_directory(&fs, &ctx);
+        ASSERT_EQ( fs_rename(&ctx, PATH("file10.txt"), PATH("renamed.txt")), 0 );
+        ASSERT_EQ( new_file(&ctx, PATH("file10.txt"), FS_READ), 0 );
+
+        // an empty data file turned into a directory is enough to move a file into
+        ASSERT_EQ( new_file(&ctx, PATH("dir"), FS_READ), 0 );
+        inode_t *dir = &fs.inodes[file_count + 2];
+        dir->internal.file_type = DIRECTORY;
+        size_t root_size = fs.inodes[0].internal.file_size;
+        ASSERT_EQ( fs_rename(&ctx, PATH("file20.txt"), PATH("dir/moved.txt")), 0 );
+        ASSERT_EQ( new_file(&ctx, PATH("new.txt"), FS_READ), 0 );
+        ASSERT_EQ( fs.inodes[0].internal.file_size, root_size ) << "The tombstone is reused.";
+
+        fs_file_t file = fs_open(&ctx, PATH("renamed.txt"));
+        ASSERT_NE( file, nullptr );
+        ASSERT_EQ( file->inode, &fs.inodes[11] );
+        fs_close(file);
+        file = fs_open(&ctx, PATH("file10.txt"));
+        ASSERT_NE( file, nullptr );
+        ASSERT_EQ( file->inode, &fs.inodes[file_count + 1] );
+        fs_close(file);
+        file = fs_open(&ctx, PATH("new.txt"));
+        ASSERT_NE( file, nullptr );
+        ASSERT_EQ( file->inode, &fs.inodes[file_count + 3] );
+        fs_close(file);
+    }   // end stdout logging
+
+    check_stdout(OUTPUT "Empty.txt");
+    free_filesystem(&fs);
+}
+
+// a moved file is no longer found under its old name
+TEST_F(DirectoryIndexSuite, Rename1)
+{
+    filesystem_t fs;
+    terminal_context_t ctx;
+    fs_file_t file;
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        make_large_directory(&fs, &ctx);
+        ASSERT_EQ( fs_rename(&ctx, PATH("file42.txt"), PATH("other.txt")), 0 );
+        file = fs_open(&ctx, PATH("file42.txt"));
+    }   // end stdout logging
+
+    ASSERT_EQ( file, nullptr );
+    check_stdout(OUTPUT "FileNotFound.txt");
+    free_filesystem(&fs);
+}
+
+// entries written to the directory data without the directory functions are picked up
+TEST_F(DirectoryIndexSuite, DirectWrite0)
+{
+    filesystem_t fs;
+    terminal_context_t ctx;
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        make_large_directory(&fs, &ctx);
+        fs_file_t file = fs_open(&ctx, PATH("file0.txt"));
+        ASSERT_NE( file, nullptr );
+        fs_close(file);
+
+        inode_index_t index = 1;
+        byte entry[WIDE_DIRECTORY_ENTRY_SIZE] = { 0 };
+        memcpy(entry, &index, fs.index_width);
+        memcpy(entry + fs.index_width, "alias", 5);
+        ASSERT_EQ( inode_write_data(&fs, &fs.inodes[0], entry, DIRECTORY_ENTRY_SIZE(&fs)), SUCCESS );
+
+        file = fs_open(&ctx, PATH("alias"));
+        ASSERT_NE( file, nullptr );
+        ASSERT_EQ( file->inode, &fs.inodes[1] );
+        fs_close(file);
+    }   // end stdout logging
+
+    check_stdout(OUTPUT "Empty.txt");
+    free_filesystem(&fs);
+}
+
+// the name stored in the entry at `offset` of a directory
+static std::string entry_name(filesystem_t *fs, inode_t *dir, size_t offset)
+{
+    byte raw[WIDE_DIRECTORY_ENTRY_SIZE];
+    size_t bytes_read;
+    EXPECT_EQ( inode_read_data(fs, dir, offset, raw, DIRECTORY_ENTRY_SIZE(fs), &bytes_read), SUCCESS );
+    const char *name = (const char*) raw + fs->index_width;
+    return std::string(name, strnlen(name, MAX_FILE_NAME_LEN));
+}
+
+// new entries fill the freed slots of a large directory from the front, whatever order
+// the slots were freed in
+TEST_F(DirectoryIndexSuite, Churn0)
+{
+    filesystem_t fs;
+    terminal_context_t ctx;
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        make_large_directory(&fs, &ctx);
+        for (size_t i : { 250, 10, 100, 200 })
+        {
+            ASSERT_EQ( remove_file(&ctx, file_name(i).data()), 0 );
+        }
+        size_t root_size = fs.inodes[0].internal.file_size;
+        for (const char *name : { "n0", "n1", "n2", "n3", "n4" })
+        {
+            ASSERT_EQ( new_file(&ctx, PATH(name), FS_READ), 0 );
+        }
+        ASSERT_EQ( fs.inodes[0].internal.file_size, root_size + DIRECTORY_ENTRY_SIZE(&fs) ) << "Only the last file needs a new slot.";
+    }   // end stdout logging
+
+    check_stdout(OUTPUT "Empty.txt");
+    // file i is entry i + 1, after `.`
+    inode_t *root = &fs.inodes[0];
+    ASSERT_EQ( entry_name(&fs, root, 11 * DIRECTORY_ENTRY_SIZE(&fs)), "n0" );
+    ASSERT_EQ( entry_name(&fs, root, 101 * DIRECTORY_ENTRY_SIZE(&fs)), "n1" );
+    ASSERT_EQ( entry_name(&fs, root, 201 * DIRECTORY_ENTRY_SIZE(&fs)), "n2" );
+    ASSERT_EQ( entry_name(&fs, root, 251 * DIRECTORY_ENTRY_SIZE(&fs)), "n3" );
+    ASSERT_EQ( entry_name(&fs, root, (file_count + 1) * DIRECTORY_ENTRY_SIZE(&fs)), "n4" );
+    free_filesystem(&fs);
+}
+
+// a small directory is scanned without an index. only the bytes of an entry up to the null
+// ending its name count, and a name of MAX_FILE_NAME_LEN characters has no null
+TEST_F(DirectoryIndexSuite, Scan0)
+{
+    filesystem_t fs;
+    ASSERT_EQ( new_filesystem(&fs, 16, 64), SUCCESS );
+    terminal_context_t ctx;
+    new_terminal(&fs, &ctx);
+    fs_file_t missing;
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ASSERT_EQ( new_file(&ctx, PATH("one"), FS_READ), 0 );
+        ASSERT_EQ( new_file(&ctx, PATH("two"), FS_READ), 0 );
+        ASSERT_EQ( new_file(&ctx, PATH("three"), FS_READ), 0 );
+
+        const char *names[] = { "abc\0garbage!!", "abcdefghijklmn", "ab" };
+        for (inode_index_t index = 1; index <= 3; ++index)
+        {
+            byte entry[WIDE_DIRECTORY_ENTRY_SIZE] = { 0 };
+            memcpy(entry, &index, fs.index_width);
+            memcpy(entry + fs.index_width, names[index - 1], MAX_FILE_NAME_LEN);
+            ASSERT_EQ( inode_write_data(&fs, &fs.inodes[0], entry, DIRECTORY_ENTRY_SIZE(&fs)), SUCCESS );
+        }
+
+        const std::pair<const char*, size_t> lookups[] = { { "abc", 1 }, { "abcdefghijklmn", 2 }, { "ab", 3 }, { "two", 2 } };
+        for (auto [name, index] : lookups)
+        {
+            fs_file_t file = fs_open(&ctx, PATH(name));
+            ASSERT_NE( file, nullptr ) << name;
+            ASSERT_EQ( file->inode, &fs.inodes[index] ) << name;
+            fs_close(file);
+        }
+        missing = fs_open(&ctx, PATH("abcdefghijklm"));
+    }   // end stdout logging
+
+    ASSERT_EQ( missing, nullptr );
+    check_stdout(OUTPUT "FileNotFound.txt");
+    free_filesystem(&fs);
+}
+
+// a file system of more than 65,536 inodes strides its directories by the wide entries, in
+// scans, through the index and across a save and load
+TEST_F(DirectoryIndexSuite, Wide0)
+{
+    filesystem_t fs;
+    ASSERT_EQ( new_filesystem(&fs, 70000, 512), SUCCESS );
+    ASSERT_EQ( DIRECTORY_ENTRY_SIZE(&fs), (size_t) WIDE_DIRECTORY_ENTRY_SIZE );
+    terminal_context_t ctx;
+    new_terminal(&fs, &ctx);
+    filesystem_t loaded;
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ASSERT_EQ( new_directory(&ctx, PATH("small")), 0 );
+        for (size_t i = 0; i < 10; ++i)
+        {
+            ASSERT_EQ( new_file(&ctx, ("small/" + file_name(i)).data(), FS_READ), 0 );
+        }
+        for (size_t i = 0; i < file_count; ++i)
+        {
+            ASSERT_EQ( new_file(&ctx, file_name(i).data(), FS_READ), 0 );
+        }
+        ASSERT_EQ( remove_file(&ctx, PATH("small/file3.txt")), 0 );
+        ASSERT_EQ( fs_compact(&ctx, PATH("small")), 0 );
+
+        FILE *file = tmpfile();
+        ASSERT_NE( file, nullptr );
+        ASSERT_EQ( save_filesystem(file, &fs), SUCCESS );
+        rewind(file);
+        ASSERT_EQ( load_filesystem(file, &loaded), SUCCESS );
+        fclose(file);
+        ASSERT_EQ( loaded.index_width, (size_t) WIDE_INODE_INDEX_WIDTH );
+
+        for (filesystem_t *each : { &fs, &loaded })
+        {
+            terminal_context_t each_ctx;
+            new_terminal(each, &each_ctx);
+            for (size_t i = 0; i < 10; ++i)
+            {
+                if (i == 3) continue;
+                fs_file_t found = fs_open(&each_ctx, ("small/" + file_name(i)).data());
+                ASSERT_NE( found, nullptr ) << file_name(i);
+                ASSERT_EQ( found->inode, &each->inodes[i + 2] );
+                fs_close(found);
+            }
+            for (size_t i = 0; i < file_count; ++i)
+            {
+                fs_file_t found = fs_open(&each_ctx, file_name(i).data());
+                ASSERT_NE( found, nullptr ) << file_name(i);
+                ASSERT_EQ( found->inode, &each->inodes[i + 12] );
+                fs_close(found);
+            }
+        }
+    }   // end stdout logging
+
+    check_stdout(OUTPUT "Empty.txt");
+    ASSERT_EQ( fs.inodes[1].internal.file_size, 11 * DIRECTORY_ENTRY_SIZE(&fs) ) << "The removed entry is compacted away.";
+    free_filesystem(&loaded);
+    free_filesystem(&fs);
+}
+
+// the index of a large directory is saved with the image, so a loaded image looks names up
+// through it without reading the directory first, and keeps it up to date from there
+TEST_F(DirectoryIndexSuite, Save0)
+{
+    filesystem_t fs;
+    terminal_context_t ctx;
+    filesystem_t loaded;
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        make_large_directory(&fs, &ctx);
+        ASSERT_EQ( new_directory(&ctx, PATH("small")), 0 );
+        ASSERT_EQ( remove_file(&ctx, PATH("file7.txt")), 0 );
+
+        FILE *file = tmpfile();
+        ASSERT_NE( file, nullptr );
+        ASSERT_EQ( save_filesystem(file, &fs), SUCCESS );
+        rewind(file);
+        ASSERT_EQ( load_filesystem(file, &loaded), SUCCESS );
+        fclose(file);
+    }   // end stdout logging
+    check_stdout(OUTPUT "Empty.txt");
+
+    ASSERT_NE( loaded.dir_indexes, nullptr );
+    ASSERT_NE( loaded.dir_indexes[0], nullptr ) << "The index of the root is loaded.";
+    ASSERT_EQ( loaded.dir_indexes[file_count + 1], nullptr ) << "A small directory has no index.";
+    terminal_context_t loaded_ctx;
+    new_terminal(&loaded, &loaded_ctx);
+    size_t root_size = loaded.inodes[0].internal.file_size;
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        for (size_t i = 0; i < file_count; ++i)
+        {
+            if (i == 7) continue;
+            fs_file_t found = fs_open(&loaded_ctx, file_name(i).data());
+            ASSERT_NE( found, nullptr ) << file_name(i);
+            ASSERT_EQ( found->inode, &loaded.inodes[i + 1] );
+            fs_close(found);
+        }
+        ASSERT_EQ( new_file(&loaded_ctx, PATH("file7.txt"), FS_READ), 0 );
+        ASSERT_EQ( loaded.inodes[0].internal.file_size, root_size ) << "The tombstone is found through the loaded index.";
+        ASSERT_EQ( new_file(&loaded_ctx, PATH("file8.txt"), FS_READ), -1 );
+    }   // end stdout logging
+
+    check_stdout(OUTPUT "FileExist.txt");
+    free_filesystem(&loaded);
+    free_filesystem(&fs);
+}
+
+// an image without large directories is saved without indexes
+TEST_F(DirectoryIndexSuite, Save1)
+{
+    filesystem_t fs;
+    ASSERT_EQ( new_filesystem(&fs, 16, 64), SUCCESS );
+    terminal_context_t ctx;
+    new_terminal(&fs, &ctx);
+    filesystem_t loaded;
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ASSERT_EQ( new_file(&ctx, PATH("one"), FS_READ), 0 );
+        fs_file_t file = fs_open(&ctx, PATH("one"));
+        ASSERT_NE( file, nullptr );
+        fs_close(file);
+
+        FILE *image = tmpfile();
+        ASSERT_NE( image, nullptr );
+        ASSERT_EQ( save_filesystem(image, &fs), SUCCESS );
+        rewind(image);
+        ASSERT_EQ( load_filesystem(image, &loaded), SUCCESS );
+        fclose(image);
+    }   // end stdout logging
+
+    check_stdout(OUTPUT "Empty.txt");
+    ASSERT_EQ( loaded.dir_indexes, nullptr );
+    free_filesystem(&loaded);
+    free_filesystem(&fs);
+}
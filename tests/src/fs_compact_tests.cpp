@@ -0,0 +1,173 @@
+#include "test_util.hpp"
+
+#include <string>
+#include <vector>
+
+using FSCompactSuite = fs_internal_test;
+
+// number of claimed dblocks
+static size_t used_dblocks(filesystem_t *fs)
+{
+    return fs->dblock_count - available_dblocks(fs);
+}
+
+// the inode index and the name of every entry of a directory, in order
+static std::vector<std::pair<inode_index_t, std::string>> entries_of(filesystem_t *fs, inode_t *dir)
+{
+    std::vector<std::pair<inode_index_t, std::string>> entries;
+    for (size_t offset = 0; offset < dir->internal.file_size; offset += DIRECTORY_ENTRY_SIZE(fs))
+    {
+        byte raw[WIDE_DIRECTORY_ENTRY_SIZE];
+        size_t bytes_read = 0;
+        EXPECT_EQ( inode_read_data(fs, dir, offset, raw, DIRECTORY_ENTRY_SIZE(fs), &bytes_read), SUCCESS );
+        inode_index_t index = 0;
+        memcpy(&index, raw, fs->index_width);
+        const char *name = (const char*) raw + fs->index_width;
+        entries.emplace_back(index, std::string(name, strnlen(name, MAX_FILE_NAME_LEN)));
+    }
+    return entries;
+}
+
+TEST_F(FSCompactSuite, InvalidInput)
+{
+    constexpr int expected_ret = 0;
+    // dummy data for testing
+    terminal_context_t ctx{
+        (filesystem_t*) 0x12345678,
+        (inode_t*) 0x87654321
+    };
+
+    int ret0, ret1;
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+
+        ret0 = fs_compact(NULL, PATH("a"));
+        ret1 = fs_compact(&ctx, NULL);
+    }   // end stdout logging
+
+    ASSERT_EQ(ret0, expected_ret) << "Incorrect return value for null context argument.";
+    ASSERT_EQ(ret1, expected_ret) << "Incorrect return value for null path argument.";
+
+    check_stdout(OUTPUT "Empty.txt");
+}
+
+// only directories are compacted
+TEST_F(FSCompactSuite, InvalidPath0)
+{
+    filesystem_t fs;
+    load_fs(INPUT "medium_tombstone.bin", fs);
+    int ret;
+
+    terminal_context_t ctx { &fs, &fs.inodes[0] };
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ret = fs_compact(&ctx, PATH("a/a.txt"));
+    }   // end stdout logging
+
+    ASSERT_EQ(ret, -1) << "Incorrect return value";
+
+    check_stdout(OUTPUT "DirectoryNotFound.txt");
+    check_fs(INPUT "medium_tombstone.bin", fs);
+    free_filesystem(&fs);
+}
+
+// a directory without tombstones is left as it is
+TEST_F(FSCompactSuite, Compact0)
+{
+    filesystem_t fs;
+    load_fs(INPUT "medium.bin", fs);
+    int ret;
+
+    terminal_context_t ctx { &fs, &fs.inodes[0] };
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ret = fs_compact(&ctx, PATH("a"));
+    }   // end stdout logging
+
+    ASSERT_EQ(ret, 0) << "Incorrect return value";
+
+    check_stdout(OUTPUT "Empty.txt");
+    check_fs(INPUT "medium.bin", fs);
+    free_filesystem(&fs);
+}
+
+// the live entries move up in their order behind `.` and `..`
+TEST_F(FSCompactSuite, Compact1)
+{
+    filesystem_t fs;
+    load_fs(INPUT "medium_tombstone.bin", fs);
+    int ret;
+
+    terminal_context_t ctx { &fs, &fs.inodes[0] };
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ret = fs_compact(&ctx, PATH("a"));
+    }   // end stdout logging
+
+    ASSERT_EQ(ret, 0) << "Incorrect return value";
+    check_stdout(OUTPUT "Empty.txt");
+
+    std::vector<std::pair<inode_index_t, std::string>> expected{
+        { 1, "." }, { 0, ".." }, { 2, "a.txt" }, { 5, "c.txt" }, { 7, "e.txt" }
+    };
+    ASSERT_EQ( entries_of(&fs, &fs.inodes[1]), expected );
+    ASSERT_EQ( fs.inodes[1].internal.file_size, 5 * DIRECTORY_ENTRY_SIZE(&fs) );
+
+    fs_file_t file = fs_open(&ctx, PATH("a/e.txt"));
+    ASSERT_NE( file, nullptr ) << "Lookups find the entries at their new offsets.";
+    ASSERT_EQ( file->inode, &fs.inodes[7] );
+    fs_close(file);
+    free_filesystem(&fs);
+}
+
+// a large directory is compacted on its own once most of it is tombstones, and gives back
+// dblocks
+TEST_F(FSCompactSuite, Automatic0)
+{
+    constexpr size_t file_count = 300;
+    auto file_name = [](size_t i) { return "file" + std::to_string(i) + ".txt"; };
+
+    filesystem_t fs;
+    terminal_context_t ctx;
+    size_t full_dblocks;
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ASSERT_EQ( new_filesystem(&fs, file_count + 8, 512), SUCCESS );
+        new_terminal(&fs, &ctx);
+        for (size_t i = 0; i < file_count; ++i)
+        {
+            ASSERT_EQ( new_file(&ctx, file_name(i).data(), FS_READ), 0 );
+        }
+        full_dblocks = used_dblocks(&fs);
+
+        // more than half of the 301 entries are tombstones after the 151st removal, which
+        // compacts the directory to 150 entries. the next 49 are not enough to compact it again
+        for (size_t i = 0; i < 200; ++i)
+        {
+            ASSERT_EQ( remove_file(&ctx, file_name(i).data()), 0 );
+        }
+    }   // end stdout logging
+
+    check_stdout(OUTPUT "Empty.txt");
+    inode_t *root = &fs.inodes[0];
+    ASSERT_EQ( root->internal.file_size, 150 * DIRECTORY_ENTRY_SIZE(&fs) );
+    ASSERT_LT( used_dblocks(&fs), full_dblocks );
+
+    std::vector<std::pair<inode_index_t, std::string>> entries = entries_of(&fs, root);
+    ASSERT_EQ( entries[0].second, "." );
+    for (size_t i = 0; i < 49; ++i) ASSERT_EQ( entries[i + 1].second, "" );
+    ASSERT_EQ( entries[50].second, file_name(200) );
+
+    for (size_t i = 200; i < file_count; ++i)
+    {
+        fs_file_t file = fs_open(&ctx, file_name(i).data());
+        ASSERT_NE( file, nullptr );
+        ASSERT_EQ( file->inode, &fs.inodes[i + 1] );
+        fs_close(file);
+    }
+    free_filesystem(&fs);
+}
@@ -0,0 +1,196 @@
+#include "test_util.hpp"
+
+#include <vector>
+
+extern "C"
+{
+    #include "compress.h"
+    #include "utility.h"
+}
+
+using FSCopySuite = fs_internal_test;
+
+static std::vector<char> read_all(filesystem_t *fs, inode_t *inode)
+{
+    std::vector<char> data(inode_data_size(fs, inode));
+    size_t bytes_read = 0;
+    EXPECT_EQ( inode_read_data(fs, inode, 0, data.data(), data.size(), &bytes_read), SUCCESS );
+    EXPECT_EQ( bytes_read, data.size() );
+    return data;
+}
+
+TEST_F(FSCopySuite, InvalidInput)
+{
+    constexpr int expected_ret = 0;
+    // dummy data for testing
+    terminal_context_t ctx{
+        (filesystem_t*) 0x12345678,
+        (inode_t*) 0x87654321
+    };
+
+    int ret0, ret1, ret2;
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+
+        ret0 = fs_copy(NULL, PATH("a"), PATH("b"));
+        ret1 = fs_copy(&ctx, NULL, PATH("b"));
+        ret2 = fs_copy(&ctx, PATH("a"), NULL);
+    }   // end stdout logging
+
+    ASSERT_EQ(ret0, expected_ret) << "Incorrect return value for null context argument.";
+    ASSERT_EQ(ret1, expected_ret) << "Incorrect return value for null source argument.";
+    ASSERT_EQ(ret2, expected_ret) << "Incorrect return value for null destination argument.";
+
+    check_stdout(OUTPUT "Empty.txt");
+}
+
+// the source does not exist
+TEST_F(FSCopySuite, InvalidPath0)
+{
+    filesystem_t fs;
+    load_fs(INPUT "medium_text.bin", fs);
+    int ret;
+
+    terminal_context_t ctx { &fs, &fs.inodes[0] };
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ret = fs_copy(&ctx, PATH("secret/nope.txt"), PATH("copy.txt"));
+    }   // end stdout logging
+
+    ASSERT_EQ(ret, -1) << "Incorrect return value";
+
+    check_stdout(OUTPUT "FileNotFound.txt");
+    check_fs(INPUT "medium_text.bin", fs);
+    free_filesystem(&fs);
+}
+
+// the source is a directory
+TEST_F(FSCopySuite, InvalidPath1)
+{
+    filesystem_t fs;
+    load_fs(INPUT "medium_text.bin", fs);
+    int ret;
+
+    terminal_context_t ctx { &fs, &fs.inodes[0] };
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ret = fs_copy(&ctx, PATH("secret"), PATH("copy"));
+    }   // end stdout logging
+
+    ASSERT_EQ(ret, -1) << "Incorrect return value";
+
+    check_stdout(OUTPUT "InvalidFileType.txt");
+    check_fs(INPUT "medium_text.bin", fs);
+    free_filesystem(&fs);
+}
+
+// the destination already exists
+TEST_F(FSCopySuite, InvalidPath2)
+{
+    filesystem_t fs;
+    load_fs(INPUT "medium_text.bin", fs);
+    int ret;
+
+    terminal_context_t ctx { &fs, &fs.inodes[4] };
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ret = fs_copy(&ctx, PATH("secret2.txt"), PATH("secret"));
+    }   // end stdout logging
+
+    ASSERT_EQ(ret, -1) << "Incorrect return value";
+
+    check_stdout(OUTPUT "FileExist.txt");
+    check_fs(INPUT "medium_text.bin", fs);
+    free_filesystem(&fs);
+}
+
+// 3 dblocks are left but the copy needs 10 for the data and 1 for the directory entry
+TEST_F(FSCopySuite, AllocationFailure0)
+{
+    filesystem_t fs;
+    load_fs(INPUT "medium_text.bin", fs);
+    int ret;
+
+    terminal_context_t ctx { &fs, &fs.inodes[0] };
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ret = fs_copy(&ctx, PATH("hi.txt"), PATH("secret/hi.txt"));
+    }   // end stdout logging
+
+    ASSERT_EQ(ret, -1) << "Incorrect return value";
+
+    check_stdout(OUTPUT "FailedDBlockAlloc.txt");
+    check_fs(INPUT "medium_text.bin", fs);
+    free_filesystem(&fs);
+}
+
+// a file with an index dblock is copied into another directory
+TEST_F(FSCopySuite, Copy0)
+{
+    filesystem_t fs;
+    ASSERT_EQ( new_filesystem(&fs, 8, 64), SUCCESS );
+    terminal_context_t ctx { &fs, &fs.inodes[0] };
+
+    std::vector<char> data(20 * DATA_BLOCK_SIZE(&fs) + 7);
+    for (size_t i = 0; i < data.size(); ++i) data[i] = (char) ('a' + i % 23);
+
+    int ret;
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ASSERT_EQ( new_file(&ctx, PATH("src.txt"), (permission_t) (FS_READ | FS_WRITE)), 0 );
+        fs_file_t file = fs_open(&ctx, PATH("src.txt"));
+        ASSERT_NE( file, nullptr );
+        ASSERT_EQ( fs_write(file, data.data(), data.size()), data.size() );
+        fs_close(file);
+
+        size_t available = available_dblocks(&fs);
+        ret = fs_copy(&ctx, PATH("src.txt"), PATH("dst.txt"));
+        ASSERT_EQ( available - available_dblocks(&fs), calculate_necessary_dblock_amount(&fs, data.size()) )
+            << "The root directory still has room for the entry.";
+    }   // end stdout logging
+
+    ASSERT_EQ(ret, 0) << "Incorrect return value";
+    check_stdout(OUTPUT "Empty.txt");
+
+    inode_t *src = &fs.inodes[1];
+    inode_t *dst = &fs.inodes[2];
+    ASSERT_STREQ( dst->internal.file_name, "dst.txt" );
+    ASSERT_EQ( dst->internal.file_type, DATA_FILE );
+    ASSERT_EQ( dst->internal.file_perms, src->internal.file_perms );
+    ASSERT_EQ( read_all(&fs, dst), data );
+
+    // the copy is independent of the source
+    char patch = '!';
+    ASSERT_EQ( inode_modify_data(&fs, src, 0, &patch, 1), SUCCESS );
+    ASSERT_EQ( read_all(&fs, dst), data );
+
+    free_filesystem(&fs);
+}
+
+// a compressed file stays compressed and is not decompressed for the copy
+TEST_F(FSCopySuite, CopyCompressed0)
+{
+    filesystem_t fs;
+    ASSERT_EQ( new_filesystem(&fs, 8, 512), SUCCESS );
+    terminal_context_t ctx { &fs, &fs.inodes[0] };
+
+    std::vector<char> data(10000, 'z');
+    ASSERT_EQ( new_file(&ctx, PATH("src.txt"), FS_READ), 0 );
+    inode_t *src = &fs.inodes[1];
+    ASSERT_EQ( inode_write_data(&fs, src, data.data(), data.size()), SUCCESS );
+    ASSERT_EQ( inode_compress_data(&fs, src), SUCCESS );
+    size_t stored_size = src->internal.file_size;
+
+    ASSERT_EQ( fs_copy(&ctx, PATH("src.txt"), PATH("dst.txt")), 0 );
+
+    inode_t *dst = &fs.inodes[2];
+    ASSERT_TRUE( dst->internal.file_perms & FS_COMPRESSED );
+    ASSERT_EQ( dst->internal.file_size, stored_size );
+    ASSERT_EQ( read_all(&fs, dst), data );
+
+    free_filesystem(&fs);
+}
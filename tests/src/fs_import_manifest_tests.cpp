@@ -0,0 +1,205 @@
+#include "test_util.hpp"
+
+#include <string>
+#include <vector>
+
+using FSImportManifestSuite = fs_internal_test;
+
+TEST_F(FSImportManifestSuite, InvalidInput)
+{
+    constexpr int expected_ret = 0;
+    // dummy data for testing
+    terminal_context_t ctx{
+        (filesystem_t*) 0x12345678,
+        (inode_t*) 0x87654321
+    };
+    char *paths[] = { PATH("a") };
+
+    int ret0, ret1, ret2, ret3;
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+
+        ret0 = fs_make_directories(NULL, PATH("a"));
+        ret1 = fs_make_directories(&ctx, NULL);
+        ret2 = fs_import_manifest(NULL, paths, 1, FS_READ);
+        ret3 = fs_import_manifest(&ctx, NULL, 1, FS_READ);
+    }   // end stdout logging
+
+    ASSERT_EQ(ret0, expected_ret) << "Incorrect return value for null context argument.";
+    ASSERT_EQ(ret1, expected_ret) << "Incorrect return value for null path argument.";
+    ASSERT_EQ(ret2, expected_ret) << "Incorrect return value for null context argument.";
+    ASSERT_EQ(ret3, expected_ret) << "Incorrect return value for null paths argument.";
+
+    check_stdout(OUTPUT "Empty.txt");
+}
+
+// the missing directories are created, the existing ones kept
+TEST_F(FSImportManifestSuite, MakeDirectories0)
+{
+    filesystem_t fs;
+    load_fs(INPUT "medium.bin", fs);
+    terminal_context_t ctx { &fs, &fs.inodes[0] };
+    int ret0, ret1, ret2;
+    char *path;
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ret0 = fs_make_directories(&ctx, PATH("a/b/x/y/z"));
+        ret1 = fs_make_directories(&ctx, PATH("a//b/x/"));
+        ret2 = fs_make_directories(&ctx, PATH("."));
+        ASSERT_EQ( change_directory(&ctx, PATH("a/b/x/y/z")), 0 );
+        path = get_path_string(&ctx);
+    }   // end stdout logging
+
+    ASSERT_EQ(ret0, 0) << "Incorrect return value";
+    ASSERT_EQ(ret1, 0) << "Incorrect return value for an existing directory";
+    ASSERT_EQ(ret2, 0) << "Incorrect return value for the working directory";
+    check_stdout(OUTPUT "Empty.txt");
+    ASSERT_STREQ(path, "root/a/b/x/y/z");
+    free(path);
+    free_filesystem(&fs);
+}
+
+// a data file on the way is not a directory
+TEST_F(FSImportManifestSuite, MakeDirectories1)
+{
+    filesystem_t fs;
+    load_fs(INPUT "medium.bin", fs);
+    terminal_context_t ctx { &fs, &fs.inodes[0] };
+    int ret;
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ret = fs_make_directories(&ctx, PATH("book.txt/x"));
+    }   // end stdout logging
+
+    ASSERT_EQ(ret, -1) << "Incorrect return value";
+    check_stdout(OUTPUT "DirectoryNotFound.txt");
+    free_filesystem(&fs);
+}
+
+// a manifest in any order creates the same tree, with the directories on the way
+TEST_F(FSImportManifestSuite, Manifest0)
+{
+    filesystem_t fs;
+    ASSERT_EQ( new_filesystem(&fs, 32, 256), SUCCESS );
+    terminal_context_t ctx;
+    new_terminal(&fs, &ctx);
+    std::vector<std::string> manifest{
+        "src/util/str.c", "docs/", "src/main.c", "src/util/", "README", "src/util/str.h",
+        "src/net/http/client.c", "docs/guide/intro.md", "src/util/str.c2", "a-b"
+    };
+    std::vector<char*> paths;
+    for (std::string& path : manifest) paths.push_back(path.data());
+    int ret;
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ret = fs_import_manifest(&ctx, paths.data(), paths.size(), (permission_t) (FS_READ | FS_WRITE));
+        ASSERT_EQ( tree(&ctx, PATH(".")), 0 );
+    }   // end stdout logging
+
+    ASSERT_EQ(ret, 0) << "Incorrect return value";
+    check_stdout(OUTPUT "ImportManifest0.txt");
+    ASSERT_EQ( manifest[0], "src/util/str.c" ) << "The manifest is left as it is.";
+    fs_file_t file = fs_open(&ctx, PATH("src/net/http/client.c"));
+    ASSERT_NE( file, nullptr );
+    ASSERT_EQ( file->inode->internal.file_perms, FS_READ | FS_WRITE );
+    fs_close(file);
+    free_filesystem(&fs);
+}
+
+// a data file named twice is a failure, and what was created before it stays
+TEST_F(FSImportManifestSuite, Manifest1)
+{
+    filesystem_t fs;
+    ASSERT_EQ( new_filesystem(&fs, 32, 256), SUCCESS );
+    terminal_context_t ctx;
+    new_terminal(&fs, &ctx);
+    char *paths[] = { PATH("d/f"), PATH("d/f"), PATH("e/") };
+    int ret;
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ret = fs_import_manifest(&ctx, paths, 3, FS_READ);
+    }   // end stdout logging
+
+    ASSERT_EQ(ret, -1) << "Incorrect return value";
+    check_stdout(OUTPUT "FileExist.txt");
+    fs_file_t file = fs_open(&ctx, PATH("d/f"));
+    ASSERT_NE( file, nullptr );
+    fs_close(file);
+    ASSERT_EQ( available_inodes(&fs), 32u - 3 );
+    free_filesystem(&fs);
+}
+
+// a manifest runs out of inodes like the single calls would
+TEST_F(FSImportManifestSuite, Manifest2)
+{
+    filesystem_t fs;
+    ASSERT_EQ( new_filesystem(&fs, 4, 256), SUCCESS );
+    terminal_context_t ctx;
+    new_terminal(&fs, &ctx);
+    char *paths[] = { PATH("a/b/c/d") };
+    int ret;
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ret = fs_import_manifest(&ctx, paths, 1, FS_READ);
+    }   // end stdout logging
+
+    ASSERT_EQ(ret, -1) << "Incorrect return value";
+    check_stdout(OUTPUT "FailedINodeAlloc.txt");
+    ASSERT_EQ( available_inodes(&fs), 0u );
+    free_filesystem(&fs);
+}
+
+// a large tree built from a manifest is the tree built by one call per path
+TEST_F(FSImportManifestSuite, Manifest3)
+{
+    filesystem_t bulk, single;
+    ASSERT_EQ( new_filesystem(&bulk, 1200, 4096), SUCCESS );
+    ASSERT_EQ( new_filesystem(&single, 1200, 4096), SUCCESS );
+    terminal_context_t bulk_ctx, single_ctx;
+    new_terminal(&bulk, &bulk_ctx);
+    new_terminal(&single, &single_ctx);
+
+    std::vector<std::string> manifest;
+    for (size_t i = 0; i < 10; ++i)
+    {
+        for (size_t j = 0; j < 10; ++j)
+        {
+            for (size_t k = 0; k < 10; ++k)
+            {
+                manifest.push_back("d" + std::to_string(i) + "/s" + std::to_string(j) + "/f" + std::to_string(k));
+            }
+        }
+    }
+    std::vector<char*> paths;
+    for (std::string& path : manifest) paths.push_back(path.data());
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ASSERT_EQ( fs_import_manifest(&bulk_ctx, paths.data(), paths.size(), FS_READ), 0 );
+        for (size_t i = 0; i < 10; ++i)
+        {
+            std::string top = "d" + std::to_string(i);
+            ASSERT_EQ( new_directory(&single_ctx, top.data()), 0 );
+            for (size_t j = 0; j < 10; ++j)
+            {
+                std::string sub = top + "/s" + std::to_string(j);
+                ASSERT_EQ( new_directory(&single_ctx, sub.data()), 0 );
+                for (size_t k = 0; k < 10; ++k)
+                {
+                    ASSERT_EQ( new_file(&single_ctx, (sub + "/f" + std::to_string(k)).data(), FS_READ), 0 );
+                }
+            }
+        }
+    }   // end stdout logging
+
+    check_stdout(OUTPUT "Empty.txt");
+    ASSERT_EQ( memcmp(bulk.inodes, single.inodes, bulk.inode_count * sizeof(inode_t)), 0 );
+    ASSERT_EQ( memcmp(bulk.dblocks, single.dblocks, bulk.dblock_count * DATA_BLOCK_SIZE(&bulk)), 0 );
+    free_filesystem(&bulk);
+    free_filesystem(&single);
+}
@@ -1,5 +1,13 @@
 #include "test_util.hpp"
 
+#include <vector>
+
+extern "C"
+{
+    #include "block_map.h"
+    #include "checksum.h"
+}
+
 using FSReadSuite = fs_internal_test;
 
 constexpr size_t OVERFLOW = 128;
@@ -197,4 +205,133 @@ TEST_F(FSReadSuite, ReadFullFile0)
     check_fs(INPUT "medium_text.bin", fs);
 
     free_filesystem(&fs);
-}
\ No newline at end of file
+}
+// claims an empty data file whose blocks are interleaved with the other ones by the caller
+static inode_t *empty_data_file(filesystem_t& fs)
+{
+    inode_index_t index;
+    if (claim_available_inode(&fs, &index) != SUCCESS) return nullptr;
+    inode_t *inode = &fs.inodes[index];
+    memset(inode, 0, sizeof(*inode));
+    inode->internal.file_type = DATA_FILE;
+    inode->internal.file_perms = FS_READ;
+    return inode;
+}
+
+// sequential reads of files whose dblocks are interleaved return the same data with and
+// without read-ahead, including after the file is shrunk and grown back to its old size
+TEST_F(FSReadSuite, SequentialFragmented0)
+{
+    constexpr size_t file_size = 50 * DEFAULT_DATA_BLOCK_SIZE;
+    constexpr size_t chunks[] = { 24, DEFAULT_DATA_BLOCK_SIZE, 200 };
+
+    filesystem_t fs;
+    new_filesystem(&fs, 4, 256);
+    inode_t *files[2] = { empty_data_file(fs), empty_data_file(fs) };
+    char expected[2][file_size];
+    for (size_t f = 0; f < 2; ++f)
+        for (size_t i = 0; i < file_size; ++i) expected[f][i] = static_cast<char>('a' + (i * 7 + f) % 26);
+
+    for (size_t offset = 0; offset < file_size; offset += DATA_BLOCK_SIZE(&fs))
+        for (size_t f = 0; f < 2; ++f)
+            ASSERT_EQ( inode_write_data(&fs, files[f], expected[f] + offset, DATA_BLOCK_SIZE(&fs)), SUCCESS );
+
+    for (int round = 0; round < 2; ++round)
+    {
+        for (size_t read_ahead : { 0, 8 })
+        {
+            fs.read_ahead_blocks = read_ahead;
+            for (size_t chunk : chunks)
+            {
+                for (size_t f = 0; f < 2; ++f)
+                {
+                    struct fs_file file { &fs, files[f], 0 };
+                    char output[file_size + OVERFLOW] = { 0 };
+                    size_t total = 0, got;
+                    while ((got = fs_read(&file, output + total, chunk)) > 0) total += got;
+                    ASSERT_EQ( total, file_size );
+                    ASSERT_EQ( memcmp(output, expected[f], file_size), 0 ) << "chunk " << chunk << ", read-ahead " << read_ahead;
+                }
+            }
+
+            // reads jumping backwards must not reuse the position of the last read
+            struct fs_file file { &fs, files[0], 0 };
+            for (size_t offset : { 3000, 100, 2000, 1000 })
+            {
+                char output[32];
+                ASSERT_EQ( fs_seek(&file, FS_SEEK_START, static_cast<int>(offset)), 0 );
+                ASSERT_EQ( fs_read(&file, output, sizeof(output)), sizeof(output) );
+                ASSERT_EQ( memcmp(output, expected[0] + offset, sizeof(output)), 0 ) << "offset " << offset;
+            }
+        }
+
+        // regrow the first file with new data so its tail lives in different dblocks
+        ASSERT_EQ( inode_shrink_data(&fs, files[0], 700), SUCCESS );
+        for (size_t i = 700; i < file_size; ++i) expected[0][i] = static_cast<char>('A' + i % 26);
+        ASSERT_EQ( inode_write_data(&fs, files[1], expected[1], DATA_BLOCK_SIZE(&fs)), SUCCESS );
+        ASSERT_EQ( inode_shrink_data(&fs, files[1], file_size), SUCCESS );
+        ASSERT_EQ( inode_write_data(&fs, files[0], expected[0] + 700, file_size - 700), SUCCESS );
+    }
+
+    free_filesystem(&fs);
+}
+
+// a file system that never enables read-ahead keeps no read state, however far its reads go
+TEST_F(FSReadSuite, NoReadAheadState0)
+{
+    constexpr size_t file_size = 20 * DEFAULT_DATA_BLOCK_SIZE;
+
+    filesystem_t fs;
+    new_filesystem(&fs, 4, 64);
+    inode_t *inode = empty_data_file(fs);
+    std::vector<char> data(file_size, 'x');
+    ASSERT_EQ( inode_write_data(&fs, inode, data.data(), file_size), SUCCESS );
+
+    struct fs_file file { &fs, inode, 0 };
+    std::vector<char> output(file_size);
+    size_t total = 0, got;
+    while ((got = fs_read(&file, output.data() + total, 100)) > 0) total += got;
+    ASSERT_EQ( total, file_size );
+    ASSERT_EQ( fs.read_aheads, nullptr );
+    ASSERT_EQ( fs.read_resumes, nullptr );
+
+    fs.read_ahead_blocks = 4;
+    ASSERT_EQ( fs_seek(&file, FS_SEEK_START, 0), 0 );
+    while ((got = fs_read(&file, output.data(), 100)) > 0) { }
+    ASSERT_NE( fs.read_resumes, nullptr );
+    free_filesystem(&fs);
+}
+
+// a read over a corrupted dblock reports the error and only returns, and moves past, the
+// bytes in front of it
+TEST_F(FSReadSuite, CorruptedDblock0)
+{
+    constexpr size_t file_size = 12 * DEFAULT_DATA_BLOCK_SIZE;
+    constexpr size_t corrupted_block = 6;
+
+    filesystem_t fs;
+    new_filesystem(&fs, 4, 64);
+    ASSERT_EQ( fs_enable_checksums(&fs), SUCCESS );
+    inode_t *inode = empty_data_file(fs);
+    std::vector<char> data(file_size);
+    for (size_t i = 0; i < file_size; ++i) data[i] = static_cast<char>('a' + i % 26);
+    ASSERT_EQ( inode_write_data(&fs, inode, data.data(), file_size), SUCCESS );
+
+    block_cursor_t cursor;
+    block_cursor_seek(&fs, inode, &cursor, corrupted_block);
+    fs.dblocks[(size_t) block_cursor_dblock(&fs, inode, &cursor) * DATA_BLOCK_SIZE(&fs)] ^= 0x10;
+
+    struct fs_file file { &fs, inode, 0 };
+    std::vector<char> output(file_size);
+    size_t got;
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        got = fs_read(&file, output.data(), file_size);
+    }   // end stdout logging
+
+    check_stdout(OUTPUT "ChecksumMismatch.txt");
+    ASSERT_EQ( got, corrupted_block * DATA_BLOCK_SIZE(&fs) );
+    ASSERT_EQ( file.offset, got );
+    ASSERT_EQ( memcmp(output.data(), data.data(), got), 0 );
+    free_filesystem(&fs);
+}
@@ -0,0 +1,272 @@
+#include "test_util.hpp"
+
+#include <string>
+
+using FSRenameSuite = fs_internal_test;
+
+// number of claimed dblocks
+static size_t used_dblocks(filesystem_t *fs)
+{
+    return fs->dblock_count - available_dblocks(fs);
+}
+
+// inode index of the entry at `offset` in a directory
+static inode_index_t entry_inode(filesystem_t *fs, inode_t *dir, size_t offset)
+{
+    inode_index_t index = 0xFFFF;
+    size_t bytes_read = 0;
+    EXPECT_EQ( inode_read_data(fs, dir, offset, &index, fs->index_width, &bytes_read), SUCCESS );
+    return index;
+}
+
+TEST_F(FSRenameSuite, InvalidInput)
+{
+    constexpr int expected_ret = 0;
+    // dummy data for testing
+    terminal_context_t ctx{
+        (filesystem_t*) 0x12345678,
+        (inode_t*) 0x87654321
+    };
+
+    int ret0, ret1, ret2;
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+
+        ret0 = fs_rename(NULL, PATH("a"), PATH("b"));
+        ret1 = fs_rename(&ctx, NULL, PATH("b"));
+        ret2 = fs_rename(&ctx, PATH("a"), NULL);
+    }   // end stdout logging
+
+    ASSERT_EQ(ret0, expected_ret) << "Incorrect return value for null context argument.";
+    ASSERT_EQ(ret1, expected_ret) << "Incorrect return value for null old path argument.";
+    ASSERT_EQ(ret2, expected_ret) << "Incorrect return value for null new path argument.";
+
+    check_stdout(OUTPUT "Empty.txt");
+}
+
+// the object to move does not exist
+TEST_F(FSRenameSuite, InvalidPath0)
+{
+    filesystem_t fs;
+    load_fs(INPUT "medium.bin", fs);
+    int ret;
+
+    terminal_context_t ctx { &fs, &fs.inodes[0] };
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ret = fs_rename(&ctx, PATH("a/b/nope.txt"), PATH("a/nope.txt"));
+    }   // end stdout logging
+
+    ASSERT_EQ(ret, -1) << "Incorrect return value";
+
+    check_stdout(OUTPUT "ObjectNotFound.txt");
+    check_fs(INPUT "medium.bin", fs);
+    free_filesystem(&fs);
+}
+
+// the new path is taken
+TEST_F(FSRenameSuite, InvalidPath1)
+{
+    filesystem_t fs;
+    load_fs(INPUT "medium.bin", fs);
+    int ret;
+
+    terminal_context_t ctx { &fs, &fs.inodes[0] };
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ret = fs_rename(&ctx, PATH("book.txt"), PATH("book2.txt"));
+    }   // end stdout logging
+
+    ASSERT_EQ(ret, -1) << "Incorrect return value";
+
+    check_stdout(OUTPUT "FileExist.txt");
+    check_fs(INPUT "medium.bin", fs);
+    free_filesystem(&fs);
+}
+
+// a directory cannot be moved below itself
+TEST_F(FSRenameSuite, InvalidPath2)
+{
+    filesystem_t fs;
+    load_fs(INPUT "medium.bin", fs);
+    int ret;
+
+    terminal_context_t ctx { &fs, &fs.inodes[0] };
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ret = fs_rename(&ctx, PATH("a"), PATH("a/b/c/a"));
+    }   // end stdout logging
+
+    ASSERT_EQ(ret, -1) << "Incorrect return value";
+
+    check_stdout(OUTPUT "InvalidInput.txt");
+    check_fs(INPUT "medium.bin", fs);
+    free_filesystem(&fs);
+}
+
+// `.` and `..` cannot be renamed
+TEST_F(FSRenameSuite, InvalidPath3)
+{
+    filesystem_t fs;
+    load_fs(INPUT "medium.bin", fs);
+    int ret;
+
+    terminal_context_t ctx { &fs, &fs.inodes[3] };
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ret = fs_rename(&ctx, PATH(".."), PATH("up"));
+    }   // end stdout logging
+
+    ASSERT_EQ(ret, -1) << "Incorrect return value";
+
+    check_stdout(OUTPUT "InvalidFilename.txt");
+    check_fs(INPUT "medium.bin", fs);
+    free_filesystem(&fs);
+}
+
+// the destination directory is full and no dblock is left for the entry
+TEST_F(FSRenameSuite, AllocationFailure0)
+{
+    filesystem_t fs;
+    load_fs(INPUT "full_medium.bin", fs);
+    int ret;
+
+    terminal_context_t ctx { &fs, &fs.inodes[0] };
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ret = fs_rename(&ctx, PATH("book.txt"), PATH("a/b/book.txt"));
+    }   // end stdout logging
+
+    ASSERT_EQ(ret, -1) << "Incorrect return value";
+
+    check_stdout(OUTPUT "FailedDBlockAlloc.txt");
+    check_fs(INPUT "full_medium.bin", fs);
+    free_filesystem(&fs);
+}
+
+// renaming in place reuses the entry
+TEST_F(FSRenameSuite, Rename0)
+{
+    filesystem_t fs;
+    load_fs(INPUT "medium.bin", fs);
+    int ret;
+
+    terminal_context_t ctx { &fs, &fs.inodes[0] };
+    size_t root_size = fs.inodes[0].internal.file_size;
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ret = fs_rename(&ctx, PATH("book.txt"), PATH("novel.txt"));
+    }   // end stdout logging
+
+    ASSERT_EQ(ret, 0) << "Incorrect return value";
+    check_stdout(OUTPUT "Empty.txt");
+
+    ASSERT_EQ( fs.inodes[0].internal.file_size, root_size );
+    ASSERT_EQ( entry_inode(&fs, &fs.inodes[0], 32), 4 );
+    ASSERT_STREQ( fs.inodes[4].internal.file_name, "novel.txt" );
+
+    fs_file_t file = fs_open(&ctx, PATH("novel.txt"));
+    ASSERT_NE( file, nullptr );
+    ASSERT_EQ( file->inode, &fs.inodes[4] );
+    fs_close(file);
+    free_filesystem(&fs);
+}
+
+// a file moves into a directory with room in its last dblock, on a file system
+// without any available dblock
+TEST_F(FSRenameSuite, MoveFile0)
+{
+    filesystem_t fs;
+    load_fs(INPUT "full_medium.bin", fs);
+    int ret;
+
+    terminal_context_t ctx { &fs, &fs.inodes[1] };
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ret = fs_rename(&ctx, PATH("b/hello.txt"), PATH("d/hi.txt"));
+    }   // end stdout logging
+
+    ASSERT_EQ(ret, 0) << "Incorrect return value";
+    check_stdout(OUTPUT "Empty.txt");
+
+    inode_t *b = &fs.inodes[2];
+    inode_t *d = &fs.inodes[7];
+    ASSERT_EQ( b->internal.file_size, 48u ) << "The old entry was the last one and is cut off.";
+    ASSERT_EQ( d->internal.file_size, 64u );
+    ASSERT_EQ( entry_inode(&fs, d, 48), 5 );
+    ASSERT_STREQ( fs.inodes[5].internal.file_name, "hi.txt" );
+
+    free_filesystem(&fs);
+}
+
+// a moved directory gets its `..` entry updated and keeps its dblocks
+TEST_F(FSRenameSuite, MoveDirectory0)
+{
+    filesystem_t fs;
+    load_fs(INPUT "medium.bin", fs);
+    int ret;
+
+    terminal_context_t ctx { &fs, &fs.inodes[0] };
+    inode_t *b = &fs.inodes[2];
+    dblock_index_t b_dblock = b->internal.direct_data[0];
+    size_t used = used_dblocks(&fs);
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ret = fs_rename(&ctx, PATH("a/b"), PATH("b"));
+    }   // end stdout logging
+
+    ASSERT_EQ(ret, 0) << "Incorrect return value";
+    check_stdout(OUTPUT "Empty.txt");
+
+    ASSERT_EQ( used_dblocks(&fs), used + 1 ) << "Only the root directory grows by a dblock.";
+    ASSERT_EQ( b->internal.direct_data[0], b_dblock );
+    ASSERT_EQ( entry_inode(&fs, b, 16), 0 ) << "`..` of the moved directory is the root.";
+    ASSERT_EQ( entry_inode(&fs, &fs.inodes[1], 32), 0 ) << "The old entry becomes a tombstone.";
+
+    terminal_context_t moved { &fs, &fs.inodes[3] };
+    char *path = get_path_string(&moved);
+    ASSERT_STREQ( path, "root/b/c" );
+    free(path);
+    free_filesystem(&fs);
+}
+
+// moving the entry that starts the last dblock of a directory gives that dblock back, as
+// removing it would
+TEST_F(FSRenameSuite, MoveFile1)
+{
+    filesystem_t fs;
+    terminal_context_t ctx;
+    int ret;
+    size_t available;
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ASSERT_EQ( new_filesystem(&fs, 2 * DEFAULT_DATA_BLOCK_SIZE / NARROW_DIRECTORY_ENTRY_SIZE, 64), SUCCESS );
+        new_terminal(&fs, &ctx);
+        ASSERT_EQ( new_directory(&ctx, PATH("dir")), 0 );
+        for (size_t i = 2; i < DIRECTORY_ENTRIES_PER_DATABLOCK(&fs); ++i)
+        {
+            std::string path = "dir/f" + std::to_string(i);
+            ASSERT_EQ( new_file(&ctx, path.data(), FS_READ), 0 );
+        }
+        available = available_dblocks(&fs);
+        ASSERT_EQ( new_file(&ctx, PATH("dir/last"), FS_READ), 0 );
+        ASSERT_EQ( available_dblocks(&fs), available - 1 );
+        ret = fs_rename(&ctx, PATH("dir/last"), PATH("last"));
+    }   // end stdout logging
+
+    ASSERT_EQ(ret, 0) << "Incorrect return value";
+    check_stdout(OUTPUT "Empty.txt");
+
+    inode_t *dir = &fs.inodes[1];
+    ASSERT_EQ( dir->internal.file_size, DATA_BLOCK_SIZE(&fs) );
+    ASSERT_EQ( available_dblocks(&fs), available ) << "The dblock the entry took is given back.";
+    free_filesystem(&fs);
+}
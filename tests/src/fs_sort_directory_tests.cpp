@@ -0,0 +1,293 @@
+#include "test_util.hpp"
+
+#include <string>
+
+extern "C"
+{
+    #include "checksum.h"
+}
+
+using FSSortDirectorySuite = fs_internal_test;
+
+// enough files for a tree of several levels
+static constexpr size_t file_count = 300;
+
+static std::string file_name(size_t i)
+{
+    return "file" + std::to_string(i) + ".txt";
+}
+
+// number of claimed dblocks
+static size_t used_dblocks(filesystem_t *fs)
+{
+    return fs->dblock_count - available_dblocks(fs);
+}
+
+// the inode a path leads to, null if it does not lead anywhere
+static inode_t *inode_at(terminal_context_t *ctx, const std::string& path)
+{
+    fs_file_t file = fs_open(ctx, std::string{ path }.data());
+    if (!file) return nullptr;
+    inode_t *inode = file->inode;
+    fs_close(file);
+    return inode;
+}
+
+// sorts the root directory of a new file system and fills it with `file_count` files, in
+// an order that is not the order of their names
+static void make_sorted_directory(filesystem_t *fs, terminal_context_t *ctx)
+{
+    ASSERT_EQ( new_filesystem(fs, file_count + 8, 2048), SUCCESS );
+    new_terminal(fs, ctx);
+    ASSERT_EQ( fs_sort_directory(ctx, PATH(".")), 0 );
+    for (size_t i = 0; i < file_count; ++i)
+    {
+        ASSERT_EQ( new_file(ctx, file_name(i * 7 % file_count).data(), FS_READ), 0 );
+    }
+}
+
+TEST_F(FSSortDirectorySuite, InvalidInput)
+{
+    constexpr int expected_ret = 0;
+    // dummy data for testing
+    terminal_context_t ctx{
+        (filesystem_t*) 0x12345678,
+        (inode_t*) 0x87654321
+    };
+
+    int ret0, ret1;
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+
+        ret0 = fs_sort_directory(NULL, PATH("a"));
+        ret1 = fs_sort_directory(&ctx, NULL);
+    }   // end stdout logging
+
+    ASSERT_EQ(ret0, expected_ret) << "Incorrect return value for null context argument.";
+    ASSERT_EQ(ret1, expected_ret) << "Incorrect return value for null path argument.";
+
+    check_stdout(OUTPUT "Empty.txt");
+}
+
+// only directories are sorted
+TEST_F(FSSortDirectorySuite, InvalidPath0)
+{
+    filesystem_t fs;
+    load_fs(INPUT "medium.bin", fs);
+    terminal_context_t ctx { &fs, &fs.inodes[0] };
+    int ret;
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ret = fs_sort_directory(&ctx, PATH("book.txt"));
+    }   // end stdout logging
+
+    ASSERT_EQ(ret, -1) << "Incorrect return value";
+    check_stdout(OUTPUT "DirectoryNotFound.txt");
+    free_filesystem(&fs);
+}
+
+// a sorted directory lists its entries in name order, whatever order they were added in
+TEST_F(FSSortDirectorySuite, List0)
+{
+    filesystem_t fs;
+    ASSERT_EQ( new_filesystem(&fs, 16, 64), SUCCESS );
+    terminal_context_t ctx;
+    new_terminal(&fs, &ctx);
+    int ret;
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ASSERT_EQ( new_file(&ctx, PATH("delta"), FS_READ), 0 );
+        ASSERT_EQ( new_directory(&ctx, PATH("bravo")), 0 );
+        ASSERT_EQ( fs_sort_directory(&ctx, PATH(".")), 0 );
+        ASSERT_EQ( new_file(&ctx, PATH("charlie"), (permission_t) (FS_READ | FS_WRITE)), 0 );
+        ASSERT_EQ( new_file(&ctx, PATH("alpha"), FS_READ), 0 );
+        ASSERT_EQ( new_file(&ctx, PATH("echo.txt"), FS_READ), 0 );
+        ASSERT_EQ( new_file(&ctx, PATH("echo"), FS_READ), 0 );
+        ret = list(&ctx, PATH("."));
+    }   // end stdout logging
+
+    ASSERT_EQ(ret, 0) << "Incorrect return value";
+    check_stdout(OUTPUT "SortedList0.txt");
+    ASSERT_EQ( fs.inodes[0].internal.file_size, 7 * DIRECTORY_ENTRY_SIZE(&fs) );
+    free_filesystem(&fs);
+}
+
+// every file of a sorted directory is found, before and after half of them are removed
+TEST_F(FSSortDirectorySuite, Lookup0)
+{
+    filesystem_t fs;
+    terminal_context_t ctx;
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        make_sorted_directory(&fs, &ctx);
+        for (size_t i = 0; i < file_count; ++i)
+        {
+            ASSERT_EQ( inode_at(&ctx, file_name(i)), &fs.inodes[i * 43 % file_count + 1] ) << file_name(i);
+        }
+        for (size_t i = 0; i < file_count; i += 2)
+        {
+            ASSERT_EQ( remove_file(&ctx, file_name(i).data()), 0 );
+        }
+        for (size_t i = 1; i < file_count; i += 2)
+        {
+            ASSERT_NE( inode_at(&ctx, file_name(i)), nullptr ) << file_name(i);
+        }
+    }   // end stdout logging
+
+    check_stdout(OUTPUT "Empty.txt");
+    ASSERT_EQ( fs.inodes[0].internal.file_size, (file_count / 2 + 1) * DIRECTORY_ENTRY_SIZE(&fs) );
+    free_filesystem(&fs);
+}
+
+// a name of a sorted directory cannot be created twice
+TEST_F(FSSortDirectorySuite, Exists0)
+{
+    filesystem_t fs;
+    terminal_context_t ctx;
+    int ret;
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        make_sorted_directory(&fs, &ctx);
+        ret = new_file(&ctx, PATH("file123.txt"), FS_READ);
+    }   // end stdout logging
+
+    ASSERT_EQ(ret, -1) << "Incorrect return value";
+    check_stdout(OUTPUT "FileExist.txt");
+    free_filesystem(&fs);
+}
+
+// a pattern lists the same entries of a directory before and after it is sorted
+TEST_F(FSSortDirectorySuite, Pattern0)
+{
+    filesystem_t fs;
+    load_fs(INPUT "medium.bin", fs);
+    terminal_context_t ctx { &fs, &fs.inodes[0] };
+    int ret0, ret1, ret2, ret3;
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ret0 = list(&ctx, PATH("b*"));
+        ASSERT_EQ( fs_sort_directory(&ctx, PATH(".")), 0 );
+        ret1 = list(&ctx, PATH("b*"));
+        ret2 = list(&ctx, PATH("a/b/*.t?t"));
+        ret3 = list(&ctx, PATH("c*"));
+    }   // end stdout logging
+
+    ASSERT_EQ(ret0, 0) << "Incorrect return value";
+    ASSERT_EQ(ret1, 0) << "Incorrect return value";
+    ASSERT_EQ(ret2, 0) << "Incorrect return value";
+    ASSERT_EQ(ret3, -1) << "Incorrect return value for a pattern without matches";
+    check_stdout(OUTPUT "ListPattern0.txt");
+    free_filesystem(&fs);
+}
+
+// renames and moves into and out of a sorted directory, including the `..` of a directory
+TEST_F(FSSortDirectorySuite, Rename0)
+{
+    filesystem_t fs;
+    terminal_context_t ctx;
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        make_sorted_directory(&fs, &ctx);
+        inode_t *renamed = inode_at(&ctx, "file10.txt");
+        ASSERT_EQ( fs_rename(&ctx, PATH("file10.txt"), PATH("zz.txt")), 0 );
+        ASSERT_EQ( inode_at(&ctx, "zz.txt"), renamed );
+        ASSERT_EQ( inode_at(&ctx, "file10.txt"), nullptr );
+
+        ASSERT_EQ( new_directory(&ctx, PATH("dir")), 0 );
+        ASSERT_EQ( fs_rename(&ctx, PATH("file20.txt"), PATH("dir/moved.txt")), 0 );
+        ASSERT_EQ( fs_rename(&ctx, PATH("dir/moved.txt"), PATH("back.txt")), 0 );
+        ASSERT_NE( inode_at(&ctx, "back.txt"), nullptr );
+
+        ASSERT_EQ( fs_sort_directory(&ctx, PATH("dir")), 0 );
+        ASSERT_EQ( new_directory(&ctx, PATH("sub")), 0 );
+        ASSERT_EQ( fs_rename(&ctx, PATH("sub"), PATH("dir/sub")), 0 );
+        ASSERT_EQ( change_directory(&ctx, PATH("dir/sub/..")), 0 );
+        ASSERT_EQ( ctx.working_directory, &fs.inodes[file_count + 1] );
+    }   // end stdout logging
+
+    check_stdout(OUTPUT "FileNotFound.txt");
+    ASSERT_EQ( fs.inodes[0].internal.file_size, (file_count + 2) * DIRECTORY_ENTRY_SIZE(&fs) );
+    free_filesystem(&fs);
+}
+
+// compacting packs the tree, and removing a sorted directory gives back all of its dblocks
+TEST_F(FSSortDirectorySuite, Remove0)
+{
+    filesystem_t fs;
+    ASSERT_EQ( new_filesystem(&fs, file_count + 8, 2048), SUCCESS );
+    terminal_context_t ctx;
+    new_terminal(&fs, &ctx);
+    size_t empty = used_dblocks(&fs);
+    size_t filled, compacted;
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ASSERT_EQ( new_directory(&ctx, PATH("dir")), 0 );
+        ASSERT_EQ( fs_sort_directory(&ctx, PATH("dir")), 0 );
+        ASSERT_EQ( change_directory(&ctx, PATH("dir")), 0 );
+        for (size_t i = 0; i < file_count; ++i)
+        {
+            ASSERT_EQ( new_file(&ctx, file_name(i).data(), FS_READ), 0 );
+        }
+        filled = used_dblocks(&fs);
+        for (size_t i = 0; i < file_count; ++i)
+        {
+            ASSERT_EQ( remove_file(&ctx, file_name(i).data()), 0 );
+        }
+        ASSERT_EQ( fs_compact(&ctx, PATH(".")), 0 );
+        compacted = used_dblocks(&fs);
+        ASSERT_EQ( change_directory(&ctx, PATH("..")), 0 );
+        ASSERT_EQ( remove_directory(&ctx, PATH("dir")), 0 );
+    }   // end stdout logging
+
+    check_stdout(OUTPUT "Empty.txt");
+    ASSERT_LT( compacted, filled );
+    ASSERT_EQ( compacted, empty + 1 ) << "`.` and `..` fit in one leaf.";
+    ASSERT_EQ( used_dblocks(&fs), empty );
+    free_filesystem(&fs);
+}
+
+// a sorted directory is saved and loaded like any other, and its dblocks keep their
+// checksums
+TEST_F(FSSortDirectorySuite, Save0)
+{
+    filesystem_t fs, loaded;
+    terminal_context_t ctx;
+    scrub_report_t report;
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ASSERT_EQ( new_filesystem(&fs, file_count + 8, 2048), SUCCESS );
+        ASSERT_EQ( fs_enable_checksums(&fs), SUCCESS );
+        new_terminal(&fs, &ctx);
+        ASSERT_EQ( fs_sort_directory(&ctx, PATH(".")), 0 );
+        for (size_t i = 0; i < file_count; ++i)
+        {
+            ASSERT_EQ( new_file(&ctx, file_name(i).data(), FS_READ), 0 );
+        }
+        ASSERT_EQ( fs_scrub(&fs, 1, &report), SUCCESS );
+
+        FILE *file = tmpfile();
+        ASSERT_NE( file, nullptr );
+        ASSERT_EQ( save_filesystem(file, &fs), SUCCESS );
+        rewind(file);
+        ASSERT_EQ( load_filesystem(file, &loaded), SUCCESS );
+        fclose(file);
+        new_terminal(&loaded, &ctx);
+        for (size_t i = 0; i < file_count; ++i)
+        {
+            ASSERT_EQ( inode_at(&ctx, file_name(i)), &loaded.inodes[i + 1] ) << file_name(i);
+        }
+    }   // end stdout logging
+
+    check_stdout(OUTPUT "Empty.txt");
+    ASSERT_EQ( report.mismatch_count, 0u );
+    free_filesystem(&fs);
+    free_filesystem(&loaded);
+}
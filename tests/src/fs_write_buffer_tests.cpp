@@ -0,0 +1,199 @@
+#include "test_util.hpp"
+
+using FSWriteBufferSuite = fs_internal_test;
+
+TEST_F(FSWriteBufferSuite, InvalidInput)
+{
+    ASSERT_EQ( fs_set_write_buffer(NULL, 64), -1 );
+    ASSERT_EQ( fs_flush(NULL), -1 );
+}
+
+// small buffered writes produce the same file system as one direct write
+// same as FSWriteSuite.WriteExpandFile0, four bytes at a time
+TEST_F(FSWriteBufferSuite, BufferedExpandFile0)
+{
+    constexpr size_t buffer_size = 32;
+    constexpr size_t record_size = 4;
+    constexpr size_t offset = 600;
+    constexpr size_t inode_index = 1;
+
+    filesystem_t fs;
+    load_fs(INPUT "medium_text.bin", fs);
+
+    inode_t *inode = &fs.inodes[inode_index];
+    size_t original_size = inode->internal.file_size;
+    struct fs_file file {
+        &fs,
+        inode,
+        offset
+    };
+    ASSERT_EQ( fs_set_write_buffer(&file, 256), 0 );
+
+    char buffer[buffer_size];
+    memset(buffer, 0x44, buffer_size);
+    for (size_t i = 0; i < buffer_size; i += record_size)
+    {
+        ASSERT_EQ( fs_write(&file, buffer + i, record_size), record_size );
+    }
+    ASSERT_EQ( file.offset, offset + buffer_size );
+    ASSERT_EQ( inode->internal.file_size, original_size ) << "Writes should still be buffered.";
+
+    ASSERT_EQ( fs_flush(&file), 0 );
+    ASSERT_EQ( inode->internal.file_size, offset + buffer_size );
+    check_fs(OUTPUT "WriteExpandFile0.bin", fs);
+
+    ASSERT_EQ( fs_set_write_buffer(&file, 0), 0 );
+    free_filesystem(&fs);
+}
+
+// reads and seeks through any handle of the file see the buffered data
+TEST_F(FSWriteBufferSuite, ReadOtherHandle0)
+{
+    constexpr size_t inode_index = 1;
+    constexpr size_t offset = 614;
+
+    filesystem_t fs;
+    load_fs(INPUT "medium_text.bin", fs);
+
+    inode_t *inode = &fs.inodes[inode_index];
+    struct fs_file writer { &fs, inode, offset };
+    struct fs_file reader { &fs, inode, offset };
+    ASSERT_EQ( fs_set_write_buffer(&writer, 128), 0 );
+
+    ASSERT_EQ( fs_write(&writer, (void*) "hello ", 6), 6u );
+    ASSERT_EQ( fs_write(&writer, (void*) "world", 5), 5u );
+
+    char output[16] = { 0 };
+    ASSERT_EQ( fs_read(&reader, output, sizeof(output)), 11u );
+    ASSERT_STREQ( output, "hello world" );
+
+    // a seek relative to the end sees the new size
+    ASSERT_EQ( fs_write(&writer, (void*) "!", 1), 1u );
+    ASSERT_EQ( fs_seek(&reader, FS_SEEK_END, -1), 0 );
+    ASSERT_EQ( reader.offset, offset + 11 );
+
+    ASSERT_EQ( fs_set_write_buffer(&writer, 0), 0 );
+    free_filesystem(&fs);
+}
+
+// a direct write through another handle is ordered after the buffered data
+TEST_F(FSWriteBufferSuite, WriteOtherHandle0)
+{
+    constexpr size_t inode_index = 1;
+
+    filesystem_t fs;
+    load_fs(INPUT "medium_text.bin", fs);
+
+    inode_t *inode = &fs.inodes[inode_index];
+    struct fs_file first { &fs, inode, 10 };
+    struct fs_file second { &fs, inode, 12 };
+    ASSERT_EQ( fs_set_write_buffer(&first, 64), 0 );
+
+    ASSERT_EQ( fs_write(&first, (void*) "AAAA", 4), 4u );
+    ASSERT_EQ( fs_write(&second, (void*) "BB", 2), 2u );
+
+    char output[5] = { 0 };
+    struct fs_file reader { &fs, inode, 10 };
+    ASSERT_EQ( fs_read(&reader, output, 4), 4u );
+    ASSERT_STREQ( output, "AABB" );
+
+    ASSERT_EQ( fs_set_write_buffer(&first, 0), 0 );
+    free_filesystem(&fs);
+}
+
+// buffered writes beyond the space of the file system are rejected up front
+TEST_F(FSWriteBufferSuite, BufferFull0)
+{
+    filesystem_t fs;
+    load_fs(INPUT "full_medium.bin", fs);
+
+    inode_t *inode = &fs.inodes[1];
+    size_t size = inode->internal.file_size;
+    struct fs_file file { &fs, inode, size };
+    ASSERT_EQ( fs_set_write_buffer(&file, 256), 0 );
+
+    char buffer[MAX_DATA_BLOCK_SIZE];
+    memset(buffer, 0x41, sizeof(buffer));
+    size_t room = (DATA_BLOCK_SIZE(&fs) - size % DATA_BLOCK_SIZE(&fs)) % DATA_BLOCK_SIZE(&fs);
+    if (room)
+    {
+        ASSERT_EQ( fs_write(&file, buffer, room), room ) << "The last block still has room.";
+    }
+    ASSERT_EQ( fs_write(&file, buffer, 1), 0u ) << "No dblock is left for the next byte.";
+
+    ASSERT_EQ( fs_flush(&file), 0 );
+    ASSERT_EQ( inode->internal.file_size, size + room );
+
+    ASSERT_EQ( fs_set_write_buffer(&file, 0), 0 );
+    free_filesystem(&fs);
+}
+
+// a fill is ordered after the buffered writes of every handle and moves the offset
+TEST_F(FSWriteBufferSuite, FillAfterBuffered0)
+{
+    filesystem_t fs;
+    load_fs(INPUT "medium_text.bin", fs);
+
+    inode_t *inode = &fs.inodes[1];
+    struct fs_file writer { &fs, inode, 20 };
+    struct fs_file filler { &fs, inode, 22 };
+    ASSERT_EQ( fs_set_write_buffer(&writer, 64), 0 );
+
+    ASSERT_EQ( fs_write(&writer, (void*) "AAAA", 4), 4u );
+    ASSERT_EQ( fs_fill(&filler, "xy", 2, 5), 5u );
+    ASSERT_EQ( filler.offset, 27u );
+    ASSERT_EQ( fs_fill(NULL, "xy", 2, 5), 0u );
+    ASSERT_EQ( fs_fill(&filler, "xy", 0, 5), 0u );
+
+    char output[8] = { 0 };
+    struct fs_file reader { &fs, inode, 20 };
+    ASSERT_EQ( fs_read(&reader, output, 7), 7u );
+    ASSERT_STREQ( output, "AAxyxyx" );
+
+    ASSERT_EQ( fs_set_write_buffer(&writer, 0), 0 );
+    free_filesystem(&fs);
+}
+
+// the buffered writes of a removed file are dropped, so closing its handles leaves the
+// file that reuses its inode untouched
+TEST_F(FSWriteBufferSuite, RemoveBuffered0)
+{
+    filesystem_t fs;
+    terminal_context_t ctx;
+    fs_file_t file, nested;
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ASSERT_EQ( new_filesystem(&fs, 8, 16), SUCCESS );
+        new_terminal(&fs, &ctx);
+        ASSERT_EQ( new_file(&ctx, PATH("a"), (permission_t) (FS_READ | FS_WRITE)), 0 );
+        ASSERT_EQ( new_directory(&ctx, PATH("dir")), 0 );
+        ASSERT_EQ( new_file(&ctx, PATH("dir/b"), (permission_t) (FS_READ | FS_WRITE)), 0 );
+        file = fs_open(&ctx, PATH("a"));
+        nested = fs_open(&ctx, PATH("dir/b"));
+        ASSERT_NE( file, nullptr );
+        ASSERT_NE( nested, nullptr );
+        ASSERT_EQ( fs_set_write_buffer(file, 64), 0 );
+        ASSERT_EQ( fs_set_write_buffer(nested, 64), 0 );
+        ASSERT_EQ( fs_write(file, (void*) "hello", 5), 5u );
+        ASSERT_EQ( fs_write(nested, (void*) "world", 5), 5u );
+
+        ASSERT_EQ( remove_file(&ctx, PATH("a")), 0 );
+        ASSERT_EQ( remove_tree(&ctx, PATH("dir")), 0 );
+        ASSERT_EQ( new_file(&ctx, PATH("c"), (permission_t) (FS_READ | FS_WRITE)), 0 );
+        ASSERT_EQ( new_file(&ctx, PATH("d"), (permission_t) (FS_READ | FS_WRITE)), 0 );
+        ASSERT_EQ( fs_flush(file), 0 );
+        fs_close(file);
+        fs_close(nested);
+    }   // end stdout logging
+
+    check_stdout(OUTPUT "Empty.txt");
+    for (size_t i = 1; i < fs.inode_count; ++i)
+    {
+        if (fs.inodes[i].internal.file_type == DATA_FILE && fs.inodes[i].internal.file_name[0] != '\0')
+        {
+            ASSERT_EQ( fs.inodes[i].internal.file_size, 0u ) << fs.inodes[i].internal.file_name;
+        }
+    }
+    ASSERT_EQ( available_dblocks(&fs), fs.dblock_count - 1 );
+    free_filesystem(&fs);
+}
@@ -1,5 +1,8 @@
 #include "test_util.hpp"
 
+#include <string>
+#include <vector>
+
 using PathStringSuite = fs_internal_test;
 
 TEST_F(PathStringSuite, InvalidInput)
@@ -55,4 +58,97 @@ TEST_F(PathStringSuite, PathString2)
 
     free(output_path_string);
     free_filesystem(&fs);
-}
\ No newline at end of file
+}
+// once the parents of the directories on the way are known, a path is built without a
+// single lookup, and it follows the directories when they are renamed and moved
+TEST_F(PathStringSuite, PathString3)
+{
+    filesystem_t fs;
+    load_fs(INPUT "medium.bin", fs);
+    terminal_context_t ctx { &fs, &fs.inodes[3] };
+    char *first, *second, *renamed, *moved;
+    dentry_cache_stats_t before, after;
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        first = get_path_string(&ctx);
+        fs_dentry_cache_stats(&fs, &before);
+        second = get_path_string(&ctx);
+        fs_dentry_cache_stats(&fs, &after);
+
+        ASSERT_EQ( fs_rename(&ctx, PATH(".."), PATH("../../x")), -1 ) << "`..` cannot be renamed.";
+        ctx.working_directory = &fs.inodes[0];
+        ASSERT_EQ( fs_rename(&ctx, PATH("a/b"), PATH("a/bb")), 0 );
+        ctx.working_directory = &fs.inodes[3];
+        renamed = get_path_string(&ctx);
+        ctx.working_directory = &fs.inodes[0];
+        ASSERT_EQ( fs_rename(&ctx, PATH("a/bb"), PATH("top")), 0 );
+        ctx.working_directory = &fs.inodes[3];
+        moved = get_path_string(&ctx);
+    }   // end stdout logging
+
+    check_stdout(OUTPUT "InvalidFilename.txt");
+    ASSERT_STREQ(first, "root/a/b/c");
+    ASSERT_STREQ(second, "root/a/b/c");
+    ASSERT_EQ(after.hits + after.misses, before.hits + before.misses) << "The second path needs no lookup.";
+    ASSERT_STREQ(renamed, "root/a/bb/c");
+    ASSERT_STREQ(moved, "root/top/c");
+
+    free(first);
+    free(second);
+    free(renamed);
+    free(moved);
+    free_filesystem(&fs);
+}
+
+// the path follows `change_directory` up and down, and a directory removed and made again
+// under another name is not shown under its old one
+TEST_F(PathStringSuite, PathString4)
+{
+    filesystem_t fs;
+    ASSERT_EQ( new_filesystem(&fs, 16, 64), SUCCESS );
+    terminal_context_t ctx, other;
+    new_terminal(&fs, &ctx);
+    new_terminal(&fs, &other);
+    std::vector<std::string> paths;
+    auto record = [&paths, &ctx]() {
+        char *path = get_path_string(&ctx);
+        paths.emplace_back(path);
+        free(path);
+    };
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ASSERT_EQ( new_directory(&ctx, PATH("a")), 0 );
+        ASSERT_EQ( new_directory(&ctx, PATH("a/bb")), 0 );
+        ASSERT_EQ( new_directory(&ctx, PATH("a/bb/c")), 0 );
+        record();
+        ASSERT_EQ( change_directory(&ctx, PATH("a")), 0 );
+        record();
+        ASSERT_EQ( change_directory(&ctx, PATH("bb")), 0 );
+        record();
+        ASSERT_EQ( change_directory(&ctx, PATH("c/..")), 0 );
+        record();
+        ASSERT_EQ( change_directory(&ctx, PATH("..")), 0 );
+        record();
+        ASSERT_EQ( change_directory(&ctx, PATH("bb/c")), 0 );
+        record();
+        ASSERT_EQ( change_directory(&ctx, PATH("../../..")), 0 );
+        record();
+
+        ASSERT_EQ( change_directory(&ctx, PATH("a/bb/c")), 0 );
+        record();
+        ASSERT_EQ( remove_directory(&other, PATH("a/bb/c")), 0 );
+        ASSERT_EQ( new_directory(&other, PATH("a/d")), 0 );
+        record();
+    }   // end stdout logging
+
+    check_stdout(OUTPUT "Empty.txt");
+    std::vector<std::string> expected{
+        "root", "root/a", "root/a/bb", "root/a/bb", "root/a", "root/a/bb/c", "root",
+        "root/a/bb/c", "root/a/d"
+    };
+    ASSERT_EQ(paths, expected);
+    ASSERT_EQ( ctx.working_directory, &fs.inodes[3] ) << "The new directory takes the inode of the removed one.";
+    free_filesystem(&fs);
+}
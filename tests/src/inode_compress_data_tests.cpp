@@ -0,0 +1,215 @@
+#include "test_util.hpp"
+
+#include <vector>
+
+extern "C"
+{
+    #include "checksum.h"
+    #include "compress.h"
+    #include "utility.h"
+}
+
+using INodeCompressDataSuite = fs_internal_test;
+
+static std::vector<char> repetitive_text(std::size_t size)
+{
+    const char sentence[] = "Anyway, keep at it! There is a lot to learn from this assignment. ";
+    std::vector<char> text(size);
+    for (std::size_t i = 0; i < size; ++i) text[i] = sentence[i % (std::size(sentence) - 1)];
+    return text;
+}
+
+static inode_t *empty_data_file(filesystem_t& fs)
+{
+    inode_index_t index;
+    if (claim_available_inode(&fs, &index) != SUCCESS) return nullptr;
+    inode_t *inode = &fs.inodes[index];
+    memset(inode, 0, sizeof(*inode));
+    inode->internal.file_type = DATA_FILE;
+    inode->internal.file_perms = FS_READ;
+    return inode;
+}
+
+// check for basic invalid inputs
+TEST_F(INodeCompressDataSuite, InvalidInput)
+{
+    filesystem_t fs;
+    new_filesystem(&fs, 1, 1);
+    inode_t *root = &fs.inodes[0];
+
+    ASSERT_EQ( inode_compress_data(&fs, NULL), INVALID_INPUT );
+    ASSERT_EQ( inode_compress_data(NULL, root), INVALID_INPUT );
+    ASSERT_EQ( inode_compress_data(&fs, root), INVALID_INPUT ) << "Directories cannot be compressed.";
+    ASSERT_EQ( inode_decompress_data(&fs, NULL), INVALID_INPUT );
+
+    free_filesystem(&fs);
+}
+
+// codec round trip, including matches that overlap their own output
+TEST_F(INodeCompressDataSuite, CodecRoundTrip)
+{
+    std::vector<char> text = repetitive_text(3000);
+    text.insert(text.end(), 500, 'z');
+
+    std::vector<byte> compressed(text.size());
+    size_t compressed_size = lz_compress((byte*) text.data(), text.size(), compressed.data(), compressed.size());
+    ASSERT_GT(compressed_size, 0u);
+    ASSERT_LT(compressed_size, text.size() / 4) << "Repetitive text should compress well.";
+
+    std::vector<char> output(text.size());
+    ASSERT_EQ(lz_decompress(compressed.data(), compressed_size, (byte*) output.data(), output.size()), text.size());
+    ASSERT_EQ(output, text);
+
+    // truncated input must be rejected rather than read out of bounds
+    ASSERT_EQ(lz_decompress(compressed.data(), compressed_size / 2, (byte*) output.data(), output.size()), (size_t) -1);
+}
+
+// compressing frees dblocks and reads at any offset return the original bytes
+TEST_F(INodeCompressDataSuite, CompressRead0)
+{
+    constexpr std::size_t size = 10000;
+
+    filesystem_t fs;
+    new_filesystem(&fs, 4, 512);
+    inode_t *inode = empty_data_file(fs);
+    std::vector<char> text = repetitive_text(size);
+    ASSERT_EQ(inode_write_data(&fs, inode, text.data(), size), SUCCESS);
+    size_t available_before = available_dblocks(&fs);
+
+    ASSERT_EQ(inode_compress_data(&fs, inode), SUCCESS);
+    ASSERT_TRUE(inode->internal.file_perms & FS_COMPRESSED);
+    ASSERT_EQ(inode_data_size(&fs, inode), size);
+    ASSERT_GT(available_dblocks(&fs), available_before) << "Compression should release dblocks.";
+
+    const std::size_t offsets[] = { 0, 63, 256, 1000, 4095, 4096, 8190, size - 1 };
+    for (std::size_t offset : offsets)
+    {
+        char output[300] = { 0 };
+        size_t bytes_read = 0;
+        ASSERT_EQ(inode_read_data(&fs, inode, offset, output, sizeof(output), &bytes_read), SUCCESS);
+        size_t expected_read = std::min(sizeof(output), size - offset);
+        ASSERT_EQ(bytes_read, expected_read) << "Incorrect number of bytes read at offset " << offset;
+        ASSERT_EQ(memcmp(output, text.data() + offset, expected_read), 0) << "Incorrect data at offset " << offset;
+    }
+
+    free_filesystem(&fs);
+}
+
+// shrinking a compressed file past its end is refused without decompressing it
+TEST_F(INodeCompressDataSuite, ShrinkPastEnd0)
+{
+    constexpr std::size_t size = 5000;
+
+    filesystem_t fs;
+    new_filesystem(&fs, 4, 512);
+    inode_t *inode = empty_data_file(fs);
+    std::vector<char> text = repetitive_text(size);
+    ASSERT_EQ(inode_write_data(&fs, inode, text.data(), size), SUCCESS);
+    ASSERT_EQ(inode_compress_data(&fs, inode), SUCCESS);
+    size_t stored = inode->internal.file_size;
+    size_t available = available_dblocks(&fs);
+
+    ASSERT_EQ(inode_shrink_data(&fs, inode, size + 1), INVALID_INPUT);
+
+    ASSERT_TRUE(inode->internal.file_perms & FS_COMPRESSED);
+    ASSERT_EQ(inode->internal.file_size, stored);
+    ASSERT_EQ(available_dblocks(&fs), available);
+    ASSERT_EQ(inode_data_size(&fs, inode), size);
+
+    free_filesystem(&fs);
+}
+
+// writing to a compressed file converts it back to raw dblocks first
+TEST_F(INodeCompressDataSuite, WriteDecompresses0)
+{
+    constexpr std::size_t size = 5000;
+
+    filesystem_t fs;
+    new_filesystem(&fs, 4, 512);
+    inode_t *inode = empty_data_file(fs);
+    std::vector<char> text = repetitive_text(size);
+    ASSERT_EQ(inode_write_data(&fs, inode, text.data(), size), SUCCESS);
+    size_t available_raw = available_dblocks(&fs);
+
+    ASSERT_EQ(inode_compress_data(&fs, inode), SUCCESS);
+    ASSERT_EQ(inode_write_data(&fs, inode, (void*) "END", 3), SUCCESS);
+
+    ASSERT_FALSE(inode->internal.file_perms & FS_COMPRESSED);
+    ASSERT_EQ(inode->internal.file_size, size + 3);
+    ASSERT_EQ(available_dblocks(&fs), available_raw) << "Thawing should reuse as many dblocks as the raw file.";
+
+    std::vector<char> output(size + 3);
+    size_t bytes_read = 0;
+    ASSERT_EQ(inode_read_data(&fs, inode, 0, output.data(), output.size(), &bytes_read), SUCCESS);
+    ASSERT_EQ(bytes_read, size + 3);
+    ASSERT_EQ(memcmp(output.data(), text.data(), size), 0);
+    ASSERT_EQ(memcmp(output.data() + size, "END", 3), 0);
+
+    free_filesystem(&fs);
+}
+
+// releasing a compressed file gives back every dblock
+TEST_F(INodeCompressDataSuite, ReleaseCompressed0)
+{
+    filesystem_t fs;
+    new_filesystem(&fs, 4, 512);
+    size_t available_empty = available_dblocks(&fs);
+    inode_t *inode = empty_data_file(fs);
+    std::vector<char> text = repetitive_text(20000);
+    ASSERT_EQ(inode_write_data(&fs, inode, text.data(), text.size()), SUCCESS);
+    ASSERT_EQ(inode_compress_data(&fs, inode), SUCCESS);
+
+    ASSERT_EQ(inode_release_data(&fs, inode), SUCCESS);
+    ASSERT_FALSE(inode->internal.file_perms & FS_COMPRESSED);
+    ASSERT_EQ(inode->internal.file_size, 0u);
+    ASSERT_EQ(available_dblocks(&fs), available_empty);
+
+    free_filesystem(&fs);
+}
+
+// text from the class images barely compresses within one chunk and stays raw
+TEST_F(INodeCompressDataSuite, IncompressibleStaysRaw)
+{
+    filesystem_t fs;
+    load_fs(INPUT "medium_text.bin", fs);
+
+    inode_t *secret_file = &fs.inodes[6];
+    ASSERT_EQ(inode_compress_data(&fs, secret_file), SUCCESS);
+    ASSERT_FALSE(secret_file->internal.file_perms & FS_COMPRESSED);
+
+    check_fs(INPUT "medium_text.bin", fs);
+    free_filesystem(&fs);
+}
+
+// a read error while compressing leaves the file untouched, and reads of a compressed file
+// report the error rather than decoding what they got
+TEST_F(INodeCompressDataSuite, ReadError0)
+{
+    constexpr std::size_t size = 5000;
+
+    filesystem_t fs;
+    new_filesystem(&fs, 4, 512);
+    ASSERT_EQ(fs_enable_checksums(&fs), SUCCESS);
+    inode_t *inode = empty_data_file(fs);
+    std::vector<char> text = repetitive_text(size);
+    ASSERT_EQ(inode_write_data(&fs, inode, text.data(), size), SUCCESS);
+    size_t available_raw = available_dblocks(&fs);
+
+    dblock_index_t first = inode->internal.direct_data[0];
+    fs.dblocks[first * DATA_BLOCK_SIZE(&fs) + 7] ^= 0x10;
+    ASSERT_EQ(inode_compress_data(&fs, inode), CHECKSUM_MISMATCH);
+    ASSERT_FALSE(inode->internal.file_perms & FS_COMPRESSED);
+    ASSERT_EQ(inode->internal.file_size, size);
+    ASSERT_EQ(available_dblocks(&fs), available_raw);
+
+    fs.dblocks[first * DATA_BLOCK_SIZE(&fs) + 7] ^= 0x10;
+    ASSERT_EQ(inode_compress_data(&fs, inode), SUCCESS);
+    ASSERT_TRUE(inode->internal.file_perms & FS_COMPRESSED);
+    fs.dblocks[inode->internal.direct_data[0] * DATA_BLOCK_SIZE(&fs)] ^= 0x10;
+    char output[100];
+    size_t bytes_read = 0;
+    ASSERT_EQ(inode_read_data(&fs, inode, 0, output, sizeof(output), &bytes_read), CHECKSUM_MISMATCH);
+    ASSERT_EQ(inode_data_size(&fs, inode), 0u);
+
+    free_filesystem(&fs);
+}
@@ -1,5 +1,8 @@
 #include "test_util.hpp"
 
+#include <vector>
+#include <algorithm>
+
 using INodeModifyDataSuite = fs_internal_test;
 
 // check for basic invalid inputs
@@ -173,4 +176,83 @@ TEST_F(INodeModifyDataSuite, ModifyDirectIndirect1)
     check_fs(OUTPUT "ModifyDirectIndirect1.bin", fs);
 
     free_filesystem(&fs);
-}
\ No newline at end of file
+}
+// random overwrites and overwrites running past the end agree with a plain buffer
+TEST_F(INodeModifyDataSuite, ModifyRandom0)
+{
+    constexpr size_t max_size = 20000;
+
+    filesystem_t fs;
+    new_filesystem(&fs, 2, 1024);
+    inode_index_t inode_idx;
+    ASSERT_EQ( claim_available_inode(&fs, &inode_idx), SUCCESS );
+    inode_t *inode = &fs.inodes[inode_idx];
+    memset(inode, 0, sizeof(*inode));
+
+    std::vector<char> model;
+    std::vector<char> buffer(700);
+    unsigned seed = 1;
+    for (int op = 0; op < 200; ++op)
+    {
+        seed = seed * 1103515245u + 12345u;
+        size_t n = (seed >> 8) % buffer.size() + 1;
+        size_t offset = model.empty() ? 0 : (seed >> 4) % (model.size() + 1);
+        if (offset + n > max_size) offset = 0;
+        for (size_t i = 0; i < n; ++i) buffer[i] = static_cast<char>(seed >> (i % 24));
+
+        ASSERT_EQ( inode_modify_data(&fs, inode, offset, buffer.data(), n), SUCCESS );
+        if (offset + n > model.size()) model.resize(offset + n);
+        std::copy(buffer.begin(), buffer.begin() + n, model.begin() + offset);
+
+        std::vector<char> output(model.size());
+        size_t bytes_read = 0;
+        ASSERT_EQ( inode_read_data(&fs, inode, 0, output.data(), output.size(), &bytes_read), SUCCESS );
+        ASSERT_EQ( bytes_read, model.size() ) << "Incorrect size after operation " << op;
+        ASSERT_EQ( output, model ) << "Incorrect data after operation " << op;
+    }
+
+    free_filesystem(&fs);
+}
+
+// filling with a pattern matches modifying with the pattern written out, for random ranges
+// that overwrite, extend and start at every phase of a block
+TEST_F(INodeModifyDataSuite, FillRandom0)
+{
+    constexpr size_t max_size = 20000;
+    const char pattern[FS_FILL_PATTERN_MAX + 1] = "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ+/";
+
+    filesystem_t fs;
+    new_filesystem(&fs, 2, 1024);
+    inode_index_t inode_idx;
+    ASSERT_EQ( claim_available_inode(&fs, &inode_idx), SUCCESS );
+    inode_t *inode = &fs.inodes[inode_idx];
+    memset(inode, 0, sizeof(*inode));
+
+    ASSERT_EQ( inode_fill_data(&fs, inode, 0, pattern, 0, 10), INVALID_INPUT );
+    ASSERT_EQ( inode_fill_data(&fs, inode, 0, pattern, FS_FILL_PATTERN_MAX + 1, 10), INVALID_INPUT );
+    ASSERT_EQ( inode_fill_data(&fs, inode, 0, NULL, 1, 10), INVALID_INPUT );
+    ASSERT_EQ( inode_fill_data(&fs, inode, 1, pattern, 1, 10), INVALID_INPUT ) << "Offset past the end of the file.";
+
+    std::vector<char> model;
+    unsigned seed = 7;
+    for (int op = 0; op < 200; ++op)
+    {
+        seed = seed * 1103515245u + 12345u;
+        size_t n = (seed >> 8) % 900 + 1;
+        size_t offset = model.empty() ? 0 : (seed >> 4) % (model.size() + 1);
+        if (offset + n > max_size) offset = 0;
+        size_t pattern_size = op % 4 == 0 ? 1 : (seed >> 12) % FS_FILL_PATTERN_MAX + 1;
+
+        ASSERT_EQ( inode_fill_data(&fs, inode, offset, pattern, pattern_size, n), SUCCESS );
+        if (offset + n > model.size()) model.resize(offset + n);
+        for (size_t i = 0; i < n; ++i) model[offset + i] = pattern[i % pattern_size];
+
+        std::vector<char> output(model.size());
+        size_t bytes_read = 0;
+        ASSERT_EQ( inode_read_data(&fs, inode, 0, output.data(), output.size(), &bytes_read), SUCCESS );
+        ASSERT_EQ( bytes_read, model.size() ) << "Incorrect size after operation " << op;
+        ASSERT_EQ( output, model ) << "Incorrect data after operation " << op;
+    }
+
+    free_filesystem(&fs);
+}
@@ -1,5 +1,10 @@
 #include "test_util.hpp"
 
+extern "C"
+{
+    #include "utility.h"
+}
+
 using INodeShrinkDataSuite = fs_internal_test;
 
 // test for basic invalid input
@@ -181,4 +186,42 @@ TEST_F(INodeReleaseDataSuite, Release1)
 
     check_fs(OUTPUT "ShrinkComplete1.bin", fs);
     free_filesystem(&fs);
-}
\ No newline at end of file
+}
+// trim the tail of a long file a little at a time, crossing index dblock boundaries
+TEST_F(INodeShrinkDataSuite, ShrinkTailRepeated0)
+{
+    constexpr std::size_t size = 6000;
+
+    filesystem_t fs;
+    new_filesystem(&fs, 2, 256);
+    size_t available_empty = available_dblocks(&fs);
+
+    inode_index_t inode_idx;
+    ASSERT_EQ( claim_available_inode(&fs, &inode_idx), SUCCESS );
+    inode_t *inode = &fs.inodes[inode_idx];
+    memset(inode, 0, sizeof(*inode));
+
+    char data[size];
+    for (std::size_t i = 0; i < size; ++i) data[i] = static_cast<char>('A' + i % 26);
+    ASSERT_EQ( inode_write_data(&fs, inode, data, size), SUCCESS );
+
+    for (std::size_t new_size = size; new_size > 0; new_size = new_size > 137 ? new_size - 137 : 0)
+    {
+        ASSERT_EQ( inode_shrink_data(&fs, inode, new_size), SUCCESS );
+        ASSERT_EQ( available_dblocks(&fs), available_empty - calculate_necessary_dblock_amount(&fs, new_size) ) << "Leaked or over released dblocks at size " << new_size;
+
+        char output[size];
+        size_t bytes_read = 0;
+        ASSERT_EQ( inode_read_data(&fs, inode, 0, output, size, &bytes_read), SUCCESS );
+        ASSERT_EQ( bytes_read, new_size );
+        ASSERT_EQ( memcmp(output, data, new_size), 0 );
+
+        // appending again must reuse the released dblocks without corrupting the chain
+        ASSERT_EQ( inode_write_data(&fs, inode, data, 70), SUCCESS );
+        ASSERT_EQ( inode_shrink_data(&fs, inode, new_size), SUCCESS );
+    }
+    ASSERT_EQ( inode_shrink_data(&fs, inode, 0), SUCCESS );
+    ASSERT_EQ( available_dblocks(&fs), available_empty );
+
+    free_filesystem(&fs);
+}
@@ -1,5 +1,12 @@
 #include "test_util.hpp"
 
+#include <string>
+
+extern "C"
+{
+    #include "compress.h"
+}
+
 using ListSuite = fs_internal_test;
 
 TEST_F(ListSuite, InvalidInput)
@@ -128,3 +135,30 @@ TEST_F(ListSuite, List1)
     check_fs(INPUT "medium.bin", fs);
     free_filesystem(&fs);
 }
+
+// a compressed file is listed with the size it reads as
+TEST_F(ListSuite, ListCompressed0)
+{
+    constexpr size_t size = 5000;
+
+    filesystem_t fs;
+    terminal_context_t ctx;
+    int ret;
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ASSERT_EQ( new_filesystem(&fs, 4, 512), SUCCESS );
+        new_terminal(&fs, &ctx);
+        ASSERT_EQ( new_file(&ctx, PATH("packed"), FS_READ), 0 );
+        fs_file_t file = fs_open(&ctx, PATH("packed"));
+        ASSERT_NE( file, nullptr );
+        ASSERT_EQ( fs_write(file, std::string(size, 'z').data(), size), size );
+        ASSERT_EQ( inode_compress_data(&fs, file->inode), SUCCESS );
+        ASSERT_LT( file->inode->internal.file_size, size );
+        fs_close(file);
+        ret = list(&ctx, PATH("packed"));
+    }   // end stdout logging
+
+    ASSERT_EQ(ret, 0) << "Incorrect return value";
+    check_stdout(OUTPUT "ListCompressed0.txt");
+    free_filesystem(&fs);
+}
@@ -187,4 +187,30 @@ TEST_F(NewFileSuite, NewFile1)
     check_stdout(OUTPUT "Empty.txt");
     check_fs(OUTPUT "NewFile1.bin", fs);
     free_filesystem(&fs);
-}
\ No newline at end of file
+}
+// bits past the permissions are dropped, the file matches the one of NewFile0
+TEST_F(NewFileSuite, NewFile2)
+{
+    constexpr size_t inode_index = 1;
+    constexpr const char *path = "b/c/new.txt";
+    constexpr permission_t perm = (permission_t) 0xff;
+
+    constexpr int expected_ret = 0;
+
+    filesystem_t fs;
+    load_fs(INPUT "medium.bin", fs);
+    int ret;
+
+    terminal_context_t ctx { &fs, &fs.inodes[inode_index] };
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ret = new_file(&ctx, PATH(path), perm);
+    }   // end stdout logging
+
+    ASSERT_EQ(ret, expected_ret) << "Incorrect return value";
+
+    check_stdout(OUTPUT "Empty.txt");
+    check_fs(OUTPUT "NewFile0.bin", fs);
+    free_filesystem(&fs);
+}
@@ -1,5 +1,8 @@
 #include "test_util.hpp"
 
+#include <string>
+#include <vector>
+
 using NewFilesystemSuite = fs_internal_test;
 
 // test invalid input with null fs
@@ -25,6 +28,24 @@ TEST_F(NewFilesystemSuite, InvalidInput1)
     ASSERT_EQ(expected_retcode, output_retcode1) << "Return values do not match for dblock_total = 0 test case!";
 }
 
+// test invalid input with more inodes than an inode index can address
+TEST_F(NewFilesystemSuite, InvalidInput2)
+{
+    constexpr size_t inode_limit = (size_t) INODE_INDEX_MAX + 1;
+    constexpr size_t narrow_limit = (size_t) NARROW_INODE_INDEX_MAX + 1;
+
+    filesystem_t fs;
+    ASSERT_EQ(new_filesystem(&fs, inode_limit + 1, 1), INVALID_INPUT);
+    ASSERT_EQ(new_filesystem(&fs, narrow_limit, 1), SUCCESS);
+    ASSERT_EQ(available_inodes(&fs), narrow_limit - 1);
+    ASSERT_EQ(fs.index_width, NARROW_INODE_INDEX_WIDTH);
+    free_filesystem(&fs);
+    ASSERT_EQ(new_filesystem(&fs, narrow_limit + 1, 1), SUCCESS);
+    ASSERT_EQ(available_inodes(&fs), narrow_limit);
+    ASSERT_EQ(fs.index_width, WIDE_INODE_INDEX_WIDTH);
+    free_filesystem(&fs);
+}
+
 TEST_F(NewFilesystemSuite, SmallFS0)
 {
     constexpr size_t inode_total = 8;
@@ -66,3 +87,162 @@ TEST_F(NewFilesystemSuite, LargeFS0)
     check_fs(OUTPUT "LargeFS0.bin", fs);
     free_filesystem(&fs);
 }
+
+// the bytes of an image saved from `fs`
+static std::vector<char> saved_image(filesystem_t *fs)
+{
+    FILE *file = tmpfile();
+    EXPECT_NE(file, nullptr);
+    EXPECT_EQ(save_filesystem(file, fs), SUCCESS);
+    std::vector<char> image(ftell(file));
+    rewind(file);
+    EXPECT_EQ(fread(image.data(), 1, image.size(), file), image.size());
+    fclose(file);
+    return image;
+}
+
+// loads the bytes of an image into `fs`
+static fs_retcode_t load_image(const std::vector<char>& image, filesystem_t *fs)
+{
+    FILE *file = tmpfile();
+    EXPECT_NE(file, nullptr);
+    fwrite(image.data(), 1, image.size(), file);
+    rewind(file);
+    fs_retcode_t ret = load_filesystem(file, fs);
+    fclose(file);
+    return ret;
+}
+
+// every block size takes a file through its index dblocks and across a save and load, and
+// only the images of another block size than the default are tagged with it
+TEST_F(NewFilesystemSuite, Geometry0)
+{
+    for (size_t block_size : { (size_t) 64, (size_t) 512, (size_t) 4096 })
+    {
+        filesystem_t fs;
+        ASSERT_EQ(new_filesystem_geometry(&fs, 8, 64, block_size), SUCCESS);
+        ASSERT_EQ(DATA_BLOCK_SIZE(&fs), block_size);
+        terminal_context_t ctx;
+        new_terminal(&fs, &ctx);
+        std::vector<char> data((INODE_DIRECT_BLOCK_COUNT + 3) * block_size + 7);
+        for (size_t i = 0; i < data.size(); ++i) data[i] = (char) ('a' + i % 23);
+        filesystem_t loaded;
+
+        {   // begin stdout logging
+            stdout_logger_lock lk{ this };
+            ASSERT_EQ(new_file(&ctx, PATH("file"), (permission_t) (FS_READ | FS_WRITE)), 0);
+            fs_file_t file = fs_open(&ctx, PATH("file"));
+            ASSERT_NE(file, nullptr);
+            ASSERT_EQ(fs_write(file, data.data(), data.size()), data.size());
+            fs_close(file);
+
+            std::vector<char> image = saved_image(&fs);
+            ASSERT_EQ(std::string(image.data(), 8) == "GEOMETRY", block_size != DEFAULT_DATA_BLOCK_SIZE) << "block size " << block_size;
+            ASSERT_EQ(load_image(image, &loaded), SUCCESS) << "block size " << block_size;
+            ASSERT_EQ(DATA_BLOCK_SIZE(&loaded), block_size);
+            ASSERT_EQ(saved_image(&loaded), image) << "block size " << block_size;
+
+            terminal_context_t loaded_ctx;
+            new_terminal(&loaded, &loaded_ctx);
+            file = fs_open(&loaded_ctx, PATH("file"));
+            ASSERT_NE(file, nullptr);
+            std::vector<char> output(data.size());
+            ASSERT_EQ(fs_read(file, output.data(), output.size()), data.size());
+            ASSERT_EQ(output, data) << "block size " << block_size;
+            fs_close(file);
+        }   // end stdout logging
+
+        check_stdout(OUTPUT "Empty.txt");
+        free_filesystem(&loaded);
+        free_filesystem(&fs);
+    }
+}
+
+// block sizes out of range are refused, and so are images tagged with them or with
+// another count of direct blocks than the build has
+TEST_F(NewFilesystemSuite, Geometry1)
+{
+    filesystem_t fs;
+    for (size_t block_size : { (size_t) 16, (size_t) 48, (size_t) 8192 })
+    {
+        ASSERT_EQ(new_filesystem_geometry(&fs, 4, 16, block_size), INVALID_INPUT) << "block size " << block_size;
+    }
+
+    ASSERT_EQ(new_filesystem_geometry(&fs, 4, 16, 512), SUCCESS);
+    std::vector<char> image = saved_image(&fs);
+    free_filesystem(&fs);
+    const uint32_t geometries[][2] = { { 512, INODE_DIRECT_BLOCK_COUNT + 1 }, { 500, INODE_DIRECT_BLOCK_COUNT }, { 8192, INODE_DIRECT_BLOCK_COUNT } };
+    for (const uint32_t *geometry : geometries)
+    {
+        std::vector<char> tagged = image;
+        memcpy(tagged.data() + 8, geometry, 2 * sizeof(uint32_t));
+        filesystem_t loaded;
+        ASSERT_EQ(load_image(tagged, &loaded), INVALID_BINARY_FORMAT) << "block size " << geometry[0];
+    }
+}
+
+// an image holds 2 byte inode indices unless it has more inodes than they reach, and
+// `load_filesystem` takes either width
+TEST_F(NewFilesystemSuite, LoadWideFormat0)
+{
+    for (size_t inode_total : { (size_t) 4, (size_t) 70000 })
+    {
+        filesystem_t fs;
+        ASSERT_EQ(new_filesystem(&fs, inode_total, 16), SUCCESS);
+        size_t width = inode_total > 65536 ? WIDE_INODE_INDEX_WIDTH : NARROW_INODE_INDEX_WIDTH;
+        ASSERT_EQ(fs.index_width, width);
+        ASSERT_EQ(DIRECTORY_ENTRY_SIZE(&fs), width + MAX_FILE_NAME_LEN);
+
+        FILE *file = tmpfile();
+        ASSERT_NE(file, nullptr);
+        ASSERT_EQ(save_filesystem(file, &fs), SUCCESS);
+        std::vector<char> image(ftell(file));
+        rewind(file);
+        ASSERT_EQ(fread(image.data(), 1, image.size(), file), image.size());
+        ASSERT_EQ(std::string(image.data(), 8) == "FSWIDE32", width == WIDE_INODE_INDEX_WIDTH);
+        rewind(file);
+
+        filesystem_t loaded;
+        ASSERT_EQ(load_filesystem(file, &loaded), SUCCESS);
+        ASSERT_EQ(loaded.index_width, width);
+        ASSERT_EQ(loaded.available_inode, fs.available_inode);
+        ASSERT_EQ(loaded.inodes[1].next_free_inode, fs.inodes[1].next_free_inode);
+        fclose(file);
+
+        // saved again, the image is the same
+        file = tmpfile();
+        ASSERT_NE(file, nullptr);
+        ASSERT_EQ(save_filesystem(file, &loaded), SUCCESS);
+        std::vector<char> saved(ftell(file));
+        rewind(file);
+        ASSERT_EQ(fread(saved.data(), 1, saved.size(), file), saved.size());
+        ASSERT_EQ(saved, image);
+        fclose(file);
+        free_filesystem(&loaded);
+        free_filesystem(&fs);
+    }
+}
+
+// a narrow image with more inodes than its indices reach is refused on the header, so
+// nothing of `loaded` is allocated
+TEST_F(NewFilesystemSuite, LoadWideFormat1)
+{
+    filesystem_t fs;
+    ASSERT_EQ(new_filesystem(&fs, 70000, 16), SUCCESS);
+
+    FILE *file = tmpfile();
+    ASSERT_NE(file, nullptr);
+    ASSERT_EQ(save_filesystem(file, &fs), SUCCESS);
+    std::vector<char> image(ftell(file));
+    rewind(file);
+    ASSERT_EQ(fread(image.data(), 1, image.size(), file), image.size());
+    image.erase(image.begin(), image.begin() + 8);
+    rewind(file);
+    fwrite(image.data(), 1, image.size(), file);
+    rewind(file);
+
+    filesystem_t loaded;
+    ASSERT_EQ(load_filesystem(file, &loaded), INVALID_BINARY_FORMAT);
+    fclose(file);
+    free_filesystem(&fs);
+}
@@ -0,0 +1,202 @@
+#include "test_util.hpp"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using ReaddirSuite = fs_internal_test;
+
+// the names read from a directory, in order
+static std::vector<std::string> read_names(fs_dir_t dir)
+{
+    std::vector<std::string> names;
+    fs_dirent_t entry;
+    while (fs_readdir(dir, &entry))
+    {
+        EXPECT_EQ( entry.name_len, strlen(entry.name) );
+        names.emplace_back(entry.name);
+    }
+    return names;
+}
+
+TEST_F(ReaddirSuite, InvalidInput)
+{
+    filesystem_t fs;
+    load_fs(INPUT "medium.bin", fs);
+    terminal_context_t ctx { &fs, &fs.inodes[0] };
+    fs_dir_t ret0, ret1;
+    fs_dirent_t entry;
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ret0 = fs_opendir(NULL, PATH("."));
+        ret1 = fs_opendir(&ctx, NULL);
+        ASSERT_EQ( fs_readdir(NULL, &entry), 0 );
+        fs_closedir(NULL);
+    }   // end stdout logging
+
+    ASSERT_EQ( ret0, nullptr );
+    ASSERT_EQ( ret1, nullptr );
+    check_stdout(OUTPUT "DirectoryNotFound.txt");
+    free_filesystem(&fs);
+}
+
+// only a directory is opened
+TEST_F(ReaddirSuite, InvalidPath0)
+{
+    filesystem_t fs;
+    load_fs(INPUT "medium.bin", fs);
+    terminal_context_t ctx { &fs, &fs.inodes[0] };
+    fs_dir_t ret;
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ret = fs_opendir(&ctx, PATH("book.txt"));
+    }   // end stdout logging
+
+    ASSERT_EQ( ret, nullptr );
+    check_stdout(OUTPUT "DirectoryNotFound.txt");
+    free_filesystem(&fs);
+}
+
+// the entries come in the order `list` shows them, `.` and `..` included
+TEST_F(ReaddirSuite, Readdir0)
+{
+    filesystem_t fs;
+    load_fs(INPUT "medium.bin", fs);
+    terminal_context_t ctx { &fs, &fs.inodes[0] };
+    fs_dir_t dir;
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        dir = fs_opendir(&ctx, PATH("./"));
+    }   // end stdout logging
+
+    ASSERT_NE( dir, nullptr );
+    std::vector<std::string> expected{ ".", "a", "book.txt", "book2.txt" };
+    ASSERT_EQ( read_names(dir), expected );
+    fs_dirent_t entry;
+    ASSERT_EQ( fs_readdir(dir, &entry), 0 ) << "The end of a directory stays its end.";
+    fs_closedir(dir);
+
+    check_stdout(OUTPUT "Empty.txt");
+    check_fs(INPUT "medium.bin", fs);
+    free_filesystem(&fs);
+}
+
+// tombstones are skipped, a directory spanning several dblocks is read to its end, and a
+// reader can stop early
+TEST_F(ReaddirSuite, Readdir1)
+{
+    filesystem_t fs;
+    terminal_context_t ctx;
+    std::vector<std::string> names;
+    fs_dirent_t first;
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ASSERT_EQ( new_filesystem(&fs, 64, 256), SUCCESS );
+        new_terminal(&fs, &ctx);
+        ASSERT_EQ( new_directory(&ctx, PATH("dir")), 0 );
+        for (size_t i = 0; i < 40; ++i)
+        {
+            std::string path = "dir/f" + std::to_string(i);
+            ASSERT_EQ( new_file(&ctx, path.data(), FS_READ), 0 );
+        }
+        for (size_t i = 1; i < 40; i += 3)
+        {
+            std::string path = "dir/f" + std::to_string(i);
+            ASSERT_EQ( remove_file(&ctx, path.data()), 0 );
+        }
+
+        fs_dir_t dir = fs_opendir(&ctx, PATH("dir"));
+        ASSERT_NE( dir, nullptr );
+        names = read_names(dir);
+        fs_closedir(dir);
+
+        dir = fs_opendir(&ctx, PATH("dir/.."));
+        ASSERT_NE( dir, nullptr );
+        ASSERT_EQ( fs_readdir(dir, &first), 1 );
+        fs_closedir(dir);
+    }   // end stdout logging
+
+    check_stdout(OUTPUT "Empty.txt");
+    std::vector<std::string> expected{ ".", ".." };
+    for (size_t i = 0; i < 40; ++i) if (i % 3 != 1) expected.push_back("f" + std::to_string(i));
+    ASSERT_EQ( names, expected );
+    ASSERT_STREQ( first.name, "." );
+    ASSERT_EQ( first.inode, 0u );
+    ASSERT_EQ( first.type, DIRECTORY );
+    free_filesystem(&fs);
+}
+
+// a sorted directory is read in name order
+TEST_F(ReaddirSuite, Sorted0)
+{
+    filesystem_t fs;
+    terminal_context_t ctx;
+    std::vector<std::string> names;
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ASSERT_EQ( new_filesystem(&fs, 128, 512), SUCCESS );
+        new_terminal(&fs, &ctx);
+        ASSERT_EQ( new_directory(&ctx, PATH("dir")), 0 );
+        ASSERT_EQ( fs_sort_directory(&ctx, PATH("dir")), 0 );
+        for (size_t i = 100; i-- > 0; )
+        {
+            std::string path = "dir/f" + std::to_string(i);
+            ASSERT_EQ( new_file(&ctx, path.data(), FS_READ), 0 );
+        }
+        ASSERT_EQ( remove_file(&ctx, PATH("dir/f50")), 0 );
+
+        fs_dir_t dir = fs_opendir(&ctx, PATH("dir"));
+        ASSERT_NE( dir, nullptr );
+        names = read_names(dir);
+        fs_closedir(dir);
+    }   // end stdout logging
+
+    check_stdout(OUTPUT "Empty.txt");
+    ASSERT_EQ( names.size(), 2u + 99 );
+    ASSERT_TRUE( std::is_sorted(names.begin(), names.end()) );
+    ASSERT_EQ( std::find(names.begin(), names.end(), "f50"), names.end() );
+    free_filesystem(&fs);
+}
+
+// the entries of a file system of more than 65,536 inodes are read in their wide format,
+// whole dblocks at a time and in name order when sorted
+TEST_F(ReaddirSuite, Wide0)
+{
+    filesystem_t fs;
+    terminal_context_t ctx;
+    std::vector<std::string> linear, sorted;
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ASSERT_EQ( new_filesystem(&fs, 70000, 512), SUCCESS );
+        new_terminal(&fs, &ctx);
+        ASSERT_EQ( new_directory(&ctx, PATH("dir")), 0 );
+        ASSERT_EQ( new_directory(&ctx, PATH("sorted")), 0 );
+        ASSERT_EQ( fs_sort_directory(&ctx, PATH("sorted")), 0 );
+        for (size_t i = 100; i-- > 0; )
+        {
+            std::string name = "f" + std::to_string(i);
+            ASSERT_EQ( new_file(&ctx, ("dir/" + name).data(), FS_READ), 0 );
+            ASSERT_EQ( new_file(&ctx, ("sorted/" + name).data(), FS_READ), 0 );
+        }
+
+        fs_dir_t dir = fs_opendir(&ctx, PATH("dir"));
+        ASSERT_NE( dir, nullptr );
+        linear = read_names(dir);
+        fs_closedir(dir);
+        dir = fs_opendir(&ctx, PATH("sorted"));
+        ASSERT_NE( dir, nullptr );
+        sorted = read_names(dir);
+        fs_closedir(dir);
+    }   // end stdout logging
+
+    check_stdout(OUTPUT "Empty.txt");
+    std::vector<std::string> expected{ ".", ".." };
+    for (size_t i = 100; i-- > 0; ) expected.push_back("f" + std::to_string(i));
+    ASSERT_EQ( linear, expected );
+    ASSERT_EQ( sorted.size(), expected.size() );
+    ASSERT_TRUE( std::is_sorted(sorted.begin(), sorted.end()) );
+    free_filesystem(&fs);
+}
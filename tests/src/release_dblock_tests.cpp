@@ -24,7 +24,7 @@ TEST_F(ReleaseDBlockSuite, SimpleReleaseDBlock0)
     filesystem_t fs;
     load_fs(INPUT "medium.bin", fs);
 
-    auto output_retcode = release_dblock(&fs, &fs.dblocks[dblock_to_free * DATA_BLOCK_SIZE]);
+    auto output_retcode = release_dblock(&fs, &fs.dblocks[dblock_to_free * DATA_BLOCK_SIZE(&fs)]);
 
     ASSERT_EQ(output_retcode, expected_retcode) << "Return value do not match!";
 
@@ -45,10 +45,42 @@ TEST_F(ReleaseDBlockSuite, ComplexReleaseDBlock0)
     for (auto&& idx : dblocks_to_release)
     {
         fs_retcode_t expected_retcode = SUCCESS;
-        fs_retcode_t output_retcode = release_dblock(&fs, &fs.dblocks[idx * DATA_BLOCK_SIZE]);
+        fs_retcode_t output_retcode = release_dblock(&fs, &fs.dblocks[idx * DATA_BLOCK_SIZE(&fs)]);
         ASSERT_EQ(output_retcode, expected_retcode) << "Return value do not match for releasing D-block index " << idx << "!";
     }
 
     check_fs(OUTPUT "ComplexReleaseDBlock0.bin", fs);
     free_filesystem(&fs);
-}
\ No newline at end of file
+}
+// batched release, invalid input leaves the file system untouched
+TEST_F(ReleaseDBlockSuite, ReleaseDBlocksInvalidInput)
+{
+    dblock_index_t indices[] = { 2, 1000000 };
+
+    filesystem_t fs;
+    load_fs(INPUT "empty_random_inode_fragmented.bin", fs);
+
+    ASSERT_EQ(release_dblocks(NULL, indices, 1), INVALID_INPUT);
+    ASSERT_EQ(release_dblocks(&fs, NULL, 1), INVALID_INPUT);
+    ASSERT_EQ(release_dblocks(&fs, NULL, 0), SUCCESS);
+    ASSERT_EQ(release_dblocks(&fs, indices, 2), INVALID_INPUT) << "Index outside of the file system must be rejected.";
+
+    check_fs(INPUT "empty_random_inode_fragmented.bin", fs);
+    free_filesystem(&fs);
+}
+
+// batched release matches releasing one by one
+TEST_F(ReleaseDBlockSuite, ComplexReleaseDBlocks0)
+{   
+    dblock_index_t dblocks_to_release[] = { 
+        27, 10, 23, 13, 30, 2
+    };
+
+    filesystem_t fs;
+    load_fs(INPUT "empty_random_inode_fragmented.bin", fs);
+
+    ASSERT_EQ(release_dblocks(&fs, dblocks_to_release, std::size(dblocks_to_release)), SUCCESS);
+
+    check_fs(OUTPUT "ComplexReleaseDBlock0.bin", fs);
+    free_filesystem(&fs);
+}
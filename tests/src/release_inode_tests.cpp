@@ -69,4 +69,25 @@ TEST_F(ReleaseINodeSuite, ComplexReleaseINode0)
 
     check_fs(OUTPUT "ComplexReleaseINode0.bin", fs);
     free_filesystem(&fs);
-}
\ No newline at end of file
+}
+// releasing the inodes in one batch leaves the same free list as releasing them one by one
+TEST_F(ReleaseINodeSuite, ComplexReleaseINodes0)
+{
+    const inode_index_t inodes_to_release_list[] = {
+        30, 29, 28, 26, 24, 23, 22, 20,
+        19, 16, 14, 13, 10, 9, 8, 7,
+        6, 5, 3, 2, 1
+    };
+    const inode_index_t invalid_list[] = { 3, 0 };
+
+    filesystem_t fs;
+    load_fs(INPUT "half_random_inode_fragmented.bin", fs);
+
+    ASSERT_EQ( release_inodes(&fs, invalid_list, 2), INVALID_INPUT ) << "The root cannot be released.";
+    ASSERT_EQ( release_inodes(&fs, inodes_to_release_list, 0), SUCCESS );
+    auto output_retcode = release_inodes(&fs, inodes_to_release_list, sizeof(inodes_to_release_list) / sizeof(inode_index_t));
+    ASSERT_EQ(output_retcode, SUCCESS) << "Return value do not match!";
+
+    check_fs(OUTPUT "ComplexReleaseINode0.bin", fs);
+    free_filesystem(&fs);
+}
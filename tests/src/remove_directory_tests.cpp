@@ -205,4 +205,33 @@ TEST_F(RemoveDirectorySuite, RemoveDir1)
     check_stdout(OUTPUT "Empty.txt");
     check_fs(OUTPUT "RemoveDir1.bin", fs);
     free_filesystem(&fs);
-}
\ No newline at end of file
+}
+// a directory made and removed again gives back its inode, its dblock and its entry
+TEST_F(RemoveDirectorySuite, RemoveDir2)
+{
+    constexpr size_t inode_index = 0;
+    constexpr const char *path = "a/b/c/new";
+
+    filesystem_t fs;
+    load_fs(INPUT "medium.bin", fs);
+    int ret0, ret1;
+
+    terminal_context_t ctx { &fs, &fs.inodes[inode_index] };
+    size_t inodes = available_inodes(&fs);
+    size_t dblocks = available_dblocks(&fs);
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ret0 = new_directory(&ctx, PATH(path));
+        ret1 = remove_directory(&ctx, PATH(path));
+    }   // end stdout logging
+
+    ASSERT_EQ(ret0, 0) << "Incorrect return value";
+    ASSERT_EQ(ret1, 0) << "Incorrect return value";
+
+    check_stdout(OUTPUT "Empty.txt");
+    ASSERT_EQ(fs.inodes[3].internal.file_size, 2 * DIRECTORY_ENTRY_SIZE(&fs)) << "The entry of the removed directory is cut off.";
+    ASSERT_EQ(available_inodes(&fs), inodes);
+    ASSERT_EQ(available_dblocks(&fs), dblocks);
+    free_filesystem(&fs);
+}
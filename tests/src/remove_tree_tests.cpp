@@ -0,0 +1,175 @@
+#include "test_util.hpp"
+
+#include <string>
+#include <vector>
+
+extern "C"
+{
+    #include "block_map.h"
+    #include "checksum.h"
+}
+
+using RemoveTreeSuite = fs_internal_test;
+
+TEST_F(RemoveTreeSuite, InvalidInput)
+{
+    constexpr int expected_ret = 0;
+    // dummy data for testing
+    terminal_context_t ctx{
+        (filesystem_t*) 0x12345678,
+        (inode_t*) 0x87654321
+    };
+
+    int ret0, ret1;
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+
+        ret0 = remove_tree(NULL, PATH("a"));
+        ret1 = remove_tree(&ctx, NULL);
+    }   // end stdout logging
+
+    ASSERT_EQ(ret0, expected_ret) << "Incorrect return value for null context argument.";
+    ASSERT_EQ(ret1, expected_ret) << "Incorrect return value for null path argument.";
+
+    check_stdout(OUTPUT "Empty.txt");
+}
+
+// the working directory cannot be removed with the directory holding it
+TEST_F(RemoveTreeSuite, InvalidPath0)
+{
+    filesystem_t fs;
+    load_fs(INPUT "medium.bin", fs);
+    terminal_context_t ctx { &fs, &fs.inodes[3] };
+    int ret;
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ret = remove_tree(&ctx, PATH("../.."));
+    }   // end stdout logging
+
+    ASSERT_EQ(ret, -1) << "Incorrect return value";
+    check_stdout(OUTPUT "InvalidFilename.txt");
+    free_filesystem(&fs);
+}
+
+TEST_F(RemoveTreeSuite, InvalidPath1)
+{
+    filesystem_t fs;
+    load_fs(INPUT "medium.bin", fs);
+    terminal_context_t ctx { &fs, &fs.inodes[3] };
+    int ret;
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ret = remove_tree(&ctx, PATH("../../../a"));
+    }   // end stdout logging
+
+    ASSERT_EQ(ret, -1) << "Incorrect return value";
+    check_stdout(OUTPUT "AttemptDeleteCWD.txt");
+    free_filesystem(&fs);
+}
+
+TEST_F(RemoveTreeSuite, InvalidPath2)
+{
+    filesystem_t fs;
+    load_fs(INPUT "medium.bin", fs);
+    terminal_context_t ctx { &fs, &fs.inodes[0] };
+    int ret;
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ret = remove_tree(&ctx, PATH("a/missing"));
+    }   // end stdout logging
+
+    ASSERT_EQ(ret, -1) << "Incorrect return value";
+    check_stdout(OUTPUT "ObjectNotFound.txt");
+    free_filesystem(&fs);
+}
+
+// a subtree of every kind of directory, and files with data, gives back every inode and
+// dblock it took, and the same tree can be made again
+TEST_F(RemoveTreeSuite, RemoveTree0)
+{
+    filesystem_t fs;
+    ASSERT_EQ( new_filesystem(&fs, 400, 2048), SUCCESS );
+    terminal_context_t ctx;
+    new_terminal(&fs, &ctx);
+    std::vector<std::string> manifest{ "keep/file", "top/a/b/c/", "top/a/f", "top/sorted/", "top/sorted/x" };
+    for (size_t i = 0; i < 100; ++i) manifest.push_back("top/large/f" + std::to_string(i));
+    std::vector<char*> paths;
+    for (std::string& path : manifest) paths.push_back(path.data());
+    std::vector<byte> data(1000, 'x');
+    size_t inodes, dblocks;
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ASSERT_EQ( new_directory(&ctx, PATH("keep")), 0 );
+        inodes = available_inodes(&fs);
+        dblocks = available_dblocks(&fs);
+        for (int round = 0; round < 2; ++round)
+        {
+            ASSERT_EQ( fs_import_manifest(&ctx, paths.data() + 1, paths.size() - 1, FS_READ), 0 );
+            ASSERT_EQ( fs_sort_directory(&ctx, PATH("top/sorted")), 0 );
+            fs_file_t file = fs_open(&ctx, PATH("top/a/f"));
+            ASSERT_NE( file, nullptr );
+            ASSERT_EQ( fs_write(file, data.data(), data.size()), data.size() );
+            fs_close(file);
+            ASSERT_EQ( change_directory(&ctx, PATH("top/a")), 0 );
+            ASSERT_EQ( remove_tree(&ctx, PATH("../../top")), -1 );
+            ASSERT_EQ( change_directory(&ctx, PATH("../..")), 0 );
+            ASSERT_EQ( remove_tree(&ctx, PATH("top")), 0 );
+            ASSERT_EQ( available_inodes(&fs), inodes );
+            ASSERT_EQ( available_dblocks(&fs), dblocks );
+        }
+        ASSERT_EQ( fs_import_manifest(&ctx, paths.data(), 1, FS_READ), 0 );
+        ASSERT_EQ( remove_tree(&ctx, PATH("keep/file")), 0 );
+        ASSERT_EQ( list(&ctx, PATH(".")), 0 );
+    }   // end stdout logging
+
+    check_stdout(OUTPUT "RemoveTree0.txt");
+    free_filesystem(&fs);
+}
+
+// a directory whose entries cannot be read fails the removal before anything is released,
+// so the objects behind the corrupted dblock are not leaked
+TEST_F(RemoveTreeSuite, CorruptedDirectory0)
+{
+    filesystem_t fs;
+    ASSERT_EQ( new_filesystem(&fs, 64, 256), SUCCESS );
+    ASSERT_EQ( fs_enable_checksums(&fs), SUCCESS );
+    terminal_context_t ctx;
+    new_terminal(&fs, &ctx);
+    std::vector<std::string> manifest;
+    for (size_t i = 0; i < 40; ++i) manifest.push_back("top/f" + std::to_string(i));
+    std::vector<char*> paths;
+    for (std::string& path : manifest) paths.push_back(path.data());
+    size_t inodes, dblocks;
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ASSERT_EQ( fs_import_manifest(&ctx, paths.data(), paths.size(), FS_READ), 0 );
+    }   // end stdout logging
+    check_stdout(OUTPUT "Empty.txt");
+
+    // the only object of the root, so it took the first free inode
+    inode_t *top = &fs.inodes[1];
+    ASSERT_EQ( top->internal.file_type, DIRECTORY );
+    ASSERT_GT( top->internal.file_size, DATA_BLOCK_SIZE(&fs) );
+    block_cursor_t cursor;
+    block_cursor_seek(&fs, top, &cursor, 1);
+    fs.dblocks[(size_t) block_cursor_dblock(&fs, top, &cursor) * DATA_BLOCK_SIZE(&fs)] ^= 0x10;
+    inodes = available_inodes(&fs);
+    dblocks = available_dblocks(&fs);
+
+    int ret;
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ret = remove_tree(&ctx, PATH("top"));
+    }   // end stdout logging
+
+    ASSERT_EQ( ret, -1 );
+    check_stdout(OUTPUT "ChecksumMismatch.txt");
+    ASSERT_EQ( available_inodes(&fs), inodes );
+    ASSERT_EQ( available_dblocks(&fs), dblocks );
+    free_filesystem(&fs);
+}
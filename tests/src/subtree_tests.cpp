@@ -0,0 +1,324 @@
+#include "test_util.hpp"
+
+#include <string>
+#include <vector>
+
+extern "C"
+{
+    #include "checksum.h"
+    #include "compress.h"
+    #include "subtree.h"
+}
+
+using SubtreeSuite = fs_internal_test;
+
+// a directory tree `levels` deep below the root where every directory holds `fanout`
+// directories and `files` data files of `file_size` bytes
+static constexpr size_t levels = 2;
+static constexpr size_t fanout = 3;
+static constexpr size_t files = 3;
+static constexpr size_t file_size = 100;
+
+static void make_tree(terminal_context_t *ctx, const std::string& dir, size_t level)
+{
+    for (size_t f = 0; f < files; ++f)
+    {
+        std::string path = dir + "/f" + std::to_string(f);
+        ASSERT_EQ( new_file(ctx, path.data(), (permission_t) (FS_READ | FS_WRITE)), 0 );
+        fs_file_t file = fs_open(ctx, path.data());
+        ASSERT_NE( file, nullptr );
+        ASSERT_EQ( fs_write(file, std::string(file_size, 'x').data(), file_size), file_size );
+        fs_close(file);
+    }
+    if (level == levels) return;
+    for (size_t d = 0; d < fanout; ++d)
+    {
+        std::string path = dir + "/d" + std::to_string(d);
+        ASSERT_EQ( new_directory(ctx, path.data()), 0 );
+        make_tree(ctx, path, level + 1);
+    }
+}
+
+// the kept totals of every object in the tree are the ones a fresh walk finds, and `du`
+// answers the same with them and without them
+static void check_totals(terminal_context_t *ctx, const char *path)
+{
+    filesystem_t *fs = ctx->fs;
+    ASSERT_NE( fs->subtrees, nullptr );
+    std::vector<subtree> kept(fs->subtrees, fs->subtrees + fs->inode_count);
+    du_report_t instant, walked;
+    ASSERT_EQ( fs_du(ctx, std::string{ path }.data(), &instant), 0 );
+
+    fs_disable_subtree_totals(fs);
+    ASSERT_EQ( fs_du(ctx, std::string{ path }.data(), &walked), 0 );
+    ASSERT_EQ( fs_enable_subtree_totals(fs), SUCCESS );
+    for (size_t i = 0; i < fs->inode_count; ++i)
+    {
+        const subtree& fresh = fs->subtrees[i];
+        if (fresh.total_files + fresh.total_directories == 0) continue;
+        ASSERT_EQ( kept[i].parent, fresh.parent ) << "inode " << i;
+        ASSERT_EQ( kept[i].bytes, fresh.bytes ) << "inode " << i;
+        ASSERT_EQ( kept[i].dblocks, fresh.dblocks ) << "inode " << i;
+        ASSERT_EQ( kept[i].total_files, fresh.total_files ) << "inode " << i;
+        ASSERT_EQ( kept[i].total_directories, fresh.total_directories ) << "inode " << i;
+        ASSERT_EQ( kept[i].total_bytes, fresh.total_bytes ) << "inode " << i;
+        ASSERT_EQ( kept[i].total_dblocks, fresh.total_dblocks ) << "inode " << i;
+    }
+
+    ASSERT_EQ( instant.files, walked.files ) << path;
+    ASSERT_EQ( instant.directories, walked.directories ) << path;
+    ASSERT_EQ( instant.bytes, walked.bytes ) << path;
+    ASSERT_EQ( instant.dblocks, walked.dblocks ) << path;
+}
+
+TEST_F(SubtreeSuite, InvalidInput)
+{
+    ASSERT_EQ( fs_enable_subtree_totals(NULL), INVALID_INPUT );
+    fs_disable_subtree_totals(NULL);
+}
+
+// every dblock the tree holds is counted, and nothing else is
+TEST_F(SubtreeSuite, Enable0)
+{
+    filesystem_t fs;
+    terminal_context_t ctx;
+    du_report_t report;
+    int ret;
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ASSERT_EQ( new_filesystem(&fs, 64, 512), SUCCESS );
+        new_terminal(&fs, &ctx);
+        make_tree(&ctx, ".", 0);
+        ASSERT_EQ( fs_enable_subtree_totals(&fs), SUCCESS );
+        ASSERT_EQ( fs_enable_subtree_totals(&fs), SUCCESS );
+        ret = fs_du(&ctx, PATH("."), &report);
+    }   // end stdout logging
+
+    ASSERT_EQ(ret, 0) << "Incorrect return value";
+    check_stdout(OUTPUT "Empty.txt");
+    ASSERT_EQ( report.directories, 1u + 3 + 9 );
+    ASSERT_EQ( report.files, 13 * files );
+    ASSERT_EQ( report.dblocks, fs.dblock_count - available_dblocks(&fs) );
+    fs_disable_subtree_totals(&fs);
+    ASSERT_EQ( fs.subtrees, nullptr );
+    free_filesystem(&fs);
+}
+
+// the totals follow writes, shrinks, creations, removals and moves
+TEST_F(SubtreeSuite, Update0)
+{
+    filesystem_t fs;
+    terminal_context_t ctx;
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ASSERT_EQ( new_filesystem(&fs, 128, 1024), SUCCESS );
+        new_terminal(&fs, &ctx);
+        make_tree(&ctx, ".", 0);
+        ASSERT_EQ( fs_enable_subtree_totals(&fs), SUCCESS );
+        check_totals(&ctx, ".");
+
+        // a file grown past its direct blocks takes index dblocks too
+        fs_file_t file = fs_open(&ctx, PATH("d1/d2/f0"));
+        ASSERT_NE( file, nullptr );
+        ASSERT_EQ( fs_seek(file, FS_SEEK_END, 0), 0 );
+        size_t grown = (INODE_DIRECT_BLOCK_COUNT + 3) * DATA_BLOCK_SIZE(&fs);
+        ASSERT_EQ( fs_write(file, std::string(grown, 'y').data(), grown), grown );
+        check_totals(&ctx, "d1");
+        ASSERT_EQ( inode_shrink_data(&fs, file->inode, DATA_BLOCK_SIZE(&fs) + 1), SUCCESS );
+        fs_close(file);
+        check_totals(&ctx, "d1/d2");
+
+        ASSERT_EQ( new_directory(&ctx, PATH("d0/d0/new")), 0 );
+        ASSERT_EQ( new_file(&ctx, PATH("d0/d0/new/file"), FS_READ), 0 );
+        check_totals(&ctx, "d0");
+        ASSERT_EQ( remove_file(&ctx, PATH("d0/d1/f2")), 0 );
+        ASSERT_EQ( remove_file(&ctx, PATH("d0/d0/new/file")), 0 );
+        ASSERT_EQ( remove_directory(&ctx, PATH("d0/d0/new")), 0 );
+        check_totals(&ctx, "d0");
+
+        ASSERT_EQ( fs_copy(&ctx, PATH("d2/f1"), PATH("d0/copy")), 0 );
+        ASSERT_EQ( fs_rename(&ctx, PATH("d2/d1"), PATH("d0/d1/moved")), 0 );
+        ASSERT_EQ( fs_rename(&ctx, PATH("d0/f0"), PATH("d0/renamed")), 0 );
+        check_totals(&ctx, "d0/d1");
+        ASSERT_EQ( remove_tree(&ctx, PATH("d0/d1")), 0 );
+        ASSERT_EQ( remove_tree(&ctx, PATH("d1/f1")), 0 );
+        check_totals(&ctx, ".");
+    }   // end stdout logging
+
+    check_stdout(OUTPUT "Empty.txt");
+    free_filesystem(&fs);
+}
+
+// the nodes of sorted directories are counted as they split and as the tree is rebuilt
+TEST_F(SubtreeSuite, Sorted0)
+{
+    filesystem_t fs;
+    terminal_context_t ctx;
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ASSERT_EQ( new_filesystem(&fs, 512, 2048), SUCCESS );
+        new_terminal(&fs, &ctx);
+        make_tree(&ctx, ".", 0);
+        ASSERT_EQ( fs_enable_subtree_totals(&fs), SUCCESS );
+        ASSERT_EQ( fs_sort_directory(&ctx, PATH("d1")), 0 );
+        check_totals(&ctx, "d1");
+        for (size_t i = 0; i < 300; ++i)
+        {
+            std::string path = "d1/s" + std::to_string(i);
+            ASSERT_EQ( new_file(&ctx, path.data(), FS_READ), 0 );
+        }
+        check_totals(&ctx, ".");
+        for (size_t i = 0; i < 300; i += 2)
+        {
+            std::string path = "d1/s" + std::to_string(i);
+            ASSERT_EQ( remove_file(&ctx, path.data()), 0 );
+        }
+        ASSERT_EQ( fs_compact(&ctx, PATH("d1")), 0 );
+        check_totals(&ctx, ".");
+        ASSERT_EQ( remove_tree(&ctx, PATH("d1")), 0 );
+        check_totals(&ctx, ".");
+    }   // end stdout logging
+
+    check_stdout(OUTPUT "Empty.txt");
+    free_filesystem(&fs);
+}
+
+// compressing a file changes what it holds
+TEST_F(SubtreeSuite, Compress0)
+{
+    filesystem_t fs;
+    terminal_context_t ctx;
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ASSERT_EQ( new_filesystem(&fs, 64, 512), SUCCESS );
+        new_terminal(&fs, &ctx);
+        make_tree(&ctx, ".", 0);
+        ASSERT_EQ( fs_enable_subtree_totals(&fs), SUCCESS );
+        fs_file_t file = fs_open(&ctx, PATH("d2/d0/f2"));
+        ASSERT_NE( file, nullptr );
+        ASSERT_EQ( fs_seek(file, FS_SEEK_END, 0), 0 );
+        size_t grown = 8 * DATA_BLOCK_SIZE(&fs);
+        ASSERT_EQ( fs_write(file, std::string(grown, 'z').data(), grown), grown );
+        ASSERT_EQ( inode_compress_data(&fs, file->inode), SUCCESS );
+        check_totals(&ctx, "d2");
+        ASSERT_EQ( inode_decompress_data(&fs, file->inode), SUCCESS );
+        fs_close(file);
+        check_totals(&ctx, "d2");
+    }   // end stdout logging
+
+    check_stdout(OUTPUT "Empty.txt");
+    free_filesystem(&fs);
+}
+
+// the totals are saved with the image and loaded back
+TEST_F(SubtreeSuite, SaveLoad0)
+{
+    filesystem_t fs, loaded;
+    terminal_context_t ctx;
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ASSERT_EQ( new_filesystem(&fs, 64, 512), SUCCESS );
+        ASSERT_EQ( fs_enable_checksums(&fs), SUCCESS );
+        new_terminal(&fs, &ctx);
+        make_tree(&ctx, ".", 0);
+        ASSERT_EQ( fs_enable_subtree_totals(&fs), SUCCESS );
+
+        FILE *file = tmpfile();
+        ASSERT_NE( file, nullptr );
+        ASSERT_EQ( save_filesystem(file, &fs), SUCCESS );
+        rewind(file);
+        ASSERT_EQ( load_filesystem(file, &loaded), SUCCESS );
+        fclose(file);
+        ASSERT_NE( loaded.dblock_checksums, nullptr );
+        ASSERT_NE( loaded.subtrees, nullptr );
+        ASSERT_EQ( memcmp(loaded.subtrees, fs.subtrees, fs.inode_count * sizeof(subtree)), 0 );
+
+        new_terminal(&loaded, &ctx);
+        ASSERT_EQ( remove_tree(&ctx, PATH("d1")), 0 );
+        check_totals(&ctx, ".");
+    }   // end stdout logging
+
+    check_stdout(OUTPUT "Empty.txt");
+    free_filesystem(&fs);
+    free_filesystem(&loaded);
+}
+
+// an image saved without totals loads without them
+TEST_F(SubtreeSuite, SaveLoad1)
+{
+    filesystem_t fs;
+    load_fs(INPUT "medium.bin", fs);
+    ASSERT_EQ( fs.subtrees, nullptr );
+    ASSERT_EQ( fs_enable_subtree_totals(&fs), SUCCESS );
+    fs_disable_subtree_totals(&fs);
+    check_fs(INPUT "medium.bin", fs);
+    free_filesystem(&fs);
+}
+
+// a saved table linking an inode to something other than a directory is counted again
+TEST_F(SubtreeSuite, SaveLoad2)
+{
+    filesystem_t fs, loaded;
+    terminal_context_t ctx;
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ASSERT_EQ( new_filesystem(&fs, 64, 512), SUCCESS );
+        new_terminal(&fs, &ctx);
+        make_tree(&ctx, ".", 0);
+        ASSERT_EQ( fs_enable_subtree_totals(&fs), SUCCESS );
+        std::vector<subtree> kept(fs.subtrees, fs.subtrees + fs.inode_count);
+
+        // one entry names a data file, the other an inode past the table
+        inode_index_t data_file = 0, directory = 0;
+        for (size_t i = 1; i < fs.inode_count; ++i)
+        {
+            if (fs.subtrees[i].parent == 0) continue;
+            if (!data_file && fs.inodes[i].internal.file_type == DATA_FILE) data_file = i;
+            else if (!directory && fs.inodes[i].internal.file_type == DIRECTORY) directory = i;
+        }
+        ASSERT_NE( data_file, 0u );
+        ASSERT_NE( directory, 0u );
+        fs.subtrees[directory].parent = data_file + 1;
+        fs.subtrees[data_file].parent = fs.inode_count + 7;
+
+        FILE *file = tmpfile();
+        ASSERT_NE( file, nullptr );
+        ASSERT_EQ( save_filesystem(file, &fs), SUCCESS );
+        rewind(file);
+        ASSERT_EQ( load_filesystem(file, &loaded), SUCCESS );
+        fclose(file);
+        ASSERT_NE( loaded.subtrees, nullptr );
+        ASSERT_EQ( memcmp(loaded.subtrees, kept.data(), fs.inode_count * sizeof(subtree)), 0 );
+    }   // end stdout logging
+
+    check_stdout(OUTPUT "Empty.txt");
+    free_filesystem(&fs);
+    free_filesystem(&loaded);
+}
+
+// an image cut inside its table does not load
+TEST_F(SubtreeSuite, SaveLoad3)
+{
+    filesystem_t fs, loaded;
+    ASSERT_EQ( new_filesystem(&fs, 16, 64), SUCCESS );
+    ASSERT_EQ( fs_enable_subtree_totals(&fs), SUCCESS );
+
+    FILE *file = tmpfile();
+    ASSERT_NE( file, nullptr );
+    ASSERT_EQ( save_filesystem(file, &fs), SUCCESS );
+    long size = ftell(file);
+    std::vector<char> image(size - sizeof(subtree));
+    rewind(file);
+    ASSERT_EQ( fread(image.data(), 1, image.size(), file), image.size() );
+    fclose(file);
+
+    file = tmpfile();
+    ASSERT_NE( file, nullptr );
+    ASSERT_EQ( fwrite(image.data(), 1, image.size(), file), image.size() );
+    rewind(file);
+    ASSERT_EQ( load_filesystem(file, &loaded), INVALID_BINARY_FORMAT );
+    fclose(file);
+    ASSERT_EQ( loaded.inodes, nullptr );
+    ASSERT_EQ( loaded.subtrees, nullptr );
+    free_filesystem(&fs);
+}
@@ -18,6 +18,26 @@ void compare_fs_files(char *output_buf, size_t output_size, char *expected_buf,
     inode_index_t expected_available_inode_index, output_available_inode_index;
 
     size_t index = 0;
+
+    // an image of another geometry starts with it, ahead of the wide magic
+    size_t block_size = DEFAULT_DATA_BLOCK_SIZE;
+    if (expected_size >= 16 && memcmp(expected_buf, "GEOMETRY", 8) == 0)
+    {
+        ASSERT_EQ(memcmp(output_buf, expected_buf, 16), 0) << "Incorrect block geometry of the filesystem.";
+        uint32_t geometry;
+        memcpy(&geometry, &expected_buf[8], sizeof(geometry));
+        block_size = geometry;
+        index += 16;
+    }
+
+    // a wide image starts with its magic and holds 4 byte indices
+    size_t index_width = NARROW_INODE_INDEX_WIDTH;
+    if (expected_size >= index + 8 && memcmp(&expected_buf[index], "FSWIDE32", 8) == 0)
+    {
+        ASSERT_EQ(memcmp(&output_buf[index], "FSWIDE32", 8), 0) << "Incorrect inode index width of the filesystem.";
+        index_width = WIDE_INODE_INDEX_WIDTH;
+        index += 8;
+    }
     
     // compare the inode counts
     memcpy(&output_inode_count, &output_buf[index], sizeof(size_t));
@@ -26,9 +46,10 @@ void compare_fs_files(char *output_buf, size_t output_size, char *expected_buf,
     ASSERT_EQ(output_inode_count, expected_inode_count) << "Incorrect inode count in filesystem.";
 
     // compare the next available inode
-    memcpy(&output_available_inode_index, &output_buf[index], sizeof(inode_index_t));
-    memcpy(&expected_available_inode_index, &expected_buf[index], sizeof(inode_index_t));
-    index += sizeof(inode_index_t);
+    output_available_inode_index = expected_available_inode_index = 0;
+    memcpy(&output_available_inode_index, &output_buf[index], index_width);
+    memcpy(&expected_available_inode_index, &expected_buf[index], index_width);
+    index += index_width;
     ASSERT_EQ(output_available_inode_index, expected_available_inode_index) << "Incorrect first available inode index.";
 
     // compare the dblock
@@ -60,7 +81,7 @@ void compare_fs_files(char *output_buf, size_t output_size, char *expected_buf,
     // now compare the data blocks
     for (size_t dblock_idx = 0; dblock_idx < expected_dblock_count; ++dblock_idx)
     {
-        for (size_t dblock_byte = 0; dblock_byte < DATA_BLOCK_SIZE; ++dblock_byte)
+        for (size_t dblock_byte = 0; dblock_byte < block_size; ++dblock_byte)
         {
             ASSERT_EQ(output_buf[index], expected_buf[index])
                 << "Incorrect value for byte " << dblock_byte << " at data block index " << dblock_idx;
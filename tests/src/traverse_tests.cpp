@@ -0,0 +1,247 @@
+#include "test_util.hpp"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+extern "C"
+{
+    #include "traverse.h"
+}
+
+using TraverseSuite = fs_internal_test;
+
+// a directory tree `levels` deep below the root where every directory holds `fanout`
+// directories and `files` data files of `file_size` bytes
+static constexpr size_t levels = 3;
+static constexpr size_t fanout = 4;
+static constexpr size_t files = 3;
+static constexpr size_t file_size = 10;
+static constexpr size_t directory_count = 1 + 4 + 16 + 64;
+
+static void make_tree(terminal_context_t *ctx, const std::string& dir, size_t level)
+{
+    for (size_t f = 0; f < files; ++f)
+    {
+        std::string path = dir + "/f" + std::to_string(f);
+        ASSERT_EQ( new_file(ctx, path.data(), (permission_t) (FS_READ | FS_WRITE)), 0 );
+        fs_file_t file = fs_open(ctx, path.data());
+        ASSERT_NE( file, nullptr );
+        ASSERT_EQ( fs_write(file, std::string(file_size, 'x').data(), file_size), file_size );
+        fs_close(file);
+    }
+    if (level == levels) return;
+    for (size_t d = 0; d < fanout; ++d)
+    {
+        std::string path = dir + "/d" + std::to_string(d);
+        ASSERT_EQ( new_directory(ctx, path.data()), 0 );
+        make_tree(ctx, path, level + 1);
+    }
+}
+
+static void make_filesystem(filesystem_t *fs, terminal_context_t *ctx)
+{
+    ASSERT_EQ( new_filesystem(fs, 4 * directory_count * (files + 1), 2048), SUCCESS );
+    new_terminal(fs, ctx);
+    make_tree(ctx, ".", 0);
+}
+
+struct visit_counts
+{
+    filesystem_t *fs;
+    std::vector<std::atomic<int>> visits;
+    std::atomic<size_t> threads_seen[TRAVERSE_MAX_THREADS];
+};
+
+// queues the subdirectories of a directory, reading its entries straight from its direct
+// blocks, where all of them fit
+static void count_visit(traverse_worker_t *worker, inode_index_t dir, void *arg)
+{
+    visit_counts *counts = static_cast<visit_counts*>(arg);
+    ++counts->visits[dir];
+    ++counts->threads_seen[traverse_worker_id(worker)];
+    inode_t *inode = &counts->fs->inodes[dir];
+    filesystem_t *fs = counts->fs;
+    for (size_t offset = 2 * DIRECTORY_ENTRY_SIZE(fs); offset < inode->internal.file_size; offset += DIRECTORY_ENTRY_SIZE(fs))
+    {
+        size_t block = offset / DATA_BLOCK_SIZE(fs);
+        if (block >= INODE_DIRECT_BLOCK_COUNT) break;
+        inode_index_t child = 0;
+        byte *data = fs->dblocks + (size_t) inode->internal.direct_data[block] * DATA_BLOCK_SIZE(fs);
+        if (offset % DATA_BLOCK_SIZE(fs) + fs->index_width > DATA_BLOCK_SIZE(fs)) continue;
+        memcpy(&child, data + offset % DATA_BLOCK_SIZE(fs), fs->index_width);
+        if (fs->inodes[child].internal.file_type == DIRECTORY) traverse_push(worker, child);
+    }
+}
+
+TEST_F(TraverseSuite, InvalidInput)
+{
+    filesystem_t fs;
+    ASSERT_EQ( new_filesystem(&fs, 4, 8), SUCCESS );
+    terminal_context_t ctx;
+    new_terminal(&fs, &ctx);
+    ASSERT_EQ( new_file(&ctx, PATH("file"), FS_READ), 0 );
+
+    ASSERT_EQ( fs_traverse(NULL, 0, 1, count_visit, nullptr), INVALID_INPUT );
+    ASSERT_EQ( fs_traverse(&fs, 0, 1, NULL, nullptr), INVALID_INPUT );
+    ASSERT_EQ( fs_traverse(&fs, 1, 1, count_visit, nullptr), INVALID_INPUT ) << "A data file is not walked.";
+    ASSERT_EQ( fs_traverse(&fs, 4, 1, count_visit, nullptr), INVALID_INPUT );
+    free_filesystem(&fs);
+}
+
+// every directory is visited once, whatever the number of threads
+TEST_F(TraverseSuite, Traverse0)
+{
+    filesystem_t fs;
+    terminal_context_t ctx;
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        make_filesystem(&fs, &ctx);
+    }   // end stdout logging
+
+    for (size_t thread_count : { 1, 4, 0 })
+    {
+        visit_counts counts{ &fs, std::vector<std::atomic<int>>(fs.inode_count), {} };
+        ASSERT_EQ( fs_traverse(&fs, 0, thread_count, count_visit, &counts), SUCCESS );
+        size_t visited = 0;
+        for (size_t i = 0; i < fs.inode_count; ++i)
+        {
+            int expected = fs.inodes[i].internal.file_type == DIRECTORY && i < directory_count * (files + 1) ? 1 : 0;
+            ASSERT_EQ( counts.visits[i].load(), expected ) << "inode " << i << " with " << thread_count << " threads";
+            visited += counts.visits[i].load();
+        }
+        ASSERT_EQ( visited, directory_count );
+        for (size_t t = traverse_thread_count(thread_count); t < TRAVERSE_MAX_THREADS; ++t)
+        {
+            ASSERT_EQ( counts.threads_seen[t].load(), 0u );
+        }
+    }
+
+    check_stdout(OUTPUT "Empty.txt");
+    free_filesystem(&fs);
+}
+
+// the tree comes out the same with one thread and with several
+TEST_F(TraverseSuite, Tree0)
+{
+    filesystem_t fs;
+    terminal_context_t ctx;
+    int ret0, ret1;
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        make_filesystem(&fs, &ctx);
+        ASSERT_EQ( fs_rename(&ctx, PATH("d1/d2/f0"), PATH("d3/moved")), 0 );
+        fs.traverse_threads = 1;
+        ret0 = tree(&ctx, PATH("."));
+        fs.traverse_threads = 8;
+        ret1 = tree(&ctx, PATH("."));
+    }   // end stdout logging
+
+    ASSERT_EQ(ret0, 0) << "Incorrect return value";
+    ASSERT_EQ(ret1, 0) << "Incorrect return value";
+
+    // the two trees are the two halves of the output
+    std::string output;
+    rewind(stdout_file);
+    for (int c; (c = fgetc(stdout_file)) != EOF; ) output += (char) c;
+    ASSERT_EQ( output.size() % 2, 0u );
+    std::string first = output.substr(0, output.size() / 2);
+    ASSERT_EQ( first, output.substr(output.size() / 2) );
+    ASSERT_EQ( first.rfind("root\n", 0), 0u );
+    ASSERT_NE( first.find("      moved\n"), std::string::npos );
+    free_filesystem(&fs);
+}
+
+// sizes of a tree and of a single file
+TEST_F(TraverseSuite, Du0)
+{
+    filesystem_t fs;
+    terminal_context_t ctx;
+    du_report_t whole, part, file;
+    int ret0, ret1, ret2;
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        make_filesystem(&fs, &ctx);
+        fs.traverse_threads = 4;
+        ret0 = fs_du(&ctx, PATH("."), &whole);
+        ret1 = fs_du(&ctx, PATH("d2"), &part);
+        ret2 = fs_du(&ctx, PATH("d2/d0/f1"), &file);
+    }   // end stdout logging
+
+    ASSERT_EQ(ret0, 0) << "Incorrect return value";
+    ASSERT_EQ(ret1, 0) << "Incorrect return value";
+    ASSERT_EQ(ret2, 0) << "Incorrect return value";
+    check_stdout(OUTPUT "Empty.txt");
+
+    // the directories above the last level hold `.`, `..`, their files and `fanout`
+    // directories, the last ones only `.`, `..` and their files. the root has no `..`
+    size_t inner_size = (2 + files + fanout) * DIRECTORY_ENTRY_SIZE(&fs);
+    size_t leaf_size = (2 + files) * DIRECTORY_ENTRY_SIZE(&fs);
+    ASSERT_EQ( whole.directories, directory_count );
+    ASSERT_EQ( whole.files, directory_count * files );
+    ASSERT_EQ( whole.bytes, 21 * inner_size - DIRECTORY_ENTRY_SIZE(&fs) + 64 * leaf_size + directory_count * files * file_size );
+    ASSERT_EQ( part.directories, 1u + 4 + 16 );
+    ASSERT_EQ( part.files, (1 + 4 + 16) * files );
+    ASSERT_EQ( part.bytes, 5 * inner_size + 16 * leaf_size + 21 * files * file_size );
+    ASSERT_EQ( file.directories, 0u );
+    ASSERT_EQ( file.files, 1u );
+    ASSERT_EQ( file.bytes, file_size );
+    free_filesystem(&fs);
+}
+
+// matches are shown with the path they were found under, in the order of `tree`
+TEST_F(TraverseSuite, Find0)
+{
+    filesystem_t fs;
+    load_fs(INPUT "medium.bin", fs);
+    terminal_context_t ctx { &fs, &fs.inodes[0] };
+    int ret0, ret1;
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ret0 = fs_find(&ctx, PATH("./"), PATH("*.txt"));
+        ret1 = fs_find(&ctx, PATH("a"), NULL);
+    }   // end stdout logging
+
+    ASSERT_EQ(ret0, 0) << "Incorrect return value";
+    ASSERT_EQ(ret1, 0) << "Incorrect return value";
+    check_stdout(OUTPUT "Find0.txt");
+    check_fs(INPUT "medium.bin", fs);
+    free_filesystem(&fs);
+}
+
+// a pattern without matches
+TEST_F(TraverseSuite, Find1)
+{
+    filesystem_t fs;
+    load_fs(INPUT "medium.bin", fs);
+    terminal_context_t ctx { &fs, &fs.inodes[0] };
+    int ret;
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ret = fs_find(&ctx, PATH("a"), PATH("book*"));
+    }   // end stdout logging
+
+    ASSERT_EQ(ret, -1) << "Incorrect return value";
+    check_stdout(OUTPUT "ObjectNotFound.txt");
+    free_filesystem(&fs);
+}
+
+// only a directory is searched
+TEST_F(TraverseSuite, InvalidPath0)
+{
+    filesystem_t fs;
+    load_fs(INPUT "medium.bin", fs);
+    terminal_context_t ctx { &fs, &fs.inodes[0] };
+    int ret;
+
+    {   // begin stdout logging
+        stdout_logger_lock lk{ this };
+        ret = fs_find(&ctx, PATH("book.txt"), NULL);
+    }   // end stdout logging
+
+    ASSERT_EQ(ret, -1) << "Incorrect return value";
+    check_stdout(OUTPUT "DirectoryNotFound.txt");
+    free_filesystem(&fs);
+}